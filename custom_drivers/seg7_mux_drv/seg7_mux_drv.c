@@ -0,0 +1,424 @@
+#include "seg7_mux_drv.h"
+
+struct seg7drv_private_data seg7drv_data;
+
+/* Glyph of each character, bit 0 is segment A and bit 7 the decimal point (same table as gpio_control) */
+static const u8 seg7_glyphs[128] = {
+    ['0'] = 0x3F, ['1'] = 0x06, ['2'] = 0x5B, ['3'] = 0x4F, ['4'] = 0x66,
+    ['5'] = 0x6D, ['6'] = 0x7D, ['7'] = 0x07, ['8'] = 0x7F, ['9'] = 0x6F,
+    ['A'] = 0x77, ['B'] = 0x7C, ['C'] = 0x39, ['D'] = 0x5E, ['E'] = 0x79, ['F'] = 0x71,
+    ['a'] = 0x77, ['b'] = 0x7C, ['c'] = 0x58, ['d'] = 0x5E, ['e'] = 0x79, ['f'] = 0x71,
+    ['G'] = 0x3D, ['H'] = 0x76, ['h'] = 0x74, ['I'] = 0x06, ['i'] = 0x04, ['J'] = 0x1E,
+    ['L'] = 0x38, ['n'] = 0x54, ['O'] = 0x3F, ['o'] = 0x5C, ['P'] = 0x73, ['r'] = 0x50,
+    ['S'] = 0x6D, ['t'] = 0x78, ['U'] = 0x3E, ['u'] = 0x1C, ['y'] = 0x6E,
+    ['-'] = 0x40, ['_'] = 0x08, ['='] = 0x48, [' '] = 0x00, ['.'] = SEG7_DP
+};
+
+/* File operations of the driver */
+struct file_operations seg7_fops = {
+    .open = seg7_open,
+    .release = seg7_release,
+    .read = seg7_read,
+    .write = seg7_write,
+    .owner = THIS_MODULE
+};
+
+int seg7_set_text(struct seg7dev_private_data* dev_data, const char* text, size_t count){
+
+    u8 glyphs[SEG7_MAX_DIGITS] = {0};
+    int n = 0;
+    int d;
+    size_t i;
+
+    if(count >= SEG7_TEXT_SIZE){
+        return -EINVAL;
+    }
+
+    for(i = 0; i < count && text[i] != '\n' && text[i] != '\0'; i++){
+        /* A dot is the decimal point of the previous digit, "12.34" uses 4 digits */
+        if(text[i] == '.' && n && !(glyphs[n - 1] & SEG7_DP)){
+            glyphs[n - 1] |= SEG7_DP;
+            continue;
+        }
+        if(n == dev_data->num_digits){
+            return -EINVAL;
+        }
+        glyphs[n++] = ((u8)text[i] < ARRAY_SIZE(seg7_glyphs)) ? seg7_glyphs[(u8)text[i]] : 0;
+    }
+
+    mutex_lock(&dev_data->seg7_lock);
+    /* The timer callback reads one glyph per slot, the unused digits are blank */
+    for(d = 0; d < dev_data->num_digits; d++){
+        WRITE_ONCE(dev_data->frame[d], glyphs[d]);
+    }
+    memcpy(dev_data->text, text, i);
+    dev_data->text[i] = '\0';
+    mutex_unlock(&dev_data->seg7_lock);
+
+    return 0;
+}
+
+static enum hrtimer_restart seg7_refresh(struct hrtimer* timer){
+
+    struct seg7dev_private_data* dev_data = container_of(timer, struct seg7dev_private_data, timer);
+    ktime_t now = ktime_get();
+    s64 late = ktime_to_ns(ktime_sub(now, hrtimer_get_expires(timer)));
+    unsigned long segments;
+    u64 forwarded;
+    int d = dev_data->current_digit;
+
+    /* Previous digit off, then the segments (one array write), then the next digit on: no ghosting */
+    gpiod_set_value(dev_data->digits->desc[d], 0);
+    d = (d + 1) % dev_data->num_digits;
+    segments = READ_ONCE(dev_data->frame[d]);
+    gpiod_set_array_value(dev_data->segments->ndescs,
+                          dev_data->segments->desc,
+                          dev_data->segments->info,
+                          &segments);
+    gpiod_set_value(dev_data->digits->desc[d], 1);
+    dev_data->current_digit = d;
+
+    /* Next slot from the previous deadline, the slots already passed are skipped */
+    forwarded = hrtimer_forward(timer, now, ns_to_ktime(READ_ONCE(dev_data->slot_ns)));
+
+    spin_lock(&dev_data->stats_lock);
+    dev_data->stats.slots++;
+    dev_data->stats.overruns += forwarded - 1;
+    if(late > 0){
+        dev_data->stats.late_total_ns += late;
+        if(late > dev_data->stats.late_max_ns){
+            dev_data->stats.late_max_ns = late > U32_MAX ? U32_MAX : late;
+        }
+    }
+    spin_unlock(&dev_data->stats_lock);
+
+    return HRTIMER_RESTART;
+}
+
+ssize_t text_show(struct device* dev, struct device_attribute* attr, char* buf){
+
+    int ret;
+    struct seg7dev_private_data* dev_data = dev_get_drvdata(dev);
+
+    mutex_lock(&dev_data->seg7_lock);
+    ret = sprintf(buf, "%s\n", dev_data->text);
+    mutex_unlock(&dev_data->seg7_lock);
+
+    return ret;
+}
+
+ssize_t text_store(struct device* dev, struct device_attribute* attr, const char* buf, size_t count){
+
+    struct seg7dev_private_data* dev_data = dev_get_drvdata(dev);
+    int ret;
+
+    ret = seg7_set_text(dev_data, buf, count);
+
+    return ret ? ret : count;
+}
+
+ssize_t segments_show(struct device* dev, struct device_attribute* attr, char* buf){
+
+    struct seg7dev_private_data* dev_data = dev_get_drvdata(dev);
+    int ret = 0;
+    int d;
+
+    for(d = 0; d < dev_data->num_digits; d++){
+        ret += sprintf(buf + ret, "%02x%c", READ_ONCE(dev_data->frame[d]),
+                       (d == dev_data->num_digits - 1) ? '\n' : ' ');
+    }
+
+    return ret;
+}
+
+ssize_t segments_store(struct device* dev, struct device_attribute* attr, const char* buf, size_t count){
+
+    struct seg7dev_private_data* dev_data = dev_get_drvdata(dev);
+    u8 glyphs[SEG7_MAX_DIGITS] = {0};
+    int pos = 0;
+    int len;
+    int n = 0;
+    int d;
+
+    /* Raw segment bitmasks in hex, one per digit from the leftmost, e.g. "06 db 4f 66" */
+    while(n < dev_data->num_digits && sscanf(buf + pos, "%hhx%n", &glyphs[n], &len) == 1){
+        pos += len;
+        n++;
+    }
+    if(!n){
+        return -EINVAL;
+    }
+
+    mutex_lock(&dev_data->seg7_lock);
+    for(d = 0; d < dev_data->num_digits; d++){
+        WRITE_ONCE(dev_data->frame[d], glyphs[d]);
+    }
+    dev_data->text[0] = '\0';
+    mutex_unlock(&dev_data->seg7_lock);
+
+    return count;
+}
+
+ssize_t slot_us_show(struct device* dev, struct device_attribute* attr, char* buf){
+
+    struct seg7dev_private_data* dev_data = dev_get_drvdata(dev);
+
+    return sprintf(buf, "%u\n", (u32)(READ_ONCE(dev_data->slot_ns) / NSEC_PER_USEC));
+}
+
+ssize_t slot_us_store(struct device* dev, struct device_attribute* attr, const char* buf, size_t count){
+
+    struct seg7dev_private_data* dev_data = dev_get_drvdata(dev);
+    u32 value;
+    int ret;
+
+    ret = kstrtou32(buf, 10, &value);
+    if(ret){
+        return ret;
+    }
+    if(value < SLOT_US_MIN || value > SLOT_US_MAX){
+        return -EINVAL;
+    }
+
+    /* Used by the timer callback from the next slot */
+    WRITE_ONCE(dev_data->slot_ns, value * NSEC_PER_USEC);
+
+    return count;
+}
+
+ssize_t stats_show(struct device* dev, struct device_attribute* attr, char* buf){
+
+    struct seg7dev_private_data* dev_data = dev_get_drvdata(dev);
+    struct seg7_stats stats;
+    unsigned long flags;
+
+    spin_lock_irqsave(&dev_data->stats_lock, flags);
+    stats = dev_data->stats;
+    spin_unlock_irqrestore(&dev_data->stats_lock, flags);
+
+    return sprintf(buf, "slots %llu\noverruns %llu\nlate_mean_ns %llu\nlate_max_ns %u\n",
+                   stats.slots, stats.overruns, stats.slots ? div64_u64(stats.late_total_ns, stats.slots) : 0,
+                   stats.late_max_ns);
+}
+
+static DEVICE_ATTR_RW(text);
+static DEVICE_ATTR_RW(segments);
+static DEVICE_ATTR_RW(slot_us);
+static DEVICE_ATTR_RO(stats);
+
+static struct attribute* seg7_attrs[] = {
+    &dev_attr_text.attr,
+    &dev_attr_segments.attr,
+    &dev_attr_slot_us.attr,
+    &dev_attr_stats.attr,
+    NULL
+};
+
+static struct attribute_group seg7_attr_group = {
+    .attrs = seg7_attrs
+};
+
+static const struct attribute_group* seg7_attr_groups[] = {
+    &seg7_attr_group,
+    NULL
+};
+
+/* Gets called when the device is removed from the system */
+int seg7_platform_driver_remove(struct platform_device* pdev){
+
+    struct seg7dev_private_data* dev_data = dev_get_drvdata(&pdev->dev);
+
+    /* Stop the refresh and switch the lit digit off */
+    hrtimer_cancel(&dev_data->timer);
+    gpiod_set_value(dev_data->digits->desc[dev_data->current_digit], 0);
+
+    device_destroy(seg7drv_data.class_seg7, dev_data->dev_num);
+    cdev_del(&dev_data->cdev);
+
+    seg7drv_data.total_devices--;
+
+    dev_info(&pdev->dev, "Device is removed\n");
+
+    return 0;
+}
+
+/* Gets called when matched platform device is found */
+int seg7_platform_driver_probe(struct platform_device* pdev){
+
+    struct device* dev = &pdev->dev;
+    struct seg7dev_private_data* dev_data;
+    u32 slot_us = SLOT_US_DEFAULT;
+    int ret;
+    int i;
+
+    dev_info(dev, "A device is detected\n");
+
+    if(seg7drv_data.total_devices >= MAX_DEVICES){
+        dev_err(dev, "Up to %d displays are supported\n", MAX_DEVICES);
+        return -ENODEV;
+    }
+
+    dev_data = devm_kzalloc(dev, sizeof(*dev_data), GFP_KERNEL);
+    if(!dev_data){
+        dev_err(dev, "Cannot allocate memory\n");
+        return -ENOMEM;
+    }
+
+    /* Segments A to G and DP, and digit selections (flagged GPIO_ACTIVE_LOW, so 1 is on), all off */
+    dev_data->segments = devm_gpiod_get_array(dev, "seg", GPIOD_OUT_LOW);
+    if(IS_ERR(dev_data->segments)){
+        dev_err(dev, "Segment GPIOs error\n");
+        return PTR_ERR(dev_data->segments);
+    }
+    if(dev_data->segments->ndescs != SEG7_NUM_SEGMENTS){
+        dev_err(dev, "%d segment GPIOs are needed\n", SEG7_NUM_SEGMENTS);
+        return -EINVAL;
+    }
+
+    dev_data->digits = devm_gpiod_get_array(dev, "digit", GPIOD_OUT_LOW);
+    if(IS_ERR(dev_data->digits)){
+        dev_err(dev, "Digit GPIOs error\n");
+        return PTR_ERR(dev_data->digits);
+    }
+    if(dev_data->digits->ndescs > SEG7_MAX_DIGITS){
+        dev_err(dev, "Up to %d digit GPIOs are supported\n", SEG7_MAX_DIGITS);
+        return -EINVAL;
+    }
+    dev_data->num_digits = dev_data->digits->ndescs;
+
+    /* The GPIOs are written from the hrtimer callback (hard irq context) */
+    for(i = 0; i < SEG7_NUM_SEGMENTS; i++){
+        if(gpiod_cansleep(dev_data->segments->desc[i])){
+            dev_err(dev, "Segment GPIO %d can sleep\n", i);
+            return -EINVAL;
+        }
+    }
+    for(i = 0; i < dev_data->num_digits; i++){
+        if(gpiod_cansleep(dev_data->digits->desc[i])){
+            dev_err(dev, "Digit GPIO %d can sleep\n", i);
+            return -EINVAL;
+        }
+    }
+
+    of_property_read_u32(dev->of_node, "org,slot-us", &slot_us);
+    if(slot_us < SLOT_US_MIN || slot_us > SLOT_US_MAX){
+        dev_err(dev, "Invalid slot %u us\n", slot_us);
+        return -EINVAL;
+    }
+    dev_data->slot_ns = slot_us * NSEC_PER_USEC;
+
+    mutex_init(&dev_data->seg7_lock);
+    spin_lock_init(&dev_data->stats_lock);
+    dev_set_drvdata(dev, dev_data);
+
+    dev_info(dev, "Digits = %d, slot = %u us\n", dev_data->num_digits, slot_us);
+
+    /* Get the device number */
+    dev_data->dev_num = seg7drv_data.device_num_base + seg7drv_data.total_devices;
+
+    /* Do cdev init and cdev add */
+    cdev_init(&dev_data->cdev, &seg7_fops);
+    dev_data->cdev.owner = THIS_MODULE;
+    ret = cdev_add(&dev_data->cdev, dev_data->dev_num, 1);
+    if(ret < 0){
+        dev_err(dev, "cdev add failed\n");
+        return ret;
+    }
+
+    /* Create /dev/seg7-N and its attributes under /sys/class/bone_seg7 */
+    dev_data->device_seg7 = device_create_with_groups(seg7drv_data.class_seg7,
+                                                      dev,
+                                                      dev_data->dev_num,
+                                                      dev_data,
+                                                      seg7_attr_groups,
+                                                      "seg7-%d",
+                                                      seg7drv_data.total_devices);
+    if(IS_ERR(dev_data->device_seg7)){
+        dev_err(dev, "Device create failed\n");
+        ret = PTR_ERR(dev_data->device_seg7);
+        cdev_del(&dev_data->cdev);
+        return ret;
+    }
+
+    seg7drv_data.total_devices++;
+
+    /* Refresh from the hrtimer, one digit per slot */
+    hrtimer_init(&dev_data->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+    dev_data->timer.function = seg7_refresh;
+    hrtimer_start(&dev_data->timer, ns_to_ktime(dev_data->slot_ns), HRTIMER_MODE_REL);
+
+    dev_info(dev, "Probe was successful\n");
+
+    return 0;
+}
+
+struct of_device_id seg7_device_match[] = {
+    {.compatible = "org,bone-seg7-mux"},
+    {}
+};
+
+struct platform_driver seg7_platform_driver = {
+    .probe = seg7_platform_driver_probe,
+    .remove = seg7_platform_driver_remove,
+    .driver = {
+        .name = "bone-seg7-mux",
+        .of_match_table = of_match_ptr(seg7_device_match)
+    }
+};
+
+static int __init seg7_platform_driver_init(void){
+
+    int ret;
+
+    /* Dynamically allocate a device number for MAX_DEVICES */
+    ret = alloc_chrdev_region(&seg7drv_data.device_num_base, 0, MAX_DEVICES, "seg7devs");
+    if(ret < 0){
+        pr_err("Alloc chrdev failed\n");
+        goto out;
+    }
+
+    /* Create device class under /sys/class */
+    seg7drv_data.class_seg7 = class_create(THIS_MODULE, "bone_seg7");
+    if(IS_ERR(seg7drv_data.class_seg7)){
+        pr_err("Class creation failed\n");
+        ret = PTR_ERR(seg7drv_data.class_seg7);
+        goto unreg_chrdev;
+    }
+
+    /* Register a platform driver */
+    ret = platform_driver_register(&seg7_platform_driver);
+    if(ret < 0){
+        pr_err("Driver registration failed\n");
+        goto class_del;
+    }
+
+    pr_info("seg7 mux platform driver loaded\n");
+
+    return 0;
+
+class_del:
+    class_destroy(seg7drv_data.class_seg7);
+
+unreg_chrdev:
+    unregister_chrdev_region(seg7drv_data.device_num_base, MAX_DEVICES);
+
+out:
+    pr_info("Platform driver init failed\n");
+    return ret;
+}
+
+static void __exit seg7_platform_driver_cleanup(void){
+
+    platform_driver_unregister(&seg7_platform_driver);
+    class_destroy(seg7drv_data.class_seg7);
+    unregister_chrdev_region(seg7drv_data.device_num_base, MAX_DEVICES);
+
+    pr_info("seg7 mux platform driver unloaded\n");
+}
+
+module_init(seg7_platform_driver_init);
+module_exit(seg7_platform_driver_cleanup);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("maherme");
+MODULE_DESCRIPTION("Multiplexed 7 segment display driver refreshed from an hrtimer");
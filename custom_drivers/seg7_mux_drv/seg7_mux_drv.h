@@ -0,0 +1,72 @@
+#ifndef SEG7_MUX_DRV_H
+#define SEG7_MUX_DRV_H
+
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/cdev.h>
+#include <linux/device.h>
+#include <linux/kdev_t.h>
+#include <linux/uaccess.h>
+#include <linux/platform_device.h>
+#include <linux/of.h>
+#include <linux/of_device.h>
+#include <linux/gpio/consumer.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/math64.h>
+
+#undef pr_fmt
+#define pr_fmt(fmt) "%s : " fmt,__func__
+
+#define MAX_DEVICES         4
+#define SEG7_NUM_SEGMENTS   8       /* Segments A to G and the decimal point */
+#define SEG7_MAX_DIGITS     8
+#define SEG7_DP             (1 << 7)
+#define SEG7_TEXT_SIZE      (2 * SEG7_MAX_DIGITS + 2)
+#define SLOT_US_DEFAULT     1000    /* 1 kHz per digit */
+#define SLOT_US_MIN         100
+#define SLOT_US_MAX         100000
+
+ssize_t seg7_read(struct file* filp, char __user* buff, size_t count, loff_t* f_pos);
+ssize_t seg7_write(struct file* filp, const char __user* buff, size_t count, loff_t* f_pos);
+int seg7_open(struct inode* inode, struct file* filp);
+int seg7_release(struct inode* inode, struct file* filp);
+
+/* Refresh statistics, updated by the timer callback */
+struct seg7_stats{
+    u64 slots;
+    u64 overruns;
+    u64 late_total_ns;
+    u32 late_max_ns;
+};
+
+/* Device private data structure */
+struct seg7dev_private_data{
+    struct gpio_descs* segments;
+    struct gpio_descs* digits;
+    int num_digits;
+    u8 frame[SEG7_MAX_DIGITS];      /* Glyph of each digit, read by the timer callback */
+    char text[SEG7_TEXT_SIZE];      /* Last text written */
+    int current_digit;
+    u32 slot_ns;
+    struct hrtimer timer;
+    struct seg7_stats stats;
+    spinlock_t stats_lock;
+    dev_t dev_num;
+    struct cdev cdev;
+    struct device* device_seg7;
+    struct mutex seg7_lock;
+};
+
+/* Driver private data structure */
+struct seg7drv_private_data{
+    int total_devices;
+    dev_t device_num_base;
+    struct class* class_seg7;
+};
+
+int seg7_set_text(struct seg7dev_private_data* dev_data, const char* text, size_t count);
+
+#endif /* SEG7_MUX_DRV_H */
@@ -0,0 +1,51 @@
+#include "seg7_mux_drv.h"
+
+ssize_t seg7_read(struct file* p_file, char __user* buff, size_t count, loff_t* f_pos){
+
+    struct seg7dev_private_data* seg7dev_data = (struct seg7dev_private_data*)p_file->private_data;
+    char text[SEG7_TEXT_SIZE + 1];
+    size_t len;
+
+    mutex_lock(&seg7dev_data->seg7_lock);
+    len = scnprintf(text, sizeof(text), "%s\n", seg7dev_data->text);
+    mutex_unlock(&seg7dev_data->seg7_lock);
+
+    return simple_read_from_buffer(buff, count, f_pos, text, len);
+}
+
+ssize_t seg7_write(struct file* p_file, const char __user* buff, size_t count, loff_t* f_pos){
+
+    struct seg7dev_private_data* seg7dev_data = (struct seg7dev_private_data*)p_file->private_data;
+    char text[SEG7_TEXT_SIZE];
+    int ret;
+
+    /* Every write is a whole frame, e.g. echo 12.34 > /dev/seg7-0 */
+    if(count >= SEG7_TEXT_SIZE){
+        return -EINVAL;
+    }
+
+    if(copy_from_user(text, buff, count)){
+        return -EFAULT;
+    }
+
+    ret = seg7_set_text(seg7dev_data, text, count);
+    if(ret){
+        return ret;
+    }
+
+    *f_pos += count;
+
+    return count;
+}
+
+int seg7_open(struct inode* inode, struct file* p_file){
+
+    p_file->private_data = container_of(inode->i_cdev, struct seg7dev_private_data, cdev);
+
+    return 0;
+}
+
+int seg7_release(struct inode* inode, struct file* p_file){
+
+    return 0;
+}
@@ -0,0 +1,332 @@
+/********************************************************************************************************//**
+* @file bench_595.c
+*
+* @brief Check and benchmark of the 74HC595 driver (shift_74hc595.h) on a host machine.
+*
+* A model of a chain of 74HC595 is fed with the transitions of the mock backend (gpio_mock_set_observer()):
+* SER is shifted in on every SRCLK rising edge and the shift register is copied to the outputs on every RCLK
+* rising edge. Random frames of 8, 16 and 32 bits are written and the latched outputs of the model are
+* compared with them, and a data change in the same port write as a clock rising edge is reported as a
+* setup violation.
+*
+* The multiplexed frame of the 4 digit display (segments and digit selection as a 16 bit frame on two
+* chips, one burst per digit) is then compared with the 12 gpio port of counter_4dig7seg.c (two port writes
+* per digit, the second one blanking), on the mock backend and on fake mmio banks (memfd).
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "gpio_driver.h"
+#include "gpio_mmio.h"
+#include "gpio_mock.h"
+#include "shift_74hc595.h"
+#include "seg7.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Default number of display frames per measurement */
+#define DEFAULT_FRAMES          20000
+
+/** @brief Random frames checked for each chain length */
+#define CHECK_FRAMES            1000
+
+#define NUM_PINS                12      /**< @brief Segments A to G, DP and the 4 digit selection lines */
+#define NUM_SEGMENTS            8       /**< @brief First digit selection line in the frame */
+#define NUM_DIGITS              4       /**< @brief Number of digits */
+#define SEGMENT_MASK            0x7F    /**< @brief Segments A to G */
+#define DIGIT_MASK              0xF00   /**< @brief Digit selection lines in the frame */
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Model of a chain of 74HC595 */
+struct hc595_model{
+    uint8_t ser;                        /**< @brief Level of SER */
+    uint8_t srclk;                      /**< @brief Level of SRCLK */
+    uint8_t rclk;                       /**< @brief Level of RCLK */
+    uint64_t t_ser;                     /**< @brief Time of the last SER change */
+    uint32_t shift;                     /**< @brief Shift register, output 0 is bit 0 */
+    uint32_t outputs;                   /**< @brief Storage register driving the outputs */
+    uint32_t shifts;                    /**< @brief SRCLK rising edges */
+    uint32_t latches;                   /**< @brief RCLK rising edges */
+    uint32_t violations;                /**< @brief SRCLK rising edges in the same write as a SER change */
+};
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Segment and digit selection pins, as grouped in the display port of seg7_mux.c */
+static const uint8_t disp_pins[NUM_PINS] = {
+    GPIO_66_P8_7_SEGA, GPIO_67_P8_8_SEGB, GPIO_69_P8_9_SEGC, GPIO_45_P8_11_SEGD, GPIO_44_P8_12_SEGE,
+    GPIO_26_P8_14_SEGF, GPIO_46_P8_16_SEGG, GPIO_68_P8_10_DP, GPIO_48_P9_15_DIG1, GPIO_49_P9_23_DIG2,
+    GPIO_112_P9_30_DIG3, GPIO_115_P9_27_DIG4
+};
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function updating the model with a transition of the mock backend.
+ * @param[in] event Is the transition.
+ * @param[in] ctx Is the model.
+ * @return void.
+ */
+static void model_observer(const struct gpio_mock_event* event, void* ctx);
+
+/**
+ * @brief Function for writing random frames and checking the outputs latched by the model.
+ * @param[in] nbits Is the length of the chain.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int check_chain(uint8_t nbits);
+
+/**
+ * @brief Function for measuring the 4 digit frame through a chain of two 74HC595.
+ * @param[in] frames Is the number of frames.
+ * @param[out] model Is the model checked after each digit, NULL for none.
+ * @return the time per frame in ns, < 0 if fail.
+ */
+static double run_595(long frames, struct hc595_model* model);
+
+/**
+ * @brief Function for measuring the 4 digit frame on the 12 gpio port.
+ * @param[in] frames Is the number of frames.
+ * @return the time per frame in ns, < 0 if fail.
+ */
+static double run_direct(long frames);
+
+/**
+ * @brief Function for selecting the mmio backend on fake banks.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int init_fake_mmio(void);
+
+/**
+ * @brief Function for getting the monotonic time in ns.
+ * @return the current time.
+ */
+static uint64_t now_ns(void);
+
+/***********************************************************************************************************/
+/*                                       Main Function                                                     */
+/***********************************************************************************************************/
+
+int main(int argc, char* argv[]){
+
+    long frames = DEFAULT_FRAMES;
+    double direct_ns = 0;
+    double sr_ns = 0;
+    uint32_t writes = 0;
+    struct hc595_model model = {0};
+    struct gpio_write_stats ws;
+
+    if(argc > 1){
+        frames = atol(argv[1]);
+    }
+
+    if(gpio_init("mock") || check_chain(8) || check_chain(16) || check_chain(32)){
+        return EXIT_FAILURE;
+    }
+    gpio_deinit();
+
+    printf("4 digit frame                 : gpios   pin writes   ns/frame\n");
+
+    /* Mock backend, the model checks every digit of the measured frames */
+    if(gpio_init("mock")){
+        return EXIT_FAILURE;
+    }
+    gpio_reset_write_stats();
+    direct_ns = run_direct(frames);
+    gpio_get_write_stats(&ws);
+    writes = ws.issued;
+    gpio_mock_set_observer(model_observer, &model);
+    gpio_reset_write_stats();
+    sr_ns = run_595(frames, &model);
+    gpio_get_write_stats(&ws);
+    gpio_mock_set_observer(NULL, NULL);
+    gpio_deinit();
+    if(direct_ns < 0 || sr_ns < 0){
+        return EXIT_FAILURE;
+    }
+    printf("mock, direct port             : %5d %12.1f %10.1f\n", NUM_PINS, (double)writes / frames, direct_ns);
+    printf("mock, 2 x 74HC595             : %5d %12.1f %10.1f\n", 3, (double)ws.issued / frames, sr_ns);
+
+    /* Fake mmio banks, one register store per port write */
+    if(init_fake_mmio()){
+        return EXIT_FAILURE;
+    }
+    direct_ns = run_direct(frames);
+    sr_ns = run_595(frames, NULL);
+    gpio_deinit();
+    if(direct_ns < 0 || sr_ns < 0){
+        return EXIT_FAILURE;
+    }
+    printf("mmio (fake banks), direct port: %5d %12s %10.1f\n", NUM_PINS, "-", direct_ns);
+    printf("mmio (fake banks), 2 x 74HC595: %5d %12s %10.1f\n", 3, "-", sr_ns);
+
+    return 0;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static void model_observer(const struct gpio_mock_event* event, void* ctx){
+
+    struct hc595_model* model = ctx;
+
+    switch(event->gpio_no){
+        case GPIO_60_P9_12_SER:
+            model->ser = event->value;
+            model->t_ser = event->t_ns;
+            break;
+        case GPIO_50_P9_14_SRCLK:
+            if(event->value && !model->srclk){
+                model->shift = (model->shift << 1) | model->ser;
+                model->shifts++;
+                /* The pins of a port write share the timestamp */
+                if(event->t_ns == model->t_ser){
+                    model->violations++;
+                }
+            }
+            model->srclk = event->value;
+            break;
+        case GPIO_51_P9_16_RCLK:
+            if(event->value && !model->rclk){
+                model->outputs = model->shift;
+                model->latches++;
+            }
+            model->rclk = event->value;
+            break;
+        default:
+            break;
+    }
+}
+
+static int check_chain(uint8_t nbits){
+
+    int i = 0;
+    uint32_t frame = 0;
+    uint32_t mask = (nbits == 32) ? UINT32_MAX : (1UL << nbits) - 1;
+    struct hc595 sr;
+    struct hc595_model model = {0};
+
+    gpio_mock_set_observer(model_observer, &model);
+    if(hc595_init(&sr, GPIO_60_P9_12_SER, GPIO_50_P9_14_SRCLK, GPIO_51_P9_16_RCLK, nbits)){
+        return 1;
+    }
+
+    srand(nbits);
+    for(i = 0; i < CHECK_FRAMES; i++){
+        frame = ((uint32_t)rand() ^ ((uint32_t)rand() << 16)) & mask;
+        if(hc595_write(&sr, frame) || (model.outputs & mask) != frame){
+            printf("FAIL: %d bit chain, frame 0x%08X latched 0x%08X\n", nbits, frame, model.outputs & mask);
+            return 1;
+        }
+    }
+    gpio_mock_set_observer(NULL, NULL);
+
+    printf("%2d bit chain, %d frames       : OK, %.1f shifts and %.1f latches per frame, %u violations\n",
+           nbits, CHECK_FRAMES, (double)model.shifts / CHECK_FRAMES, (double)model.latches / CHECK_FRAMES,
+           model.violations);
+
+    return model.violations != 0;
+}
+
+static double run_595(long frames, struct hc595_model* model){
+
+    long f = 0;
+    uint8_t d = 0;
+    long number = 0;
+    uint32_t frame = 0;
+    uint64_t t = 0;
+    struct hc595 sr;
+
+    if(hc595_init(&sr, GPIO_60_P9_12_SER, GPIO_50_P9_14_SRCLK, GPIO_51_P9_16_RCLK, 2 * HC595_CHIP_BITS)){
+        return -1;
+    }
+
+    t = now_ns();
+    for(f = 0; f < frames; f++){
+        number = f % 10000;
+        for(d = 0; d < NUM_DIGITS; d++){
+            /* The outputs change at once on the latch, so a digit replaces the previous one without blanking */
+            frame = seg7_encode_hex(number % 10) | (DIGIT_MASK & ~(1 << (NUM_SEGMENTS + d)));
+            if(hc595_write(&sr, frame) || (model && (model->outputs & 0xFFFF) != frame)){
+                return -1;
+            }
+            number /= 10;
+        }
+    }
+
+    return (double)(now_ns() - t) / frames;
+}
+
+static double run_direct(long frames){
+
+    long f = 0;
+    uint8_t i = 0;
+    uint8_t d = 0;
+    long number = 0;
+    uint64_t t = 0;
+    struct gpio_port disp_port;
+
+    for(i = 0; i < NUM_PINS; i++){
+        if(gpio_export(disp_pins[i]) || gpio_config_dir(disp_pins[i], GPIO_DIR_OUT)){
+            return -1;
+        }
+    }
+    if(gpio_port_init(&disp_port, disp_pins, NUM_PINS)){
+        return -1;
+    }
+
+    t = now_ns();
+    for(f = 0; f < frames; f++){
+        number = f % 10000;
+        for(d = 0; d < NUM_DIGITS; d++){
+            gpio_write_mask(&disp_port, SEGMENT_MASK | DIGIT_MASK,
+                            seg7_encode_hex(number % 10) | (DIGIT_MASK & ~(1 << (NUM_SEGMENTS + d))));
+            gpio_write_mask(&disp_port, SEGMENT_MASK | DIGIT_MASK, DIGIT_MASK);
+            number /= 10;
+        }
+    }
+
+    return (double)(now_ns() - t) / frames;
+}
+
+static int init_fake_mmio(void){
+
+    int fd = memfd_create("gpio_banks", 0);
+
+    if(fd < 0 || ftruncate(fd, GPIO_MMIO_NUM_BANKS * GPIO_MMIO_BANK_SIZE) < 0){
+        perror("Error, fake gpio banks could not be created");
+        return 1;
+    }
+    if(gpio_mmio_init_fd(fd, NULL, GPIO_MMIO_EMULATE)){
+        return 1;
+    }
+    close(fd);
+
+    return gpio_init("mmio");
+}
+
+static uint64_t now_ns(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
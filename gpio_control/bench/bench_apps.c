@@ -0,0 +1,573 @@
+/********************************************************************************************************//**
+* @file bench_apps.c
+*
+* @brief Benchmark of the hot paths of the gpio_control applications, run on a host machine.
+*
+* Each application frame (a 7 segment digit, a multiplexed 4 digit frame and an LCD character) is run on
+* every host backend: mock, sysfs on a fake tree and mmio on fake banks (memfd). The selected backend is
+* wrapped by a counting backend, so for each frame the report gives:
+*       - the latency distribution (mean, p50, p90, p99 and max),
+*       - the backend operations issued,
+*       - the pin writes elided by the shadow copy of the driver,
+*       - the read/write syscalls issued (from /proc/self/io),
+*       - the achieved rate (frames/s).
+*
+* The 4 digit frame is run without the hold time of each digit, so it measures the driver cost. The
+* LCD character includes the delays required by the HD44780, so only a few characters are sent.
+*
+* The startup of the 4 digit application (gpio_init_pins() of its pin table) is also measured on the fake
+* sysfs tree, for a first start (every direction is written) and for a restart of the application on the
+* configured tree (the sysfs state is read and nothing is rewritten).
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "gpio_driver.h"
+#include "gpio_backend.h"
+#include "gpio_mmio.h"
+#include "lcd_hd44780.h"
+#include "seg7.h"
+#include "fake_sysfs.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Default number of 7 segment digits per measurement, the 4 digit frames are 1/5 of it */
+#define DEFAULT_FRAMES          100000
+
+/** @brief Number of LCD characters per measurement (each one takes ~9 ms) */
+#define LCD_FRAMES              10
+
+/** @brief Number of segment pins (A to G and the decimal point) */
+#define NUM_SEGMENTS            8
+
+/** @brief Number of digits of the 4 digit display */
+#define NUM_DIGITS              4
+
+#define SEGMENT_MASK            0x7F    /**< @brief Segments A to G */
+#define DIGIT_MASK              0xF00   /**< @brief Digit selection lines in the display port */
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Application frame measured by the benchmark */
+struct scenario{
+    const char* name;                   /**< @brief Name printed in the report */
+    int (*setup)(void);                 /**< @brief Export and configure the gpios */
+    void (*frame)(long i);              /**< @brief Run the frame number i */
+    long frames;                        /**< @brief Number of frames per measurement */
+};
+
+/** @brief Host backend the scenarios are run on */
+struct bench_backend{
+    const char* name;                   /**< @brief Name printed in the report */
+    int (*prepare)(void);               /**< @brief Prepare the simulated gpios before selecting it */
+    void (*cleanup)(void);              /**< @brief Remove the simulated gpios */
+    const struct gpio_backend* be;      /**< @brief Backend wrapped by the counting backend */
+};
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+static int setup_7seg(void);
+static int setup_4dig(void);
+static int setup_lcd(void);
+static void frame_7seg(long i);
+static void frame_7seg_banks(long i);
+static void frame_4dig(long i);
+static void frame_lcd(long i);
+
+static int prepare_sysfs(void);
+static void cleanup_sysfs(void);
+static int prepare_mmio(void);
+
+/**
+ * @brief Function for running a scenario on a backend and printing one line of the report.
+ * @param[in] sc Is the scenario.
+ * @param[in] bb Is the backend.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int run_scenario(const struct scenario* sc, const struct bench_backend* bb);
+
+/**
+ * @brief Function for measuring the first start and the restart of the 4 digit application on sysfs.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int run_startup(void);
+
+/**
+ * @brief Function for getting the number of read and write syscalls issued by the process.
+ * @param[out] writes Is the number of write syscalls, it can be NULL.
+ * @return the number of syscalls, 0 if /proc/self/io is not available.
+ */
+static uint64_t rw_syscalls(uint64_t* writes);
+
+/**
+ * @brief Function for comparing two latencies, for qsort().
+ */
+static int cmp_u64(const void* a, const void* b);
+
+/**
+ * @brief Function for getting the monotonic time in ns.
+ * @return the current time.
+ */
+static uint64_t now_ns(void);
+
+/* Counting backend operations, forwarded to the wrapped backend */
+static int count_init(void);
+static void count_deinit(void);
+static int count_export(uint8_t gpio_no);
+static int count_config_dir(uint8_t gpio_no, uint8_t dir_val);
+static int count_write(uint8_t gpio_no, uint8_t out_val);
+static int count_read(uint8_t gpio_no);
+static int count_config_edge(uint8_t gpio_no, const char* edge);
+static int count_write_batch(const uint8_t* pins, uint8_t npins, uint32_t mask, uint32_t values);
+static int count_write_bank(uint8_t bank, uint32_t mask, uint32_t values);
+static int count_wait_ready(const uint8_t* gpios, uint8_t n);
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Segment pins A to G and DP, as wired in counter_4dig7seg.c */
+static const uint8_t seg_pins[NUM_SEGMENTS] = {66, 67, 69, 45, 44, 26, 46, 68};
+
+/** @brief Segment and digit selection pins, as grouped in the display port of seg7_mux.c */
+static const uint8_t disp_pins[NUM_SEGMENTS + NUM_DIGITS] = {66, 67, 69, 45, 44, 26, 46, 68, 48, 49, 112, 115};
+
+/** @brief Every gpio used by the scenarios, created in the fake sysfs tree */
+static const uint8_t all_pins[] = {66, 67, 69, 68, 45, 44, 26, 46, 48, 49, 112, 115};
+
+/** @brief Seven segment display, as initialized by counter_7seg.c */
+static struct seg7 seg_display;
+
+static struct gpio_port disp_port;
+
+/** @brief Pin table of the 4 digit application, segments low and digits high (off) */
+static const struct gpio_pin_config startup_pins[] = {
+    GPIO_PIN_OUT(66, 0), GPIO_PIN_OUT(67, 0), GPIO_PIN_OUT(69, 0), GPIO_PIN_OUT(68, 0),
+    GPIO_PIN_OUT(45, 0), GPIO_PIN_OUT(44, 0), GPIO_PIN_OUT(26, 0), GPIO_PIN_OUT(46, 0),
+    GPIO_PIN_OUT(48, 1), GPIO_PIN_OUT(49, 1), GPIO_PIN_OUT(112, 1), GPIO_PIN_OUT(115, 1)
+};
+
+/** @brief Root path of the fake sysfs tree */
+static char fake_root[] = FAKE_SYSFS_TEMPLATE;
+
+/** @brief Backend wrapped by the counting backend */
+static const struct gpio_backend* inner = NULL;
+
+/** @brief Number of operations forwarded to the wrapped backend */
+static uint64_t backend_ops = 0;
+
+/** @brief Counting backend, the optional writes and wait_ready are only set if the wrapped backend has them */
+static struct gpio_backend counting_backend = {
+    .name = "counting",
+    .init = count_init,
+    .deinit = count_deinit,
+    .export = count_export,
+    .config_dir = count_config_dir,
+    .write = count_write,
+    .read = count_read,
+    .config_edge = count_config_edge,
+};
+
+static struct scenario scenarios[] = {
+    {"7seg digit", setup_7seg, frame_7seg, DEFAULT_FRAMES},
+    {"7seg banks", setup_7seg, frame_7seg_banks, DEFAULT_FRAMES},
+    {"4dig frame", setup_4dig, frame_4dig, DEFAULT_FRAMES / 5},
+    {"lcd char",   setup_lcd,  frame_lcd,  LCD_FRAMES},
+};
+
+static const struct bench_backend bench_backends[] = {
+    {"mock",  NULL,          NULL,            &gpio_mock_backend},
+    {"sysfs", prepare_sysfs, cleanup_sysfs,   &gpio_sysfs_backend},
+    {"mmio",  prepare_mmio,  NULL,            &gpio_mmio_backend},
+};
+
+/***********************************************************************************************************/
+/*                                       Main Function                                                     */
+/***********************************************************************************************************/
+
+int main(int argc, char* argv[]){
+
+    uint8_t s = 0;
+    uint8_t b = 0;
+    long frames = DEFAULT_FRAMES;
+
+    if(argc > 1){
+        frames = atol(argv[1]);
+        if(frames < 5){
+            fprintf(stderr, "Usage: %s [digits per measurement, >= 5]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+        scenarios[0].frames = frames;
+        scenarios[1].frames = frames;
+        scenarios[2].frames = frames / 5;
+    }
+
+    printf("%-11s %-7s %8s %9s %9s %9s %9s %10s %9s %9s %9s %12s\n", "scenario", "backend", "frames",
+           "mean(ns)", "p50(ns)", "p90(ns)", "p99(ns)", "max(ns)", "ops/frm", "elid/frm", "sysc/frm",
+           "frames/s");
+
+    for(s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++){
+        for(b = 0; b < sizeof(bench_backends) / sizeof(bench_backends[0]); b++){
+            if(run_scenario(&scenarios[s], &bench_backends[b])){
+                fprintf(stderr, "Error, scenario \"%s\" failed on the %s backend\n", scenarios[s].name,
+                        bench_backends[b].name);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    if(run_startup()){
+        fprintf(stderr, "Error, startup measurement failed\n");
+        return EXIT_FAILURE;
+    }
+
+    return 0;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static int run_scenario(const struct scenario* sc, const struct bench_backend* bb){
+
+    long i = 0;
+    uint64_t* lat = NULL;
+    uint64_t t_start = 0;
+    uint64_t t_frame = 0;
+    uint64_t total = 0;
+    uint64_t ops = 0;
+    uint64_t sysc = 0;
+    uint64_t sysc_overhead = 0;
+    struct gpio_write_stats wstats;
+    int ret = 1;
+
+    lat = malloc(sc->frames * sizeof(*lat));
+    if(!lat){
+        return 1;
+    }
+
+    gpio_deinit();
+    if(bb->prepare && bb->prepare()){
+        free(lat);
+        return 1;
+    }
+
+    inner = bb->be;
+    counting_backend.write_batch = inner->write_batch ? count_write_batch : NULL;
+    counting_backend.write_bank = inner->write_bank ? count_write_bank : NULL;
+    counting_backend.wait_ready = inner->wait_ready ? count_wait_ready : NULL;
+    if(gpio_init_backend(&counting_backend) || sc->setup()){
+        goto out;
+    }
+
+    /* Syscalls issued by reading /proc/self/io itself */
+    sysc_overhead = rw_syscalls(NULL);
+    sysc_overhead = rw_syscalls(NULL) - sysc_overhead;
+
+    backend_ops = 0;
+    gpio_reset_write_stats();
+    sysc = rw_syscalls(NULL);
+    t_start = now_ns();
+    for(i = 0; i < sc->frames; i++){
+        t_frame = now_ns();
+        sc->frame(i);
+        lat[i] = now_ns() - t_frame;
+    }
+    total = now_ns() - t_start;
+    sysc = rw_syscalls(NULL) - sysc - sysc_overhead;
+    ops = backend_ops;
+    gpio_get_write_stats(&wstats);
+
+    qsort(lat, sc->frames, sizeof(*lat), cmp_u64);
+
+    printf("%-11s %-7s %8ld %9.0f %9llu %9llu %9llu %10llu %9.2f %9.2f %9.2f %12.0f\n", sc->name, bb->name,
+           sc->frames, (double)total / sc->frames,
+           (unsigned long long)lat[sc->frames / 2],
+           (unsigned long long)lat[sc->frames * 90 / 100],
+           (unsigned long long)lat[sc->frames * 99 / 100],
+           (unsigned long long)lat[sc->frames - 1],
+           (double)ops / sc->frames, (double)wstats.elided / sc->frames, (double)sysc / sc->frames, sc->frames / (total / 1e9));
+    ret = 0;
+
+out:
+    gpio_deinit();
+    if(bb->cleanup){
+        bb->cleanup();
+    }
+    free(lat);
+
+    return ret;
+}
+
+static int run_startup(void){
+
+    uint8_t run = 0;
+    uint64_t sysc = 0;
+    uint64_t sysw = 0;
+    uint64_t sysw_end = 0;
+    struct gpio_init_report report;
+    static const char* const run_names[] = {"first start", "restart"};
+    int ret = 1;
+
+    gpio_deinit();
+    if(prepare_sysfs()){
+        return 1;
+    }
+
+    inner = &gpio_sysfs_backend;
+    counting_backend.write_batch = NULL;
+    counting_backend.write_bank = NULL;
+    counting_backend.wait_ready = count_wait_ready;
+
+    printf("\n%-11s %-7s %6s %10s %9s %9s %9s\n", "startup", "backend", "pins", "total(us)", "ops",
+           "sysc", "writes");
+
+    for(run = 0; run < 2; run++){
+        /* Selecting the backend again drops its cached state, as a new process would */
+        if(gpio_init_backend(&counting_backend)){
+            goto out;
+        }
+        backend_ops = 0;
+        sysc = rw_syscalls(&sysw);
+        if(gpio_init_pins(startup_pins, sizeof(startup_pins) / sizeof(startup_pins[0]), &report)){
+            goto out;
+        }
+        sysc = rw_syscalls(&sysw_end) - sysc;
+        printf("%-11s %-7s %6u %10u %9llu %9llu %9llu\n", run_names[run], inner->name, report.npins,
+               report.total_us, (unsigned long long)backend_ops, (unsigned long long)sysc,
+               (unsigned long long)(sysw_end - sysw));
+    }
+    ret = 0;
+
+out:
+    gpio_deinit();
+    cleanup_sysfs();
+
+    return ret;
+}
+
+static int setup_7seg(void){
+
+    uint8_t i = 0;
+
+    for(i = 0; i < NUM_SEGMENTS; i++){
+        if(gpio_export(seg_pins[i]) || gpio_config_dir(seg_pins[i], GPIO_DIR_OUT)){
+            return 1;
+        }
+    }
+
+    return seg7_init(&seg_display, seg_pins);
+}
+
+static int setup_4dig(void){
+
+    uint8_t i = 0;
+
+    if(setup_7seg()){
+        return 1;
+    }
+
+    for(i = NUM_SEGMENTS; i < NUM_SEGMENTS + NUM_DIGITS; i++){
+        if(gpio_export(disp_pins[i]) || gpio_config_dir(disp_pins[i], GPIO_DIR_OUT)){
+            return 1;
+        }
+    }
+
+    return gpio_port_init(&disp_port, disp_pins, NUM_SEGMENTS + NUM_DIGITS);
+}
+
+static int setup_lcd(void){
+
+    hd44780_init();
+
+    return 0;
+}
+
+static void frame_7seg(long i){
+
+    seg7_write(&seg_display, '0' + i % 10);
+}
+
+static void frame_7seg_banks(long i){
+
+    seg7_write_digit(&seg_display, i % 10);
+}
+
+static void frame_4dig(long i){
+
+    uint8_t d = 0;
+    long number = i % 10000;
+
+    /* Same port writes as the slots of seg7_mux.c (digits off, segments, digit on), without the slot time */
+    for(d = NUM_DIGITS; d > 0; d--){
+        gpio_write_mask(&disp_port, DIGIT_MASK, DIGIT_MASK);
+        gpio_write_mask(&disp_port, SEGMENT_MASK | SEG7_DP, seg7_encode_hex(number % 10));
+        gpio_write_mask(&disp_port, 1 << (NUM_SEGMENTS + d - 1), 0);
+        number /= 10;
+    }
+}
+
+static void frame_lcd(long i){
+
+    hd44780_print_char('A' + i % 26);
+}
+
+static int prepare_sysfs(void){
+
+    strcpy(fake_root, FAKE_SYSFS_TEMPLATE);
+    if(fake_sysfs_create(fake_root, all_pins, sizeof(all_pins))){
+        return 1;
+    }
+    gpio_set_sysfs_root(fake_root);
+
+    return 0;
+}
+
+static void cleanup_sysfs(void){
+
+    fake_sysfs_destroy(fake_root);
+}
+
+static int prepare_mmio(void){
+
+    int fd = memfd_create("gpio_banks", 0);
+
+    if(fd < 0 || ftruncate(fd, GPIO_MMIO_NUM_BANKS * GPIO_MMIO_BANK_SIZE) < 0){
+        perror("Error, fake gpio banks could not be created");
+        return 1;
+    }
+
+    /* Mapped before selecting the backend, so its init keeps the fake banks */
+    if(gpio_mmio_init_fd(fd, NULL, GPIO_MMIO_EMULATE)){
+        close(fd);
+        return 1;
+    }
+    close(fd);
+
+    return 0;
+}
+
+static uint64_t rw_syscalls(uint64_t* writes){
+
+    FILE* f = NULL;
+    char line[64];
+    unsigned long long n = 0;
+    uint64_t total = 0;
+
+    f = fopen("/proc/self/io", "r");
+    if(!f){
+        return 0;
+    }
+
+    while(fgets(line, sizeof(line), f)){
+        if(sscanf(line, "syscr: %llu", &n) == 1){
+            total += n;
+        }
+        else if(sscanf(line, "syscw: %llu", &n) == 1){
+            total += n;
+            if(writes){
+                *writes = n;
+            }
+        }
+    }
+    fclose(f);
+
+    return total;
+}
+
+static int cmp_u64(const void* a, const void* b){
+
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+static uint64_t now_ns(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int count_init(void){
+
+    return inner->init ? inner->init() : 0;
+}
+
+static void count_deinit(void){
+
+    if(inner->deinit){
+        inner->deinit();
+    }
+}
+
+static int count_export(uint8_t gpio_no){
+
+    backend_ops++;
+
+    return inner->export(gpio_no);
+}
+
+static int count_config_dir(uint8_t gpio_no, uint8_t dir_val){
+
+    backend_ops++;
+
+    return inner->config_dir(gpio_no, dir_val);
+}
+
+static int count_write(uint8_t gpio_no, uint8_t out_val){
+
+    backend_ops++;
+
+    return inner->write(gpio_no, out_val);
+}
+
+static int count_read(uint8_t gpio_no){
+
+    backend_ops++;
+
+    return inner->read(gpio_no);
+}
+
+static int count_config_edge(uint8_t gpio_no, const char* edge){
+
+    backend_ops++;
+
+    return inner->config_edge(gpio_no, edge);
+}
+
+static int count_write_batch(const uint8_t* pins, uint8_t npins, uint32_t mask, uint32_t values){
+
+    backend_ops++;
+
+    return inner->write_batch(pins, npins, mask, values);
+}
+
+static int count_write_bank(uint8_t bank, uint32_t mask, uint32_t values){
+
+    backend_ops++;
+
+    return inner->write_bank(bank, mask, values);
+}
+
+static int count_wait_ready(const uint8_t* gpios, uint8_t n){
+
+    return inner->wait_ready(gpios, n);
+}
@@ -0,0 +1,515 @@
+/********************************************************************************************************//**
+* @file bench_async.c
+*
+* @brief Check and benchmark of the asynchronous write queue (gpio_async.h) on a host machine.
+*
+* A random sequence of pin and port writes is played synchronously and through the queue on the mock
+* backend, and the transitions of every gpio (gpio_mock_set_observer()) are compared: the merging of the
+* queue must not lose, add or reorder the transitions of a gpio.
+*
+* The segments of a digit written pin by pin (gpio_write_value(), as the applications did before the ports)
+* and the multiplexed 4 digit frame (two port writes per digit) are then measured synchronously and through
+* the queue on the mock, sysfs (fake tree) and mmio (fake banks) backends. For each run it reports the time
+* spent in the loop of the application, the time until the last write reached the backend (gpio_flush()),
+* the backend operations per frame and the bank writes queued and issued by the I/O thread once merged.
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "gpio_driver.h"
+#include "gpio_backend.h"
+#include "gpio_async.h"
+#include "gpio_mmio.h"
+#include "gpio_mock.h"
+#include "board_pins.h"
+#include "seg7.h"
+#include "fake_sysfs.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Default number of frames per measurement */
+#define DEFAULT_FRAMES          20000
+
+/** @brief Writes of the random sequence checked */
+#define CHECK_WRITES            20000
+
+#define NUM_SEGMENTS            8       /**< @brief Segments A to G and DP */
+#define NUM_DIGITS              4       /**< @brief Number of digits */
+#define NUM_PINS                (NUM_SEGMENTS + NUM_DIGITS)
+#define SEGMENT_MASK            0x7F    /**< @brief Segments A to G */
+#define DIGIT_MASK              0xF00   /**< @brief Digit selection lines in the display port */
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Application loop measured */
+struct scenario{
+    const char* name;                   /**< @brief Name printed in the report */
+    void (*frame)(long i, uint8_t async); /**< @brief Run the frame number i, through the queue if async */
+    long div;                           /**< @brief Divider of the number of frames */
+};
+
+/** @brief Host backend the scenarios are run on */
+struct bench_backend{
+    const char* name;                   /**< @brief Name printed in the report */
+    int (*prepare)(void);               /**< @brief Prepare the simulated gpios before selecting it */
+    void (*cleanup)(void);              /**< @brief Remove the simulated gpios */
+    const struct gpio_backend* be;      /**< @brief Backend wrapped by the counting backend */
+};
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+static void frame_7seg_pins(long i, uint8_t async);
+static void frame_4dig(long i, uint8_t async);
+
+static int prepare_sysfs(void);
+static void cleanup_sysfs(void);
+static int prepare_mmio(void);
+
+/**
+ * @brief Function counting the transitions of each gpio of the mock backend.
+ * @param[in] event Is the transition.
+ * @param[in] ctx Is the counters, one per gpio.
+ * @return void.
+ */
+static void count_transitions(const struct gpio_mock_event* event, void* ctx);
+
+/**
+ * @brief Function for playing the random sequence and counting the transitions of each gpio.
+ * @param[in] async Is 1 for writing through the queue.
+ * @param[out] transitions Is the transitions of each gpio.
+ * @param[out] levels Is the final levels of the display port.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int play_sequence(uint8_t async, uint32_t* transitions, uint32_t* levels);
+
+/**
+ * @brief Function for comparing the transitions of the random sequence written with and without the queue.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int check_sequence(void);
+
+/**
+ * @brief Function for running a scenario on a backend, with and without the queue.
+ * @param[in] sc Is the scenario.
+ * @param[in] bb Is the backend.
+ * @param[in] frames Is the number of frames.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int run_scenario(const struct scenario* sc, const struct bench_backend* bb, long frames);
+
+/**
+ * @brief Function for exporting the display gpios as outputs and grouping them in the display port.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int setup_display(void);
+
+/**
+ * @brief Function for getting the monotonic time in ns.
+ * @return the current time.
+ */
+static uint64_t now_ns(void);
+
+/* Counting backend, forwarding to the wrapped backend */
+static int count_init(void);
+static void count_deinit(void);
+static int count_export(uint8_t gpio_no);
+static int count_config_dir(uint8_t gpio_no, uint8_t dir_val);
+static int count_write(uint8_t gpio_no, uint8_t out_val);
+static int count_read(uint8_t gpio_no);
+static int count_config_edge(uint8_t gpio_no, const char* edge);
+static int count_write_batch(const uint8_t* pins, uint8_t npins, uint32_t mask, uint32_t values);
+static int count_write_bank(uint8_t bank, uint32_t mask, uint32_t values);
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Segment and digit selection pins, as grouped in the display port of seg7_mux.c */
+static const uint8_t disp_pins[NUM_PINS] = {
+    GPIO_66_P8_7_SEGA, GPIO_67_P8_8_SEGB, GPIO_69_P8_9_SEGC, GPIO_45_P8_11_SEGD, GPIO_44_P8_12_SEGE,
+    GPIO_26_P8_14_SEGF, GPIO_46_P8_16_SEGG, GPIO_68_P8_10_DP, GPIO_48_P9_15_DIG1, GPIO_49_P9_23_DIG2,
+    GPIO_112_P9_30_DIG3, GPIO_115_P9_27_DIG4
+};
+
+/** @brief Segments and digit selection lines */
+static struct gpio_port disp_port;
+
+/** @brief Root path of the fake sysfs tree */
+static char fake_root[] = FAKE_SYSFS_TEMPLATE;
+
+/** @brief Backend wrapped by the counting backend */
+static const struct gpio_backend* inner = NULL;
+
+/** @brief Number of operations forwarded to the wrapped backend */
+static uint64_t backend_ops = 0;
+
+/** @brief Counting backend, the optional writes are only set if the wrapped backend has them */
+static struct gpio_backend counting_backend = {
+    .name = "counting",
+    .init = count_init,
+    .deinit = count_deinit,
+    .export = count_export,
+    .config_dir = count_config_dir,
+    .write = count_write,
+    .read = count_read,
+    .config_edge = count_config_edge,
+};
+
+static const struct scenario scenarios[] = {
+    {"7seg pins", frame_7seg_pins, 1},
+    {"4dig frame", frame_4dig, 4},
+};
+
+static const struct bench_backend bench_backends[] = {
+    {"mock",  NULL,          NULL,            &gpio_mock_backend},
+    {"sysfs", prepare_sysfs, cleanup_sysfs,   &gpio_sysfs_backend},
+    {"mmio",  prepare_mmio,  NULL,            &gpio_mmio_backend},
+};
+
+/***********************************************************************************************************/
+/*                                       Main Function                                                     */
+/***********************************************************************************************************/
+
+int main(int argc, char* argv[]){
+
+    uint8_t s = 0;
+    uint8_t b = 0;
+    long frames = DEFAULT_FRAMES;
+
+    if(argc > 1){
+        frames = atol(argv[1]);
+        if(frames < 4){
+            fprintf(stderr, "Usage: %s [frames per measurement, >= 4]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if(check_sequence()){
+        return EXIT_FAILURE;
+    }
+
+    printf("%-10s %-7s %-5s %8s %11s %11s %9s %9s %9s\n", "scenario", "backend", "mode", "frames",
+           "loop(ns)", "total(ns)", "ops/frm", "queued", "issued");
+
+    for(s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++){
+        for(b = 0; b < sizeof(bench_backends) / sizeof(bench_backends[0]); b++){
+            if(run_scenario(&scenarios[s], &bench_backends[b], frames / scenarios[s].div)){
+                fprintf(stderr, "Error, scenario \"%s\" failed on the %s backend\n", scenarios[s].name,
+                        bench_backends[b].name);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static void frame_7seg_pins(long i, uint8_t async){
+
+    uint8_t s = 0;
+    uint8_t segments = seg7_encode_hex(i % 10);
+
+    /* One call per segment, the caller blocks on each one when the queue is not used */
+    for(s = 0; s < NUM_SEGMENTS; s++){
+        if(async){
+            gpio_async_write_value(disp_pins[s], (segments >> s) & 1);
+        }
+        else{
+            gpio_write_value(disp_pins[s], (segments >> s) & 1);
+        }
+    }
+}
+
+static void frame_4dig(long i, uint8_t async){
+
+    uint8_t d = 0;
+    long number = i % 10000;
+    uint32_t values = 0;
+
+    /* Port writes of the former waveform refresh of counter_4dig7seg.c, without the hold time */
+    for(d = 0; d < NUM_DIGITS; d++){
+        values = seg7_encode_hex(number % 10) | (DIGIT_MASK & ~(1 << (NUM_SEGMENTS + d)));
+        if(async){
+            gpio_async_write_mask(&disp_port, SEGMENT_MASK | DIGIT_MASK, values);
+            gpio_async_write_mask(&disp_port, SEGMENT_MASK | DIGIT_MASK, DIGIT_MASK);
+        }
+        else{
+            gpio_write_mask(&disp_port, SEGMENT_MASK | DIGIT_MASK, values);
+            gpio_write_mask(&disp_port, SEGMENT_MASK | DIGIT_MASK, DIGIT_MASK);
+        }
+        number /= 10;
+    }
+}
+
+static void count_transitions(const struct gpio_mock_event* event, void* ctx){
+
+    ((uint32_t*)ctx)[event->gpio_no]++;
+}
+
+static int play_sequence(uint8_t async, uint32_t* transitions, uint32_t* levels){
+
+    int i = 0;
+    int ret = 1;
+    uint32_t r = 0;
+
+    memset(transitions, 0, GPIO_MAX_NUMBER * sizeof(*transitions));
+
+    if(gpio_init("mock") || setup_display()){
+        return 1;
+    }
+    gpio_mock_set_observer(count_transitions, transitions);
+    if(async && gpio_async_start()){
+        goto out;
+    }
+
+    /* Pulses, single pins and overlapping port writes, the same sequence on both runs */
+    srand(1);
+    for(i = 0; i < CHECK_WRITES; i++){
+        r = (uint32_t)rand();
+        if(r & 1){
+            gpio_async_write_value(disp_pins[(r >> 1) % NUM_PINS], (r >> 8) & 1);
+        }
+        else{
+            gpio_async_write_mask(&disp_port, (r >> 1) & 0xFFF, r >> 13);
+        }
+    }
+    if(gpio_flush() || gpio_read_port(&disp_port, levels)){
+        goto out;
+    }
+    ret = 0;
+
+out:
+    gpio_async_stop();
+    gpio_mock_set_observer(NULL, NULL);
+    gpio_deinit();
+
+    return ret;
+}
+
+static int check_sequence(void){
+
+    uint8_t i = 0;
+    uint32_t sync_levels = 0;
+    uint32_t async_levels = 0;
+    uint64_t total = 0;
+    static uint32_t sync_transitions[GPIO_MAX_NUMBER];
+    static uint32_t async_transitions[GPIO_MAX_NUMBER];
+    struct gpio_async_stats stats;
+
+    if(play_sequence(0, sync_transitions, &sync_levels) || play_sequence(1, async_transitions, &async_levels)){
+        return 1;
+    }
+    gpio_async_get_stats(&stats);
+
+    for(i = 0; i < NUM_PINS; i++){
+        if(sync_transitions[disp_pins[i]] != async_transitions[disp_pins[i]]){
+            printf("FAIL: gpio %d, %u transitions written synchronously, %u through the queue\n", disp_pins[i],
+                   sync_transitions[disp_pins[i]], async_transitions[disp_pins[i]]);
+            return 1;
+        }
+        total += sync_transitions[disp_pins[i]];
+    }
+    if(sync_levels != async_levels){
+        printf("FAIL: final levels 0x%03X written synchronously, 0x%03X through the queue\n", sync_levels,
+               async_levels);
+        return 1;
+    }
+
+    printf("%d random writes: OK, %llu transitions kept, %llu bank writes queued, %llu issued, %u errors\n\n",
+           CHECK_WRITES, (unsigned long long)total, (unsigned long long)stats.queued,
+           (unsigned long long)stats.issued, stats.errors);
+
+    return stats.errors != 0;
+}
+
+static int run_scenario(const struct scenario* sc, const struct bench_backend* bb, long frames){
+
+    long i = 0;
+    uint8_t async = 0;
+    uint64_t t_start = 0;
+    uint64_t t_loop = 0;
+    uint64_t t_total = 0;
+    struct gpio_async_stats stats;
+    static const char* const mode_names[] = {"sync", "async"};
+    int ret = 1;
+
+    for(async = 0; async < 2; async++){
+        gpio_deinit();
+        if(bb->prepare && bb->prepare()){
+            return 1;
+        }
+
+        inner = bb->be;
+        counting_backend.write_batch = inner->write_batch ? count_write_batch : NULL;
+        counting_backend.write_bank = inner->write_bank ? count_write_bank : NULL;
+        if(gpio_init_backend(&counting_backend) || setup_display()){
+            goto out;
+        }
+        if(async && gpio_async_start()){
+            goto out;
+        }
+
+        backend_ops = 0;
+        t_start = now_ns();
+        for(i = 0; i < frames; i++){
+            sc->frame(i, async);
+        }
+        t_loop = now_ns() - t_start;
+        if(gpio_flush()){
+            goto out;
+        }
+        t_total = now_ns() - t_start;
+        gpio_async_stop();
+        gpio_async_get_stats(&stats);
+
+        printf("%-10s %-7s %-5s %8ld %11.1f %11.1f %9.2f %9.2f %9.2f\n", sc->name, bb->name, mode_names[async],
+               frames, (double)t_loop / frames, (double)t_total / frames, (double)backend_ops / frames,
+               async ? (double)stats.queued / frames : 0, async ? (double)stats.issued / frames : 0);
+
+        gpio_deinit();
+        if(bb->cleanup){
+            bb->cleanup();
+        }
+    }
+
+    return 0;
+
+out:
+    gpio_async_stop();
+    gpio_deinit();
+    if(bb->cleanup){
+        bb->cleanup();
+    }
+
+    return ret;
+}
+
+static int setup_display(void){
+
+    uint8_t i = 0;
+
+    for(i = 0; i < NUM_PINS; i++){
+        if(gpio_export(disp_pins[i]) || gpio_config_dir(disp_pins[i], GPIO_DIR_OUT)){
+            return 1;
+        }
+    }
+
+    return gpio_port_init(&disp_port, disp_pins, NUM_PINS);
+}
+
+static int prepare_sysfs(void){
+
+    strcpy(fake_root, FAKE_SYSFS_TEMPLATE);
+    if(fake_sysfs_create(fake_root, disp_pins, NUM_PINS)){
+        return 1;
+    }
+    gpio_set_sysfs_root(fake_root);
+
+    return 0;
+}
+
+static void cleanup_sysfs(void){
+
+    fake_sysfs_destroy(fake_root);
+}
+
+static int prepare_mmio(void){
+
+    int fd = memfd_create("gpio_banks", 0);
+
+    if(fd < 0 || ftruncate(fd, GPIO_MMIO_NUM_BANKS * GPIO_MMIO_BANK_SIZE) < 0){
+        perror("Error, fake gpio banks could not be created");
+        return 1;
+    }
+
+    /* Mapped before selecting the backend, so its init keeps the fake banks */
+    if(gpio_mmio_init_fd(fd, NULL, GPIO_MMIO_EMULATE)){
+        close(fd);
+        return 1;
+    }
+    close(fd);
+
+    return 0;
+}
+
+static uint64_t now_ns(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int count_init(void){
+
+    return inner->init ? inner->init() : 0;
+}
+
+static void count_deinit(void){
+
+    if(inner->deinit){
+        inner->deinit();
+    }
+}
+
+static int count_export(uint8_t gpio_no){
+
+    return inner->export(gpio_no);
+}
+
+static int count_config_dir(uint8_t gpio_no, uint8_t dir_val){
+
+    return inner->config_dir(gpio_no, dir_val);
+}
+
+static int count_write(uint8_t gpio_no, uint8_t out_val){
+
+    backend_ops++;
+
+    return inner->write(gpio_no, out_val);
+}
+
+static int count_read(uint8_t gpio_no){
+
+    return inner->read(gpio_no);
+}
+
+static int count_config_edge(uint8_t gpio_no, const char* edge){
+
+    return inner->config_edge(gpio_no, edge);
+}
+
+static int count_write_batch(const uint8_t* pins, uint8_t npins, uint32_t mask, uint32_t values){
+
+    backend_ops++;
+
+    return inner->write_batch(pins, npins, mask, values);
+}
+
+static int count_write_bank(uint8_t bank, uint32_t mask, uint32_t values){
+
+    backend_ops++;
+
+    return inner->write_bank(bank, mask, values);
+}
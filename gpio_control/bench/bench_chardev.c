@@ -0,0 +1,114 @@
+/********************************************************************************************************//**
+* @file bench_chardev.c
+*
+* @brief Benchmark and check of the gpio character device backend using the 7 segment display lines.
+*
+* It can be run on a plain Linux box using the gpio-mockup module (or gpio-sim with four banks of 32 lines):
+*       modprobe gpio-mockup gpio_mockup_ranges=-1,32,-1,32,-1,32,-1,32
+*       ./bin/host/bench_chardev <index of the first mockup gpiochip>
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include "gpio_driver.h"
+#include "gpio_chardev.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Default number of digits written per measurement */
+#define DEFAULT_FRAMES          100000
+
+/** @brief Number of segments of the display (A to G) */
+#define NUM_SEGMENTS            7
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Gpios of the segments A to G, as wired in counter_7seg.c */
+static const uint8_t seg_gpios[NUM_SEGMENTS] = {66, 67, 69, 45, 44, 26, 46};
+
+/** @brief Segments (bit 0 is A) switched on for each digit */
+static const uint8_t digits[10] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for getting the monotonic time in seconds.
+ * @return the current time.
+ */
+static double now_s(void);
+
+/***********************************************************************************************************/
+/*                                       Main Function                                                     */
+/***********************************************************************************************************/
+
+int main(int argc, char* argv[]){
+
+    struct gpio_chardev_group grp;
+    long frames = DEFAULT_FRAMES;
+    long i = 0;
+    uint32_t read_back = 0;
+    double t_start = 0;
+    double elapsed = 0;
+
+    if(argc > 1){
+        gpio_chardev_set_chip_base(atoi(argv[1]));
+    }
+    if(argc > 2){
+        frames = atol(argv[2]);
+    }
+
+    if(gpio_chardev_request(&grp, seg_gpios, NUM_SEGMENTS, GPIO_DIR_OUT, 0, "bench_chardev")){
+        printf("Usage: %s <first gpiochip index> [frames]\n", argv[0]);
+        printf("Load gpio-mockup first: modprobe gpio-mockup gpio_mockup_ranges=-1,32,-1,32,-1,32,-1,32\n");
+        return EXIT_FAILURE;
+    }
+
+    /* Check every digit is latched in the lines */
+    for(i = 0; i < 10; i++){
+        if(gpio_chardev_set(&grp, 0x7F, digits[i]) || gpio_chardev_get(&grp, &read_back)){
+            gpio_chardev_release(&grp);
+            return EXIT_FAILURE;
+        }
+        if(read_back != digits[i]){
+            printf("FAIL: digit %ld wrote 0x%02X read 0x%02X\n", i, digits[i], read_back);
+            gpio_chardev_release(&grp);
+            return EXIT_FAILURE;
+        }
+    }
+    printf("readback check          : OK\n");
+
+    t_start = now_s();
+    for(i = 0; i < frames; i++){
+        gpio_chardev_set(&grp, 0x7F, digits[i % 10]);
+    }
+    elapsed = now_s() - t_start;
+
+    printf("digits written          : %ld\n", frames);
+    printf("ioctls per digit        : %d\n", grp.nhandles);
+    printf("digits per second       : %12.0f\n", frames / elapsed);
+
+    gpio_chardev_release(&grp);
+
+    return 0;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static double now_s(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,292 @@
+/********************************************************************************************************//**
+* @file bench_event.c
+*
+* @brief Benchmark of the gpio event engine (gpio_event.h) using the mock backend, so it runs on a host.
+*
+* Several mock inputs are serviced by the main thread with gpio_event_wait(). Two measurements are done:
+*       - ping-pong: a stimulus thread generates one edge at a time, giving the latency from the edge to
+*         its delivery,
+*       - burst: an edge is pending on every input, giving the events delivered per call and the cost of
+*         each event,
+*       - bounce: presses with contact bounce on one input, giving the returns to the application and the
+*         filtered edges per press for each debounce mode.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "gpio_driver.h"
+#include "gpio_event.h"
+#include "gpio_mock.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Default number of edges of the ping-pong measurement */
+#define DEFAULT_EDGES           20000
+
+/** @brief Number of bursts of the burst measurement */
+#define NUM_BURSTS              2000
+
+/** @brief Number of inputs serviced by the engine */
+#define NUM_INPUTS              8
+
+/** @brief Number of presses of the bounce measurement */
+#define NUM_PRESSES             10
+
+/** @brief Edges of the contact bounce of each press and release */
+#define BOUNCE_EDGES            6
+
+/** @brief Time between the edges of the contact bounce in us */
+#define BOUNCE_PERIOD_US        100
+
+/** @brief Time the button is held pressed or released in us */
+#define HOLD_TIME_US            15000
+
+/** @brief Debounce window in us */
+#define DEBOUNCE_WINDOW_US      5000
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Gpios used as inputs (free pins of the P9 header) */
+static const uint8_t input_pins[NUM_INPUTS] = {49, 48, 60, 50, 51, 5, 4, 3};
+
+/** @brief Number of edges of the ping-pong measurement */
+static long edges = DEFAULT_EDGES;
+
+/** @brief Time when the current edge was generated */
+static volatile uint64_t t_edge_ns = 0;
+
+/** @brief Number of events handled by the main thread */
+static volatile long handled = 0;
+
+/** @brief The bounce stimulus finished */
+static volatile int presses_done = 0;
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Thread generating the edges of the ping-pong measurement.
+ * @param[in] arg Is not used.
+ * @return NULL.
+ */
+static void* stimulus(void* arg);
+
+/**
+ * @brief Thread generating presses and releases with contact bounce on the first input.
+ * @param[in] arg Is not used.
+ * @return NULL.
+ */
+static void* bouncy_button(void* arg);
+
+/**
+ * @brief Function for measuring the presses with contact bounce using a debounce mode.
+ * @param[in] name Is the name of the mode printed in the report.
+ * @param[in] mode Is the debounce mode.
+ * @return void.
+ */
+static void run_bounce(const char* name, uint8_t mode);
+
+/**
+ * @brief Function for comparing two latencies, for qsort().
+ */
+static int cmp_u64(const void* a, const void* b);
+
+/**
+ * @brief Function for getting the monotonic time in ns.
+ * @return the current time.
+ */
+static uint64_t now_ns(void);
+
+/***********************************************************************************************************/
+/*                                       Main Function                                                     */
+/***********************************************************************************************************/
+
+int main(int argc, char* argv[]){
+
+    uint8_t i = 0;
+    int n = 0;
+    int k = 0;
+    long b = 0;
+    long wakeups = 0;
+    long total = 0;
+    uint64_t t_start = 0;
+    uint64_t t_burst = 0;
+    uint8_t level[NUM_INPUTS] = {0};
+    uint64_t* lat = NULL;
+    pthread_t thread;
+    struct gpio_event events[GPIO_EVENT_MAX_BATCH];
+
+    if(argc > 1){
+        edges = atol(argv[1]);
+    }
+
+    lat = malloc(edges * sizeof(*lat));
+    if(!lat || gpio_init("mock")){
+        return EXIT_FAILURE;
+    }
+
+    for(i = 0; i < NUM_INPUTS; i++){
+        if(gpio_export(input_pins[i]) || gpio_config_dir(input_pins[i], GPIO_DIR_IN) ||
+           gpio_event_add(input_pins[i], "both")){
+            return EXIT_FAILURE;
+        }
+    }
+
+    pthread_create(&thread, NULL, stimulus, NULL);
+
+    /* Ping-pong, the stimulus waits for every edge to be handled */
+    while(handled < edges){
+        n = gpio_event_wait(events, GPIO_EVENT_MAX_BATCH, -1);
+        for(k = 0; k < n; k++){
+            lat[handled] = events[k].t_ns - t_edge_ns;
+            __atomic_store_n(&handled, handled + 1, __ATOMIC_RELEASE);
+        }
+    }
+
+    pthread_join(thread, NULL);
+
+    /* Burst, every input changes before the wait */
+    for(b = 0; b < NUM_BURSTS; b++){
+        for(i = 0; i < NUM_INPUTS; i++){
+            level[i] = !level[i];
+            gpio_mock_set_input(input_pins[i], level[i]);
+        }
+        t_start = now_ns();
+        while((n = gpio_event_wait(events, GPIO_EVENT_MAX_BATCH, 0)) > 0){
+            wakeups++;
+            total += n;
+        }
+        t_burst += now_ns() - t_start;
+    }
+
+    qsort(lat, edges, sizeof(*lat), cmp_u64);
+
+    printf("inputs serviced by one thread : %d\n", NUM_INPUTS);
+    printf("ping-pong edges               : %ld\n", edges);
+    printf("edge to delivery latency (ns) : p50 %llu  p90 %llu  p99 %llu  max %llu\n",
+           (unsigned long long)lat[edges / 2], (unsigned long long)lat[edges * 90 / 100],
+           (unsigned long long)lat[edges * 99 / 100], (unsigned long long)lat[edges - 1]);
+    printf("burst edges                   : %ld\n", total);
+    printf("events per call               : %.2f\n", (double)total / wakeups);
+    printf("cost per event (ns)           : %.0f\n", (double)t_burst / total);
+
+    /* Only the first input is used, as a rising edge button */
+    for(i = 1; i < NUM_INPUTS; i++){
+        gpio_event_remove(input_pins[i]);
+    }
+    gpio_event_remove(input_pins[0]);
+    gpio_mock_set_input(input_pins[0], 0);
+    gpio_event_add(input_pins[0], "rising");
+
+    printf("bounce: %d presses, %d edges per press and release, %d us window\n", NUM_PRESSES,
+           BOUNCE_EDGES, DEBOUNCE_WINDOW_US);
+    printf("%-8s %12s %12s %12s\n", "mode", "returns/prs", "events/prs", "filtered/prs");
+    run_bounce("none", GPIO_DEBOUNCE_NONE);
+    run_bounce("lockout", GPIO_DEBOUNCE_LOCKOUT);
+    run_bounce("settle", GPIO_DEBOUNCE_SETTLE);
+
+    gpio_event_deinit();
+    free(lat);
+
+    return 0;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static void* stimulus(void* arg){
+
+    long e = 0;
+    uint8_t i = 0;
+    uint8_t level[NUM_INPUTS] = {0};
+
+    for(e = 0; e < edges; e++){
+        i = e % NUM_INPUTS;
+        level[i] ^= 1;
+        t_edge_ns = now_ns();
+        gpio_mock_set_input(input_pins[i], level[i]);
+        while(__atomic_load_n(&handled, __ATOMIC_ACQUIRE) <= e);
+    }
+
+    return NULL;
+}
+
+static void run_bounce(const char* name, uint8_t mode){
+
+    int n = 0;
+    long returns = 0;
+    long delivered = 0;
+    pthread_t thread;
+    struct gpio_event_stats before;
+    struct gpio_event_stats after;
+    struct gpio_event events[GPIO_EVENT_MAX_BATCH];
+
+    gpio_event_set_debounce(input_pins[0], mode, DEBOUNCE_WINDOW_US);
+    gpio_event_get_stats(&before);
+
+    presses_done = 0;
+    pthread_create(&thread, NULL, bouncy_button, NULL);
+
+    /* Keep waiting after the last press so the last settle window expires */
+    while(!presses_done || n > 0){
+        n = gpio_event_wait(events, GPIO_EVENT_MAX_BATCH, 2 * DEBOUNCE_WINDOW_US / 1000);
+        if(n > 0){
+            returns++;
+            delivered += n;
+        }
+    }
+    pthread_join(thread, NULL);
+
+    gpio_event_get_stats(&after);
+    printf("%-8s %12.2f %12.2f %12.2f\n", name, (double)returns / NUM_PRESSES,
+           (double)delivered / NUM_PRESSES, (double)(after.filtered - before.filtered) / NUM_PRESSES);
+}
+
+static void* bouncy_button(void* arg){
+
+    int p = 0;
+    int e = 0;
+    uint8_t level = 0;
+
+    for(p = 0; p < NUM_PRESSES; p++){
+        /* Press: the contact bounces and stays high, release: it bounces and stays low */
+        for(level = 1; level <= 2; level++){
+            for(e = 0; e < BOUNCE_EDGES; e++){
+                gpio_mock_set_input(input_pins[0], (e & 1) == (level == 1 ? 0 : 1));
+                usleep(BOUNCE_PERIOD_US);
+            }
+            gpio_mock_set_input(input_pins[0], level == 1);
+            usleep(HOLD_TIME_US);
+        }
+    }
+    presses_done = 1;
+
+    return NULL;
+}
+
+static int cmp_u64(const void* a, const void* b){
+
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+static uint64_t now_ns(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
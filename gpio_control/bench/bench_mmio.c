@@ -0,0 +1,193 @@
+/********************************************************************************************************//**
+* @file bench_mmio.c
+*
+* @brief Benchmark of the memory mapped gpio backend using a fake register file (memfd), so it runs on a
+*        host machine without the board.
+*
+* The throughput of single gpio toggles and 7 segment digit writes is compared against the sysfs driver
+* running on a fake sysfs tree.
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "gpio_driver.h"
+#include "gpio_mmio.h"
+#include "fake_sysfs.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Default number of operations per measurement */
+#define DEFAULT_OPS             200000
+
+/** @brief Gpio used for the toggle benchmark (segment A of the 7 segment display) */
+#define BENCH_GPIO              66
+
+/** @brief Number of segments of the display (A to G) */
+#define NUM_SEGMENTS            7
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Gpios of the segments A to G, as wired in counter_7seg.c */
+static const uint8_t seg_gpios[NUM_SEGMENTS] = {66, 67, 69, 45, 44, 26, 46};
+
+/** @brief Segments (bit 0 is A) switched on for each digit */
+static const uint8_t digits[10] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
+
+/** @brief Root path of the fake sysfs tree */
+static char fake_root[] = FAKE_SYSFS_TEMPLATE;
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for writing a digit using one bank write per bank touched.
+ * @param[in] segments Is the bitmask of segments to switch on.
+ * @return void.
+ */
+static void mmio_write_digit(uint8_t segments);
+
+/**
+ * @brief Function for getting the monotonic time in seconds.
+ * @return the current time.
+ */
+static double now_s(void);
+
+/***********************************************************************************************************/
+/*                                       Main Function                                                     */
+/***********************************************************************************************************/
+
+int main(int argc, char* argv[]){
+
+    int fd = 0;
+    long ops = DEFAULT_OPS;
+    long i = 0;
+    uint8_t s = 0;
+    uint8_t read_back = 0;
+    struct gpio_port seg_port;
+    double t_start = 0;
+    double mmio_toggle = 0;
+    double mmio_digit = 0;
+    double sysfs_toggle = 0;
+    double sysfs_digit = 0;
+
+    if(argc > 1){
+        ops = atol(argv[1]);
+    }
+
+    /* Fake register file for the four banks */
+    fd = memfd_create("gpio_banks", 0);
+    if(fd < 0 || ftruncate(fd, GPIO_MMIO_NUM_BANKS * GPIO_MMIO_BANK_SIZE) < 0){
+        perror("Error, fake gpio banks could not be created");
+        return EXIT_FAILURE;
+    }
+    if(gpio_mmio_init_fd(fd, NULL, GPIO_MMIO_EMULATE)){
+        return EXIT_FAILURE;
+    }
+    close(fd);
+
+    for(s = 0; s < NUM_SEGMENTS; s++){
+        gpio_mmio_config_dir(seg_gpios[s], GPIO_DIR_OUT);
+    }
+
+    /* Check every digit is latched in the fake banks */
+    for(i = 0; i < 10; i++){
+        mmio_write_digit(digits[i]);
+        read_back = 0;
+        for(s = 0; s < NUM_SEGMENTS; s++){
+            read_back |= gpio_mmio_read(seg_gpios[s]) << s;
+        }
+        if(read_back != digits[i]){
+            printf("FAIL: digit %ld wrote 0x%02X read 0x%02X\n", i, digits[i], read_back);
+            return EXIT_FAILURE;
+        }
+    }
+    printf("readback check          : OK\n");
+
+    t_start = now_s();
+    for(i = 0; i < ops; i++){
+        gpio_mmio_write(BENCH_GPIO, i & 1);
+    }
+    mmio_toggle = ops / (now_s() - t_start);
+
+    t_start = now_s();
+    for(i = 0; i < ops; i++){
+        mmio_write_digit(digits[i % 10]);
+    }
+    mmio_digit = ops / (now_s() - t_start);
+
+    gpio_mmio_deinit();
+
+    /* Same measurements with the sysfs driver on a fake tree */
+    if(fake_sysfs_create(fake_root, seg_gpios, NUM_SEGMENTS)){
+        return EXIT_FAILURE;
+    }
+    gpio_set_sysfs_root(fake_root);
+    gpio_port_init(&seg_port, seg_gpios, NUM_SEGMENTS);
+
+    t_start = now_s();
+    for(i = 0; i < ops; i++){
+        gpio_write_value(BENCH_GPIO, i & 1);
+    }
+    sysfs_toggle = ops / (now_s() - t_start);
+
+    t_start = now_s();
+    for(i = 0; i < ops; i++){
+        gpio_write_mask(&seg_port, 0x7F, digits[i % 10]);
+    }
+    sysfs_digit = ops / (now_s() - t_start);
+
+    gpio_close_all();
+    fake_sysfs_destroy(fake_root);
+
+    printf("operations per measurement : %ld\n", ops);
+    printf("                  %16s %16s\n", "toggles/s", "digits/s");
+    printf("sysfs (cached fd) %16.0f %16.0f\n", sysfs_toggle, sysfs_digit);
+    printf("mmio              %16.0f %16.0f\n", mmio_toggle, mmio_digit);
+
+    return 0;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static void mmio_write_digit(uint8_t segments){
+
+    uint8_t s = 0;
+    uint32_t mask[GPIO_MMIO_NUM_BANKS] = {0};
+    uint32_t values[GPIO_MMIO_NUM_BANKS] = {0};
+    uint8_t bank = 0;
+
+    for(s = 0; s < NUM_SEGMENTS; s++){
+        bank = seg_gpios[s] / GPIO_MMIO_BANK_LINES;
+        mask[bank] |= 1UL << (seg_gpios[s] % GPIO_MMIO_BANK_LINES);
+        if(segments & (1 << s)){
+            values[bank] |= 1UL << (seg_gpios[s] % GPIO_MMIO_BANK_LINES);
+        }
+    }
+
+    for(bank = 0; bank < GPIO_MMIO_NUM_BANKS; bank++){
+        if(mask[bank]){
+            gpio_mmio_write_bank(bank, mask[bank], values[bank]);
+        }
+    }
+}
+
+static double now_s(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
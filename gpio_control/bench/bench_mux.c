@@ -0,0 +1,478 @@
+/********************************************************************************************************//**
+* @file bench_mux.c
+*
+* @brief Check and benchmark of the multiplex refresh engine (seg7_mux.h) using the mock backend.
+*
+* The check feeds every transition of the 4 digit display to a model of the digits (mock observer) while
+* the engine refreshes a fixed frame, and verifies that at most one digit is on, that the segments never
+* change while a digit is on and that each digit is switched on with its own glyph. A second check dims
+* the digits to different levels (one of them off) with a blank time, and also verifies that no digit is
+* lit before the blank time has passed and that the digit at level 0 is never lit; the time each digit was
+* on, as seen by the model, gives its duty.
+*
+* The benchmark runs the engine for a fixed time at several slot lengths while the application posts a
+* new number every POST_PERIOD_US, and reports the achieved slot and frame rates, the overruns, the
+* lateness of the slots (refresh jitter) and the CPU used by the refresh thread. The CPU used by the
+* previous refresh of counter_4dig7seg.c (the frame played as a waveform in a loop) is given for reference.
+* It then runs the engine at several brightness levels and reports the nominal and measured share of the
+* time a digit is lit (the average current of the display relative to full brightness) and the CPU.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "gpio_driver.h"
+#include "gpio_mock.h"
+#include "gpio_wave.h"
+#include "seg7_mux.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Default run time of each measurement in ms */
+#define DEFAULT_RUN_MS          1000
+
+/** @brief Run time of the check in ms */
+#define CHECK_RUN_MS            200
+
+/** @brief Slot of the check in us */
+#define CHECK_SLOT_US           250
+
+/** @brief Slot and blank time of the dimmed check in us */
+#define DIM_SLOT_US             1000
+#define DIM_BLANK_US            50
+
+/** @brief Slot of the brightness measurements in us */
+#define BRIGHT_SLOT_US          1000
+
+/** @brief Time between two numbers posted during a measurement */
+#define POST_PERIOD_US          10000
+
+/** @brief Number of digits of the 4 digit display */
+#define NUM_DIGITS              4
+
+#define DIGIT_MASK              0xF00   /**< @brief Digit selection lines in the display port of the wave */
+#define DIGIT_HOLD_NS           100000  /**< @brief Time a digit was on in the waveform refresh */
+#define DIGIT_BLANK_NS          10000   /**< @brief Time between two digits in the waveform refresh */
+
+/** @brief Steps of the waveform of a frame */
+#define FRAME_STEPS             (2 * NUM_DIGITS + 1)
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Model of the display fed by the mock observer */
+struct display_model{
+    uint8_t segments;                   /**< @brief Current level of the segments, bit N is seg_pins[N] */
+    uint8_t selected;                   /**< @brief Digits on, bit N is digit_pins[N] low */
+    uint8_t glyphs[NUM_DIGITS];         /**< @brief Frame posted */
+    uint32_t on[NUM_DIGITS];            /**< @brief Times each digit was switched on */
+    uint32_t ghost;                     /**< @brief Segment changes while a digit was on */
+    uint32_t overlap;                   /**< @brief Transitions leaving several digits on */
+    uint32_t wrong;                     /**< @brief Digits switched on with a wrong glyph */
+    uint64_t blank_ns;                  /**< @brief Blank time expected before a digit is switched on */
+    uint64_t t_off;                     /**< @brief Time the last digit was switched off */
+    uint64_t t_on[NUM_DIGITS];          /**< @brief Time each digit was last switched on */
+    uint64_t lit_ns[NUM_DIGITS];        /**< @brief Time each digit was on */
+    uint32_t short_blank;               /**< @brief Digits switched on before the end of the blank time */
+};
+
+/** @brief Brightness measurement */
+struct bright_run{
+    uint8_t level;                      /**< @brief Brightness of every digit */
+    uint32_t blank_us;                  /**< @brief Blank time */
+};
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Segment pins A to G and DP, as wired in counter_4dig7seg.c */
+static const uint8_t seg_pins[SEG7_NUM_PINS] = {66, 67, 69, 45, 44, 26, 46, 68};
+
+/** @brief Digit selection pins, as wired in counter_4dig7seg.c */
+static const uint8_t digit_pins[NUM_DIGITS] = {48, 49, 112, 115};
+
+/** @brief Segment and digit selection pins in one port, as the waveform refresh used */
+static const uint8_t disp_pins[SEG7_NUM_PINS + NUM_DIGITS] = {
+    66, 67, 69, 45, 44, 26, 46, 68, 48, 49, 112, 115
+};
+
+/** @brief Slots measured, in us */
+static const uint32_t slots_us[] = {1000, 500, 250, 100};
+
+/** @brief Brightness of each digit in the dimmed check */
+static const uint8_t dim_levels[NUM_DIGITS] = {SEG7_MUX_BRIGHTNESS_MAX, 8, 2, 0};
+
+/** @brief Brightness measurements */
+static const struct bright_run bright_runs[] = {
+    {SEG7_MUX_BRIGHTNESS_MAX, 0}, {SEG7_MUX_BRIGHTNESS_MAX, 20}, {12, 20}, {8, 20}, {4, 20}, {1, 20}
+};
+
+static struct gpio_port disp_port;
+static struct gpio_wave_step frame_steps[FRAME_STEPS];
+static struct gpio_wave frame_wave;
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for checking the transitions of the refresh against the display model.
+ * @param[in] slot_us Is the slot.
+ * @param[in] levels Is the brightness of each digit.
+ * @param[in] blank_us Is the blank time.
+ * @return 0 if the refresh is correct.
+ * @return != 0 if not.
+ */
+static int run_check(uint32_t slot_us, const uint8_t* levels, uint32_t blank_us);
+
+/**
+ * @brief Observer of the mock backend updating the display model.
+ * @param[in] event Is the transition.
+ * @param[in] ctx Is the display model.
+ * @return void.
+ */
+static void model_observer(const struct gpio_mock_event* event, void* ctx);
+
+/**
+ * @brief Function for measuring the engine at one slot length.
+ * @param[in] slot_us Is the slot.
+ * @param[in] run_ms Is the run time.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int run_mux(uint32_t slot_us, long run_ms);
+
+/**
+ * @brief Function for measuring the lit time and CPU of the engine at one brightness.
+ * @param[in] run Is the brightness and blank time.
+ * @param[in] run_ms Is the run time.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int run_bright(const struct bright_run* run, long run_ms);
+
+/**
+ * @brief Function for measuring the CPU of the waveform refresh in a loop.
+ * @param[in] run_ms Is the run time.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int run_wave(long run_ms);
+
+/**
+ * @brief Function for getting the CPU time used by the process in us.
+ * @return the user and system time.
+ */
+static uint64_t cpu_time_us(void);
+
+/**
+ * @brief Function for getting the monotonic time in us.
+ * @return the current time.
+ */
+static uint64_t now_us(void);
+
+/***********************************************************************************************************/
+/*                                       Main Function                                                     */
+/***********************************************************************************************************/
+
+int main(int argc, char* argv[]){
+
+    uint8_t i = 0;
+    long run_ms = DEFAULT_RUN_MS;
+    const uint8_t full[NUM_DIGITS] = {SEG7_MUX_BRIGHTNESS_MAX, SEG7_MUX_BRIGHTNESS_MAX,
+                                      SEG7_MUX_BRIGHTNESS_MAX, SEG7_MUX_BRIGHTNESS_MAX};
+
+    if(argc > 1){
+        run_ms = atol(argv[1]);
+    }
+
+    if(gpio_init("mock")){
+        return EXIT_FAILURE;
+    }
+
+    for(i = 0; i < sizeof(disp_pins); i++){
+        if(gpio_export(disp_pins[i]) || gpio_config_dir(disp_pins[i], GPIO_DIR_OUT)){
+            return EXIT_FAILURE;
+        }
+    }
+    if(gpio_port_init(&disp_port, disp_pins, sizeof(disp_pins))){
+        return EXIT_FAILURE;
+    }
+    gpio_write_mask(&disp_port, SEG7_SEGMENT_MASK | SEG7_DP | DIGIT_MASK, DIGIT_MASK);
+
+    if(run_check(CHECK_SLOT_US, full, 0) || run_check(DIM_SLOT_US, dim_levels, DIM_BLANK_US)){
+        return EXIT_FAILURE;
+    }
+
+    printf("\nrun per slot (ms)             : %ld, a new number every %d ms\n", run_ms,
+           POST_PERIOD_US / 1000);
+    printf("%-10s %9s %10s %9s %13s %10s %10s %10s %8s\n", "refresh", "slot(us)", "slots/s", "frames/s",
+           "overruns", "late(us)", "p99(us)", "max(us)", "cpu(%)");
+    for(i = 0; i < sizeof(slots_us) / sizeof(slots_us[0]); i++){
+        if(run_mux(slots_us[i], run_ms)){
+            return EXIT_FAILURE;
+        }
+    }
+
+    if(run_wave(run_ms)){
+        return EXIT_FAILURE;
+    }
+
+    printf("\n%-10s %9s %9s %10s %10s %10s %10s %8s\n", "brightness", "slot(us)", "blank(us)", "nominal(%)",
+           "lit(%)", "late(us)", "overruns", "cpu(%)");
+    for(i = 0; i < sizeof(bright_runs) / sizeof(bright_runs[0]); i++){
+        if(run_bright(&bright_runs[i], run_ms)){
+            return EXIT_FAILURE;
+        }
+    }
+
+    gpio_deinit();
+
+    return 0;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static int run_check(uint32_t slot_us, const uint8_t* levels, uint32_t blank_us){
+
+    uint8_t d = 0;
+    int ok = 0;
+    uint64_t run_ns = 0;
+    struct display_model model = {
+        .glyphs = {0x06, 0x5B | SEG7_DP, 0x4F, 0x66},   /* 12.34 */
+        .blank_ns = blank_us * 1000
+    };
+
+    for(d = 0; d < SEG7_NUM_PINS; d++){
+        model.segments |= gpio_mock_get_value(seg_pins[d]) ? 1 << d : 0;
+    }
+    for(d = 0; d < NUM_DIGITS; d++){
+        model.selected |= gpio_mock_get_value(digit_pins[d]) ? 0 : 1 << d;
+    }
+
+    if(seg7_mux_init(seg_pins, digit_pins, NUM_DIGITS, slot_us) || seg7_mux_set_blank(blank_us)){
+        return 1;
+    }
+    for(d = 0; d < NUM_DIGITS; d++){
+        if(seg7_mux_set_digit_brightness(d, levels[d])){
+            return 1;
+        }
+    }
+    seg7_mux_post(model.glyphs);
+
+    gpio_mock_set_observer(model_observer, &model);
+    run_ns = now_us() * 1000;
+    if(seg7_mux_start()){
+        return 1;
+    }
+    usleep(CHECK_RUN_MS * 1000);
+    seg7_mux_stop();
+    run_ns = now_us() * 1000 - run_ns;
+    gpio_mock_set_observer(NULL, NULL);
+    seg7_mux_deinit();
+
+    /* Each digit lit if and only if its level is not 0 */
+    ok = !model.ghost && !model.overlap && !model.wrong && !model.selected && !model.short_blank;
+    for(d = 0; d < NUM_DIGITS; d++){
+        ok = ok && (!model.on[d] == !levels[d]);
+    }
+
+    printf("check (%d ms, %4d us slots, %2u us blank): digits on %u %u %u %u, ghost segment changes %u, "
+           "overlaps %u, wrong glyphs %u, short blanks %u: %s\n", CHECK_RUN_MS, slot_us, blank_us,
+           model.on[0], model.on[1], model.on[2], model.on[3], model.ghost, model.overlap, model.wrong,
+           model.short_blank, ok ? "OK" : "FAIL");
+    printf("  levels %2u %2u %2u %2u, duty of the digits (%%): %.1f %.1f %.1f %.1f\n", levels[0], levels[1],
+           levels[2], levels[3], 100.0 * model.lit_ns[0] / run_ns, 100.0 * model.lit_ns[1] / run_ns,
+           100.0 * model.lit_ns[2] / run_ns, 100.0 * model.lit_ns[3] / run_ns);
+
+    return !ok;
+}
+
+static void model_observer(const struct gpio_mock_event* event, void* ctx){
+
+    uint8_t i = 0;
+    struct display_model* model = ctx;
+
+    for(i = 0; i < SEG7_NUM_PINS; i++){
+        if(event->gpio_no == seg_pins[i]){
+            model->segments = event->value ? model->segments | (1 << i) : model->segments & ~(1 << i);
+            if(model->selected){
+                model->ghost++;
+            }
+            return;
+        }
+    }
+
+    for(i = 0; i < NUM_DIGITS; i++){
+        if(event->gpio_no != digit_pins[i]){
+            continue;
+        }
+
+        /* Digit selection is active low */
+        if(event->value){
+            if(model->selected & (1 << i)){
+                model->lit_ns[i] += event->t_ns - model->t_on[i];
+                model->t_off = event->t_ns;
+            }
+            model->selected &= ~(1 << i);
+            return;
+        }
+        model->selected |= 1 << i;
+        model->on[i]++;
+        model->t_on[i] = event->t_ns;
+        if(model->selected & (model->selected - 1)){
+            model->overlap++;
+        }
+        if(model->t_off && event->t_ns - model->t_off < model->blank_ns){
+            model->short_blank++;
+        }
+        if(model->segments != model->glyphs[i]){
+            model->wrong++;
+        }
+        return;
+    }
+}
+
+static int run_mux(uint32_t slot_us, long run_ms){
+
+    uint32_t number = 0;
+    uint64_t start = 0;
+    struct seg7_mux_stats stats;
+
+    if(seg7_mux_init(seg_pins, digit_pins, NUM_DIGITS, slot_us)){
+        return 1;
+    }
+    seg7_mux_reset_stats();
+    gpio_mock_reset();
+
+    if(seg7_mux_start()){
+        return 1;
+    }
+    start = now_us();
+    while(now_us() - start < (uint64_t)run_ms * 1000){
+        seg7_mux_post_number(number++, 0);
+        usleep(POST_PERIOD_US);
+    }
+    seg7_mux_stop();
+    seg7_mux_get_stats(&stats);
+    seg7_mux_deinit();
+
+    if(!stats.slots || !stats.run_ns){
+        fprintf(stderr, "Error, the refresh thread did not run\n");
+        return 1;
+    }
+
+    printf("%-10s %9u %10.0f %9.1f %13u %10.2f %10.1f %10.1f %8.2f\n", "mux", slot_us,
+           stats.slots * 1e9 / stats.run_ns, stats.slots * 1e9 / stats.run_ns / NUM_DIGITS, stats.overruns,
+           stats.late_total_ns / 1000.0 / stats.slots, seg7_mux_late_percentile(&stats, 99) / 1000.0,
+           stats.late_max_ns / 1000.0, 100.0 * stats.cpu_ns / stats.run_ns);
+
+    return stats.errors != 0;
+}
+
+static int run_bright(const struct bright_run* run, long run_ms){
+
+    uint32_t number = 0;
+    uint64_t start = 0;
+    struct seg7_mux_stats stats;
+
+    if(seg7_mux_init(seg_pins, digit_pins, NUM_DIGITS, BRIGHT_SLOT_US) ||
+       seg7_mux_set_blank(run->blank_us) || seg7_mux_set_brightness(run->level)){
+        return 1;
+    }
+    seg7_mux_reset_stats();
+    gpio_mock_reset();
+
+    if(seg7_mux_start()){
+        return 1;
+    }
+    start = now_us();
+    while(now_us() - start < (uint64_t)run_ms * 1000){
+        seg7_mux_post_number(number++, 0);
+        usleep(POST_PERIOD_US);
+    }
+    seg7_mux_stop();
+    seg7_mux_get_stats(&stats);
+    seg7_mux_deinit();
+
+    if(!stats.slots || !stats.run_ns){
+        fprintf(stderr, "Error, the refresh thread did not run\n");
+        return 1;
+    }
+
+    printf("%-10u %9d %9u %10.1f %10.1f %10.2f %10u %8.2f\n", run->level, BRIGHT_SLOT_US, run->blank_us,
+           100.0 * (BRIGHT_SLOT_US - run->blank_us) * run->level / BRIGHT_SLOT_US / SEG7_MUX_BRIGHTNESS_MAX,
+           100.0 * stats.lit_ns / stats.run_ns, stats.late_total_ns / 1000.0 / stats.slots, stats.overruns,
+           100.0 * stats.cpu_ns / stats.run_ns);
+
+    return stats.errors != 0;
+}
+
+static int run_wave(long run_ms){
+
+    uint8_t d = 0;
+    uint16_t number = 0;
+    uint16_t n = 0;
+    uint64_t frames = 0;
+    uint64_t start = 0;
+    uint64_t wall = 0;
+    uint64_t cpu = 0;
+
+    gpio_wave_init(&frame_wave, &disp_port, frame_steps, FRAME_STEPS);
+    gpio_mock_reset();
+
+    cpu = cpu_time_us();
+    start = now_us();
+    while((wall = now_us() - start) < (uint64_t)run_ms * 1000){
+        number = wall / POST_PERIOD_US;
+
+        /* Same waveform as display_number() in counter_4dig7seg.c before the refresh thread */
+        gpio_wave_clear(&frame_wave);
+        for(d = NUM_DIGITS, n = number; d > 0; d--){
+            gpio_wave_add(&frame_wave, (d == NUM_DIGITS) ? 0 : DIGIT_BLANK_NS, SEG7_SEGMENT_MASK | DIGIT_MASK,
+                          seg7_encode_hex(n % 10) | (DIGIT_MASK & ~(1 << (SEG7_NUM_PINS + d - 1))));
+            gpio_wave_add(&frame_wave, DIGIT_HOLD_NS, SEG7_SEGMENT_MASK | DIGIT_MASK, DIGIT_MASK);
+            n /= 10;
+        }
+        gpio_wave_add(&frame_wave, DIGIT_BLANK_NS, 0, 0);
+        if(gpio_wave_play(&frame_wave, NULL)){
+            return 1;
+        }
+        frames++;
+    }
+    cpu = cpu_time_us() - cpu;
+
+    printf("%-10s %9d %10.0f %9.1f %13s %10s %10s %10s %8.2f\n", "wave loop",
+           (DIGIT_HOLD_NS + DIGIT_BLANK_NS) / 1000, frames * NUM_DIGITS * 1e6 / wall, frames * 1e6 / wall, "-",
+           "-", "-", "-", 100.0 * cpu / wall);
+
+    return 0;
+}
+
+static uint64_t cpu_time_us(void){
+
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ULL + ru.ru_utime.tv_usec +
+           ru.ru_stime.tv_usec;
+}
+
+static uint64_t now_us(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
@@ -0,0 +1,174 @@
+/********************************************************************************************************//**
+* @file bench_pwm.c
+*
+* @brief Benchmark of the software PWM engine (gpio_pwm.h) using the mock backend, so it runs on a host.
+*
+* Several mock outputs with different duty cycles are driven by the engine during a fixed time. The report
+* gives the lateness of the edges (from the deadline to the port write), the overruns, the port writes per
+* period, the CPU used by the process and, for each gpio, the duty cycle measured from the transitions
+* recorded by the mock backend.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "gpio_driver.h"
+#include "gpio_mock.h"
+#include "gpio_pwm.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Default PWM period in us */
+#define DEFAULT_PERIOD_US       2000
+
+/** @brief Duration of the measurement in ms */
+#define RUN_TIME_MS             2000
+
+/** @brief Number of PWM outputs */
+#define NUM_OUTPUTS             8
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Gpios used as outputs (segments and digits of the 4 digit display) */
+static const uint8_t output_pins[NUM_OUTPUTS] = {66, 67, 69, 45, 44, 26, 46, 68};
+
+/** @brief Duty cycle of each output */
+static const uint8_t output_duty[NUM_OUTPUTS] = {0, 5, 12, 25, 50, 50, 90, 100};
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for measuring the duty cycle of a gpio from the recorded transitions.
+ * @param[in] gpio_no Is the gpio number.
+ * @param[in] events Is the array of recorded transitions.
+ * @param[in] n Is the number of transitions.
+ * @return the duty cycle in percent, between the first and the last rising edge.
+ */
+static double measured_duty(uint8_t gpio_no, const struct gpio_mock_event* events, uint32_t n);
+
+/**
+ * @brief Function for getting the CPU time used by the process in us.
+ * @return the user and system time.
+ */
+static uint64_t cpu_time_us(void);
+
+/***********************************************************************************************************/
+/*                                       Main Function                                                     */
+/***********************************************************************************************************/
+
+int main(int argc, char* argv[]){
+
+    uint8_t i = 0;
+    uint32_t period_us = DEFAULT_PERIOD_US;
+    uint32_t n = 0;
+    uint64_t cpu = 0;
+    const struct gpio_mock_event* events = NULL;
+    struct gpio_pwm_stats stats;
+
+    if(argc > 1){
+        period_us = atoi(argv[1]);
+    }
+
+    if(gpio_init("mock") || gpio_pwm_init(period_us)){
+        return EXIT_FAILURE;
+    }
+
+    for(i = 0; i < NUM_OUTPUTS; i++){
+        if(gpio_export(output_pins[i]) || gpio_config_dir(output_pins[i], GPIO_DIR_OUT) ||
+           gpio_pwm_add(output_pins[i], output_duty[i])){
+            return EXIT_FAILURE;
+        }
+    }
+
+    gpio_mock_reset();
+    cpu = cpu_time_us();
+    if(gpio_pwm_start()){
+        return EXIT_FAILURE;
+    }
+    usleep(RUN_TIME_MS * 1000);
+    gpio_pwm_stop();
+    cpu = cpu_time_us() - cpu;
+
+    gpio_pwm_get_stats(&stats);
+    n = gpio_mock_get_events(&events);
+
+    printf("outputs driven by one thread  : %d\n", NUM_OUTPUTS);
+    printf("period (us)                   : %u\n", period_us);
+    printf("periods                       : %u\n", stats.periods);
+    printf("port writes per period        : %.2f\n", (double)stats.edges / stats.periods);
+    printf("overruns                      : %u\n", stats.overruns);
+    printf("edge lateness (ns)            : mean %llu  p50 %u  p99 %u  max %u\n",
+           (unsigned long long)(stats.late_total_ns / stats.edges), gpio_pwm_late_percentile(&stats, 50),
+           gpio_pwm_late_percentile(&stats, 99), stats.late_max_ns);
+    printf("cpu usage                     : %.1f %%\n", 100.0 * cpu / (RUN_TIME_MS * 1000));
+    printf("%-6s %10s %10s\n", "gpio", "duty(%)", "measured");
+    for(i = 0; i < NUM_OUTPUTS; i++){
+        printf("%-6d %10d %10.2f\n", output_pins[i], output_duty[i], measured_duty(output_pins[i], events, n));
+    }
+
+    gpio_pwm_deinit();
+
+    return 0;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static double measured_duty(uint8_t gpio_no, const struct gpio_mock_event* events, uint32_t n){
+
+    uint32_t i = 0;
+    uint64_t t_first = 0;
+    uint64_t t_last = 0;
+    uint64_t high = 0;
+    uint64_t pulse = 0;
+    uint8_t level = 0;
+    uint8_t started = 0;
+
+    for(i = 0; i < n; i++){
+        if(events[i].gpio_no != gpio_no || events[i].value == level){
+            continue;
+        }
+        level = events[i].value;
+        if(level){
+            if(!started){
+                t_first = events[i].t_ns;
+                started = 1;
+            }
+            t_last = events[i].t_ns;
+            pulse = 0;
+        }
+        else if(started){
+            pulse = events[i].t_ns - t_last;
+            high += pulse;
+        }
+    }
+
+    /* Always on or always off */
+    if(!started || t_last == t_first){
+        return level ? 100.0 : 0.0;
+    }
+
+    /* The pulse of the last rising edge belongs to a period which is not measured */
+    high -= pulse;
+
+    return 100.0 * high / (t_last - t_first);
+}
+
+static uint64_t cpu_time_us(void){
+
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ULL + ru.ru_utime.tv_usec +
+           ru.ru_stime.tv_usec;
+}
@@ -0,0 +1,289 @@
+/********************************************************************************************************//**
+* @file bench_read.c
+*
+* @brief Benchmark of the bulk input reads (gpio_read_port()) and of the fixed rate sampler (gpio_sampler.h)
+*        on a host machine.
+*
+* The 8 lines of a 4x4 keypad are read one by one with gpio_read_value() and at once with gpio_read_port()
+* on the mock backend, the sysfs backend on a fake tree and the mmio backend on fake banks. Then a quadrature
+* encoder is simulated on two mock inputs while the sampler stores the changes, and the steps decoded from
+* the samples are compared with the steps generated.
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "gpio_driver.h"
+#include "gpio_mmio.h"
+#include "gpio_mock.h"
+#include "gpio_sampler.h"
+#include "fake_sysfs.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Default number of reads per measurement */
+#define DEFAULT_READS           100000
+
+#define NUM_KEYPAD_PINS         8       /**< @brief 4 rows and 4 columns */
+#define NUM_ENCODER_PINS        2       /**< @brief Channels A and B */
+
+#define SAMPLE_PERIOD_US        250     /**< @brief Sampling period of the encoder */
+#define STEP_PERIOD_US          1000    /**< @brief Time between two encoder steps */
+#define ENCODER_STEPS           2000    /**< @brief Steps generated (2 s) */
+#define READ_BATCH              64      /**< @brief Samples consumed per gpio_sampler_read() */
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Keypad lines, spread over three banks */
+static const uint8_t keypad_pins[NUM_KEYPAD_PINS] = {30, 31, 48, 49, 60, 112, 115, 117};
+
+/** @brief Encoder channels A (bit 0) and B (bit 1) */
+static const uint8_t encoder_pins[NUM_ENCODER_PINS] = {14, 15};
+
+/** @brief Gray sequence of the encoder channels (B << 1 | A) */
+static const uint8_t quadrature[4] = {0x0, 0x1, 0x3, 0x2};
+
+/** @brief Root path of the fake sysfs tree */
+static char fake_root[] = FAKE_SYSFS_TEMPLATE;
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for configuring the keypad lines as inputs and measuring both read methods.
+ * @param[in] name Is the backend name printed.
+ * @param[in] reads Is the number of reads per method.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int run_keypad(const char* name, long reads);
+
+/**
+ * @brief Function for simulating the encoder and decoding the samples stored by the sampler.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int run_encoder(void);
+
+/**
+ * @brief Function for consuming the stored samples and decoding the encoder steps.
+ * @param[in,out] state Is the position of the last sample in the quadrature sequence.
+ * @param[in,out] steps Is the steps decoded (+1 forward, -1 backward).
+ * @param[in,out] invalid Is the transitions skipping a state (a missed sample).
+ * @return void.
+ */
+static void decode_samples(uint8_t* state, int32_t* steps, uint32_t* invalid);
+
+/**
+ * @brief Function for getting the monotonic time in ns.
+ * @return the current time.
+ */
+static uint64_t now_ns(void);
+
+/***********************************************************************************************************/
+/*                                       Main Function                                                     */
+/***********************************************************************************************************/
+
+int main(int argc, char* argv[]){
+
+    int fd = 0;
+    long reads = DEFAULT_READS;
+
+    if(argc > 1){
+        reads = atol(argv[1]);
+    }
+
+    printf("keypad, %d lines               : per pin (ns)   port (ns)\n", NUM_KEYPAD_PINS);
+
+    if(gpio_init("mock") || run_keypad("mock", reads)){
+        return EXIT_FAILURE;
+    }
+    gpio_deinit();
+
+    if(fake_sysfs_create(fake_root, keypad_pins, NUM_KEYPAD_PINS)){
+        return EXIT_FAILURE;
+    }
+    gpio_set_sysfs_root(fake_root);
+    if(gpio_init("sysfs") || run_keypad("sysfs (fake tree)", reads / 10)){
+        fake_sysfs_destroy(fake_root);
+        return EXIT_FAILURE;
+    }
+    gpio_deinit();
+    fake_sysfs_destroy(fake_root);
+
+    /* Fake register file for the four banks, injected before selecting the backend */
+    fd = memfd_create("gpio_banks", 0);
+    if(fd < 0 || ftruncate(fd, GPIO_MMIO_NUM_BANKS * GPIO_MMIO_BANK_SIZE) < 0){
+        perror("Error, fake gpio banks could not be created");
+        return EXIT_FAILURE;
+    }
+    if(gpio_mmio_init_fd(fd, NULL, GPIO_MMIO_EMULATE)){
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    if(gpio_init("mmio") || run_keypad("mmio (fake banks)", reads)){
+        return EXIT_FAILURE;
+    }
+    gpio_deinit();
+
+    if(gpio_init("mock") || run_encoder()){
+        return EXIT_FAILURE;
+    }
+    gpio_deinit();
+
+    return 0;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static int run_keypad(const char* name, long reads){
+
+    long r = 0;
+    uint8_t i = 0;
+    int level = 0;
+    uint32_t values = 0;
+    uint32_t check = 0;
+    uint64_t t = 0;
+    double pin_ns = 0;
+    double port_ns = 0;
+    struct gpio_port keypad;
+
+    for(i = 0; i < NUM_KEYPAD_PINS; i++){
+        if(gpio_export(keypad_pins[i]) || gpio_config_dir(keypad_pins[i], GPIO_DIR_IN)){
+            return 1;
+        }
+    }
+    if(gpio_port_init(&keypad, keypad_pins, NUM_KEYPAD_PINS)){
+        return 1;
+    }
+
+    t = now_ns();
+    for(r = 0; r < reads; r++){
+        values = 0;
+        for(i = 0; i < NUM_KEYPAD_PINS; i++){
+            level = gpio_read_value(keypad_pins[i]);
+            if(level < 0){
+                return 1;
+            }
+            values |= (uint32_t)level << i;
+        }
+    }
+    pin_ns = (double)(now_ns() - t) / reads;
+
+    t = now_ns();
+    for(r = 0; r < reads; r++){
+        if(gpio_read_port(&keypad, &check)){
+            return 1;
+        }
+    }
+    port_ns = (double)(now_ns() - t) / reads;
+
+    if(check != values){
+        printf("FAIL: %s port read 0x%02X, pin reads 0x%02X\n", name, check, values);
+        return 1;
+    }
+    printf("%-30s: %12.1f %11.1f\n", name, pin_ns, port_ns);
+
+    return 0;
+}
+
+static int run_encoder(void){
+
+    int32_t s = 0;
+    uint8_t i = 0;
+    uint8_t state = 0;
+    int32_t decoded = 0;
+    uint32_t invalid = 0;
+    uint64_t t_next = 0;
+    struct timespec ts;
+    struct gpio_port encoder;
+    struct gpio_sampler_stats stats;
+
+    for(i = 0; i < NUM_ENCODER_PINS; i++){
+        if(gpio_export(encoder_pins[i]) || gpio_config_dir(encoder_pins[i], GPIO_DIR_IN)){
+            return 1;
+        }
+        gpio_mock_set_input(encoder_pins[i], 0);
+    }
+    if(gpio_port_init(&encoder, encoder_pins, NUM_ENCODER_PINS) ||
+       gpio_sampler_init(&encoder, SAMPLE_PERIOD_US, GPIO_SAMPLER_CHANGES) || gpio_sampler_start()){
+        return 1;
+    }
+
+    /* One step forward per STEP_PERIOD_US, the samples are consumed in between */
+    t_next = now_ns();
+    for(s = 1; s <= ENCODER_STEPS; s++){
+        gpio_mock_set_input(encoder_pins[0], quadrature[s & 3] & 1);
+        gpio_mock_set_input(encoder_pins[1], quadrature[s & 3] >> 1);
+
+        decode_samples(&state, &decoded, &invalid);
+
+        t_next += STEP_PERIOD_US * 1000;
+        ts.tv_sec = t_next / 1000000000ULL;
+        ts.tv_nsec = t_next % 1000000000ULL;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+
+    gpio_sampler_stop();
+    decode_samples(&state, &decoded, &invalid);
+    gpio_sampler_get_stats(&stats);
+    gpio_sampler_deinit();
+
+    printf("encoder sampled every %d us, %d steps of %d us:\n", SAMPLE_PERIOD_US, ENCODER_STEPS,
+           STEP_PERIOD_US);
+    printf("samples                       : %llu\n", (unsigned long long)stats.samples);
+    printf("stored (changes only)         : %llu\n", (unsigned long long)stats.stored);
+    printf("dropped / overruns / errors   : %u / %u / %u\n", stats.dropped, stats.overruns, stats.errors);
+    printf("late mean / max (us)          : %.1f / %.1f\n",
+           stats.samples ? stats.late_total_ns / 1000.0 / stats.samples : 0, stats.late_max_ns / 1000.0);
+    printf("steps decoded                 : %d of %d (%u invalid transitions)\n", decoded, ENCODER_STEPS,
+           invalid);
+
+    return 0;
+}
+
+static void decode_samples(uint8_t* state, int32_t* steps, uint32_t* invalid){
+
+    uint32_t i = 0;
+    uint32_t n = 0;
+    struct gpio_sample samples[READ_BATCH];
+
+    do{
+        n = gpio_sampler_read(samples, READ_BATCH);
+        for(i = 0; i < n; i++){
+            /* +1 for the next state of the sequence, -1 for the previous one */
+            if(samples[i].values == quadrature[(*state + 1) & 3]){
+                (*steps)++;
+                *state = (*state + 1) & 3;
+            }
+            else if(samples[i].values == quadrature[(*state - 1) & 3]){
+                (*steps)--;
+                *state = (*state - 1) & 3;
+            }
+            else if(samples[i].values != quadrature[*state]){
+                (*invalid)++;
+                *state = (*state + 2) & 3;
+            }
+        }
+    }while(n);
+}
+
+static uint64_t now_ns(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
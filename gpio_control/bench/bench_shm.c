@@ -0,0 +1,241 @@
+/********************************************************************************************************//**
+* @file bench_shm.c
+*
+* @brief Benchmark of the gpio server (gpio_shm.h) on a host, with a server on the mock backend.
+*
+* A server process and NUM_CLIENTS client processes are forked. Each client selects the shm backend,
+* configures the pins of the 4 digit display and writes multiplexed frames (the port writes of the former
+* waveform refresh of counter_4dig7seg.c, without the hold time) as fast as it can. The report gives the
+* frames per second of each client, the commands merged by each drain of the ring, the port writes issued
+* by the server per command and the wake ups of the server. The frames per second of one process writing
+* to the mock backend directly are given as reference.
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "gpio_driver.h"
+#include "gpio_shm.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Default number of frames of each client */
+#define DEFAULT_FRAMES          100000
+
+/** @brief Number of client processes */
+#define NUM_CLIENTS             2
+
+#define NUM_PINS                12      /**< @brief Segments A to G, DP and the 4 digit selection lines */
+#define NUM_SEGMENTS            8       /**< @brief First digit selection line in the display port */
+#define NUM_DIGITS              4       /**< @brief Number of digits */
+#define SEGMENT_MASK            0x7F    /**< @brief Segments A to G */
+#define DIGIT_MASK              0xF00   /**< @brief Digit selection lines in the display port */
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Segment and digit selection pins, as grouped in the display port of seg7_mux.c */
+static const uint8_t disp_pins[NUM_PINS] = {66, 67, 69, 45, 44, 26, 46, 68, 48, 49, 112, 115};
+
+/** @brief Segments (bit 0 is A) switched on for each digit */
+static const uint8_t digit_segments[10] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
+
+/** @brief Set by SIGTERM in the server process */
+static volatile sig_atomic_t stop = 0;
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for running the server process until SIGTERM.
+ * @param[in] ready_fd Is the pipe written when the server is ready.
+ * @return the exit status.
+ */
+static int run_server(int ready_fd);
+
+/**
+ * @brief Function for configuring the display pins and writing frames with the selected backend.
+ * @param[in] frames Is the number of frames.
+ * @return the frames per second, < 0 if fail.
+ */
+static double run_client(long frames);
+
+/**
+ * @brief Signal handler for SIGTERM, stopping the server.
+ * @param[in] sig Is the signal number.
+ * @return void.
+ */
+static void stop_handler(int sig);
+
+/**
+ * @brief Function for getting the monotonic time in ns.
+ * @return the current time.
+ */
+static uint64_t now_ns(void);
+
+/***********************************************************************************************************/
+/*                                       Main Function                                                     */
+/***********************************************************************************************************/
+
+int main(int argc, char* argv[]){
+
+    int i = 0;
+    int ready[2];
+    int results[2];
+    char c = 0;
+    long frames = DEFAULT_FRAMES;
+    double fps = 0;
+    pid_t server = 0;
+    pid_t clients[NUM_CLIENTS];
+    struct gpio_shm_stats stats;
+
+    if(argc > 1){
+        frames = atol(argv[1]);
+    }
+
+    /* Reference, one process on the mock backend */
+    if(gpio_init("mock")){
+        return EXIT_FAILURE;
+    }
+    fps = run_client(frames);
+    gpio_deinit();
+    printf("direct mock, 1 process        : %.0f frames/s\n", fps);
+
+    /* Own shared memory object, so a running server is not disturbed */
+    setenv(GPIO_SHM_ENV, "/gpio_server_bench", 1);
+
+    if(pipe(ready) || pipe(results)){
+        perror("Error, pipes could not be created");
+        return EXIT_FAILURE;
+    }
+
+    fflush(stdout);
+    server = fork();
+    if(!server){
+        close(ready[0]);
+        return run_server(ready[1]);
+    }
+    close(ready[1]);
+    if(read(ready[0], &c, 1) != 1){
+        fprintf(stderr, "Error, gpio server did not start\n");
+        return EXIT_FAILURE;
+    }
+
+    for(i = 0; i < NUM_CLIENTS; i++){
+        clients[i] = fork();
+        if(!clients[i]){
+            if(gpio_init("shm")){
+                return EXIT_FAILURE;
+            }
+            fps = run_client(frames);
+            gpio_shm_flush();
+            gpio_deinit();
+            return (write(results[1], &fps, sizeof(fps)) == sizeof(fps)) ? 0 : EXIT_FAILURE;
+        }
+    }
+
+    for(i = 0; i < NUM_CLIENTS; i++){
+        if(read(results[0], &fps, sizeof(fps)) != sizeof(fps)){
+            fprintf(stderr, "Error, a client failed\n");
+            kill(server, SIGTERM);
+            return EXIT_FAILURE;
+        }
+        printf("shm client %d of %d            : %.0f frames/s\n", i + 1, NUM_CLIENTS, fps);
+        waitpid(clients[i], NULL, 0);
+    }
+
+    /* The counters are read as a client before stopping the server */
+    if(gpio_init("shm")){
+        kill(server, SIGTERM);
+        return EXIT_FAILURE;
+    }
+    gpio_shm_get_stats(&stats);
+    gpio_deinit();
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+
+    printf("commands                      : %llu\n", (unsigned long long)stats.commands);
+    printf("commands per drain            : %.2f\n", (double)stats.commands / stats.batches);
+    printf("port writes per command       : %.2f\n", (double)stats.port_writes / stats.commands);
+    printf("server wake ups               : %llu\n", (unsigned long long)stats.wakeups);
+    printf("errors                        : %u\n", stats.errors);
+
+    return 0;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static int run_server(int ready_fd){
+
+    char c = 1;
+
+    signal(SIGTERM, stop_handler);
+    if(gpio_init("mock") || gpio_shm_server_init()){
+        return EXIT_FAILURE;
+    }
+    if(write(ready_fd, &c, 1) != 1){
+        return EXIT_FAILURE;
+    }
+
+    gpio_shm_serve(&stop);
+    gpio_shm_server_deinit();
+
+    return 0;
+}
+
+static double run_client(long frames){
+
+    long f = 0;
+    uint8_t i = 0;
+    uint8_t d = 0;
+    long number = 0;
+    uint64_t t = 0;
+    struct gpio_port disp_port;
+
+    for(i = 0; i < NUM_PINS; i++){
+        if(gpio_export(disp_pins[i]) || gpio_config_dir(disp_pins[i], GPIO_DIR_OUT)){
+            return -1;
+        }
+    }
+    if(gpio_port_init(&disp_port, disp_pins, NUM_PINS)){
+        return -1;
+    }
+
+    t = now_ns();
+    for(f = 0; f < frames; f++){
+        number = f % 10000;
+        for(d = 0; d < NUM_DIGITS; d++){
+            gpio_write_mask(&disp_port, SEGMENT_MASK | DIGIT_MASK,
+                            digit_segments[number % 10] | (DIGIT_MASK & ~(1 << (NUM_SEGMENTS + d))));
+            gpio_write_mask(&disp_port, SEGMENT_MASK | DIGIT_MASK, DIGIT_MASK);
+            number /= 10;
+        }
+    }
+
+    return 1e9 * frames / (now_ns() - t);
+}
+
+static void stop_handler(int sig){
+
+    stop = 1;
+}
+
+static uint64_t now_ns(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
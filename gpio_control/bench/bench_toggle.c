@@ -0,0 +1,142 @@
+/********************************************************************************************************//**
+* @file bench_toggle.c
+*
+* @brief Benchmark measuring gpio toggles per second on a fake sysfs tree.
+*
+* The legacy path (snprintf + open + write + close per call) is compared against gpio_write_value(), which
+* uses the cached value file descriptor of each gpio.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include "gpio_driver.h"
+#include "fake_sysfs.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Default number of toggles per measurement */
+#define DEFAULT_TOGGLES         200000
+
+/** @brief Gpio used for the benchmark (segment A of the 7 segment display) */
+#define BENCH_GPIO              66
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Root path of the fake sysfs tree */
+static char fake_root[] = FAKE_SYSFS_TEMPLATE;
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function replicating the former gpio_write_value(), opening and closing the value file per call.
+ * @param[in] gpio_no Is the gpio number.
+ * @param[in] out_val Is the value to be set as output.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int legacy_write_value(uint8_t gpio_no, uint8_t out_val);
+
+/**
+ * @brief Function for getting the monotonic time in seconds.
+ * @return the current time.
+ */
+static double now_s(void);
+
+/***********************************************************************************************************/
+/*                                       Main Function                                                     */
+/***********************************************************************************************************/
+
+int main(int argc, char* argv[]){
+
+    uint8_t gpio = BENCH_GPIO;
+    long toggles = DEFAULT_TOGGLES;
+    long i = 0;
+    double t_start = 0;
+    double legacy_rate = 0;
+    double cached_rate = 0;
+
+    if(argc > 1){
+        toggles = atol(argv[1]);
+    }
+
+    if(fake_sysfs_create(fake_root, &gpio, 1)){
+        return EXIT_FAILURE;
+    }
+    gpio_set_sysfs_root(fake_root);
+
+    t_start = now_s();
+    for(i = 0; i < toggles; i++){
+        legacy_write_value(gpio, i & 1);
+    }
+    legacy_rate = toggles / (now_s() - t_start);
+
+    if(gpio_open(gpio) < 0){
+        fake_sysfs_destroy(fake_root);
+        return EXIT_FAILURE;
+    }
+
+    t_start = now_s();
+    for(i = 0; i < toggles; i++){
+        gpio_write_value(gpio, i & 1);
+    }
+    cached_rate = toggles / (now_s() - t_start);
+
+    printf("toggles per measurement : %ld\n", toggles);
+    printf("open/write/close        : %12.0f toggles/s\n", legacy_rate);
+    printf("cached fd (pwrite)      : %12.0f toggles/s\n", cached_rate);
+    printf("speedup                 : %12.2fx\n", cached_rate / legacy_rate);
+
+    gpio_close_all();
+    fake_sysfs_destroy(fake_root);
+
+    return 0;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static int legacy_write_value(uint8_t gpio_no, uint8_t out_val){
+
+    int fd = 0;
+    char buf[100] = {0};
+
+    snprintf(buf, sizeof(buf), "%s/gpio%d/value", fake_root, gpio_no);
+
+    fd = open(buf, O_WRONLY);
+    if(fd < 0){
+        perror("Error, file for managing gpio could not be opened");
+        return fd;
+    }
+
+    if(out_val){
+        write(fd, "1", 2);
+    }
+    else{
+        write(fd, "0", 2);
+    }
+
+    close(fd);
+
+    return 0;
+}
+
+static double now_s(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
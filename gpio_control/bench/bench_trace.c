@@ -0,0 +1,164 @@
+/********************************************************************************************************//**
+* @file bench_trace.c
+*
+* @brief Benchmark of the transition tracing (gpio_trace.h) using the mock backend, so it runs on a host.
+*
+* The cost of recording an event is measured alone (ring stores of a 12 pin port write with a given
+* timestamp) and inside the driver, as the time per frame of the 4 digit display with the tracing disabled
+* and enabled divided by the events recorded per frame. The ring is then flushed to a trace file, which can
+* be converted with trace2vcd.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include "gpio_driver.h"
+#include "gpio_trace.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Default number of frames per measurement */
+#define DEFAULT_FRAMES          200000
+
+/** @brief Number of port writes recorded alone */
+#define RECORD_LOOPS            1000000
+
+/** @brief Trace file written at the end */
+#define TRACE_FILE              "/tmp/bench_trace.trace"
+
+#define NUM_PINS                12      /**< @brief Segments A to G, DP and the 4 digit selection lines */
+#define NUM_SEGMENTS            8       /**< @brief First digit selection line in the display port */
+#define NUM_DIGITS              4       /**< @brief Number of digits */
+#define SEGMENT_MASK            0x7F    /**< @brief Segments A to G */
+#define DIGIT_MASK              0xF00   /**< @brief Digit selection lines in the display port */
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Segment and digit selection pins, as grouped in the display port of seg7_mux.c */
+static const uint8_t disp_pins[NUM_PINS] = {66, 67, 69, 45, 44, 26, 46, 68, 48, 49, 112, 115};
+
+/** @brief Segments (bit 0 is A) switched on for each digit */
+static const uint8_t digit_segments[10] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
+
+static struct gpio_port disp_port;
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for running frames of the 4 digit display.
+ * @param[in] frames Is the number of frames.
+ * @return the time per frame in ns.
+ */
+static double run_frames(long frames);
+
+/**
+ * @brief Function for getting the monotonic time in ns.
+ * @return the current time.
+ */
+static uint64_t now_ns(void);
+
+/***********************************************************************************************************/
+/*                                       Main Function                                                     */
+/***********************************************************************************************************/
+
+int main(int argc, char* argv[]){
+
+    long i = 0;
+    long frames = DEFAULT_FRAMES;
+    uint64_t t = 0;
+    uint32_t events = 0;
+    double record_ns = 0;
+    double off_ns = 0;
+    double on_ns = 0;
+
+    if(argc > 1){
+        frames = atol(argv[1]);
+    }
+
+    if(gpio_init("mock")){
+        return EXIT_FAILURE;
+    }
+    for(i = 0; i < NUM_PINS; i++){
+        if(gpio_export(disp_pins[i]) || gpio_config_dir(disp_pins[i], GPIO_DIR_OUT)){
+            return EXIT_FAILURE;
+        }
+    }
+    if(gpio_port_init(&disp_port, disp_pins, NUM_PINS)){
+        return EXIT_FAILURE;
+    }
+
+    /* Ring stores alone */
+    gpio_trace_enable(NULL);
+    t = now_ns();
+    for(i = 0; i < RECORD_LOOPS; i++){
+        gpio_trace_record_port(t, disp_pins, 0xFFF, i);
+    }
+    record_ns = (double)(now_ns() - t) / RECORD_LOOPS / NUM_PINS;
+
+    /* Driver path, disabled and enabled */
+    gpio_trace_disable();
+    off_ns = run_frames(frames);
+    gpio_trace_reset();
+    gpio_trace_enable(NULL);
+    on_ns = run_frames(frames);
+    gpio_trace_disable();
+    events = gpio_trace_head;
+
+    printf("ring store (ns/event)         : %.2f\n", record_ns);
+    printf("4dig frame, tracing off (ns)  : %.1f\n", off_ns);
+    printf("4dig frame, tracing on (ns)   : %.1f\n", on_ns);
+    printf("events per frame              : %.2f\n", (double)events / frames);
+    printf("tracing cost (ns/event)       : %.2f (timestamp included)\n",
+           (on_ns - off_ns) * frames / (events ? events : 1));
+
+    if(gpio_trace_flush(TRACE_FILE)){
+        perror("Error, trace file could not be written");
+        return EXIT_FAILURE;
+    }
+    printf("last %u events written to %s\n", events < GPIO_TRACE_RING_SIZE ? events : GPIO_TRACE_RING_SIZE,
+           TRACE_FILE);
+
+    gpio_deinit();
+
+    return 0;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static double run_frames(long frames){
+
+    long f = 0;
+    uint8_t d = 0;
+    long number = 0;
+    uint64_t t = now_ns();
+
+    for(f = 0; f < frames; f++){
+        number = f % 10000;
+        for(d = 0; d < NUM_DIGITS; d++){
+            gpio_write_mask(&disp_port, SEGMENT_MASK | DIGIT_MASK,
+                            digit_segments[number % 10] | (DIGIT_MASK & ~(1 << (NUM_SEGMENTS + d))));
+            gpio_write_mask(&disp_port, SEGMENT_MASK | DIGIT_MASK, DIGIT_MASK);
+            number /= 10;
+        }
+    }
+
+    return (double)(now_ns() - t) / frames;
+}
+
+static uint64_t now_ns(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
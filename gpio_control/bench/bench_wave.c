@@ -0,0 +1,311 @@
+/********************************************************************************************************//**
+* @file bench_wave.c
+*
+* @brief Benchmark of the waveform playback (gpio_wave.h) using the mock backend, so it runs on a host.
+*
+* The multiplexed frame of the 4 digit display (each digit on during DIGIT_HOLD_NS, DIGIT_BLANK_NS between
+* digits) is refreshed for a number of frames in two ways:
+*       - usleep: the digits are written and held with usleep(), as display_number() did before,
+*       - wave: the frame is a precomputed waveform played with absolute deadlines.
+*
+* For each method the report gives the mean frame time against the nominal one, the time each digit was
+* switched on measured from the transitions recorded by the mock backend (mean and worst error against
+* DIGIT_HOLD_NS), the lateness of the waveform steps and the CPU used by the process.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "gpio_driver.h"
+#include "gpio_mock.h"
+#include "gpio_wave.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Default number of frames per method */
+#define DEFAULT_FRAMES          2000
+
+/** @brief Number of segment pins (A to G and the decimal point) */
+#define NUM_SEGMENTS            8
+
+/** @brief Number of digits of the 4 digit display */
+#define NUM_DIGITS              4
+
+#define SEGMENT_MASK            0x7F    /**< @brief Segments A to G */
+#define DIGIT_MASK              0xF00   /**< @brief Digit selection lines in the display port */
+#define DIGIT_HOLD_NS           100000  /**< @brief Time a digit was on in counter_4dig7seg.c */
+#define DIGIT_BLANK_NS          10000   /**< @brief Blank between digits in counter_4dig7seg.c */
+
+/** @brief Nominal duration of a frame */
+#define FRAME_NS                (NUM_DIGITS * (DIGIT_HOLD_NS + DIGIT_BLANK_NS))
+
+/** @brief Steps of the waveform of a frame */
+#define FRAME_STEPS             (2 * NUM_DIGITS + 1)
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Result of a method */
+struct wave_result{
+    uint64_t frame_ns;                  /**< @brief Mean frame time */
+    uint64_t on_mean_ns;                /**< @brief Mean time a digit was on */
+    uint64_t on_err_max_ns;             /**< @brief Worst difference between the on time and the hold time */
+    uint64_t late_mean_ns;              /**< @brief Mean lateness of the waveform steps (wave only) */
+    uint64_t late_max_ns;               /**< @brief Latest waveform step (wave only) */
+    uint64_t cpu_us;                    /**< @brief CPU time used */
+    uint64_t wall_us;                   /**< @brief Elapsed time */
+};
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Segment and digit selection pins, as grouped in the display port of seg7_mux.c */
+static const uint8_t disp_pins[NUM_SEGMENTS + NUM_DIGITS] = {66, 67, 69, 45, 44, 26, 46, 68, 48, 49, 112, 115};
+
+/** @brief Segments (bit 0 is A) switched on for each digit */
+static const uint8_t digit_segments[10] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
+
+static struct gpio_port disp_port;
+static struct gpio_wave_step frame_steps[FRAME_STEPS];
+static struct gpio_wave frame_wave;
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for refreshing the display with usleep() holds.
+ * @param[in] number Is the number displayed.
+ * @return void.
+ */
+static void frame_usleep(uint16_t number);
+
+/**
+ * @brief Function for refreshing the display with a waveform.
+ * @param[in] number Is the number displayed.
+ * @param[out] report Is the timing of the playback.
+ * @return void.
+ */
+static void frame_wave_play(uint16_t number, struct gpio_wave_report* report);
+
+/**
+ * @brief Function for measuring the time the digits were on from the recorded transitions.
+ * @param[out] res Is the result filled with the on time and its worst error.
+ * @return void.
+ */
+static void measure_on_time(struct wave_result* res);
+
+/**
+ * @brief Function for printing the result of a method.
+ * @param[in] name Is the method.
+ * @param[in] res Is the result.
+ * @param[in] wave Is != 0 if the lateness of the steps is printed.
+ * @return void.
+ */
+static void print_result(const char* name, const struct wave_result* res, int wave);
+
+/**
+ * @brief Function for getting the CPU time used by the process in us.
+ * @return the user and system time.
+ */
+static uint64_t cpu_time_us(void);
+
+/**
+ * @brief Function for getting the monotonic time in us.
+ * @return the current time.
+ */
+static uint64_t now_us(void);
+
+/***********************************************************************************************************/
+/*                                       Main Function                                                     */
+/***********************************************************************************************************/
+
+int main(int argc, char* argv[]){
+
+    uint8_t i = 0;
+    long f = 0;
+    long frames = DEFAULT_FRAMES;
+    uint64_t late_total = 0;
+    struct gpio_wave_report report;
+    struct wave_result res_usleep = {0};
+    struct wave_result res_wave = {0};
+
+    if(argc > 1){
+        frames = atol(argv[1]);
+    }
+
+    if(gpio_init("mock")){
+        return EXIT_FAILURE;
+    }
+
+    for(i = 0; i < NUM_SEGMENTS + NUM_DIGITS; i++){
+        if(gpio_export(disp_pins[i]) || gpio_config_dir(disp_pins[i], GPIO_DIR_OUT)){
+            return EXIT_FAILURE;
+        }
+    }
+    if(gpio_port_init(&disp_port, disp_pins, NUM_SEGMENTS + NUM_DIGITS)){
+        return EXIT_FAILURE;
+    }
+    gpio_write_mask(&disp_port, SEGMENT_MASK | DIGIT_MASK, DIGIT_MASK);
+    gpio_wave_init(&frame_wave, &disp_port, frame_steps, FRAME_STEPS);
+
+    /* usleep() holds */
+    gpio_mock_reset();
+    res_usleep.cpu_us = cpu_time_us();
+    res_usleep.wall_us = now_us();
+    for(f = 0; f < frames; f++){
+        frame_usleep(f % 10000);
+    }
+    res_usleep.wall_us = now_us() - res_usleep.wall_us;
+    res_usleep.cpu_us = cpu_time_us() - res_usleep.cpu_us;
+    res_usleep.frame_ns = res_usleep.wall_us * 1000 / frames;
+    measure_on_time(&res_usleep);
+
+    /* Precomputed waveform */
+    gpio_mock_reset();
+    res_wave.cpu_us = cpu_time_us();
+    res_wave.wall_us = now_us();
+    for(f = 0; f < frames; f++){
+        frame_wave_play(f % 10000, &report);
+        late_total += report.late_mean_ns;
+        if(report.late_max_ns > res_wave.late_max_ns){
+            res_wave.late_max_ns = report.late_max_ns;
+        }
+    }
+    res_wave.wall_us = now_us() - res_wave.wall_us;
+    res_wave.cpu_us = cpu_time_us() - res_wave.cpu_us;
+    res_wave.frame_ns = res_wave.wall_us * 1000 / frames;
+    res_wave.late_mean_ns = late_total / frames;
+    measure_on_time(&res_wave);
+
+    printf("frames per method             : %ld\n", frames);
+    printf("nominal frame (us)            : %.1f (hold %d us, blank %d us per digit)\n", FRAME_NS / 1000.0,
+           DIGIT_HOLD_NS / 1000, DIGIT_BLANK_NS / 1000);
+    printf("%-8s %10s %12s %14s %13s %13s %8s\n", "method", "frame(us)", "on mean(us)", "on err max(us)",
+           "late mean(us)", "late max(us)", "cpu(%)");
+    print_result("usleep", &res_usleep, 0);
+    print_result("wave", &res_wave, 1);
+
+    gpio_deinit();
+
+    return 0;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static void frame_usleep(uint16_t number){
+
+    uint8_t i = 0;
+
+    for(i = NUM_DIGITS; i > 0; i--){
+        gpio_write_mask(&disp_port, SEGMENT_MASK | DIGIT_MASK,
+                        digit_segments[number % 10] | (DIGIT_MASK & ~(1 << (NUM_SEGMENTS + i - 1))));
+        number /= 10;
+        usleep(DIGIT_HOLD_NS / 1000);
+        gpio_write_mask(&disp_port, SEGMENT_MASK | DIGIT_MASK, DIGIT_MASK);
+        usleep(DIGIT_BLANK_NS / 1000);
+    }
+}
+
+static void frame_wave_play(uint16_t number, struct gpio_wave_report* report){
+
+    uint8_t i = 0;
+
+    gpio_wave_clear(&frame_wave);
+
+    /* Same waveform as the former display_number() of counter_4dig7seg.c */
+    for(i = NUM_DIGITS; i > 0; i--){
+        gpio_wave_add(&frame_wave, (i == NUM_DIGITS) ? 0 : DIGIT_BLANK_NS, SEGMENT_MASK | DIGIT_MASK,
+                      digit_segments[number % 10] | (DIGIT_MASK & ~(1 << (NUM_SEGMENTS + i - 1))));
+        gpio_wave_add(&frame_wave, DIGIT_HOLD_NS, SEGMENT_MASK | DIGIT_MASK, DIGIT_MASK);
+        number /= 10;
+    }
+    gpio_wave_add(&frame_wave, DIGIT_BLANK_NS, 0, 0);
+
+    gpio_wave_play(&frame_wave, report);
+}
+
+static void measure_on_time(struct wave_result* res){
+
+    uint32_t i = 0;
+    uint32_t d = 0;
+    uint32_t n = 0;
+    uint64_t on_total = 0;
+    uint64_t on_count = 0;
+    uint64_t on = 0;
+    uint64_t err = 0;
+    uint64_t t_on[NUM_DIGITS] = {0};
+    const struct gpio_mock_event* events = NULL;
+
+    n = gpio_mock_get_events(&events);
+    res->on_err_max_ns = 0;
+
+    for(i = 0; i < n; i++){
+        for(d = 0; d < NUM_DIGITS; d++){
+            if(events[i].gpio_no == disp_pins[NUM_SEGMENTS + d]){
+                break;
+            }
+        }
+        if(d == NUM_DIGITS){
+            continue;
+        }
+
+        /* Digit selection is active low */
+        if(!events[i].value){
+            t_on[d] = events[i].t_ns;
+        }
+        else if(t_on[d]){
+            on = events[i].t_ns - t_on[d];
+            err = on > DIGIT_HOLD_NS ? on - DIGIT_HOLD_NS : DIGIT_HOLD_NS - on;
+            if(err > res->on_err_max_ns){
+                res->on_err_max_ns = err;
+            }
+            on_total += on;
+            on_count++;
+            t_on[d] = 0;
+        }
+    }
+
+    res->on_mean_ns = on_count ? on_total / on_count : 0;
+}
+
+static void print_result(const char* name, const struct wave_result* res, int wave){
+
+    printf("%-8s %10.1f %12.1f %14.1f ", name, res->frame_ns / 1000.0, res->on_mean_ns / 1000.0,
+           res->on_err_max_ns / 1000.0);
+    if(wave){
+        printf("%13.2f %13.1f", res->late_mean_ns / 1000.0, res->late_max_ns / 1000.0);
+    }
+    else{
+        printf("%13s %13s", "-", "-");
+    }
+    printf(" %8.1f\n", 100.0 * res->cpu_us / res->wall_us);
+}
+
+static uint64_t cpu_time_us(void){
+
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ULL + ru.ru_utime.tv_usec +
+           ru.ru_stime.tv_usec;
+}
+
+static uint64_t now_us(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
@@ -0,0 +1,95 @@
+/********************************************************************************************************//**
+* @file fake_sysfs.c
+*
+* @brief Functions for creating a fake gpio sysfs tree, used for running the drivers on a host.
+*
+* Public Functions:
+*       - int fake_sysfs_create(char* root, const uint8_t* gpios, uint8_t n)
+*       - void fake_sysfs_destroy(const char* root)
+*/
+
+#define _DEFAULT_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "fake_sysfs.h"
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for creating a file with an initial content.
+ * @param[in] path Is the path of the file.
+ * @param[in] content Is the initial content.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int create_file(const char* path, const char* content);
+
+/***********************************************************************************************************/
+/*                                       Public API Definitions                                            */
+/***********************************************************************************************************/
+
+int fake_sysfs_create(char* root, const uint8_t* gpios, uint8_t n){
+
+    uint8_t i = 0;
+    char buf[256] = {0};
+
+    if(mkdtemp(root) == NULL){
+        perror("Error, fake sysfs root could not be created");
+        return 1;
+    }
+
+    snprintf(buf, sizeof(buf), "%s/export", root);
+    if(create_file(buf, "")){return 1;}
+
+    for(i = 0; i < n; i++){
+        snprintf(buf, sizeof(buf), "%s/gpio%d", root, gpios[i]);
+        if(mkdir(buf, 0755) < 0){
+            perror("Error, fake gpio directory could not be created");
+            return 1;
+        }
+        snprintf(buf, sizeof(buf), "%s/gpio%d/value", root, gpios[i]);
+        if(create_file(buf, "0\n")){return 1;}
+        snprintf(buf, sizeof(buf), "%s/gpio%d/direction", root, gpios[i]);
+        if(create_file(buf, "in\n")){return 1;}
+        snprintf(buf, sizeof(buf), "%s/gpio%d/edge", root, gpios[i]);
+        if(create_file(buf, "none\n")){return 1;}
+    }
+
+    return 0;
+}
+
+void fake_sysfs_destroy(const char* root){
+
+    char cmd[300] = {0};
+
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", root);
+    if(system(cmd) != 0){
+        fprintf(stderr, "Warning, fake sysfs tree %s could not be removed\n", root);
+    }
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static int create_file(const char* path, const char* content){
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if(fd < 0){
+        perror("Error, fake sysfs file could not be created");
+        return 1;
+    }
+
+    write(fd, content, strlen(content));
+    close(fd);
+
+    return 0;
+}
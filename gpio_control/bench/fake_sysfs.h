@@ -0,0 +1,44 @@
+/********************************************************************************************************//**
+* @file fake_sysfs.h
+*
+* @brief Header file containing the prototypes of the APIs for creating a fake gpio sysfs tree.
+*
+* Public Functions:
+*       - int fake_sysfs_create(char* root, const uint8_t* gpios, uint8_t n)
+*       - void fake_sysfs_destroy(const char* root)
+*/
+
+#ifndef FAKE_SYSFS_H
+#define FAKE_SYSFS_H
+
+#include <stdint.h>
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Template used for the temporary directory of the fake tree */
+#define FAKE_SYSFS_TEMPLATE     "/tmp/fake_gpio_XXXXXX"
+
+/***********************************************************************************************************/
+/*                                       APIs Supported                                                    */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for creating a fake sysfs tree with export file and gpioN/{value,direction,edge} files.
+ * @param[in,out] root Is a writable buffer initialized with FAKE_SYSFS_TEMPLATE, it gets the created path.
+ * @param[in] gpios Is the list of gpio numbers to be created.
+ * @param[in] n Is the number of gpios in the list.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int fake_sysfs_create(char* root, const uint8_t* gpios, uint8_t n);
+
+/**
+ * @brief Function for removing a fake sysfs tree.
+ * @param[in] root Is the path returned by fake_sysfs_create().
+ * @return void.
+ */
+void fake_sysfs_destroy(const char* root);
+
+#endif
@@ -0,0 +1,70 @@
+/********************************************************************************************************//**
+* @file board_pins.h
+*
+* @brief Header file containing the gpios of the BeagleBone Black wired to the modules of the applications.
+*
+* Every application and module takes its pin assignments from this file, so a module is rewired in one
+* place. The names give the gpio number, the header pin and the signal. Some header pins are used by
+* several applications which are not run at the same time (e.g. P9_23 is a digit line of the 4 digit display
+* and the push button of button_7seg.c, P8_7 to P8_14 are shared by the 7 segment displays and the LCD).
+*
+* The bank of a gpio and its bit in the bank are given by GPIO_BANK() and GPIO_BANK_BIT() (gpio_driver.h).
+*/
+
+#ifndef BOARD_PINS_H
+#define BOARD_PINS_H
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/**
+ * @defgroup GPIO_7SEG GPIO connected to the 7 segment display (also the segments of the 4 digit display).
+ * @{
+ */
+#define GPIO_66_P8_7_SEGA       66  /**< @brief GPIO regarding segment A */
+#define GPIO_67_P8_8_SEGB       67  /**< @brief GPIO regarding segment B */
+#define GPIO_69_P8_9_SEGC       69  /**< @brief GPIO regarding segment C */
+#define GPIO_68_P8_10_DP        68  /**< @brief GPIO regarding decimal point */
+#define GPIO_45_P8_11_SEGD      45  /**< @brief GPIO regarding segment D */
+#define GPIO_44_P8_12_SEGE      44  /**< @brief GPIO regarding segment E */
+#define GPIO_26_P8_14_SEGF      26  /**< @brief GPIO regarding segment F */
+#define GPIO_46_P8_16_SEGG      46  /**< @brief GPIO regarding segment G */
+/** @} */
+
+/**
+ * @defgroup GPIO_4DIG GPIO connected to the selection of digit PINs.
+ * @{
+ */
+#define GPIO_48_P9_15_DIG1      48  /**< @brief GPIO regarding digit 1 */
+#define GPIO_49_P9_23_DIG2      49  /**< @brief GPIO regarding digit 2 */
+#define GPIO_112_P9_30_DIG3     112 /**< @brief GPIO regarding digit 3 */
+#define GPIO_115_P9_27_DIG4     115 /**< @brief GPIO regarding digit 4 */
+/** @} */
+
+/** @brief GPIO connected to the push button */
+#define GPIO_49_P9_23_BUTTON    49
+
+/**
+ * @defgroup GPIO_PIN Connected GPIO pins to the HD44780 module.
+ * @{
+ */
+#define GPIO_66_P8_7_RS_4       66  /**< @brief Register Selection (character of command) */
+#define GPIO_67_P8_8_RW_5       67  /**< @brief Read/write */
+#define GPIO_69_P8_9_EN_6       69  /**< @brief Enable */
+#define GPIO_68_P8_10_D4_11     68  /**< @brief Data line 4 */
+#define GPIO_45_P8_11_D5_12     45  /**< @brief Data line 5 */
+#define GPIO_44_P8_12_D6_13     44  /**< @brief Data line 6 */
+#define GPIO_26_P8_14_D7_14     26  /**< @brief Data line 7 */
+/** @} */
+
+/**
+ * @defgroup GPIO_HC595 Gpios connected to the 74HC595 (free pins of the P9 header).
+ * @{
+ */
+#define GPIO_60_P9_12_SER       60  /**< @brief Serial data */
+#define GPIO_50_P9_14_SRCLK     50  /**< @brief Shift clock */
+#define GPIO_51_P9_16_RCLK      51  /**< @brief Latch clock */
+/** @} */
+
+#endif
@@ -18,17 +18,64 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include "gpio_driver.h"
+#include "gpio_wave.h"
+#include "gpio_async.h"
 #include "lcd_hd44780.h"
 
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+#define LCD_PORT_DATA_MASK      0x0F    /**< @brief Bitmask of the data lines D4 to D7 in the lcd port */
+#define LCD_PORT_RS_BIT         4       /**< @brief Position of the RS line in the lcd port */
+#define LCD_PORT_EN_BIT         5       /**< @brief Position of the EN line in the lcd port */
+#define LCD_PORT_EN             (1 << LCD_PORT_EN_BIT)
+#define LCD_PORT_MASK           (LCD_PORT_DATA_MASK | (1 << LCD_PORT_RS_BIT) | LCD_PORT_EN)
+
+#define LCD_SETUP_NS            1000        /**< @brief Time from the data and RS lines to the EN rising edge */
+#define LCD_EN_PULSE_NS         2000000     /**< @brief Time EN is kept high (2 ms) */
+#define LCD_CHAR_WAIT_NS        5000000     /**< @brief Time after a character (5 ms) */
+#define LCD_WAVE_STEPS          7           /**< @brief Steps of the waveform of a byte */
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Gpios of the data lines, RS and EN, bit N of the lcd port is lcd_pins[N] */
+static const uint8_t lcd_pins[] = {
+    GPIO_68_P8_10_D4_11, GPIO_45_P8_11_D5_12, GPIO_44_P8_12_D6_13, GPIO_26_P8_14_D7_14, GPIO_66_P8_7_RS_4,
+    GPIO_69_P8_9_EN_6
+};
+
+/** @brief Gpios used by the module */
+static const struct gpio_pin_config lcd_pin_table[] = {
+    GPIO_PIN_OUT(GPIO_66_P8_7_RS_4, GPIO_LOW_VALUE), GPIO_PIN_OUT(GPIO_67_P8_8_RW_5, GPIO_LOW_VALUE),
+    GPIO_PIN_OUT(GPIO_69_P8_9_EN_6, GPIO_LOW_VALUE), GPIO_PIN_OUT(GPIO_68_P8_10_D4_11, GPIO_LOW_VALUE),
+    GPIO_PIN_OUT(GPIO_45_P8_11_D5_12, GPIO_LOW_VALUE), GPIO_PIN_OUT(GPIO_44_P8_12_D6_13, GPIO_LOW_VALUE),
+    GPIO_PIN_OUT(GPIO_26_P8_14_D7_14, GPIO_LOW_VALUE)
+};
+
+/** @brief Port grouping the data lines, RS and EN */
+static struct gpio_port lcd_port;
+
+/** @brief Steps of the waveform of a byte */
+static struct gpio_wave_step lcd_steps[LCD_WAVE_STEPS];
+
+/** @brief Waveform writing a byte as two nibbles */
+static struct gpio_wave lcd_wave;
+
 /***********************************************************************************************************/
 /*                                       Static Function Prototypes                                        */
 /***********************************************************************************************************/
 
 /**
- * @brief Function for enabling the HD44780 module.
+ * @brief Function for writing a byte as two nibbles (MSB first), each one latched by an EN pulse.
+ * @param[in] mode Is COMMAND_MODE or USER_DATA_MODE (value of RS).
+ * @param[in] value Is the byte to be written.
+ * @param[in] wait_ns Is the time waited after the second EN pulse.
  * @return void.
  */
-static void hd44780_enable(void);
+static void hd44780_write(uint8_t mode, uint8_t value, uint32_t wait_ns);
 
 /***********************************************************************************************************/
 /*                                       Public API Definitions                                            */
@@ -38,32 +85,11 @@ void hd44780_init(void){
 
     uint8_t cmd = 0;
 
-    /* Export all needed gpios */
-    gpio_export(GPIO_66_P8_7_RS_4);
-    gpio_export(GPIO_67_P8_8_RW_5);
-    gpio_export(GPIO_69_P8_9_EN_6);
-    gpio_export(GPIO_68_P8_10_D4_11);
-    gpio_export(GPIO_45_P8_11_D5_12);
-    gpio_export(GPIO_44_P8_12_D6_13);
-    gpio_export(GPIO_26_P8_14_D7_14);
-
-    /* Configure direction */
-    gpio_config_dir(GPIO_66_P8_7_RS_4, GPIO_DIR_OUT);
-    gpio_config_dir(GPIO_67_P8_8_RW_5, GPIO_DIR_OUT);
-    gpio_config_dir(GPIO_69_P8_9_EN_6, GPIO_DIR_OUT);
-    gpio_config_dir(GPIO_68_P8_10_D4_11, GPIO_DIR_OUT);
-    gpio_config_dir(GPIO_45_P8_11_D5_12, GPIO_DIR_OUT);
-    gpio_config_dir(GPIO_44_P8_12_D6_13, GPIO_DIR_OUT);
-    gpio_config_dir(GPIO_26_P8_14_D7_14, GPIO_DIR_OUT);
-
-    /* Set initial value */
-    gpio_write_value(GPIO_66_P8_7_RS_4, GPIO_LOW_VALUE);
-    gpio_write_value(GPIO_67_P8_8_RW_5, GPIO_LOW_VALUE);
-    gpio_write_value(GPIO_69_P8_9_EN_6, GPIO_LOW_VALUE);
-    gpio_write_value(GPIO_68_P8_10_D4_11, GPIO_LOW_VALUE);
-    gpio_write_value(GPIO_45_P8_11_D5_12, GPIO_LOW_VALUE);
-    gpio_write_value(GPIO_44_P8_12_D6_13, GPIO_LOW_VALUE);
-    gpio_write_value(GPIO_26_P8_14_D7_14, GPIO_LOW_VALUE);
+    /* Export and configure all needed gpios, initialized to low */
+    gpio_init_pins(lcd_pin_table, sizeof(lcd_pin_table) / sizeof(lcd_pin_table[0]), NULL);
+
+    gpio_port_init(&lcd_port, lcd_pins, sizeof(lcd_pins));
+    gpio_wave_init(&lcd_wave, &lcd_port, lcd_steps, LCD_WAVE_STEPS);
 
     cmd = HD44780_CMD_FUNC_SET | DATA_LEN_4 | DISPLAY_2_LINES | MATRIX_5_X_8;
     hd44780_send_cmd(cmd);
@@ -84,24 +110,7 @@ void hd44780_init(void){
 
 void hd44780_send_cmd(uint8_t cmd){
 
-    uint8_t cmd_msb = (cmd >> 4) & 0x0F;
-    uint8_t cmd_lsb = cmd & 0x0F;
-
-    /* Set RS to 0 */
-    gpio_write_value(GPIO_66_P8_7_RS_4, COMMAND_MODE);
-
-    /* Send the MSB */
-    gpio_write_value(GPIO_68_P8_10_D4_11, (cmd_msb & (1 << 0)));
-    gpio_write_value(GPIO_45_P8_11_D5_12, (cmd_msb & (1 << 1)));
-    gpio_write_value(GPIO_44_P8_12_D6_13, (cmd_msb & (1 << 2)));
-    gpio_write_value(GPIO_26_P8_14_D7_14, (cmd_msb & (1 << 3)));
-    hd44780_enable();
-    /* Send the LSB */
-    gpio_write_value(GPIO_68_P8_10_D4_11, (cmd_lsb & (1 << 0)));
-    gpio_write_value(GPIO_45_P8_11_D5_12, (cmd_lsb & (1 << 1)));
-    gpio_write_value(GPIO_44_P8_12_D6_13, (cmd_lsb & (1 << 2)));
-    gpio_write_value(GPIO_26_P8_14_D7_14, (cmd_lsb & (1 << 3)));
-    hd44780_enable();
+    hd44780_write(COMMAND_MODE, cmd, 0);
 }
 
 void hd44780_set_cursor(uint8_t row, uint8_t column){
@@ -121,27 +130,7 @@ void hd44780_set_cursor(uint8_t row, uint8_t column){
 
 void hd44780_print_char(uint8_t value){
 
-    uint8_t tmp = 0;
-
-    gpio_write_value(GPIO_66_P8_7_RS_4, USER_DATA_MODE);
-
-    /* Write MSB */
-    tmp = (value >> 4) & 0x0F;
-    gpio_write_value(GPIO_68_P8_10_D4_11, (tmp & (1 << 0)));
-    gpio_write_value(GPIO_45_P8_11_D5_12, (tmp & (1 << 1)));
-    gpio_write_value(GPIO_44_P8_12_D6_13, (tmp & (1 << 2)));
-    gpio_write_value(GPIO_26_P8_14_D7_14, (tmp & (1 << 3)));
-    hd44780_enable();
-
-    /* Write LSB */
-    tmp = value & 0x0F;
-    gpio_write_value(GPIO_68_P8_10_D4_11, (tmp & (1 << 0)));
-    gpio_write_value(GPIO_45_P8_11_D5_12, (tmp & (1 << 1)));
-    gpio_write_value(GPIO_44_P8_12_D6_13, (tmp & (1 << 2)));
-    gpio_write_value(GPIO_26_P8_14_D7_14, (tmp & (1 << 3)));
-    hd44780_enable();
-
-    usleep(5000); /* 5 ms */
+    hd44780_write(USER_DATA_MODE, value, LCD_CHAR_WAIT_NS);
 }
 
 void hd44780_print_string(char* msg){
@@ -190,9 +179,27 @@ void hd44780_load_cgram(char tab[], uint8_t charnum){
 /*                                       Static Function Definitions                                       */
 /***********************************************************************************************************/
 
-static void hd44780_enable(void){
+static void hd44780_write(uint8_t mode, uint8_t value, uint32_t wait_ns){
+
+    uint32_t rs = mode << LCD_PORT_RS_BIT;
+
+    gpio_wave_clear(&lcd_wave);
+
+    /* MSB with RS, latched on the falling edge of EN */
+    gpio_wave_add(&lcd_wave, 0, LCD_PORT_MASK, rs | ((value >> 4) & 0x0F));
+    gpio_wave_add(&lcd_wave, LCD_SETUP_NS, LCD_PORT_EN, LCD_PORT_EN);
+    gpio_wave_add(&lcd_wave, LCD_EN_PULSE_NS, LCD_PORT_EN, 0);
+
+    /* LSB, changed after the falling edge to keep the hold time of the MSB */
+    gpio_wave_add(&lcd_wave, LCD_SETUP_NS, LCD_PORT_DATA_MASK, value & 0x0F);
+    gpio_wave_add(&lcd_wave, LCD_SETUP_NS, LCD_PORT_EN, LCD_PORT_EN);
+    gpio_wave_add(&lcd_wave, LCD_EN_PULSE_NS, LCD_PORT_EN, 0);
+
+    if(wait_ns){
+        gpio_wave_add(&lcd_wave, wait_ns, 0, 0);
+    }
 
-    gpio_write_value(GPIO_69_P8_9_EN_6, 1);
-    usleep(2000); /* 2 ms */
-    gpio_write_value(GPIO_69_P8_9_EN_6, 0);
+    /* The writes still queued (e.g. other gpios of the banks) must not land inside the EN timing */
+    gpio_flush();
+    gpio_wave_play(&lcd_wave, NULL);
 }
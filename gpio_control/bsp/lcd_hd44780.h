@@ -17,24 +17,12 @@
 #define LCD_HD44780_H
 
 #include <stdint.h>
+#include "board_pins.h"
 
 /***********************************************************************************************************/
 /*                                       Defines and Macros                                                */
 /***********************************************************************************************************/
 
-/**
- * @defgroup GPIO_PIN Connected GPIO pins to the HD44780 module.
- * @{
- */
-#define GPIO_66_P8_7_RS_4       66  /**< @brief Register Selection (character of command) */
-#define GPIO_67_P8_8_RW_5       67  /**< @brief Read/write */
-#define GPIO_69_P8_9_EN_6       69  /**< @brief Enable */
-#define GPIO_68_P8_10_D4_11     68  /**< @brief Data line 4 */
-#define GPIO_45_P8_11_D5_12     45  /**< @brief Data line 5 */
-#define GPIO_44_P8_12_D6_13     44  /**< @brief Data line 6 */
-#define GPIO_26_P8_14_D7_14     26  /**< @brief Data line 7 */
-/** @} */
-
 /**
  * @defgroup CMD_FUNC_SET Sets interface data length, number of display lines and character font.
  * @{
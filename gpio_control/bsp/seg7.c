@@ -0,0 +1,96 @@
+/********************************************************************************************************//**
+* @file seg7.c
+*
+* @brief Functions for encoding and writing 7 segment glyphs.
+*
+* Public Functions:
+*       - uint8_t seg7_encode(char c)
+*       - uint8_t seg7_encode_hex(uint8_t value)
+*       - int seg7_init(struct seg7* disp, const uint8_t* pins)
+*       - int seg7_write(struct seg7* disp, char c)
+*       - int seg7_write_digit(struct seg7* disp, uint8_t value)
+*       - int seg7_write_segments(struct seg7* disp, uint8_t segments)
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include "gpio_driver.h"
+#include "seg7.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Characters of the glyph table (7 bit ASCII) */
+#define SEG7_TABLE_SIZE         128
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Glyph of each character, 0 for the characters without glyph */
+static const uint8_t glyphs[SEG7_TABLE_SIZE] = {
+    ['0'] = 0x3F, ['1'] = 0x06, ['2'] = 0x5B, ['3'] = 0x4F, ['4'] = 0x66,
+    ['5'] = 0x6D, ['6'] = 0x7D, ['7'] = 0x07, ['8'] = 0x7F, ['9'] = 0x6F,
+    ['A'] = 0x77, ['B'] = 0x7C, ['C'] = 0x39, ['D'] = 0x5E, ['E'] = 0x79, ['F'] = 0x71,
+    ['a'] = 0x77, ['b'] = 0x7C, ['c'] = 0x58, ['d'] = 0x5E, ['e'] = 0x79, ['f'] = 0x71,
+    ['G'] = 0x3D, ['H'] = 0x76, ['h'] = 0x74, ['I'] = 0x06, ['i'] = 0x04, ['J'] = 0x1E,
+    ['L'] = 0x38, ['n'] = 0x54, ['O'] = 0x3F, ['o'] = 0x5C, ['P'] = 0x73, ['r'] = 0x50,
+    ['S'] = 0x6D, ['t'] = 0x78, ['U'] = 0x3E, ['u'] = 0x1C, ['y'] = 0x6E,
+    ['-'] = 0x40, ['_'] = 0x08, ['='] = 0x48, [' '] = 0x00
+};
+
+/** @brief Characters of the hex digits */
+static const char hex_chars[SEG7_NUM_DIGITS] = "0123456789AbCdEF";
+
+/***********************************************************************************************************/
+/*                                       Public API Definitions                                            */
+/***********************************************************************************************************/
+
+uint8_t seg7_encode(char c){
+
+    return ((uint8_t)c < SEG7_TABLE_SIZE) ? glyphs[(uint8_t)c] : 0;
+}
+
+uint8_t seg7_encode_hex(uint8_t value){
+
+    return glyphs[(uint8_t)hex_chars[value & 0x0F]];
+}
+
+int seg7_init(struct seg7* disp, const uint8_t* pins){
+
+    uint8_t i = 0;
+
+    if(gpio_port_init(&disp->port, pins, SEG7_NUM_PINS)){
+        return 1;
+    }
+
+    /* The segments of a glyph span several banks: the masks of each bank are computed only once */
+    for(i = 0; i < SEG7_NUM_DIGITS; i++){
+        if(gpio_port_prepare(&disp->port, SEG7_SEGMENT_MASK, seg7_encode_hex(i), &disp->digits[i])){
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int seg7_write(struct seg7* disp, char c){
+
+    return gpio_write_mask(&disp->port, SEG7_SEGMENT_MASK, seg7_encode(c));
+}
+
+int seg7_write_digit(struct seg7* disp, uint8_t value){
+
+    if(value >= SEG7_NUM_DIGITS){
+        fprintf(stderr, "Error, %d is not a hex digit\n", value);
+        return 1;
+    }
+
+    return gpio_write_banks(&disp->digits[value]);
+}
+
+int seg7_write_segments(struct seg7* disp, uint8_t segments){
+
+    return gpio_write_mask(&disp->port, SEG7_SEGMENT_MASK | SEG7_DP, segments);
+}
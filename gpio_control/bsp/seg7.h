@@ -0,0 +1,117 @@
+/********************************************************************************************************//**
+* @file seg7.h
+*
+* @brief Header file containing the prototypes of the APIs for encoding and writing 7 segment glyphs.
+*
+* A glyph is a segment bitmask, bit 0 is segment A, bit 6 is segment G and bit 7 the decimal point. The
+* glyphs are looked up in a table indexed by character (digits, hex A to F in both cases, minus, blank,
+* underscore and the letters readable on 7 segments), so a new glyph is one entry of the table. Unknown
+* characters are blank.
+*
+* A display groups its 8 segment gpios in one port, so a glyph is written with one port write (one
+* backend operation with the batching backends). The writes of the 16 hex digits are split per bank once
+* (gpio_port_prepare()) when the display is initialized.
+*
+* Public Functions:
+*       - uint8_t seg7_encode(char c)
+*       - uint8_t seg7_encode_hex(uint8_t value)
+*       - int seg7_init(struct seg7* disp, const uint8_t* pins)
+*       - int seg7_write(struct seg7* disp, char c)
+*       - int seg7_write_digit(struct seg7* disp, uint8_t value)
+*       - int seg7_write_segments(struct seg7* disp, uint8_t segments)
+*/
+
+#ifndef SEG7_H
+#define SEG7_H
+
+#include <stdint.h>
+#include "gpio_driver.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/**
+ * @defgroup SEG7_SEGMENTS Bits of the segments in a glyph.
+ * @{
+ */
+#define SEG7_A                  (1 << 0)
+#define SEG7_B                  (1 << 1)
+#define SEG7_C                  (1 << 2)
+#define SEG7_D                  (1 << 3)
+#define SEG7_E                  (1 << 4)
+#define SEG7_F                  (1 << 5)
+#define SEG7_G                  (1 << 6)
+#define SEG7_DP                 (1 << 7)
+/** @} */
+
+#define SEG7_SEGMENT_MASK       0x7F    /**< @brief Segments A to G, without the decimal point */
+#define SEG7_NUM_PINS           8       /**< @brief Segment gpios of a display (A to G and DP) */
+#define SEG7_NUM_DIGITS         16      /**< @brief Hex digits with prepared writes */
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief 7 segment display */
+struct seg7{
+    struct gpio_port port;              /**< @brief Segment gpios, bit N of the port is bit N of a glyph */
+    struct gpio_bank_write digits[SEG7_NUM_DIGITS];  /**< @brief Prepared writes of the hex digits */
+};
+
+/***********************************************************************************************************/
+/*                                       APIs Supported                                                    */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for getting the glyph of a character.
+ * @param[in] c Is the character.
+ * @return the segments of the glyph, 0 (blank) for the characters without glyph.
+ */
+uint8_t seg7_encode(char c);
+
+/**
+ * @brief Function for getting the glyph of a hex digit.
+ * @param[in] value Is the digit, only its 4 lower bits are used.
+ * @return the segments of the glyph.
+ */
+uint8_t seg7_encode_hex(uint8_t value);
+
+/**
+ * @brief Function for grouping the segment gpios of a display and preparing the writes of the digits.
+ * @note The gpios must be exported and configured as output.
+ * @param[out] disp Is the display to be initialized.
+ * @param[in] pins Is the gpios of the segments A to G and DP (SEG7_NUM_PINS gpios).
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int seg7_init(struct seg7* disp, const uint8_t* pins);
+
+/**
+ * @brief Function for writing the glyph of a character, the decimal point is not changed.
+ * @param[in] disp Is the display.
+ * @param[in] c Is the character.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int seg7_write(struct seg7* disp, char c);
+
+/**
+ * @brief Function for writing a hex digit with its prepared write, the decimal point is not changed.
+ * @param[in] disp Is the display.
+ * @param[in] value Is the digit (0 to 15).
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int seg7_write_digit(struct seg7* disp, uint8_t value);
+
+/**
+ * @brief Function for writing every segment, including the decimal point.
+ * @param[in] disp Is the display.
+ * @param[in] segments Is the segments switched on, see @ref SEG7_SEGMENTS.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int seg7_write_segments(struct seg7* disp, uint8_t segments);
+
+#endif
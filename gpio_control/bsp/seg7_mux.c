@@ -0,0 +1,471 @@
+/********************************************************************************************************//**
+* @file seg7_mux.c
+*
+* @brief Refresh engine of a multiplexed 7 segment display, scanning the digits from one thread.
+*
+* The frame is one 64 bit word (one glyph per byte) stored atomically by seg7_mux_post(), so the thread
+* never shows half of a new frame and the application never waits for the thread. The brightness levels
+* and the blank time are also read by the thread at every slot, so they can be changed while refreshing.
+*
+* Public Functions:
+*       - int seg7_mux_init(const uint8_t* seg_pins, const uint8_t* digit_pins, uint8_t ndigits,
+*                           uint32_t slot_us)
+*       - void seg7_mux_deinit(void)
+*       - int seg7_mux_start(void)
+*       - void seg7_mux_stop(void)
+*       - void seg7_mux_post(const uint8_t* glyphs)
+*       - void seg7_mux_post_number(uint32_t number, uint8_t dots)
+*       - int seg7_mux_set_brightness(uint8_t level)
+*       - int seg7_mux_set_digit_brightness(uint8_t digit, uint8_t level)
+*       - int seg7_mux_set_blank(uint32_t blank_us)
+*       - void seg7_mux_get_stats(struct seg7_mux_stats* stats)
+*       - void seg7_mux_reset_stats(void)
+*       - uint32_t seg7_mux_late_percentile(const struct seg7_mux_stats* stats, uint8_t percent)
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/timerfd.h>
+#include "gpio_driver.h"
+#include "seg7_mux.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief First bit of the digit selection pins in the display port */
+#define DIGIT_SHIFT             SEG7_NUM_PINS
+
+/** @brief Bitmask of the segment pins (and decimal point) in the display port */
+#define SEGMENTS_MASK           ((1UL << SEG7_NUM_PINS) - 1)
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Protects the statistics */
+static pthread_mutex_t mux_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Segments and then digit selections of the display */
+static struct gpio_port disp_port;
+
+/** @brief Prepared write switching every digit off */
+static struct gpio_bank_write blank_write;
+
+/** @brief Prepared write selecting each digit (the others are already off) */
+static struct gpio_bank_write select_writes[SEG7_MUX_MAX_DIGITS];
+
+/** @brief Number of digits of the display, 0 if not initialized */
+static uint8_t num_digits = 0;
+
+/** @brief Time each digit is on */
+static uint32_t slot_ns = SEG7_MUX_DEFAULT_SLOT_US * 1000;
+
+/** @brief Current frame, byte N is the glyph of digit N */
+static uint64_t frame = 0;
+
+/** @brief Brightness level of each digit */
+static uint8_t levels[SEG7_MUX_MAX_DIGITS];
+
+/** @brief Time every digit is off at the start of a slot */
+static uint32_t blank_ns = 0;
+
+/** @brief Timing statistics */
+static struct seg7_mux_stats stats;
+
+/** @brief Refresh thread */
+static pthread_t mux_thread;
+
+/** @brief The refresh thread is running */
+static volatile uint8_t running = 0;
+
+/** @brief File descriptor of the deadline timer, -1 if not created */
+static int timer_fd = -1;
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for sleeping until an absolute deadline.
+ * @param[in] deadline_ns Is the CLOCK_MONOTONIC deadline.
+ * @return void.
+ */
+static void sleep_until(uint64_t deadline_ns);
+
+/**
+ * @brief Thread scanning the digits.
+ * @param[in] arg Is not used.
+ * @return NULL.
+ */
+static void* mux_loop(void* arg);
+
+/**
+ * @brief Function for getting the time of a clock in ns.
+ * @param[in] clock Is the clock (CLOCK_MONOTONIC or CLOCK_THREAD_CPUTIME_ID).
+ * @return the current time.
+ */
+static uint64_t clock_ns(clockid_t clock);
+
+/***********************************************************************************************************/
+/*                                       Public API Definitions                                            */
+/***********************************************************************************************************/
+
+int seg7_mux_init(const uint8_t* seg_pins, const uint8_t* digit_pins, uint8_t ndigits, uint32_t slot_us){
+
+    uint8_t i = 0;
+    uint8_t pins[SEG7_NUM_PINS + SEG7_MUX_MAX_DIGITS];
+    uint32_t digit_mask = 0;
+
+    if(running){
+        fprintf(stderr, "Error, the display can not be changed while refreshing\n");
+        return 1;
+    }
+
+    if(!ndigits || ndigits > SEG7_MUX_MAX_DIGITS){
+        fprintf(stderr, "Error, a multiplexed display has 1 to %d digits\n", SEG7_MUX_MAX_DIGITS);
+        return 1;
+    }
+
+    if(!slot_us){
+        slot_us = SEG7_MUX_DEFAULT_SLOT_US;
+    }
+    if(slot_us < SEG7_MUX_MIN_SLOT_US){
+        fprintf(stderr, "Error, the digit slot can not be shorter than %d us\n", SEG7_MUX_MIN_SLOT_US);
+        return 1;
+    }
+    if(slot_us > SEG7_MUX_MAX_SLOT_US){
+        fprintf(stderr, "Error, the digit slot can not be longer than %d us\n", SEG7_MUX_MAX_SLOT_US);
+        return 1;
+    }
+
+    memcpy(pins, seg_pins, SEG7_NUM_PINS);
+    memcpy(pins + SEG7_NUM_PINS, digit_pins, ndigits);
+    if(gpio_port_init(&disp_port, pins, SEG7_NUM_PINS + ndigits)){
+        return 1;
+    }
+
+    /* The selections are active low: a digit is on when its pin is low and the others are high */
+    digit_mask = ((1UL << ndigits) - 1) << DIGIT_SHIFT;
+    if(gpio_port_prepare(&disp_port, digit_mask, digit_mask, &blank_write)){
+        return 1;
+    }
+    for(i = 0; i < ndigits; i++){
+        if(gpio_port_prepare(&disp_port, 1UL << (DIGIT_SHIFT + i), 0, &select_writes[i])){
+            return 1;
+        }
+    }
+
+    if(timer_fd < 0){
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        if(timer_fd < 0){
+            perror("Error, display timer could not be created");
+            return 1;
+        }
+    }
+
+    num_digits = ndigits;
+    slot_ns = slot_us * 1000;
+    blank_ns = 0;
+    memset(levels, SEG7_MUX_BRIGHTNESS_MAX, sizeof(levels));
+    __atomic_store_n(&frame, 0, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+void seg7_mux_deinit(void){
+
+    seg7_mux_stop();
+
+    num_digits = 0;
+    if(timer_fd >= 0){
+        close(timer_fd);
+        timer_fd = -1;
+    }
+}
+
+int seg7_mux_start(void){
+
+    if(running){
+        return 0;
+    }
+
+    if(!num_digits){
+        fprintf(stderr, "Error, the display is not initialized\n");
+        return 1;
+    }
+
+    running = 1;
+    if(pthread_create(&mux_thread, NULL, mux_loop, NULL)){
+        running = 0;
+        fprintf(stderr, "Error, display thread could not be created\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+void seg7_mux_stop(void){
+
+    if(!running){
+        return;
+    }
+
+    /* The thread checks the flag once per frame, after the slots of all the digits */
+    running = 0;
+    pthread_join(mux_thread, NULL);
+
+    gpio_write_banks(&blank_write);
+}
+
+void seg7_mux_post(const uint8_t* glyphs){
+
+    uint8_t i = 0;
+    uint64_t next = 0;
+
+    for(i = 0; i < num_digits; i++){
+        next |= (uint64_t)glyphs[i] << (8 * i);
+    }
+    __atomic_store_n(&frame, next, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&mux_lock);
+    stats.frames++;
+    pthread_mutex_unlock(&mux_lock);
+}
+
+void seg7_mux_post_number(uint32_t number, uint8_t dots){
+
+    uint8_t i = 0;
+    uint8_t glyphs[SEG7_MUX_MAX_DIGITS];
+
+    /* The rightmost digit is the units */
+    for(i = num_digits; i > 0; i--){
+        glyphs[i - 1] = seg7_encode_hex(number % 10) | ((dots & (1 << (i - 1))) ? SEG7_DP : 0);
+        number /= 10;
+    }
+
+    seg7_mux_post(glyphs);
+}
+
+int seg7_mux_set_brightness(uint8_t level){
+
+    uint8_t i = 0;
+
+    if(level > SEG7_MUX_BRIGHTNESS_MAX){
+        fprintf(stderr, "Error, brightness levels go from 0 to %d\n", SEG7_MUX_BRIGHTNESS_MAX);
+        return 1;
+    }
+
+    for(i = 0; i < SEG7_MUX_MAX_DIGITS; i++){
+        __atomic_store_n(&levels[i], level, __ATOMIC_RELAXED);
+    }
+
+    return 0;
+}
+
+int seg7_mux_set_digit_brightness(uint8_t digit, uint8_t level){
+
+    if(digit >= num_digits){
+        fprintf(stderr, "Error, the display has %d digits\n", num_digits);
+        return 1;
+    }
+
+    if(level > SEG7_MUX_BRIGHTNESS_MAX){
+        fprintf(stderr, "Error, brightness levels go from 0 to %d\n", SEG7_MUX_BRIGHTNESS_MAX);
+        return 1;
+    }
+
+    __atomic_store_n(&levels[digit], level, __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+int seg7_mux_set_blank(uint32_t blank_us){
+
+    if((uint64_t)blank_us * 1000 >= slot_ns){
+        fprintf(stderr, "Error, the blank time must be shorter than the slot (%u us)\n", slot_ns / 1000);
+        return 1;
+    }
+
+    __atomic_store_n(&blank_ns, blank_us * 1000, __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+void seg7_mux_get_stats(struct seg7_mux_stats* stats_out){
+
+    pthread_mutex_lock(&mux_lock);
+    *stats_out = stats;
+    pthread_mutex_unlock(&mux_lock);
+}
+
+void seg7_mux_reset_stats(void){
+
+    pthread_mutex_lock(&mux_lock);
+    memset(&stats, 0, sizeof(stats));
+    pthread_mutex_unlock(&mux_lock);
+}
+
+uint32_t seg7_mux_late_percentile(const struct seg7_mux_stats* stats_in, uint8_t percent){
+
+    uint8_t b = 0;
+    uint64_t count = 0;
+    uint64_t target = (stats_in->slots * percent + 99) / 100;
+
+    for(b = 0; b < SEG7_MUX_LATE_BUCKETS; b++){
+        count += stats_in->late_hist[b];
+        if(count >= target){
+            break;
+        }
+    }
+
+    return ((1UL << (b + 1)) - 1) < stats_in->late_max_ns ? (1UL << (b + 1)) - 1 : stats_in->late_max_ns;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static void sleep_until(uint64_t deadline_ns){
+
+    uint64_t expirations = 0;
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = deadline_ns / 1000000000ULL;
+    its.it_value.tv_nsec = deadline_ns % 1000000000ULL;
+
+    /* A deadline already passed expires at once */
+    if(timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0){
+        return;
+    }
+    while(read(timer_fd, &expirations, sizeof(expirations)) < 0 && errno == EINTR);
+}
+
+static void* mux_loop(void* arg){
+
+    uint8_t d = 0;
+    uint8_t b = 0;
+    uint8_t glyph = 0;
+    uint8_t lit = 0;
+    int ret = 0;
+    uint32_t blank = 0;
+    uint64_t on_ns = 0;
+    uint64_t t_on = 0;
+    uint64_t t_off = 0;
+    uint64_t t_slot = 0;
+    uint64_t late = 0;
+    uint64_t now = 0;
+    uint64_t skipped = 0;
+    uint64_t t_frame = 0;
+    uint64_t cpu_frame = 0;
+    uint64_t cpu = 0;
+    struct seg7_mux_stats frame_stats;
+
+    t_slot = clock_ns(CLOCK_MONOTONIC);
+    t_frame = t_slot;
+    cpu_frame = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+
+    while(running){
+        memset(&frame_stats, 0, sizeof(frame_stats));
+
+        for(d = 0; d < num_digits; d++){
+            sleep_until(t_slot);
+
+            now = clock_ns(CLOCK_MONOTONIC);
+            late = now > t_slot ? now - t_slot : 0;
+
+            /* Previous digit off (if not already off by its brightness) */
+            ret = gpio_write_banks(&blank_write);
+            if(lit){
+                t_off = clock_ns(CLOCK_MONOTONIC);
+                frame_stats.lit_ns += t_off - t_on;
+                lit = 0;
+            }
+
+            /* Time the digit is on, what is left of the slot after the blank time scaled by the level */
+            blank = __atomic_load_n(&blank_ns, __ATOMIC_RELAXED);
+            on_ns = (uint64_t)(slot_ns - blank) * __atomic_load_n(&levels[d], __ATOMIC_RELAXED) /
+                    SEG7_MUX_BRIGHTNESS_MAX;
+
+            if(on_ns){
+                /* Counted from the time the previous digit went off, also when the thread is late */
+                if(blank && clock_ns(CLOCK_MONOTONIC) < t_off + blank){
+                    sleep_until(t_off + blank);
+                }
+
+                /* The segments, then the digit on: no segment changes while lit */
+                glyph = __atomic_load_n(&frame, __ATOMIC_ACQUIRE) >> (8 * d);
+                ret |= gpio_write_mask(&disp_port, SEGMENTS_MASK, glyph);
+                ret |= gpio_write_banks(&select_writes[d]);
+                t_on = clock_ns(CLOCK_MONOTONIC);
+                lit = 1;
+
+                /* Dimmed digit: off before the end of its slot, the display stays dark until the next one */
+                if(on_ns < slot_ns - blank){
+                    sleep_until(t_slot + blank + on_ns);
+                    ret |= gpio_write_banks(&blank_write);
+                    t_off = clock_ns(CLOCK_MONOTONIC);
+                    frame_stats.lit_ns += t_off - t_on;
+                    lit = 0;
+                }
+            }
+            if(ret){
+                frame_stats.errors++;
+            }
+
+            b = late ? 63 - __builtin_clzll(late) : 0;
+            frame_stats.late_hist[b < SEG7_MUX_LATE_BUCKETS ? b : SEG7_MUX_LATE_BUCKETS - 1]++;
+            frame_stats.late_total_ns += late;
+            if(late > frame_stats.late_max_ns){
+                frame_stats.late_max_ns = late > UINT32_MAX ? UINT32_MAX : late;
+            }
+            frame_stats.slots++;
+
+            /* A late thread skips the slots already passed instead of running them back to back */
+            t_slot += slot_ns;
+            now = clock_ns(CLOCK_MONOTONIC);
+            if(now >= t_slot + slot_ns){
+                skipped = (now - t_slot) / slot_ns;
+                frame_stats.overruns += skipped;
+                t_slot += skipped * slot_ns;
+            }
+        }
+
+        /* Statistics of the frame, once per frame */
+        cpu = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+        pthread_mutex_lock(&mux_lock);
+        stats.slots += frame_stats.slots;
+        stats.overruns += frame_stats.overruns;
+        stats.errors += frame_stats.errors;
+        stats.lit_ns += frame_stats.lit_ns;
+        stats.late_total_ns += frame_stats.late_total_ns;
+        if(frame_stats.late_max_ns > stats.late_max_ns){
+            stats.late_max_ns = frame_stats.late_max_ns;
+        }
+        for(b = 0; b < SEG7_MUX_LATE_BUCKETS; b++){
+            stats.late_hist[b] += frame_stats.late_hist[b];
+        }
+        stats.cpu_ns += cpu - cpu_frame;
+        stats.run_ns += now - t_frame;
+        pthread_mutex_unlock(&mux_lock);
+        cpu_frame = cpu;
+        t_frame = now;
+    }
+
+    return NULL;
+}
+
+static uint64_t clock_ns(clockid_t clock){
+
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
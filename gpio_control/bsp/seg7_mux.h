@@ -0,0 +1,174 @@
+/********************************************************************************************************//**
+* @file seg7_mux.h
+*
+* @brief Header file containing the prototypes of the APIs for refreshing a multiplexed 7 segment display.
+*
+* The segments of the digits are wired together and every digit has a selection gpio (active low), so only
+* one digit is on at a time. One thread switches to the next digit every slot (e.g. 1 ms, 1 kHz per digit),
+* sleeping until the absolute deadline of each slot with a timerfd, so the refresh rate does not depend on
+* the write latency and the thread does not use the CPU between two slots. A slot is three port writes:
+* every digit off, the segments of the digit, then its selection, so the segments never change while a
+* digit is on (no ghosting).
+*
+* The application only posts a frame (the glyphs of the digits, see seg7.h) with seg7_mux_post() when the
+* content changes; the thread picks it up at its next slot. The lateness of the slots (refresh jitter) is
+* recorded in a log2 histogram, and the CPU time of the thread is measured, both returned by
+* seg7_mux_get_stats(). When the thread is late by whole slots, the missed slots are counted as overruns.
+*
+* The brightness is set by the time a digit is on inside its slot (on-time slicing, no hardware PWM), for
+* every digit with seg7_mux_set_brightness() or per digit with seg7_mux_set_digit_brightness(): at level L
+* the digit is switched off after L / SEG7_MUX_BRIGHTNESS_MAX of its slot and the display stays dark until
+* the next slot, so the average current drops with the level while the refresh rate does not change. A
+* blank time (seg7_mux_set_blank()) keeps every digit off at the start of each slot before the next digit
+* is lit, giving slow digit drivers the time to switch off so the previous digit does not glow with the
+* segments of the next one. A dimmed slot costs a second wake-up of the thread.
+*
+* Public Functions:
+*       - int seg7_mux_init(const uint8_t* seg_pins, const uint8_t* digit_pins, uint8_t ndigits,
+*                           uint32_t slot_us)
+*       - void seg7_mux_deinit(void)
+*       - int seg7_mux_start(void)
+*       - void seg7_mux_stop(void)
+*       - void seg7_mux_post(const uint8_t* glyphs)
+*       - void seg7_mux_post_number(uint32_t number, uint8_t dots)
+*       - int seg7_mux_set_brightness(uint8_t level)
+*       - int seg7_mux_set_digit_brightness(uint8_t digit, uint8_t level)
+*       - int seg7_mux_set_blank(uint32_t blank_us)
+*       - void seg7_mux_get_stats(struct seg7_mux_stats* stats)
+*       - void seg7_mux_reset_stats(void)
+*       - uint32_t seg7_mux_late_percentile(const struct seg7_mux_stats* stats, uint8_t percent)
+*/
+
+#ifndef SEG7_MUX_H
+#define SEG7_MUX_H
+
+#include <stdint.h>
+#include "seg7.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+#define SEG7_MUX_MAX_DIGITS         8       /**< @brief Digits of a display, a frame fits in 64 bits */
+#define SEG7_MUX_DEFAULT_SLOT_US    1000    /**< @brief 1 kHz per digit, 250 Hz frames with 4 digits */
+#define SEG7_MUX_MIN_SLOT_US        100     /**< @brief Shortest slot accepted */
+#define SEG7_MUX_MAX_SLOT_US        100000  /**< @brief Longest slot accepted (10 Hz per digit) */
+#define SEG7_MUX_LATE_BUCKETS       24      /**< @brief Log2 buckets of the lateness, up to 16 ms */
+#define SEG7_MUX_BRIGHTNESS_MAX     16      /**< @brief Full brightness, a digit is on for its whole slot */
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Timing statistics of the refresh thread */
+struct seg7_mux_stats{
+    uint64_t slots;                                 /**< @brief Digits switched on */
+    uint32_t frames;                                /**< @brief Frames posted */
+    uint32_t overruns;                              /**< @brief Slots skipped because the thread was late */
+    uint32_t errors;                                /**< @brief Slots whose port writes failed */
+    uint64_t late_total_ns;                         /**< @brief Sum of the lateness of the slots */
+    uint32_t late_max_ns;                           /**< @brief Latest slot */
+    uint32_t late_hist[SEG7_MUX_LATE_BUCKETS];      /**< @brief Slots per log2 bucket of lateness in ns */
+    uint64_t lit_ns;                                /**< @brief Time a digit was on */
+    uint64_t cpu_ns;                                /**< @brief CPU time used by the thread */
+    uint64_t run_ns;                                /**< @brief Time the thread has been running */
+};
+
+/***********************************************************************************************************/
+/*                                       APIs Supported                                                    */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for initializing the refresh engine, with a blank frame, full brightness and no blank time.
+ * @note The gpios must be exported and configured as output, the digits high (off).
+ * @param[in] seg_pins Is the gpios of the segments A to G and DP (SEG7_NUM_PINS gpios).
+ * @param[in] digit_pins Is the selection gpios of the digits, the leftmost digit first.
+ * @param[in] ndigits Is the number of digits (up to SEG7_MUX_MAX_DIGITS).
+ * @param[in] slot_us Is the time each digit is on in us (SEG7_MUX_MIN_SLOT_US to SEG7_MUX_MAX_SLOT_US).
+ * @return 0 if success.
+ * @return != 0 if fail (e.g. the engine is running).
+ */
+int seg7_mux_init(const uint8_t* seg_pins, const uint8_t* digit_pins, uint8_t ndigits, uint32_t slot_us);
+
+/**
+ * @brief Function for stopping the refresh engine and releasing its timer.
+ * @return void.
+ */
+void seg7_mux_deinit(void);
+
+/**
+ * @brief Function for starting the refresh thread.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int seg7_mux_start(void);
+
+/**
+ * @brief Function for stopping the refresh thread, switching every digit off.
+ * @return void.
+ */
+void seg7_mux_stop(void);
+
+/**
+ * @brief Function for posting the frame shown from the next slot.
+ * @param[in] glyphs Is the segments of each digit (see seg7.h), the leftmost digit first.
+ * @return void.
+ */
+void seg7_mux_post(const uint8_t* glyphs);
+
+/**
+ * @brief Function for posting a decimal number, with leading zeros.
+ * @param[in] number Is the number, only its lower digits are shown.
+ * @param[in] dots Is the decimal points switched on, bit N for digit N (the leftmost is digit 0).
+ * @return void.
+ */
+void seg7_mux_post_number(uint32_t number, uint8_t dots);
+
+/**
+ * @brief Function for setting the brightness of every digit, applied from the next slot.
+ * @param[in] level Is the brightness, from 0 (off) to SEG7_MUX_BRIGHTNESS_MAX (on for the whole slot).
+ * @return 0 if success.
+ * @return != 0 if fail (e.g. invalid level).
+ */
+int seg7_mux_set_brightness(uint8_t level);
+
+/**
+ * @brief Function for setting the brightness of one digit, applied from its next slot.
+ * @param[in] digit Is the digit (the leftmost is digit 0).
+ * @param[in] level Is the brightness, from 0 (off) to SEG7_MUX_BRIGHTNESS_MAX (on for the whole slot).
+ * @return 0 if success.
+ * @return != 0 if fail (e.g. invalid digit or level).
+ */
+int seg7_mux_set_digit_brightness(uint8_t digit, uint8_t level);
+
+/**
+ * @brief Function for setting the time every digit is off at the start of each slot.
+ * @note The on time of the digits is taken from the rest of the slot.
+ * @param[in] blank_us Is the blank time in us (0 by default, shorter than the slot).
+ * @return 0 if success.
+ * @return != 0 if fail (e.g. not shorter than the slot).
+ */
+int seg7_mux_set_blank(uint32_t blank_us);
+
+/**
+ * @brief Function for getting the statistics of the refresh thread.
+ * @param[out] stats Is the statistics.
+ * @return void.
+ */
+void seg7_mux_get_stats(struct seg7_mux_stats* stats);
+
+/**
+ * @brief Function for clearing the statistics of the refresh thread.
+ * @return void.
+ */
+void seg7_mux_reset_stats(void);
+
+/**
+ * @brief Function for estimating a percentile of the slot lateness from the histogram.
+ * @param[in] stats Is the statistics.
+ * @param[in] percent Is the percentile (e.g. 99).
+ * @return the upper bound of the bucket containing the percentile in ns.
+ */
+uint32_t seg7_mux_late_percentile(const struct seg7_mux_stats* stats, uint8_t percent);
+
+#endif
@@ -0,0 +1,71 @@
+/********************************************************************************************************//**
+* @file shift_74hc595.c
+*
+* @brief Functions for driving chained 74HC595 shift registers with 3 gpios.
+*
+* Public Functions:
+*       - int hc595_init(struct hc595* sr, uint8_t data_gpio, uint8_t clock_gpio, uint8_t latch_gpio,
+*                        uint8_t nbits)
+*       - int hc595_write(struct hc595* sr, uint32_t frame)
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include "gpio_driver.h"
+#include "shift_74hc595.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+#define HC595_PORT_DATA         (1 << 0)    /**< @brief SER in the port of the chain */
+#define HC595_PORT_CLOCK        (1 << 1)    /**< @brief SRCLK in the port of the chain */
+#define HC595_PORT_LATCH        (1 << 2)    /**< @brief RCLK in the port of the chain */
+#define HC595_PORT_PINS         3           /**< @brief Gpios of a chain */
+
+/***********************************************************************************************************/
+/*                                       Public API Definitions                                            */
+/***********************************************************************************************************/
+
+int hc595_init(struct hc595* sr, uint8_t data_gpio, uint8_t clock_gpio, uint8_t latch_gpio, uint8_t nbits){
+
+    const uint8_t pins[HC595_PORT_PINS] = {data_gpio, clock_gpio, latch_gpio};
+    const struct gpio_pin_config pin_table[HC595_PORT_PINS] = {
+        GPIO_PIN_OUT(data_gpio, GPIO_LOW_VALUE), GPIO_PIN_OUT(clock_gpio, GPIO_LOW_VALUE),
+        GPIO_PIN_OUT(latch_gpio, GPIO_LOW_VALUE)
+    };
+
+    if(!nbits || nbits > HC595_MAX_BITS || nbits % HC595_CHIP_BITS){
+        fprintf(stderr, "Error, a 74HC595 chain can not have %d outputs\n", nbits);
+        return 1;
+    }
+
+    if(gpio_init_pins(pin_table, HC595_PORT_PINS, NULL) || gpio_port_init(&sr->port, pins, HC595_PORT_PINS)){
+        return 1;
+    }
+    sr->nbits = nbits;
+
+    return 0;
+}
+
+int hc595_write(struct hc595* sr, uint32_t frame){
+
+    uint8_t i = sr->nbits;
+
+    /* MSB first: data with the clock falling edge, sampled by the chip on the rising edge */
+    while(i--){
+        if(gpio_write_mask(&sr->port, HC595_PORT_DATA | HC595_PORT_CLOCK,
+                           ((frame >> i) & 1) ? HC595_PORT_DATA : 0) ||
+           gpio_write_mask(&sr->port, HC595_PORT_CLOCK, HC595_PORT_CLOCK)){
+            return 1;
+        }
+    }
+
+    /* The shifted frame is copied to the outputs on the latch rising edge */
+    if(gpio_write_mask(&sr->port, HC595_PORT_CLOCK | HC595_PORT_LATCH, HC595_PORT_LATCH) ||
+       gpio_write_mask(&sr->port, HC595_PORT_LATCH, 0)){
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+/********************************************************************************************************//**
+* @file shift_74hc595.h
+*
+* @brief Header file containing the prototypes of the APIs for driving 74HC595 shift registers.
+*
+* One or several chained 74HC595 (QH' of a chip to SER of the next one) are driven with 3 gpios: the serial
+* data (SER), the shift clock (SRCLK) and the latch clock (RCLK). OE is tied low and SRCLR high. A frame of
+* 8 to 32 bits is shifted MSB first, so bit N of the frame ends on output N of the chain (QA of the first
+* chip is output 0), and the outputs change at once on the latch pulse.
+*
+* The 3 gpios are grouped in one port, so every edge is one port write: the data bit is set together with
+* the clock falling edge, then the clock rises. A frame of N bits is 2 * N + 2 port writes, which are one
+* register store each with the mmio backend when the gpios share a bank. The data writes of equal
+* consecutive bits are elided by the driver.
+*
+* Public Functions:
+*       - int hc595_init(struct hc595* sr, uint8_t data_gpio, uint8_t clock_gpio, uint8_t latch_gpio,
+*                        uint8_t nbits)
+*       - int hc595_write(struct hc595* sr, uint32_t frame)
+*/
+
+#ifndef SHIFT_74HC595_H
+#define SHIFT_74HC595_H
+
+#include <stdint.h>
+#include "gpio_driver.h"
+#include "board_pins.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+#define HC595_CHIP_BITS         8   /**< @brief Outputs of one chip */
+#define HC595_MAX_BITS          32  /**< @brief Outputs of the longest chain (4 chips) */
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Chain of shift registers */
+struct hc595{
+    struct gpio_port port;              /**< @brief Data, clock and latch gpios (bits 0, 1 and 2) */
+    uint8_t nbits;                      /**< @brief Outputs of the chain */
+};
+
+/***********************************************************************************************************/
+/*                                       APIs Supported                                                    */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for exporting and configuring the gpios of a chain, driven low.
+ * @note The outputs of the chips are unknown until the first hc595_write().
+ * @param[out] sr Is the chain to be initialized.
+ * @param[in] data_gpio Is the gpio connected to SER.
+ * @param[in] clock_gpio Is the gpio connected to SRCLK.
+ * @param[in] latch_gpio Is the gpio connected to RCLK.
+ * @param[in] nbits Is the number of outputs, a multiple of HC595_CHIP_BITS up to HC595_MAX_BITS.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int hc595_init(struct hc595* sr, uint8_t data_gpio, uint8_t clock_gpio, uint8_t latch_gpio, uint8_t nbits);
+
+/**
+ * @brief Function for shifting a frame into the chain and latching it to the outputs.
+ * @param[in] sr Is the chain.
+ * @param[in] frame Is the outputs, bit N is output N of the chain.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int hc595_write(struct hc595* sr, uint32_t frame);
+
+#endif
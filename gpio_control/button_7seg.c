@@ -6,45 +6,44 @@
 
 #include <stdio.h>
 #include <stdint.h>
-#include <unistd.h>
-#include <string.h>
 #include <stdlib.h>
-#include <fcntl.h>
-#include <poll.h>
 #include "gpio_driver.h"
+#include "gpio_event.h"
+#include "board_pins.h"
+#include "seg7.h"
 
 /***********************************************************************************************************/
 /*                                       Defines and Macros                                                */
 /***********************************************************************************************************/
 
-/**
- * @defgroup GPIO_7SEG GPIO connected to the 7 segment display.
- * @{
- */
-#define GPIO_66_P8_7_SEGA       66  /**< @brief GPIO regarding segment A */
-#define GPIO_67_P8_8_SEGB       67  /**< @brief GPIO regarding segment B */
-#define GPIO_69_P8_9_SEGC       69  /**< @brief GPIO regarding segment C */
-#define GPIO_68_P8_10_DP        68  /**< @brief GPIO regarding decimal point */
-#define GPIO_45_P8_11_SEGD      45  /**< @brief GPIO regarding segment D */
-#define GPIO_44_P8_12_SEGE      44  /**< @brief GPIO regarding segment E */
-#define GPIO_26_P8_14_SEGF      26  /**< @brief GPIO regarding segment F */
-#define GPIO_46_P8_16_SEGG      46  /**< @brief GPIO regarding segment G */
-/** @} */
-
-/** @brief GPIO connected to the push button */
-#define GPIO_49_P9_23_BUTTON    49
-
-/**
- * @defgroup SEGMENT_ON Possible values for settin a segment of the display as ON/OFF.
- * @{
- */
-#define SEGMENT_ON              1   /**< @brief Value for setting a segment to ON */
-#define SEGMENT_OFF             0   /**< @brief Value for setting a segment to OFF */
-/** @} */
+/** @brief Time the button level must be stable for counting a press (contact bounce filter) */
+#define BUTTON_SETTLE_TIME      20000 /* In microseconds */
 
-/** @brief Timeout of the poll process for detecting button press */
+/** @brief Timeout of the wait for detecting button press */
 #define POLL_TIMEOUT            3000 /* In miliseconds */
 
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Gpios of the segments A to G and DP */
+static const uint8_t seg_pins[SEG7_NUM_PINS] = {
+    GPIO_66_P8_7_SEGA, GPIO_67_P8_8_SEGB, GPIO_69_P8_9_SEGC, GPIO_45_P8_11_SEGD,
+    GPIO_44_P8_12_SEGE, GPIO_26_P8_14_SEGF, GPIO_46_P8_16_SEGG, GPIO_68_P8_10_DP
+};
+
+/** @brief Gpios used by the application, the edge of the button is configured by the event engine */
+static const struct gpio_pin_config pin_table[] = {
+    GPIO_PIN_OUT(GPIO_66_P8_7_SEGA, GPIO_LOW_VALUE), GPIO_PIN_OUT(GPIO_67_P8_8_SEGB, GPIO_LOW_VALUE),
+    GPIO_PIN_OUT(GPIO_69_P8_9_SEGC, GPIO_LOW_VALUE), GPIO_PIN_OUT(GPIO_68_P8_10_DP, GPIO_LOW_VALUE),
+    GPIO_PIN_OUT(GPIO_45_P8_11_SEGD, GPIO_LOW_VALUE), GPIO_PIN_OUT(GPIO_44_P8_12_SEGE, GPIO_LOW_VALUE),
+    GPIO_PIN_OUT(GPIO_26_P8_14_SEGF, GPIO_LOW_VALUE), GPIO_PIN_OUT(GPIO_46_P8_16_SEGG, GPIO_LOW_VALUE),
+    GPIO_PIN_IN(GPIO_49_P9_23_BUTTON, NULL)
+};
+
+/** @brief 7 segment display */
+static struct seg7 display;
+
 /***********************************************************************************************************/
 /*                                       Static Function Prototypes                                        */
 /***********************************************************************************************************/
@@ -56,53 +55,33 @@
  */
 static int ini_all_gpio(void);
 
-/**
- * @brief Function for set a number in the display.
- * @param[in] number_dis Is the number to be set.
- * @return void.
- */
-static void write_7seg(uint8_t number_dis);
-
 /***********************************************************************************************************/
 /*                                       Main Function                                                     */
 /***********************************************************************************************************/
 
 int main(int argc, char* argv[]){
 
-    int fd = 0;
-    int timeout = POLL_TIMEOUT;
-    struct pollfd fdset[2];
+    int i = 0;
+    int n = 0;
     uint8_t counter = 0;
-    uint8_t buffer[100] = {0};
+    struct gpio_event events[GPIO_EVENT_MAX_BATCH];
 
-    if(ini_all_gpio() < 0){
+    if(ini_all_gpio()){
         printf("Error: GPIO init failed\n");
-    }
-    else{
-        printf("Push button for counting...\n");
-
-        /* Open file of the button GPIO */
-        fd = open("/sys/class/gpio/gpio49/value", O_RDONLY | O_NONBLOCK );
-        if(fd <= 0){
-            perror("Error, filer for reading button GPIO could not be opened");
-            exit(EXIT_FAILURE);
-        }
+        exit(EXIT_FAILURE);
     }
 
-    while(1){
-        /* Initialize fdset struct */
-        memset((void*)fdset, 0, sizeof(fdset));
-        fdset[1].fd = fd;
-        fdset[1].events = POLLPRI;
+    printf("Push button for counting...\n");
 
+    while(1){
         /* Waiting until button is pressed */
-        poll(fdset, 2, timeout);
+        n = gpio_event_wait(events, GPIO_EVENT_MAX_BATCH, POLL_TIMEOUT);
 
-        if(fdset[1].revents & POLLPRI){
-            lseek(fdset[1].fd, 0, SEEK_SET);
-            read(fdset[1].fd, buffer, 100);
-            write_7seg(counter);
-            counter++;
+        for(i = 0; i < n; i++){
+            if(events[i].gpio_no == GPIO_49_P9_23_BUTTON){
+                seg7_write_digit(&display, counter);
+                counter = (counter + 1) % 10;
+            }
         }
     }
 
@@ -115,139 +94,18 @@ int main(int argc, char* argv[]){
 
 static int ini_all_gpio(void){
 
-    /* Export all required GPIOs */
-    if(gpio_export(GPIO_66_P8_7_SEGA)){return 1;}
-    if(gpio_export(GPIO_67_P8_8_SEGB)){return 1;}
-    if(gpio_export(GPIO_69_P8_9_SEGC)){return 1;}
-    if(gpio_export(GPIO_68_P8_10_DP)){return 1;}
-    if(gpio_export(GPIO_45_P8_11_SEGD)){return 1;}
-    if(gpio_export(GPIO_44_P8_12_SEGE)){return 1;}
-    if(gpio_export(GPIO_26_P8_14_SEGF)){return 1;}
-    if(gpio_export(GPIO_46_P8_16_SEGG)){return 1;}
-    if(gpio_export(GPIO_49_P9_23_BUTTON)){return 1;}
-
-    /* Configure the direction of all required GPIOs */
-    if(gpio_config_dir(GPIO_66_P8_7_SEGA, GPIO_DIR_OUT)){return 1;}
-    if(gpio_config_dir(GPIO_67_P8_8_SEGB, GPIO_DIR_OUT)){return 1;}
-    if(gpio_config_dir(GPIO_69_P8_9_SEGC, GPIO_DIR_OUT)){return 1;}
-    if(gpio_config_dir(GPIO_68_P8_10_DP, GPIO_DIR_OUT)){return 1;}
-    if(gpio_config_dir(GPIO_45_P8_11_SEGD, GPIO_DIR_OUT)){return 1;}
-    if(gpio_config_dir(GPIO_44_P8_12_SEGE, GPIO_DIR_OUT)){return 1;}
-    if(gpio_config_dir(GPIO_26_P8_14_SEGF, GPIO_DIR_OUT)){return 1;}
-    if(gpio_config_dir(GPIO_46_P8_16_SEGG, GPIO_DIR_OUT)){return 1;}
-    if(gpio_config_dir(GPIO_49_P9_23_BUTTON, GPIO_DIR_IN)){return 1;}
-
-    /* Initialize to low the value of all required GPIOs */
-    if(gpio_write_value(GPIO_66_P8_7_SEGA, GPIO_LOW_VALUE)){return 1;}
-    if(gpio_write_value(GPIO_67_P8_8_SEGB, GPIO_LOW_VALUE)){return 1;}
-    if(gpio_write_value(GPIO_69_P8_9_SEGC, GPIO_LOW_VALUE)){return 1;}
-    if(gpio_write_value(GPIO_68_P8_10_DP, GPIO_LOW_VALUE)){return 1;}
-    if(gpio_write_value(GPIO_45_P8_11_SEGD, GPIO_LOW_VALUE)){return 1;}
-    if(gpio_write_value(GPIO_44_P8_12_SEGE, GPIO_LOW_VALUE)){return 1;}
-    if(gpio_write_value(GPIO_26_P8_14_SEGF, GPIO_LOW_VALUE)){return 1;}
-    if(gpio_write_value(GPIO_46_P8_16_SEGG, GPIO_LOW_VALUE)){return 1;}
-    if(gpio_write_value(GPIO_49_P9_23_BUTTON, GPIO_LOW_VALUE)){return 1;}
-
-    /* Set edge detection for button pin to rising */
-    if(gpio_config_edge(GPIO_49_P9_23_BUTTON, "rising")){return 1;}
+    struct gpio_init_report report;
 
-    return 0;
-}
+    /* Export and configure all required GPIOs, segments initialized to low */
+    if(gpio_init_pins(pin_table, sizeof(pin_table) / sizeof(pin_table[0]), &report)){return 1;}
+    gpio_print_init_report(&report);
 
-static void write_7seg(uint8_t number_dis){
-
-    switch(number_dis){
-        case 0:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_ON);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_ON);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_ON);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_ON);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_ON);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_ON);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_OFF);
-            break;
-        case 1:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_OFF);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_ON);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_ON);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_OFF);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_OFF);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_OFF);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_OFF);
-            break;
-        case 2:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_ON);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_ON);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_OFF);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_ON);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_ON);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_OFF);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_ON);
-            break;
-        case 3:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_ON);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_ON);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_ON);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_ON);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_OFF);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_OFF);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_ON);
-            break;
-        case 4:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_OFF);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_ON);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_ON);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_OFF);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_OFF);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_ON);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_ON);
-            break;
-        case 5:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_ON);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_OFF);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_ON);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_ON);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_OFF);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_ON);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_ON);
-            break;
-        case 6:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_ON);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_OFF);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_ON);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_ON);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_ON);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_ON);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_ON);
-            break;
-        case 7:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_ON);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_ON);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_ON);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_OFF);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_OFF);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_OFF);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_OFF);
-            break;
-        case 8:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_ON);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_ON);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_ON);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_ON);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_ON);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_ON);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_ON);
-            break;
-        case 9:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_ON);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_ON);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_ON);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_ON);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_OFF);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_ON);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_ON);
-            break;
-        default:
-            break;
-    }
+    /* Wait for the rising edges of the button pin, once the contact bounce has settled */
+    if(gpio_event_set_debounce(GPIO_49_P9_23_BUTTON, GPIO_DEBOUNCE_SETTLE, BUTTON_SETTLE_TIME)){return 1;}
+    if(gpio_event_add(GPIO_49_P9_23_BUTTON, "rising")){return 1;}
+
+    /* Group the segment gpios, the writes of the digits are prepared once */
+    if(seg7_init(&display, seg_pins)){return 1;}
+
+    return 0;
 }
@@ -2,6 +2,13 @@
 * @file counter_4dig7seg.c
 *
 * @brief Application for controlling a 4 digit 7 segment display.
+*
+* The digits are refreshed by the thread of seg7_mux.h, the application only posts a new frame when the
+* number changes. The counting modes are state machines advanced by a periodic timerfd (count rate in Hz),
+* so the counting speed does not depend on the refresh or on the time spent posting, and the clock sleeps
+* until the next minute boundary of the wall clock. Ctrl+C stops it and prints the counts done and the
+* refresh jitter and CPU usage of the thread. The display can be dimmed (e.g. at night) with the
+* SEG7_BRIGHTNESS environment variable, from 0 to SEG7_MUX_BRIGHTNESS_MAX.
 */
 
 #include <stdio.h>
@@ -10,142 +17,213 @@
 #include <string.h>
 #include <stdlib.h>
 #include <time.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/timerfd.h>
 #include "gpio_driver.h"
+#include "board_pins.h"
+#include "seg7_mux.h"
 
 /***********************************************************************************************************/
 /*                                       Defines and Macros                                                */
 /***********************************************************************************************************/
 
-/**
- * @defgroup GPIO_7SEG GPIO connected to the 7 segment display.
- * @{
- */
-#define GPIO_66_P8_7_SEGA       66  /**< @brief GPIO regarding segment A */
-#define GPIO_67_P8_8_SEGB       67  /**< @brief GPIO regarding segment B */
-#define GPIO_69_P8_9_SEGC       69  /**< @brief GPIO regarding segment C */
-#define GPIO_68_P8_10_DP        68  /**< @brief GPIO regarding decimal point */
-#define GPIO_45_P8_11_SEGD      45  /**< @brief GPIO regarding segment D */
-#define GPIO_44_P8_12_SEGE      44  /**< @brief GPIO regarding segment E */
-#define GPIO_26_P8_14_SEGF      26  /**< @brief GPIO regarding segment F */
-#define GPIO_46_P8_16_SEGG      46  /**< @brief GPIO regarding segment G */
-/** @} */
+/** @brief Number of digits of the display */
+#define NUM_DIGITS              4
 
-/**
- * @defgroup GPIO_4DIG GPIO connected to the selection of digit PINs.
- * @{
- */
-#define GPIO_48_P9_15_DIG1      48  /**< @brief GPIO regarding digit 1 */
-#define GPIO_49_P9_23_DIG2      49  /**< @brief GPIO regarding digit 2 */
-#define GPIO_112_P9_30_DIG3     112 /**< @brief GPIO regarding digit 3 */
-#define GPIO_115_P9_27_DIG4     115 /**< @brief GPIO regarding digit 4 */
-/** @} */
+/** @brief Decimal point of the second digit, used as the colon of the clock (HH.MM) */
+#define CLOCK_DOTS              (1 << 1)
 
-/**
- * @defgroup SEGMENT_ON Possible values for settin a segment of the display as ON/OFF.
- * @{
- */
-#define SEGMENT_ON              1   /**< @brief Value for setting a segment to ON */
-#define SEGMENT_OFF             0   /**< @brief Value for setting a segment to OFF */
-/** @} */
+/** @brief Numbers shown by the counting modes (0 to 9999) */
+#define COUNT_MODULO            10000
+
+/** @brief Environment variable setting the brightness of the display */
+#define SEG7_BRIGHTNESS_ENV     "SEG7_BRIGHTNESS"
+
+/** @brief Fastest count rate accepted in Hz */
+#define COUNT_RATE_MAX_HZ       1000.0
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief State of a counting mode */
+struct counter_state{
+    uint16_t number;                    /**< @brief Number shown */
+    int8_t direction;                   /**< @brief Direction of the up and down mode (1 or -1) */
+};
+
+/** @brief Counting mode, one step per period of the count timer */
+struct counter_mode{
+    const char* name;                   /**< @brief Name given in the command line */
+    const char* message;                /**< @brief Printed when the mode starts */
+    uint16_t first;                     /**< @brief First number shown */
+    void (*step)(struct counter_state* state);  /**< @brief Advances the state by one count */
+};
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Gpios of the segments A to G and DP */
+static const uint8_t seg_pins[SEG7_NUM_PINS] = {
+    GPIO_66_P8_7_SEGA, GPIO_67_P8_8_SEGB, GPIO_69_P8_9_SEGC, GPIO_45_P8_11_SEGD,
+    GPIO_44_P8_12_SEGE, GPIO_26_P8_14_SEGF, GPIO_46_P8_16_SEGG, GPIO_68_P8_10_DP
+};
+
+/** @brief Selection gpios of the digits, the leftmost first */
+static const uint8_t digit_pins[NUM_DIGITS] = {
+    GPIO_48_P9_15_DIG1, GPIO_49_P9_23_DIG2, GPIO_112_P9_30_DIG3, GPIO_115_P9_27_DIG4
+};
+
+/** @brief Gpios used by the application */
+static const struct gpio_pin_config pin_table[] = {
+    GPIO_PIN_OUT(GPIO_66_P8_7_SEGA, GPIO_LOW_VALUE), GPIO_PIN_OUT(GPIO_67_P8_8_SEGB, GPIO_LOW_VALUE),
+    GPIO_PIN_OUT(GPIO_69_P8_9_SEGC, GPIO_LOW_VALUE), GPIO_PIN_OUT(GPIO_68_P8_10_DP, GPIO_LOW_VALUE),
+    GPIO_PIN_OUT(GPIO_45_P8_11_SEGD, GPIO_LOW_VALUE), GPIO_PIN_OUT(GPIO_44_P8_12_SEGE, GPIO_LOW_VALUE),
+    GPIO_PIN_OUT(GPIO_26_P8_14_SEGF, GPIO_LOW_VALUE), GPIO_PIN_OUT(GPIO_46_P8_16_SEGG, GPIO_LOW_VALUE),
+    GPIO_PIN_OUT(GPIO_48_P9_15_DIG1, GPIO_HIGH_VALUE), GPIO_PIN_OUT(GPIO_49_P9_23_DIG2, GPIO_HIGH_VALUE),
+    GPIO_PIN_OUT(GPIO_112_P9_30_DIG3, GPIO_HIGH_VALUE), GPIO_PIN_OUT(GPIO_115_P9_27_DIG4, GPIO_HIGH_VALUE)
+};
+
+/** @brief Set by SIGINT and SIGTERM */
+static volatile sig_atomic_t stop = 0;
 
 /***********************************************************************************************************/
 /*                                       Static Function Prototypes                                        */
 /***********************************************************************************************************/
 
 /**
- * @brief Function for initializing needed gpios.
+ * @brief Function for initializing needed gpios and starting the refresh of the display.
  * @return 0 if success.
  * @return != 0 if fail.
  */
 static int ini_all_gpio(void);
 
 /**
- * @brief Function for setting a number in the selected digit display.
- * @param[in] number_dis Is the number to be set.
+ * @brief Function for stopping the refresh of the display and printing its statistics.
  * @return void.
  */
-static void write_7seg(uint8_t number_dis);
+static void print_refresh_report(void);
 
 /**
- * @brief Function for setting a digit in the display.
- * @param[in] number Is the digit to be set (1, 2, 3 or 4).
+ * @brief Signal handler for SIGINT and SIGTERM, stopping the application.
+ * @param[in] sig Is the signal number.
  * @return void.
  */
-static void display_number(uint16_t number);
+static void stop_handler(int sig);
 
 /**
- * @brief Function for setting an upcounting process in the display.
- * @param[in] delay Is a delay for refreshing the counter.
+ * @brief Function for counting up, 9999 is followed by 0.
+ * @param[in,out] state Is the state of the mode.
  * @return void.
  */
-static void start_upcounting(int delay);
+static void step_up(struct counter_state* state);
 
 /**
- * @brief Function for setting a downcounting process in the display.
- * @param[in] delay Is a delay for refreshing the counter.
+ * @brief Function for counting down, 0 is followed by 9999.
+ * @param[in,out] state Is the state of the mode.
  * @return void.
  */
-static void start_downcounting(int delay);
+static void step_down(struct counter_state* state);
 
 /**
- * @brief Function for setting an upcounting and downcounting process in the display.
- * @param[in] delay Is a delay for refreshing the counter.
+ * @brief Function for counting up to 9999 and then down to 0.
+ * @param[in,out] state Is the state of the mode.
  * @return void.
  */
-static void start_updowncounting(int delay);
+static void step_updown(struct counter_state* state);
 
 /**
- * @brief Function for setting a random number in the display.
- * @param[in] delay_ms Is a delay for refreshing the counter.
+ * @brief Function for drawing a random number.
+ * @param[in,out] state Is the state of the mode.
  * @return void.
  */
-static void start_randomcounting(int delay);
+static void step_random(struct counter_state* state);
 
 /**
- * @brief Function for displaying the system clock (HH:MM).
+ * @brief Function for running a counting mode until the application stops.
+ * @param[in] mode Is the mode.
+ * @param[in] rate_hz Is the number of counts per second.
+ * @return void.
+ */
+static void run_counting(const struct counter_mode* mode, double rate_hz);
+
+/**
+ * @brief Function for displaying the system clock (HH:MM), updated on the minute boundaries.
  * @return void.
  */
 static void display_clock(void);
 
+/**
+ * @brief Function for getting the monotonic time in ns.
+ * @return the current time.
+ */
+static uint64_t now_ns(void);
+
+/***********************************************************************************************************/
+/*                                       Counting Modes                                                    */
+/***********************************************************************************************************/
+
+/** @brief Counting modes */
+static const struct counter_mode modes[] = {
+    {"up",     "Up counting...",          0,                step_up},
+    {"down",   "Down counting...",        COUNT_MODULO - 1, step_down},
+    {"updown", "Up and down counting...", 0,                step_updown},
+    {"random", "Random counting...",      0,                step_random},
+};
+
 /***********************************************************************************************************/
 /*                                       Main Function                                                     */
 /***********************************************************************************************************/
 
 int main(int argc, char* argv[]){
 
-    int delay_value = 0;
+    uint8_t i = 0;
+    double rate_hz = 0;
+    struct sigaction sa;
+
+    /* Without SA_RESTART, so a signal interrupts the wait for the next count or minute */
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stop_handler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
 
     printf("Application for up/down/random counter on 4 digit 7 segment display\n");
 
     /* Check the right number of arguments */
-    if(argc!= 3){
-        printf("Usage: %s <direction> <delay>\n", argv[0]);
+    if(argc < 2 || argc > 3 || (strcmp(argv[1], "clock") && argc != 3)){
+        printf("Usage: %s <direction> <rate>\n", argv[0]);
         printf("Valid direction: up, down, updown, random or clock\n");
-        printf("Recommended delay range : 1 to 100\n");
+        printf("Counts per second, e.g. 10 or 0.5 (not used by clock)\n");
+        return 0;
     }
-    else{
-        delay_value = atoi(argv[2]);
 
-        if(!strcmp(argv[1], "up")){
-            start_upcounting(delay_value);
-        }
-        else if(!strcmp(argv[1], "down")){
-            start_downcounting(delay_value);
-        }
-        else if(!strcmp(argv[1], "updown")){
-            start_updowncounting(delay_value);
-        }
-        else if(!strcmp(argv[1], "random")){
-            start_randomcounting(delay_value);
-        }
-        else if(!strcmp(argv[1], "clock")){
-            display_clock();
-        }
-        else{
-            printf("Invalid direction values\n");
-            printf("Valid direction values: up, down, updown, random\n");
+    if(!strcmp(argv[1], "clock")){
+        display_clock();
+        print_refresh_report();
+        return 0;
+    }
+
+    for(i = 0; i < sizeof(modes) / sizeof(modes[0]); i++){
+        if(!strcmp(argv[1], modes[i].name)){
+            break;
         }
     }
+    if(i == sizeof(modes) / sizeof(modes[0])){
+        printf("Invalid direction values\n");
+        printf("Valid direction values: up, down, updown, random, clock\n");
+        return 0;
+    }
+
+    rate_hz = strtod(argv[2], NULL);
+    if(rate_hz <= 0 || rate_hz > COUNT_RATE_MAX_HZ){
+        printf("Invalid rate, valid range: more than 0 up to %.0f Hz\n", COUNT_RATE_MAX_HZ);
+        return 0;
+    }
+
+    run_counting(&modes[i], rate_hz);
+    print_refresh_report();
 
     return 0;
 }
@@ -156,302 +234,184 @@ int main(int argc, char* argv[]){
 
 static int ini_all_gpio(void){
 
-    /* Export all required GPIOs */
-    if(gpio_export(GPIO_66_P8_7_SEGA)){return 1;}
-    if(gpio_export(GPIO_67_P8_8_SEGB)){return 1;}
-    if(gpio_export(GPIO_69_P8_9_SEGC)){return 1;}
-    if(gpio_export(GPIO_68_P8_10_DP)){return 1;}
-    if(gpio_export(GPIO_45_P8_11_SEGD)){return 1;}
-    if(gpio_export(GPIO_44_P8_12_SEGE)){return 1;}
-    if(gpio_export(GPIO_26_P8_14_SEGF)){return 1;}
-    if(gpio_export(GPIO_46_P8_16_SEGG)){return 1;}
-    if(gpio_export(GPIO_48_P9_15_DIG1)){return 1;}
-    if(gpio_export(GPIO_49_P9_23_DIG2)){return 1;}
-    if(gpio_export(GPIO_112_P9_30_DIG3)){return 1;}
-    if(gpio_export(GPIO_115_P9_27_DIG4)){return 1;}
-
-    /* Configure the direction of all required GPIOs */
-    if(gpio_config_dir(GPIO_66_P8_7_SEGA, GPIO_DIR_OUT)){return 1;}
-    if(gpio_config_dir(GPIO_67_P8_8_SEGB, GPIO_DIR_OUT)){return 1;}
-    if(gpio_config_dir(GPIO_69_P8_9_SEGC, GPIO_DIR_OUT)){return 1;}
-    if(gpio_config_dir(GPIO_68_P8_10_DP, GPIO_DIR_OUT)){return 1;}
-    if(gpio_config_dir(GPIO_45_P8_11_SEGD, GPIO_DIR_OUT)){return 1;}
-    if(gpio_config_dir(GPIO_44_P8_12_SEGE, GPIO_DIR_OUT)){return 1;}
-    if(gpio_config_dir(GPIO_26_P8_14_SEGF, GPIO_DIR_OUT)){return 1;}
-    if(gpio_config_dir(GPIO_46_P8_16_SEGG, GPIO_DIR_OUT)){return 1;}
-    if(gpio_config_dir(GPIO_48_P9_15_DIG1, GPIO_DIR_OUT)){return 1;}
-    if(gpio_config_dir(GPIO_49_P9_23_DIG2, GPIO_DIR_OUT)){return 1;}
-    if(gpio_config_dir(GPIO_112_P9_30_DIG3, GPIO_DIR_OUT)){return 1;}
-    if(gpio_config_dir(GPIO_115_P9_27_DIG4, GPIO_DIR_OUT)){return 1;}
-
-
-    /* Initialize to low the value of all required GPIOs */
-    if(gpio_write_value(GPIO_66_P8_7_SEGA, GPIO_LOW_VALUE)){return 1;}
-    if(gpio_write_value(GPIO_67_P8_8_SEGB, GPIO_LOW_VALUE)){return 1;}
-    if(gpio_write_value(GPIO_69_P8_9_SEGC, GPIO_LOW_VALUE)){return 1;}
-    if(gpio_write_value(GPIO_68_P8_10_DP, GPIO_LOW_VALUE)){return 1;}
-    if(gpio_write_value(GPIO_45_P8_11_SEGD, GPIO_LOW_VALUE)){return 1;}
-    if(gpio_write_value(GPIO_44_P8_12_SEGE, GPIO_LOW_VALUE)){return 1;}
-    if(gpio_write_value(GPIO_26_P8_14_SEGF, GPIO_LOW_VALUE)){return 1;}
-    if(gpio_write_value(GPIO_46_P8_16_SEGG, GPIO_LOW_VALUE)){return 1;}
-    if(gpio_write_value(GPIO_48_P9_15_DIG1, GPIO_HIGH_VALUE)){return 1;}
-    if(gpio_write_value(GPIO_49_P9_23_DIG2, GPIO_HIGH_VALUE)){return 1;}
-    if(gpio_write_value(GPIO_112_P9_30_DIG3, GPIO_HIGH_VALUE)){return 1;}
-    if(gpio_write_value(GPIO_115_P9_27_DIG4, GPIO_HIGH_VALUE)){return 1;}
+    struct gpio_init_report report;
 
+    /* Export and configure all required GPIOs, segments low and digits high (off) */
+    if(gpio_init_pins(pin_table, sizeof(pin_table) / sizeof(pin_table[0]), &report)){return 1;}
+    gpio_print_init_report(&report);
 
-    return 0;
-}
+    /* Each digit is on for one slot, the thread scans them until the application stops */
+    if(seg7_mux_init(seg_pins, digit_pins, NUM_DIGITS, SEG7_MUX_DEFAULT_SLOT_US)){return 1;}
 
-static void write_7seg(uint8_t number_dis){
-
-    switch(number_dis){
-        case 0:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_ON);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_ON);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_ON);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_ON);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_ON);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_ON);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_OFF);
-            break;
-        case 1:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_OFF);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_ON);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_ON);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_OFF);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_OFF);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_OFF);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_OFF);
-            break;
-        case 2:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_ON);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_ON);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_OFF);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_ON);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_ON);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_OFF);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_ON);
-            break;
-        case 3:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_ON);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_ON);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_ON);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_ON);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_OFF);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_OFF);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_ON);
-            break;
-        case 4:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_OFF);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_ON);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_ON);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_OFF);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_OFF);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_ON);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_ON);
-            break;
-        case 5:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_ON);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_OFF);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_ON);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_ON);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_OFF);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_ON);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_ON);
-            break;
-        case 6:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_ON);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_OFF);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_ON);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_ON);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_ON);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_ON);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_ON);
-            break;
-        case 7:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_ON);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_ON);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_ON);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_OFF);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_OFF);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_OFF);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_OFF);
-            break;
-        case 8:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_ON);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_ON);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_ON);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_ON);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_ON);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_ON);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_ON);
-            break;
-        case 9:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_ON);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_ON);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_ON);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_ON);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_OFF);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_ON);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_ON);
-            break;
-        case 10:
-            gpio_write_value(GPIO_66_P8_7_SEGA, SEGMENT_OFF);
-            gpio_write_value(GPIO_67_P8_8_SEGB, SEGMENT_OFF);
-            gpio_write_value(GPIO_69_P8_9_SEGC, SEGMENT_OFF);
-            gpio_write_value(GPIO_45_P8_11_SEGD, SEGMENT_OFF);
-            gpio_write_value(GPIO_44_P8_12_SEGE, SEGMENT_OFF);
-            gpio_write_value(GPIO_26_P8_14_SEGF, SEGMENT_OFF);
-            gpio_write_value(GPIO_46_P8_16_SEGG, SEGMENT_OFF);
-            break;
-        default:
-            break;
-    }
+    /* Dimmed by switching the digits off earlier in their slot, full brightness by default */
+    if(getenv(SEG7_BRIGHTNESS_ENV) && seg7_mux_set_brightness(atoi(getenv(SEG7_BRIGHTNESS_ENV)))){return 1;}
+
+    return seg7_mux_start();
 }
 
-static void display_number(uint16_t number){
+static void print_refresh_report(void){
 
-    uint8_t i = 0;
+    struct seg7_mux_stats stats;
 
-    for(i = 4; i > 0; i--){
-        switch(i){
-            case 1:
-                gpio_write_value(GPIO_48_P9_15_DIG1, GPIO_LOW_VALUE);
-                break;
-            case 2:
-                gpio_write_value(GPIO_49_P9_23_DIG2, GPIO_LOW_VALUE);
-                break;
-            case 3:
-                gpio_write_value(GPIO_112_P9_30_DIG3, GPIO_LOW_VALUE);
-                break;
-            case 4:
-                gpio_write_value(GPIO_115_P9_27_DIG4, GPIO_LOW_VALUE);
-                break;
-            default:
-                break;
-        }
+    seg7_mux_stop();
+    seg7_mux_get_stats(&stats);
+    seg7_mux_deinit();
 
-        write_7seg(number%10);
-        number /= 10;
+    if(!stats.slots){
+        return;
+    }
 
-        usleep(10); // 10 usec waiting
+    printf("\nrefresh: %llu slots, %u frames posted, %u overruns, %u errors\n",
+           (unsigned long long)stats.slots, stats.frames, stats.overruns, stats.errors);
+    printf("lateness: mean %llu ns, p99 %u ns, max %u ns\n",
+           (unsigned long long)(stats.late_total_ns / stats.slots), seg7_mux_late_percentile(&stats, 99),
+           stats.late_max_ns);
+    printf("cpu: %.2f %% of %.1f s, display lit %.1f %% of the time\n",
+           stats.run_ns ? 100.0 * stats.cpu_ns / stats.run_ns : 0.0, stats.run_ns / 1e9,
+           stats.run_ns ? 100.0 * stats.lit_ns / stats.run_ns : 0.0);
+}
 
-        /* Turn off segments */
-        write_7seg(10);
+static void stop_handler(int sig){
 
-        /* Turn off all digits */
-        gpio_write_value(GPIO_48_P9_15_DIG1, GPIO_HIGH_VALUE);
-        gpio_write_value(GPIO_49_P9_23_DIG2, GPIO_HIGH_VALUE);
-        gpio_write_value(GPIO_112_P9_30_DIG3, GPIO_HIGH_VALUE);
-        gpio_write_value(GPIO_115_P9_27_DIG4, GPIO_HIGH_VALUE);
-    }
+    stop = 1;
 }
 
-static void start_upcounting(int delay){
-
-    uint16_t i = 0;
-    uint16_t number = 0;
+static void step_up(struct counter_state* state){
 
-    if(ini_all_gpio() < 0){
-        printf("Error: GPIO init failed\n");
-    }
-    else{
-        printf("Up counting...\n");
-        while(1){
-            for(i = 0; i < delay; i++){
-                display_number(number);
-            }
-            if(number == 9999){number = 0;}
-            number++;
-        }
-    }
+    state->number = (state->number + 1) % COUNT_MODULO;
 }
 
-static void start_downcounting(int delay){
+static void step_down(struct counter_state* state){
 
-    uint16_t i = 0;
-    uint16_t number = 9999;
+    state->number = state->number ? state->number - 1 : COUNT_MODULO - 1;
+}
 
-    if(ini_all_gpio() < 0){
-        printf("Error: GPIO init failed\n");
+static void step_updown(struct counter_state* state){
+
+    if(!state->direction){
+        state->direction = 1;
     }
-    else{
-        printf("Down counting...\n");
-        while(1){
-            for(i = 0; i < delay; i++){
-                display_number(number);
-            }
-            if(number == 0){number = 9999;}
-            number--;
-        }
+    if((state->direction > 0 && state->number == COUNT_MODULO - 1) ||
+       (state->direction < 0 && !state->number)){
+        state->direction = -state->direction;
     }
+    state->number += state->direction;
 }
 
-static void start_updowncounting(int delay){
+static void step_random(struct counter_state* state){
 
-    uint16_t i = 0;
-    uint16_t number = 0;
-
-    if(ini_all_gpio() < 0){
-        printf("Error: GPIO init failed\n");
-    }
-    else{
-        printf("Up and down counting...\n");
-        while(1){
-            while(number < 10000){
-                for(i = 0; i < delay; i++){
-                    display_number(number);
-                }
-                number++;
-            }
-            while(number > 0){
-                number--;
-                for(i = 0; i < delay; i++){
-                    display_number(number);
-                }
-            }
-        }
-    }
+    state->number = rand() % COUNT_MODULO;
 }
 
-static void start_randomcounting(int delay){
+static void run_counting(const struct counter_mode* mode, double rate_hz){
 
-    uint16_t i = 0;
-    uint16_t number = 0;
+    int timer_fd = -1;
+    uint64_t period_ns = 1e9 / rate_hz + 0.5;
+    uint64_t expirations = 0;
+    uint64_t counts = 0;
+    uint64_t start = 0;
+    uint64_t elapsed = 0;
+    struct itimerspec its;
+    struct counter_state state = {.number = mode->first, .direction = 0};
 
-    if(ini_all_gpio() < 0){
+    if(ini_all_gpio()){
         printf("Error: GPIO init failed\n");
+        return;
     }
-    else{
-        printf("Random counting...\n");
-        while(1){
-            number = rand() % 10000;
-            for(i = 0; i < delay; i++){
-                display_number(number);
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if(timer_fd < 0){
+        perror("Error, count timer could not be created");
+        return;
+    }
+
+    /* Periodic timer: the counts keep the rate even if posting a frame is late */
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = period_ns / 1000000000ULL;
+    its.it_value.tv_nsec = period_ns % 1000000000ULL;
+    its.it_interval = its.it_value;
+
+    printf("%s\n", mode->message);
+    seg7_mux_post_number(state.number, 0);
+    start = now_ns();
+    if(timerfd_settime(timer_fd, 0, &its, NULL) < 0){
+        perror("Error, count timer could not be started");
+        close(timer_fd);
+        return;
+    }
+
+    while(!stop){
+        if(read(timer_fd, &expirations, sizeof(expirations)) < 0){
+            if(errno == EINTR){
+                continue;
             }
+            break;
         }
+
+        /* Every period is counted, also the ones missed while the application was not scheduled */
+        counts += expirations;
+        while(expirations--){
+            mode->step(&state);
+        }
+        seg7_mux_post_number(state.number, 0);
     }
+
+    elapsed = now_ns() - start;
+    close(timer_fd);
+
+    printf("\ncount: %llu counts in %.3f s, %.3f Hz (nominal %.3f Hz)\n",
+           (unsigned long long)counts, elapsed / 1e9, elapsed ? counts * 1e9 / elapsed : 0.0,
+           1e9 / period_ns);
 }
 
 static void display_clock(void){
 
-    time_t t = time(NULL);
-    struct tm tm = *localtime(&t);
-    uint16_t current_time = 0;
+    int timer_fd = -1;
+    uint32_t updates = 0;
+    time_t t = 0;
+    struct tm tm;
+    struct itimerspec its;
+    uint64_t expirations = 0;
 
-    if(ini_all_gpio() < 0){
+    if(ini_all_gpio()){
         printf("Error: GPIO init failed\n");
+        return;
+    }
+
+    /* Absolute wall clock deadlines, cancelled if the clock is set (e.g. by NTP) */
+    timer_fd = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC);
+    if(timer_fd < 0){
+        perror("Error, clock timer could not be created");
+        return;
     }
-    else{
-        /* Set colon for clock format */
-        gpio_write_value(GPIO_68_P8_10_DP, GPIO_HIGH_VALUE);
-        printf("System clock working (HH:MM)...\n");
-        while(1){
-            t = time(NULL);
-            tm = *localtime(&t);
-            current_time = tm.tm_hour*100 + tm.tm_min;
-            display_number(current_time);
+
+    printf("System clock working (HH:MM)...\n");
+    while(!stop){
+        t = time(NULL);
+        localtime_r(&t, &tm);
+        seg7_mux_post_number(tm.tm_hour * 100 + tm.tm_min, CLOCK_DOTS);
+        updates++;
+
+        /* Sleep until the next minute boundary */
+        memset(&its, 0, sizeof(its));
+        its.it_value.tv_sec = (t / 60 + 1) * 60;
+        if(timerfd_settime(timer_fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &its, NULL) < 0){
+            perror("Error, clock timer could not be started");
+            break;
         }
+        while(!stop && read(timer_fd, &expirations, sizeof(expirations)) < 0 && errno == EINTR);
     }
+
+    close(timer_fd);
+
+    printf("\nclock: %u updates\n", updates);
+}
+
+static uint64_t now_ns(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
 }
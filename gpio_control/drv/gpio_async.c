@@ -0,0 +1,361 @@
+/********************************************************************************************************//**
+* @file gpio_async.c
+*
+* @brief Asynchronous writes of output gpios through a queue drained by an I/O thread.
+*
+* The queue holds bank writes (bank, mask and values), so a port write spanning several banks is queued as
+* one entry per bank, in one critical section. The thread takes every entry queued at once and merges them
+* per bank until a gpio would be written twice, then writes the merged banks with one gpio_write_banks()
+* call, which also elides the gpios already holding their value.
+*
+* Public Functions:
+*       - int gpio_async_start(void)
+*       - void gpio_async_stop(void)
+*       - int gpio_async_write_value(uint8_t gpio_no, uint8_t out_val)
+*       - int gpio_async_write_mask(struct gpio_port* port, uint32_t mask, uint32_t values)
+*       - int gpio_async_write_banks(const struct gpio_bank_write* bw)
+*       - int gpio_flush(void)
+*       - void gpio_async_get_stats(struct gpio_async_stats* stats)
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "gpio_driver.h"
+#include "gpio_backend.h"
+#include "gpio_async.h"
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Write of some gpios of a bank */
+struct async_write{
+    uint8_t bank;                       /**< @brief Bank of the gpios */
+    uint32_t mask;                      /**< @brief Gpios of the bank written */
+    uint32_t values;                    /**< @brief Values of the gpios of the bank */
+};
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Bank writes not taken by the thread yet */
+static struct async_write queue[GPIO_ASYNC_QUEUE_SIZE];
+
+/** @brief Writes appended, taken by the thread and written, the queue holds head - tail entries */
+static uint32_t head = 0;
+static uint32_t tail = 0;
+static uint32_t done = 0;
+
+/** @brief Protects the queue, its indexes and the counters */
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Signaled when writes are queued while the thread waits */
+static pthread_cond_t not_empty = PTHREAD_COND_INITIALIZER;
+
+/** @brief Signaled when the thread takes the queued writes */
+static pthread_cond_t not_full = PTHREAD_COND_INITIALIZER;
+
+/** @brief Signaled when the thread has written the writes it took */
+static pthread_cond_t written = PTHREAD_COND_INITIALIZER;
+
+/** @brief The thread waits for writes, the first producer queueing a write then signals it */
+static uint8_t io_waiting = 0;
+
+/** @brief Number of threads waiting in gpio_flush() */
+static uint32_t flush_waiting = 0;
+
+/** @brief A queued write failed since the previous gpio_flush() */
+static uint8_t failed = 0;
+
+/** @brief Counters of the queue */
+static struct gpio_async_stats stats;
+
+/** @brief I/O thread */
+static pthread_t io_thread;
+
+/** @brief The I/O thread is running, the writes are queued */
+static volatile uint8_t running = 0;
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Thread draining the queue.
+ * @param[in] arg Is not used.
+ * @return NULL.
+ */
+static void* io_loop(void* arg);
+
+/**
+ * @brief Function for appending bank writes to the queue, waiting for room if it is full.
+ * @param[in] writes Is the bank writes.
+ * @param[in] n Is the number of bank writes (at most GPIO_NUM_BANKS).
+ * @return void.
+ */
+static void push_writes(const struct async_write* writes, uint8_t n);
+
+/**
+ * @brief Function for merging and writing bank writes taken from the queue.
+ * @param[in] writes Is the bank writes, in queue order.
+ * @param[in] n Is the number of bank writes.
+ * @param[out] errors Is the number of merged writes which failed.
+ * @return the number of bank writes passed to the driver.
+ */
+static uint32_t write_merged(const struct async_write* writes, uint32_t n, uint32_t* errors);
+
+/***********************************************************************************************************/
+/*                                       Public API Definitions                                            */
+/***********************************************************************************************************/
+
+int gpio_async_start(void){
+
+    if(running){
+        return 0;
+    }
+    if(!gpio_get_backend()){
+        return 1;
+    }
+
+    pthread_mutex_lock(&queue_lock);
+    memset(&stats, 0, sizeof(stats));
+    failed = 0;
+    pthread_mutex_unlock(&queue_lock);
+
+    running = 1;
+    if(pthread_create(&io_thread, NULL, io_loop, NULL)){
+        running = 0;
+        fprintf(stderr, "Error, gpio I/O thread could not be created\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+void gpio_async_stop(void){
+
+    if(!running){
+        return;
+    }
+
+    /* The thread writes what is left in the queue before leaving */
+    pthread_mutex_lock(&queue_lock);
+    running = 0;
+    io_waiting = 0;
+    pthread_cond_signal(&not_empty);
+    pthread_mutex_unlock(&queue_lock);
+
+    pthread_join(io_thread, NULL);
+}
+
+int gpio_async_write_value(uint8_t gpio_no, uint8_t out_val){
+
+    struct async_write w;
+
+    if(!running || gpio_no >= GPIO_MAX_NUMBER){
+        return gpio_write_value(gpio_no, out_val);
+    }
+
+    w.bank = GPIO_BANK(gpio_no);
+    w.mask = GPIO_BANK_BIT(gpio_no);
+    w.values = out_val ? w.mask : 0;
+    push_writes(&w, 1);
+
+    return 0;
+}
+
+int gpio_async_write_mask(struct gpio_port* port, uint32_t mask, uint32_t values){
+
+    struct gpio_bank_write bw;
+
+    if(!running){
+        return gpio_write_mask(port, mask, values);
+    }
+
+    if(gpio_port_prepare(port, mask, values, &bw)){
+        return 1;
+    }
+
+    return gpio_async_write_banks(&bw);
+}
+
+int gpio_async_write_banks(const struct gpio_bank_write* bw){
+
+    uint8_t b = 0;
+    struct async_write w[GPIO_NUM_BANKS];
+
+    if(!running){
+        return gpio_write_banks(bw);
+    }
+
+    for(b = 0; b < bw->nbanks; b++){
+        w[b].bank = bw->banks[b];
+        w[b].mask = bw->masks[b];
+        w[b].values = bw->values[b];
+    }
+    if(bw->nbanks){
+        push_writes(w, bw->nbanks);
+    }
+
+    return 0;
+}
+
+int gpio_flush(void){
+
+    int ret = 0;
+    uint32_t target = 0;
+
+    /* Nothing is queued while the queue is stopped, e.g. for the HD44780 module flushing before each byte */
+    if(!running && !__atomic_load_n(&failed, __ATOMIC_RELAXED)){
+        return 0;
+    }
+
+    pthread_mutex_lock(&queue_lock);
+    target = head;
+    if(done != target){
+        stats.flushes++;
+        flush_waiting++;
+        /* Wrap-safe, done may already be past target when other threads keep queueing */
+        while((int32_t)(done - target) < 0){
+            pthread_cond_wait(&written, &queue_lock);
+        }
+        flush_waiting--;
+    }
+    ret = failed;
+    failed = 0;
+    pthread_mutex_unlock(&queue_lock);
+
+    return ret;
+}
+
+void gpio_async_get_stats(struct gpio_async_stats* stats_out){
+
+    pthread_mutex_lock(&queue_lock);
+    *stats_out = stats;
+    pthread_mutex_unlock(&queue_lock);
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static void* io_loop(void* arg){
+
+    uint32_t i = 0;
+    uint32_t n = 0;
+    uint32_t issued = 0;
+    uint32_t errors = 0;
+    static struct async_write taken[GPIO_ASYNC_QUEUE_SIZE];
+
+    pthread_mutex_lock(&queue_lock);
+    while(1){
+        while(running && tail == head){
+            io_waiting = 1;
+            pthread_cond_wait(&not_empty, &queue_lock);
+        }
+        if(tail == head){
+            break;
+        }
+
+        /* Every queued write is taken at once, so the writes of a port are never split */
+        n = head - tail;
+        for(i = 0; i < n; i++){
+            taken[i] = queue[(tail + i) & (GPIO_ASYNC_QUEUE_SIZE - 1)];
+        }
+        tail = head;
+        pthread_cond_broadcast(&not_full);
+        pthread_mutex_unlock(&queue_lock);
+
+        issued = write_merged(taken, n, &errors);
+
+        pthread_mutex_lock(&queue_lock);
+        done += n;
+        stats.issued += issued;
+        stats.errors += errors;
+        if(errors){
+            failed = 1;
+        }
+        if(flush_waiting){
+            pthread_cond_broadcast(&written);
+        }
+    }
+    pthread_mutex_unlock(&queue_lock);
+
+    return NULL;
+}
+
+static void push_writes(const struct async_write* writes, uint8_t n){
+
+    uint8_t i = 0;
+
+    pthread_mutex_lock(&queue_lock);
+    if(head - tail + n > GPIO_ASYNC_QUEUE_SIZE){
+        stats.stalls++;
+        while(head - tail + n > GPIO_ASYNC_QUEUE_SIZE){
+            pthread_cond_wait(&not_full, &queue_lock);
+        }
+    }
+
+    for(i = 0; i < n; i++){
+        queue[(head + i) & (GPIO_ASYNC_QUEUE_SIZE - 1)] = writes[i];
+    }
+    head += n;
+    stats.queued += n;
+    if(head - tail > stats.max_depth){
+        stats.max_depth = head - tail;
+    }
+
+    /* One wake up per drain, the writes queued until the thread runs are taken with this one */
+    if(io_waiting){
+        io_waiting = 0;
+        pthread_cond_signal(&not_empty);
+    }
+    pthread_mutex_unlock(&queue_lock);
+}
+
+static uint32_t write_merged(const struct async_write* writes, uint32_t n, uint32_t* errors){
+
+    uint32_t i = 0;
+    uint8_t b = 0;
+    uint32_t issued = 0;
+    uint32_t masks[GPIO_NUM_BANKS] = {0};
+    uint32_t values[GPIO_NUM_BANKS] = {0};
+    const struct async_write* w = NULL;
+    struct gpio_bank_write bw;
+
+    *errors = 0;
+
+    /* One more pass writes the last merged banks */
+    for(i = 0; i <= n; i++){
+        w = (i < n) ? &writes[i] : NULL;
+        if(!w || (masks[w->bank] & w->mask)){
+            /* A gpio written twice (or the end), the merged banks are written first */
+            bw.nbanks = 0;
+            for(b = 0; b < GPIO_NUM_BANKS; b++){
+                if(masks[b]){
+                    bw.banks[bw.nbanks] = b;
+                    bw.masks[bw.nbanks] = masks[b];
+                    bw.values[bw.nbanks] = values[b];
+                    bw.nbanks++;
+                    masks[b] = 0;
+                    values[b] = 0;
+                }
+            }
+            if(bw.nbanks){
+                issued += bw.nbanks;
+                if(gpio_write_banks(&bw)){
+                    (*errors)++;
+                }
+            }
+        }
+        if(w){
+            masks[w->bank] |= w->mask;
+            values[w->bank] |= w->values & w->mask;
+        }
+    }
+
+    return issued;
+}
@@ -0,0 +1,117 @@
+/********************************************************************************************************//**
+* @file gpio_async.h
+*
+* @brief Header file containing the prototypes of the APIs for writing output gpios asynchronously.
+*
+* While the write queue is started, gpio_async_write_value(), gpio_async_write_mask() and
+* gpio_async_write_banks() only append the write to a queue, split per bank, and return. A dedicated I/O
+* thread drains the queue and merges consecutive writes into one gpio_write_banks() call (one backend
+* operation per bank), as long as no gpio is written twice: a pulse queued as two writes of the same gpio is
+* kept as two operations, so no transition is lost, but the time between the merged writes is not kept.
+*
+* gpio_flush() is the barrier of the queue: it returns once every write queued before it reached the
+* backend. It must be called before the timing sensitive sequences (e.g. the EN strobe of the HD44780 played
+* as a waveform) and before the synchronous writes of the gpios also written through the queue. It returns at
+* once when the queue is not started.
+*
+* When the queue is not started the writes are done at once by the caller, so a module can use the
+* asynchronous calls whether or not the application started the queue. The errors of the queued writes are
+* counted and reported by the next gpio_flush().
+*
+* Public Functions:
+*       - int gpio_async_start(void)
+*       - void gpio_async_stop(void)
+*       - int gpio_async_write_value(uint8_t gpio_no, uint8_t out_val)
+*       - int gpio_async_write_mask(struct gpio_port* port, uint32_t mask, uint32_t values)
+*       - int gpio_async_write_banks(const struct gpio_bank_write* bw)
+*       - int gpio_flush(void)
+*       - void gpio_async_get_stats(struct gpio_async_stats* stats)
+*/
+
+#ifndef GPIO_ASYNC_H
+#define GPIO_ASYNC_H
+
+#include <stdint.h>
+#include "gpio_driver.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Bank writes held by the queue, power of 2 */
+#define GPIO_ASYNC_QUEUE_SIZE   256
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Counters of the write queue */
+struct gpio_async_stats{
+    uint64_t queued;                    /**< @brief Bank writes appended to the queue */
+    uint64_t issued;                    /**< @brief Bank writes passed to the driver once merged */
+    uint32_t flushes;                   /**< @brief Calls of gpio_flush() which had to wait */
+    uint32_t stalls;                    /**< @brief Writes which waited for room in a full queue */
+    uint32_t max_depth;                 /**< @brief Most bank writes waiting in the queue */
+    uint32_t errors;                    /**< @brief Merged writes which failed */
+};
+
+/***********************************************************************************************************/
+/*                                       APIs Supported                                                    */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for starting the I/O thread, the asynchronous writes are queued from now on.
+ * @note The backend must be selected before, and the queue stopped before gpio_deinit().
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_async_start(void);
+
+/**
+ * @brief Function for flushing the queue and stopping the I/O thread.
+ * @return void.
+ */
+void gpio_async_stop(void);
+
+/**
+ * @brief Function for queueing the write of an output value, see gpio_write_value().
+ * @param[in] gpio_no Is the gpio number.
+ * @param[in] out_val Is the value (0 or 1).
+ * @return 0 if success.
+ * @return != 0 if fail (only when the queue is not started).
+ */
+int gpio_async_write_value(uint8_t gpio_no, uint8_t out_val);
+
+/**
+ * @brief Function for queueing the write of the pins of a port, see gpio_write_mask().
+ * @param[in] port Is the port.
+ * @param[in] mask Is the pins of the port written.
+ * @param[in] values Is the values, bit N is the value of pins[N].
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_async_write_mask(struct gpio_port* port, uint32_t mask, uint32_t values);
+
+/**
+ * @brief Function for queueing prepared bank writes, see gpio_write_banks().
+ * @param[in] bw Is the bank writes.
+ * @return 0 if success.
+ * @return != 0 if fail (only when the queue is not started).
+ */
+int gpio_async_write_banks(const struct gpio_bank_write* bw);
+
+/**
+ * @brief Function for waiting until every queued write reached the backend.
+ * @return 0 if success or if the queue is not started.
+ * @return != 0 if a queued write failed since the previous flush.
+ */
+int gpio_flush(void);
+
+/**
+ * @brief Function for getting the counters of the write queue.
+ * @param[out] stats Is the counters.
+ * @return void.
+ */
+void gpio_async_get_stats(struct gpio_async_stats* stats);
+
+#endif
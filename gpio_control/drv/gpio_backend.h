@@ -0,0 +1,106 @@
+/********************************************************************************************************//**
+* @file gpio_backend.h
+*
+* @brief Header file containing the interface implemented by the gpio backends used by gpio_driver.
+*
+* Available backends:
+*       - gpio_sysfs_backend ("sysfs"): /sys/class/gpio interface, the default one.
+*       - gpio_chardev_backend ("chardev"): /dev/gpiochipN line handles, one handle per bank.
+*       - gpio_mmio_backend ("mmio"): memory mapped AM335x gpio bank registers.
+*       - gpio_mock_backend ("mock"): in-memory gpios recording every transition, for running on a host.
+*       - gpio_shm_backend ("shm"): commands sent to the gpio server through shared memory (gpio_shm.h).
+*
+* Public Functions:
+*       - int gpio_init_backend(const struct gpio_backend* be)
+*       - const struct gpio_backend* gpio_get_backend(void)
+*       - void gpio_backend_lock(void)
+*       - void gpio_backend_unlock(void)
+*/
+
+#ifndef GPIO_BACKEND_H
+#define GPIO_BACKEND_H
+
+#include <stdint.h>
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Operations of a gpio backend.
+ * @note All operations return 0 if success and != 0 if fail, except read and event_read which return the
+ *       level (0 or 1) or < 0 if fail, and event_fd which returns a file descriptor or < 0 if fail.
+ *       init, deinit, write_batch, read_batch, write_bank, event_fd, event_read and wait_ready are optional
+ *       (NULL).
+ *       If shared is set the pins can be written by other processes, so gpio_driver does not elide writes.
+ *       The operations are called with the backend lock held (gpio_backend_lock()), one at a time, so a
+ *       backend does not need to be thread safe; it must not call the gpio_driver functions.
+ */
+struct gpio_backend{
+    const char* name;                                               /**< @brief Name used for selection */
+    int (*init)(void);                                              /**< @brief Called when selected */
+    void (*deinit)(void);                                           /**< @brief Called when released */
+    int (*export)(uint8_t gpio_no);                                 /**< @brief Export a gpio */
+    int (*config_dir)(uint8_t gpio_no, uint8_t dir_val);            /**< @brief Set the direction */
+    int (*write)(uint8_t gpio_no, uint8_t out_val);                 /**< @brief Set an output value */
+    int (*read)(uint8_t gpio_no);                                   /**< @brief Get the level */
+    int (*config_edge)(uint8_t gpio_no, const char* edge);          /**< @brief Set the edge detection */
+    int (*write_batch)(const uint8_t* pins, uint8_t npins,
+                       uint32_t mask, uint32_t values);             /**< @brief Set several outputs */
+    int (*read_batch)(const uint8_t* pins, uint8_t npins,
+                      uint32_t* values);                            /**< @brief Get several levels */
+    int (*write_bank)(uint8_t bank, uint32_t mask, uint32_t values); /**< @brief Set outputs of a bank */
+    int (*event_fd)(uint8_t gpio_no, uint32_t* events);             /**< @brief Fd and epoll events
+                                                                         signaling an edge */
+    int (*event_read)(uint8_t gpio_no);                             /**< @brief Acknowledge an edge and
+                                                                         get the level */
+    int (*wait_ready)(const uint8_t* gpios, uint8_t n);             /**< @brief Wait for exported gpios
+                                                                         to be available */
+    uint8_t shared;                                                 /**< @brief Pins shared with other
+                                                                         processes */
+};
+
+/***********************************************************************************************************/
+/*                                       Backends                                                          */
+/***********************************************************************************************************/
+
+extern const struct gpio_backend gpio_sysfs_backend;
+extern const struct gpio_backend gpio_chardev_backend;
+extern const struct gpio_backend gpio_mmio_backend;
+extern const struct gpio_backend gpio_mock_backend;
+extern const struct gpio_backend gpio_shm_backend;
+
+/***********************************************************************************************************/
+/*                                       APIs Supported                                                    */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for selecting and initializing a backend which is not in the list of gpio_init().
+ * @note Useful for wrapping a backend, e.g. for counting or timing its operations.
+ * @param[in] be Is the backend, it must remain valid while it is selected.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_init_backend(const struct gpio_backend* be);
+
+/**
+ * @brief Function for getting the selected backend, selecting the default one if none was selected.
+ * @return the backend, NULL if it could not be selected.
+ */
+const struct gpio_backend* gpio_get_backend(void);
+
+/**
+ * @brief Function for taking the lock held by gpio_driver during every backend operation.
+ * @note Modules calling the operations of the backend directly (e.g. the event engine) take it around
+ *       each call, so they do not run at the same time as the writes of other threads. Not recursive.
+ * @return void.
+ */
+void gpio_backend_lock(void);
+
+/**
+ * @brief Function for releasing the lock taken with gpio_backend_lock().
+ * @return void.
+ */
+void gpio_backend_unlock(void);
+
+#endif
@@ -0,0 +1,536 @@
+/********************************************************************************************************//**
+* @file gpio_chardev.c
+*
+* @brief Functions for controlling groups of gpios through the gpio character device.
+*
+* The line handle ABI (GPIO_GET_LINEHANDLE_IOCTL) is used because it is the one available in the kernels
+* and toolchains used with the BeagleBone Black, and it is still supported by current kernels.
+*
+* It also implements gpio_chardev_backend, which requests one line handle per bank and direction. Edge
+* detection is not supported by this backend. A handle can not be extended, so configuring a line marks
+* its bank as pending and the bank is requested again on its next write or read: configuring all the pins
+* of an application (e.g. gpio_init_pins()) costs one request per bank instead of one per pin, and a line
+* which can not be requested (e.g. busy) is reported by that write or read.
+*
+* Public Functions:
+*       - void gpio_chardev_set_chip_base(uint8_t first_chip)
+*       - int gpio_chardev_request(struct gpio_chardev_group* grp, const uint8_t* gpios, uint8_t n,
+*                                  uint8_t dir, uint32_t init_values, const char* label)
+*       - int gpio_chardev_set(struct gpio_chardev_group* grp, uint32_t mask, uint32_t values)
+*       - int gpio_chardev_get(struct gpio_chardev_group* grp, uint32_t* values)
+*       - void gpio_chardev_release(struct gpio_chardev_group* grp)
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#include "gpio_driver.h"
+#include "gpio_chardev.h"
+#include "gpio_backend.h"
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Lines of one bank requested by the backend with the same direction */
+struct bank_lines{
+    uint8_t n;                                      /**< @brief Number of lines */
+    uint8_t gpios[GPIO_CHARDEV_LINES_PER_CHIP];     /**< @brief Gpio number of each line */
+    uint8_t pending;                                /**< @brief Lines changed since the last request */
+    struct gpio_chardev_group grp;                  /**< @brief Group holding the line handle */
+};
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Index of the gpiochip device of bank 0 */
+static uint8_t chip_base = 0;
+
+/** @brief Output lines requested by the backend in each bank */
+static struct bank_lines bank_out[GPIO_CHARDEV_MAX_CHIPS];
+
+/** @brief Input lines requested by the backend in each bank */
+static struct bank_lines bank_in[GPIO_CHARDEV_MAX_CHIPS];
+
+/** @brief Position of each gpio in its bank group, -1 if the gpio is not configured */
+static int8_t line_pos[GPIO_MAX_NUMBER] = {[0 ... GPIO_MAX_NUMBER - 1] = -1};
+
+/** @brief Direction of each requested gpio */
+static uint8_t line_dir[GPIO_MAX_NUMBER] = {0};
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for requesting a line handle to one chip.
+ * @param[out] handle Is the handle to be initialized.
+ * @param[in] chip Is the bank number.
+ * @param[in] req Is the filled request (offsets, flags, default values and label).
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int request_handle(struct gpio_chardev_handle* handle, uint8_t chip, struct gpiohandle_request* req);
+
+/**
+ * @brief Function for requesting again the lines of a bank if lines were added or removed.
+ * @note The current output values are kept. If the request fails the bank stays pending, its writes and
+ *       reads fail until a request succeeds.
+ * @param[in] bank Is the bank lines.
+ * @param[in] dir_val Is the direction of the lines.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int bank_request(struct bank_lines* bank, uint8_t dir_val);
+
+/* Backend operations, see struct gpio_backend */
+static void chardev_deinit(void);
+static int chardev_export(uint8_t gpio_no);
+static int chardev_config_dir(uint8_t gpio_no, uint8_t dir_val);
+static int chardev_write(uint8_t gpio_no, uint8_t out_val);
+static int chardev_read(uint8_t gpio_no);
+static int chardev_config_edge(uint8_t gpio_no, const char* edge);
+static int chardev_write_batch(const uint8_t* pins, uint8_t npins, uint32_t mask, uint32_t values);
+static int chardev_read_batch(const uint8_t* pins, uint8_t npins, uint32_t* values);
+static int chardev_write_bank(uint8_t bank, uint32_t mask, uint32_t values);
+
+/***********************************************************************************************************/
+/*                                       Backend Definition                                                */
+/***********************************************************************************************************/
+
+const struct gpio_backend gpio_chardev_backend = {
+    .name = "chardev",
+    .deinit = chardev_deinit,
+    .export = chardev_export,
+    .config_dir = chardev_config_dir,
+    .write = chardev_write,
+    .read = chardev_read,
+    .config_edge = chardev_config_edge,
+    .write_batch = chardev_write_batch,
+    .read_batch = chardev_read_batch,
+    .write_bank = chardev_write_bank,
+};
+
+/***********************************************************************************************************/
+/*                                       Public API Definitions                                            */
+/***********************************************************************************************************/
+
+void gpio_chardev_set_chip_base(uint8_t first_chip){
+
+    chip_base = first_chip;
+}
+
+int gpio_chardev_request(struct gpio_chardev_group* grp, const uint8_t* gpios, uint8_t n,
+                         uint8_t dir, uint32_t init_values, const char* label){
+
+    uint8_t i = 0;
+    uint8_t chip = 0;
+    struct gpiohandle_request req;
+
+    memset(grp, 0, sizeof(*grp));
+
+    if(n > GPIO_CHARDEV_MAX_LINES){
+        fprintf(stderr, "Error, a gpio group can not contain more than %d lines\n", GPIO_CHARDEV_MAX_LINES);
+        return 1;
+    }
+
+    for(i = 0; i < n; i++){
+        if(gpios[i] >= GPIO_CHARDEV_MAX_CHIPS * GPIO_CHARDEV_LINES_PER_CHIP){
+            fprintf(stderr, "Error, invalid gpio %d in a gpio group\n", gpios[i]);
+            return 1;
+        }
+    }
+
+    grp->nlines = n;
+    grp->values = init_values;
+
+    /* One line handle is requested per bank containing lines of the group */
+    for(chip = 0; chip < GPIO_CHARDEV_MAX_CHIPS; chip++){
+        memset(&req, 0, sizeof(req));
+        req.flags = dir ? GPIOHANDLE_REQUEST_OUTPUT : GPIOHANDLE_REQUEST_INPUT;
+        strncpy(req.consumer_label, label ? label : "gpio_control", sizeof(req.consumer_label) - 1);
+
+        for(i = 0; i < n; i++){
+            if(gpios[i] / GPIO_CHARDEV_LINES_PER_CHIP == chip){
+                grp->handle[grp->nhandles].pos[req.lines] = i;
+                req.lineoffsets[req.lines] = gpios[i] % GPIO_CHARDEV_LINES_PER_CHIP;
+                req.default_values[req.lines] = (init_values >> i) & 1;
+                req.lines++;
+            }
+        }
+
+        if(req.lines){
+            if(request_handle(&grp->handle[grp->nhandles], chip, &req)){
+                gpio_chardev_release(grp);
+                return 1;
+            }
+            grp->nhandles++;
+        }
+    }
+
+    return 0;
+}
+
+int gpio_chardev_set(struct gpio_chardev_group* grp, uint32_t mask, uint32_t values){
+
+    uint8_t h = 0;
+    uint8_t i = 0;
+    uint32_t handle_mask = 0;
+    struct gpio_chardev_handle* handle = NULL;
+    struct gpiohandle_data data;
+
+    /* A group whose request failed has no handle, nothing would be written */
+    if(!grp->nhandles){
+        fprintf(stderr, "Error, gpio lines are not requested\n");
+        return 1;
+    }
+
+    /* The line handle ABI sets all the lines of a handle, unselected lines keep their last value */
+    grp->values = (grp->values & ~mask) | (values & mask);
+
+    for(h = 0; h < grp->nhandles; h++){
+        handle = &grp->handle[h];
+
+        handle_mask = 0;
+        for(i = 0; i < handle->nlines; i++){
+            handle_mask |= 1UL << handle->pos[i];
+            data.values[i] = (grp->values >> handle->pos[i]) & 1;
+        }
+
+        if(!(handle_mask & mask)){
+            continue;
+        }
+
+        if(ioctl(handle->fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data) < 0){
+            perror("Error, gpio line values could not be set");
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int gpio_chardev_get(struct gpio_chardev_group* grp, uint32_t* values){
+
+    uint8_t h = 0;
+    uint8_t i = 0;
+    uint32_t read_values = 0;
+    struct gpio_chardev_handle* handle = NULL;
+    struct gpiohandle_data data;
+
+    if(!grp->nhandles){
+        fprintf(stderr, "Error, gpio lines are not requested\n");
+        return 1;
+    }
+
+    for(h = 0; h < grp->nhandles; h++){
+        handle = &grp->handle[h];
+
+        memset(&data, 0, sizeof(data));
+        if(ioctl(handle->fd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data) < 0){
+            perror("Error, gpio line values could not be read");
+            return 1;
+        }
+
+        for(i = 0; i < handle->nlines; i++){
+            if(data.values[i]){
+                read_values |= 1UL << handle->pos[i];
+            }
+        }
+    }
+
+    *values = read_values;
+
+    return 0;
+}
+
+void gpio_chardev_release(struct gpio_chardev_group* grp){
+
+    uint8_t h = 0;
+
+    for(h = 0; h < grp->nhandles; h++){
+        if(grp->handle[h].fd >= 0){
+            close(grp->handle[h].fd);
+            grp->handle[h].fd = -1;
+        }
+    }
+
+    grp->nhandles = 0;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static int request_handle(struct gpio_chardev_handle* handle, uint8_t chip, struct gpiohandle_request* req){
+
+    int fd = 0;
+    char buf[100] = {0};
+
+    snprintf(buf, sizeof(buf), GPIO_CHARDEV_PATH "%d", chip_base + chip);
+
+    fd = open(buf, O_RDWR);
+    if(fd < 0){
+        perror("Error, gpio chip could not be opened");
+        return 1;
+    }
+
+    if(ioctl(fd, GPIO_GET_LINEHANDLE_IOCTL, req) < 0){
+        perror("Error, gpio lines could not be requested");
+        close(fd);
+        return 1;
+    }
+
+    /* The chip file is not needed anymore, lines are controlled through the handle */
+    close(fd);
+
+    handle->fd = req->fd;
+    handle->nlines = req->lines;
+
+    return 0;
+}
+
+static int bank_request(struct bank_lines* bank, uint8_t dir_val){
+
+    uint32_t values = bank->grp.values;
+
+    if(!bank->pending){
+        return 0;
+    }
+
+    gpio_chardev_release(&bank->grp);
+
+    if(bank->n && gpio_chardev_request(&bank->grp, bank->gpios, bank->n, dir_val, values, "gpio_control")){
+        /* The values are kept for the next attempt */
+        bank->grp.values = values;
+        return 1;
+    }
+    bank->pending = 0;
+
+    return 0;
+}
+
+static void chardev_deinit(void){
+
+    uint8_t chip = 0;
+    int i = 0;
+
+    for(chip = 0; chip < GPIO_CHARDEV_MAX_CHIPS; chip++){
+        gpio_chardev_release(&bank_out[chip].grp);
+        gpio_chardev_release(&bank_in[chip].grp);
+        memset(&bank_out[chip], 0, sizeof(bank_out[chip]));
+        memset(&bank_in[chip], 0, sizeof(bank_in[chip]));
+    }
+
+    for(i = 0; i < GPIO_MAX_NUMBER; i++){
+        line_pos[i] = -1;
+    }
+}
+
+static int chardev_export(uint8_t gpio_no){
+
+    /* Lines are requested when the direction is configured, exporting through sysfs would make them busy */
+    return gpio_no < GPIO_MAX_NUMBER ? 0 : 1;
+}
+
+static int chardev_config_dir(uint8_t gpio_no, uint8_t dir_val){
+
+    uint8_t i = 0;
+    struct bank_lines* bank = NULL;
+    uint8_t chip = gpio_no / GPIO_CHARDEV_LINES_PER_CHIP;
+
+    if(gpio_no >= GPIO_MAX_NUMBER){
+        return 1;
+    }
+
+    if(line_pos[gpio_no] >= 0){
+        if(line_dir[gpio_no] == dir_val){
+            return 0;
+        }
+
+        /* Remove the line from the group of the other direction */
+        bank = line_dir[gpio_no] ? &bank_out[chip] : &bank_in[chip];
+        for(i = line_pos[gpio_no]; i + 1 < bank->n; i++){
+            bank->gpios[i] = bank->gpios[i + 1];
+            if(bank->grp.values & (1UL << (i + 1))){
+                bank->grp.values |= 1UL << i;
+            }
+            else{
+                bank->grp.values &= ~(1UL << i);
+            }
+        }
+        bank->n--;
+        line_pos[gpio_no] = -1;
+        for(i = 0; i < bank->n; i++){
+            line_pos[bank->gpios[i]] = i;
+        }
+
+        /* Released now, so the line can be requested with the other direction */
+        gpio_chardev_release(&bank->grp);
+        bank->pending = 1;
+    }
+
+    /* Requested with the other lines of the bank on the next write or read */
+    bank = dir_val ? &bank_out[chip] : &bank_in[chip];
+    bank->gpios[bank->n] = gpio_no;
+    bank->grp.values &= ~(1UL << bank->n);
+    line_pos[gpio_no] = bank->n;
+    bank->n++;
+    bank->pending = 1;
+    line_dir[gpio_no] = dir_val;
+
+    return 0;
+}
+
+static int chardev_write(uint8_t gpio_no, uint8_t out_val){
+
+    uint32_t bit = 0;
+    struct bank_lines* bank = NULL;
+
+    if(gpio_no >= GPIO_MAX_NUMBER || line_pos[gpio_no] < 0 || !line_dir[gpio_no]){
+        fprintf(stderr, "Error, gpio %d is not configured as output\n", gpio_no);
+        return 1;
+    }
+
+    bit = 1UL << line_pos[gpio_no];
+    bank = &bank_out[gpio_no / GPIO_CHARDEV_LINES_PER_CHIP];
+    if(bank_request(bank, GPIO_DIR_OUT)){
+        return 1;
+    }
+
+    return gpio_chardev_set(&bank->grp, bit, out_val ? bit : 0);
+}
+
+static int chardev_read(uint8_t gpio_no){
+
+    uint32_t values = 0;
+    struct bank_lines* bank = NULL;
+
+    if(gpio_no >= GPIO_MAX_NUMBER || line_pos[gpio_no] < 0){
+        fprintf(stderr, "Error, gpio %d is not configured\n", gpio_no);
+        return -1;
+    }
+
+    bank = line_dir[gpio_no] ? &bank_out[gpio_no / GPIO_CHARDEV_LINES_PER_CHIP]
+                             : &bank_in[gpio_no / GPIO_CHARDEV_LINES_PER_CHIP];
+
+    if(bank_request(bank, line_dir[gpio_no]) || gpio_chardev_get(&bank->grp, &values)){
+        return -1;
+    }
+
+    return (values >> line_pos[gpio_no]) & 1;
+}
+
+static int chardev_config_edge(uint8_t gpio_no, const char* edge){
+
+    fprintf(stderr, "Error, edge detection is not supported by the chardev gpio backend\n");
+
+    return 1;
+}
+
+static int chardev_write_batch(const uint8_t* pins, uint8_t npins, uint32_t mask, uint32_t values){
+
+    uint8_t i = 0;
+    uint8_t chip = 0;
+    uint32_t bit = 0;
+    uint32_t chip_mask[GPIO_CHARDEV_MAX_CHIPS] = {0};
+    uint32_t chip_values[GPIO_CHARDEV_MAX_CHIPS] = {0};
+
+    for(i = 0; i < npins; i++){
+        if(!(mask & (1UL << i))){
+            continue;
+        }
+        if(pins[i] >= GPIO_MAX_NUMBER || line_pos[pins[i]] < 0 || !line_dir[pins[i]]){
+            fprintf(stderr, "Error, gpio %d is not configured as output\n", pins[i]);
+            return 1;
+        }
+        chip = pins[i] / GPIO_CHARDEV_LINES_PER_CHIP;
+        bit = 1UL << line_pos[pins[i]];
+        chip_mask[chip] |= bit;
+        if(values & (1UL << i)){
+            chip_values[chip] |= bit;
+        }
+    }
+
+    /* One ioctl per bank touched */
+    for(chip = 0; chip < GPIO_CHARDEV_MAX_CHIPS; chip++){
+        if(chip_mask[chip] && (bank_request(&bank_out[chip], GPIO_DIR_OUT) ||
+                               gpio_chardev_set(&bank_out[chip].grp, chip_mask[chip], chip_values[chip]))){
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int chardev_read_batch(const uint8_t* pins, uint8_t npins, uint32_t* values){
+
+    uint8_t i = 0;
+    uint8_t chip = 0;
+    uint8_t dir = 0;
+    uint8_t sampled[2][GPIO_CHARDEV_MAX_CHIPS] = {{0}};
+    uint32_t levels[2][GPIO_CHARDEV_MAX_CHIPS] = {{0}};
+    struct bank_lines* bank = NULL;
+
+    *values = 0;
+    for(i = 0; i < npins; i++){
+        if(pins[i] >= GPIO_MAX_NUMBER || line_pos[pins[i]] < 0){
+            fprintf(stderr, "Error, gpio %d is not configured\n", pins[i]);
+            return 1;
+        }
+        chip = pins[i] / GPIO_CHARDEV_LINES_PER_CHIP;
+        dir = line_dir[pins[i]];
+
+        /* One ioctl per bank and direction touched, the lines of a group are sampled at the same time */
+        if(!sampled[dir][chip]){
+            bank = dir ? &bank_out[chip] : &bank_in[chip];
+            if(bank_request(bank, dir) || gpio_chardev_get(&bank->grp, &levels[dir][chip])){
+                return 1;
+            }
+            sampled[dir][chip] = 1;
+        }
+        if(levels[dir][chip] & (1UL << line_pos[pins[i]])){
+            *values |= 1UL << i;
+        }
+    }
+
+    return 0;
+}
+
+static int chardev_write_bank(uint8_t bank, uint32_t mask, uint32_t values){
+
+    uint8_t gpio_no = 0;
+    uint32_t bit = 0;
+    uint32_t grp_mask = 0;
+    uint32_t grp_values = 0;
+
+    if(bank >= GPIO_CHARDEV_MAX_CHIPS){
+        return 1;
+    }
+
+    /* The bank bits are moved to the positions of the lines in the output group of the bank */
+    for(; mask; mask &= mask - 1){
+        gpio_no = bank * GPIO_CHARDEV_LINES_PER_CHIP + __builtin_ctz(mask);
+        if(line_pos[gpio_no] < 0 || !line_dir[gpio_no]){
+            fprintf(stderr, "Error, gpio %d is not configured as output\n", gpio_no);
+            return 1;
+        }
+        bit = 1UL << line_pos[gpio_no];
+        grp_mask |= bit;
+        if(values & (1UL << __builtin_ctz(mask))){
+            grp_values |= bit;
+        }
+    }
+
+    if(bank_request(&bank_out[bank], GPIO_DIR_OUT)){
+        return 1;
+    }
+
+    return gpio_chardev_set(&bank_out[bank].grp, grp_mask, grp_values);
+}
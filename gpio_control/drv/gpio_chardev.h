@@ -0,0 +1,108 @@
+/********************************************************************************************************//**
+* @file gpio_chardev.h
+*
+* @brief Header file containing the prototypes of the APIs for controlling groups of gpios through the gpio
+*        character device (/dev/gpiochipN line handle ioctls).
+*
+* Gpios are identified using the sysfs numbering (bank * 32 + line), so the same defines used with
+* gpio_driver.h can be used here. A group can contain lines of different banks, in that case one line
+* handle is requested per bank and a group write costs one ioctl per bank touched.
+*
+* Public Functions:
+*       - void gpio_chardev_set_chip_base(uint8_t first_chip)
+*       - int gpio_chardev_request(struct gpio_chardev_group* grp, const uint8_t* gpios, uint8_t n,
+*                                  uint8_t dir, uint32_t init_values, const char* label)
+*       - int gpio_chardev_set(struct gpio_chardev_group* grp, uint32_t mask, uint32_t values)
+*       - int gpio_chardev_get(struct gpio_chardev_group* grp, uint32_t* values)
+*       - void gpio_chardev_release(struct gpio_chardev_group* grp)
+*/
+
+#ifndef GPIO_CHARDEV_H
+#define GPIO_CHARDEV_H
+
+#include <stdint.h>
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+#define GPIO_CHARDEV_PATH           "/dev/gpiochip"
+
+#define GPIO_CHARDEV_LINES_PER_CHIP 32  /**< @brief Number of lines of each AM335x gpio bank */
+#define GPIO_CHARDEV_MAX_CHIPS      4   /**< @brief Number of gpio banks of the AM335x */
+#define GPIO_CHARDEV_MAX_LINES      32  /**< @brief Maximum number of lines of a group */
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Line handle requested to one gpio chip */
+struct gpio_chardev_handle{
+    int fd;                                     /**< @brief File descriptor of the line handle */
+    uint8_t nlines;                             /**< @brief Number of lines requested to the chip */
+    uint8_t pos[GPIO_CHARDEV_MAX_LINES];        /**< @brief Position in the group of each line */
+};
+
+/** @brief Group of gpio lines which are written or read in one operation per chip */
+struct gpio_chardev_group{
+    uint8_t nlines;                                         /**< @brief Number of lines of the group */
+    uint8_t nhandles;                                       /**< @brief Number of chips used */
+    uint32_t values;                                        /**< @brief Last values written */
+    struct gpio_chardev_handle handle[GPIO_CHARDEV_MAX_CHIPS];  /**< @brief Handles of the group */
+};
+
+/***********************************************************************************************************/
+/*                                       APIs Supported                                                    */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for setting the gpiochip index of the first bank.
+ * @note By default bank N is /dev/gpiochipN as in the BeagleBone Black. When testing with gpio-mockup or
+ *       gpio-sim the simulated chips can be registered after the chips of the host.
+ * @param[in] first_chip Is the index of the gpiochip device of bank 0.
+ * @return void.
+ */
+void gpio_chardev_set_chip_base(uint8_t first_chip);
+
+/**
+ * @brief Function for requesting a group of gpio lines.
+ * @param[out] grp Is the group to be initialized.
+ * @param[in] gpios Is the list of gpio numbers, bit N of the group values is gpios[N].
+ * @param[in] n Is the number of gpios in the list.
+ * @param[in] dir Is the direction of all the lines (GPIO_DIR_OUT or GPIO_DIR_IN).
+ * @param[in] init_values Is the bitmask of initial values for output lines.
+ * @param[in] label Is the consumer label of the lines.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_chardev_request(struct gpio_chardev_group* grp, const uint8_t* gpios, uint8_t n,
+                         uint8_t dir, uint32_t init_values, const char* label);
+
+/**
+ * @brief Function for setting the values of a group of output lines.
+ * @note Only the chips with lines selected in mask are written (one ioctl per chip).
+ * @param[in] grp Is the group.
+ * @param[in] mask Is the bitmask of lines to be modified.
+ * @param[in] values Is the bitmask of values.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_chardev_set(struct gpio_chardev_group* grp, uint32_t mask, uint32_t values);
+
+/**
+ * @brief Function for getting the values of a group of lines.
+ * @param[in] grp Is the group.
+ * @param[out] values Is the bitmask of values read.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_chardev_get(struct gpio_chardev_group* grp, uint32_t* values);
+
+/**
+ * @brief Function for releasing the lines of a group.
+ * @param[in] grp Is the group.
+ * @return void.
+ */
+void gpio_chardev_release(struct gpio_chardev_group* grp);
+
+#endif
@@ -3,47 +3,245 @@
 *
 * @brief Functions for controlling the gpio.
 *
+* The operations are forwarded to the selected backend (see gpio_backend.h). Every backend call is done
+* with the backend lock held, together with the update of the write statistics and of the latency
+* histograms (gpio_instr.h), so the applications can write and read pins from several threads (e.g. the
+* pwm, multiplex, write queue and sampler threads) although the backends keep unsynchronized state (e.g.
+* the values of a chardev line handle or the lazily opened sysfs value files).
+*
 * Public Functions:
+*       - int gpio_init(const char* backend_name)
+*       - int gpio_init_backend(const struct gpio_backend* be)
+*       - const struct gpio_backend* gpio_get_backend(void)
+*       - void gpio_backend_lock(void)
+*       - void gpio_backend_unlock(void)
+*       - void gpio_deinit(void)
+*       - const char* gpio_backend_name(void)
 *       - int gpio_export(uint8_t gpio_no)
 *       - int gpio_config_dir(uint8_t gpio_no, uint8_t dir_val)
 *       - int gpio_write_value(uint8_t gpio_no, uint8_t out_val)
 *       - int gpio_read_value(uint8_t gpio_no)
 *       - int gpio_config_edge(uint8_t gpio_no, char* edge)
+*       - int gpio_port_init(struct gpio_port* port, const uint8_t* pins, uint8_t npins)
+*       - int gpio_write_mask(struct gpio_port* port, uint32_t mask, uint32_t values)
+*       - int gpio_read_port(const struct gpio_port* port, uint32_t* values)
+*       - int gpio_port_prepare(const struct gpio_port* port, uint32_t mask, uint32_t values,
+*                               struct gpio_bank_write* bw)
+*       - int gpio_write_banks(const struct gpio_bank_write* bw)
+*       - void gpio_shadow_invalidate(uint8_t gpio_no)
+*       - void gpio_get_write_stats(struct gpio_write_stats* stats)
+*       - void gpio_reset_write_stats(void)
+*       - int gpio_init_pins(const struct gpio_pin_config* pins, uint8_t npins, struct gpio_init_report* report)
+*       - void gpio_print_init_report(const struct gpio_init_report* report)
 */
 
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <errno.h>
-#include <fcntl.h>
-#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
 #include "gpio_driver.h"
+#include "gpio_backend.h"
+#include "gpio_instr.h"
+#include "gpio_trace.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Select the default backend if none was selected, returning from the caller if it fails */
+#define CHECK_BACKEND()     do{ if(!backend && gpio_init(NULL)){ return -1; } }while(0)
+
+/** @brief Number of 32 bit words of the shadow bitmaps, one per bank */
+#define SHADOW_WORDS        GPIO_NUM_BANKS
+
+/** @brief Word and bit of a gpio in the shadow bitmaps */
+#define SHADOW_WORD(gpio)   GPIO_BANK(gpio)
+#define SHADOW_BIT(gpio)    GPIO_BANK_BIT(gpio)
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Available backends */
+static const struct gpio_backend* const backends[] = {
+    &gpio_sysfs_backend,
+    &gpio_chardev_backend,
+    &gpio_mmio_backend,
+    &gpio_mock_backend,
+    &gpio_shm_backend,
+};
+
+/** @brief Serializes the backend calls and the statistics */
+static pthread_mutex_t backend_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Selected backend, NULL until gpio_init() is called */
+static const struct gpio_backend* backend = NULL;
+
+/** @brief Last value written to each gpio */
+static uint32_t shadow_values[SHADOW_WORDS];
+
+/** @brief Gpios whose last written value is known (the shadow value is valid) */
+static uint32_t shadow_known[SHADOW_WORDS];
+
+/** @brief Number of pin writes issued and elided */
+static struct gpio_write_stats write_stats;
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for checking if a gpio already holds a value.
+ * @param[in] gpio_no Is the gpio number.
+ * @param[in] out_val Is the value (0 or 1).
+ * @return 1 if the last value written to the gpio is out_val, 0 otherwise.
+ */
+static uint8_t shadow_match(uint8_t gpio_no, uint8_t out_val);
+
+/**
+ * @brief Function for recording the value written to a gpio.
+ * @param[in] gpio_no Is the gpio number.
+ * @param[in] out_val Is the value (0 or 1).
+ * @return void.
+ */
+static void shadow_set(uint8_t gpio_no, uint8_t out_val);
+
+/**
+ * @brief Function for writing an output value, see gpio_write_value().
+ */
+static int write_value(uint8_t gpio_no, uint8_t out_val);
+
+/**
+ * @brief Function for writing the pins of a port, see gpio_write_mask().
+ */
+static int write_mask(struct gpio_port* port, uint32_t mask, uint32_t values);
+
+/**
+ * @brief Function for reading the pins of a port, see gpio_read_port().
+ */
+static int read_port(const struct gpio_port* port, uint32_t* values);
+
+/**
+ * @brief Function for writing the changed gpios of a bank, see gpio_write_banks().
+ * @param[in] bank Is the bank.
+ * @param[in] mask Is the gpios of the bank written.
+ * @param[in] values Is the values of the bank.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int write_bank(uint8_t bank, uint32_t mask, uint32_t values);
+
+/**
+ * @brief Function for getting the monotonic time in us.
+ * @return the current time.
+ */
+static uint64_t now_us(void);
 
 /***********************************************************************************************************/
 /*                                       Public API Definitions                                            */
 /***********************************************************************************************************/
 
-int gpio_export(uint8_t gpio_no){
+int gpio_init(const char* backend_name){
+
+    uint8_t i = 0;
+    const struct gpio_backend* selected = NULL;
 
-    int fd = 0;
-    int len = 0;
-    char buf[4] = {0};
+    if(!backend_name){
+        backend_name = getenv(GPIO_BACKEND_ENV);
+    }
+    if(!backend_name){
+        backend_name = GPIO_DEFAULT_BACKEND;
+    }
 
-    fd = open(SYS_FS_GPIO_PATH "/export", O_WRONLY);
-    if(fd < 0){
-        perror("Error, filer for exporting gpio could not be opened");
-        return fd;
+    for(i = 0; i < sizeof(backends) / sizeof(backends[0]); i++){
+        if(!strcmp(backends[i]->name, backend_name)){
+            selected = backends[i];
+        }
     }
 
-    len = snprintf(buf, sizeof(buf), "%d", gpio_no);
-    write(fd, buf, len);
+    if(!selected){
+        fprintf(stderr, "Error, unknown gpio backend \"%s\"\n", backend_name);
+        return 1;
+    }
+
+    return gpio_init_backend(selected);
+}
 
-    close(fd);
+int gpio_init_backend(const struct gpio_backend* be){
+
+    gpio_deinit();
+
+    memset(shadow_known, 0, sizeof(shadow_known));
+
+    if(getenv(GPIO_INSTR_ENV)){
+        gpio_instr_enable(1);
+    }
+    if(getenv(GPIO_TRACE_ENV) && !gpio_trace_enabled){
+        gpio_trace_enable(getenv(GPIO_TRACE_ENV));
+    }
+
+    if(be->init && be->init()){
+        fprintf(stderr, "Error, gpio backend \"%s\" could not be initialized\n", be->name);
+        return 1;
+    }
+
+    backend = be;
 
     return 0;
 }
 
+void gpio_deinit(void){
+
+    if(backend && backend->deinit){
+        backend->deinit();
+    }
+
+    backend = NULL;
+}
+
+const char* gpio_backend_name(void){
+
+    return backend ? backend->name : NULL;
+}
+
+const struct gpio_backend* gpio_get_backend(void){
+
+    if(!backend && gpio_init(NULL)){
+        return NULL;
+    }
+
+    return backend;
+}
+
+void gpio_backend_lock(void){
+
+    pthread_mutex_lock(&backend_mutex);
+}
+
+void gpio_backend_unlock(void){
+
+    pthread_mutex_unlock(&backend_mutex);
+}
+
+int gpio_export(uint8_t gpio_no){
+
+    int ret = 0;
+    uint64_t t_start = 0;
+
+    CHECK_BACKEND();
+
+    t_start = gpio_instr_start();
+    gpio_backend_lock();
+    gpio_shadow_invalidate(gpio_no);
+    ret = backend->export(gpio_no);
+    gpio_instr_stop(GPIO_INSTR_EXPORT, gpio_no, t_start);
+    gpio_backend_unlock();
+
+    return ret;
+}
+
 /**
  * @brief Function for setting the direction of a gpio number.
  * @param[in] gpio_no Is the gpio number for configuring.
@@ -53,27 +251,19 @@ int gpio_export(uint8_t gpio_no){
  */
 int gpio_config_dir(uint8_t gpio_no, uint8_t dir_val){
 
-    int fd = 0;
-    char buf[100] = {0};
-
-    snprintf(buf, sizeof(buf), SYS_FS_GPIO_PATH "/gpio%d/direction", gpio_no);
-
-    fd = open(buf, O_WRONLY);
-    if(fd < 0){
-        perror("Error, file for managing gpio could not be opened");
-        return fd;
-    }
+    int ret = 0;
+    uint64_t t_start = 0;
 
-    if(dir_val){
-        write(fd, "out", 4);
-    }
-    else{
-        write(fd, "in", 3);
-    }
+    CHECK_BACKEND();
 
-    close(fd);
+    t_start = gpio_instr_start();
+    gpio_backend_lock();
+    gpio_shadow_invalidate(gpio_no);
+    ret = backend->config_dir(gpio_no, dir_val);
+    gpio_instr_stop(GPIO_INSTR_DIR, gpio_no, t_start);
+    gpio_backend_unlock();
 
-    return 0;
+    return ret;
 }
 
 /**
@@ -85,72 +275,459 @@ int gpio_config_dir(uint8_t gpio_no, uint8_t dir_val){
  */
 int gpio_write_value(uint8_t gpio_no, uint8_t out_val){
 
-    int fd = 0;
-    char buf[100] = {0};
+    int ret = 0;
+    uint64_t t_start = 0;
+
+    CHECK_BACKEND();
+
+    t_start = gpio_instr_start();
+    gpio_backend_lock();
+    ret = write_value(gpio_no, out_val);
+    gpio_instr_stop(GPIO_INSTR_WRITE, gpio_no, t_start);
+    gpio_backend_unlock();
+
+    return ret;
+}
+
+/**
+ * @brief Function for reading an input value to a gpio number.
+ * @param[in] gpio_no Is the gpio number for configuring.
+ * @return the value read (0 or 1) if success.
+ * @return < 0 if fail.
+ */
+int gpio_read_value(uint8_t gpio_no){
+
+    int ret = 0;
+    uint64_t t_start = 0;
+
+    CHECK_BACKEND();
+
+    t_start = gpio_instr_start();
+    gpio_backend_lock();
+    ret = backend->read(gpio_no);
+    gpio_instr_stop(GPIO_INSTR_READ, gpio_no, t_start);
+    gpio_backend_unlock();
+
+    return ret;
+}
+
+int gpio_config_edge(uint8_t gpio_no, char* edge){
+
+    int ret = 0;
+    uint64_t t_start = 0;
+
+    CHECK_BACKEND();
 
-    snprintf(buf, sizeof(buf), SYS_FS_GPIO_PATH "/gpio%d/value", gpio_no);
+    t_start = gpio_instr_start();
+    gpio_backend_lock();
+    ret = backend->config_edge(gpio_no, edge);
+    gpio_instr_stop(GPIO_INSTR_EDGE, gpio_no, t_start);
+    gpio_backend_unlock();
 
-    fd = open(buf, O_WRONLY);
-    if(fd < 0){
-        perror("Error, file for managing gpio could not be opened");
-        return fd;
+    return ret;
+}
+
+int gpio_port_init(struct gpio_port* port, const uint8_t* pins, uint8_t npins){
+
+    memset(port, 0, sizeof(*port));
+
+    if(npins > GPIO_PORT_MAX_PINS){
+        fprintf(stderr, "Error, a gpio port can not contain more than %d pins\n", GPIO_PORT_MAX_PINS);
+        return 1;
+    }
+
+    memcpy(port->pins, pins, npins);
+    port->npins = npins;
+
+    return 0;
+}
+
+int gpio_write_mask(struct gpio_port* port, uint32_t mask, uint32_t values){
+
+    int ret = 0;
+    uint64_t t_start = 0;
+
+    CHECK_BACKEND();
+
+    t_start = gpio_instr_start();
+    gpio_backend_lock();
+    ret = write_mask(port, mask, values);
+    gpio_instr_stop(GPIO_INSTR_WRITE_MASK, GPIO_INSTR_NO_PIN, t_start);
+    gpio_backend_unlock();
+
+    return ret;
+}
+
+int gpio_read_port(const struct gpio_port* port, uint32_t* values){
+
+    int ret = 0;
+    uint64_t t_start = 0;
+
+    CHECK_BACKEND();
+
+    t_start = gpio_instr_start();
+    gpio_backend_lock();
+    ret = read_port(port, values);
+    gpio_instr_stop(GPIO_INSTR_READ_PORT, GPIO_INSTR_NO_PIN, t_start);
+    gpio_backend_unlock();
+
+    return ret;
+}
+
+int gpio_port_prepare(const struct gpio_port* port, uint32_t mask, uint32_t values, struct gpio_bank_write* bw){
+
+    uint8_t i = 0;
+    uint8_t b = 0;
+    uint8_t bank = 0;
+    uint32_t masks[GPIO_NUM_BANKS] = {0};
+    uint32_t bank_values[GPIO_NUM_BANKS] = {0};
+
+    for(i = 0; i < port->npins; i++){
+        if(!(mask & (1UL << i))){
+            continue;
+        }
+        if(port->pins[i] >= GPIO_MAX_NUMBER){
+            fprintf(stderr, "Error, invalid gpio %d in a port\n", port->pins[i]);
+            return 1;
+        }
+        bank = GPIO_BANK(port->pins[i]);
+        masks[bank] |= GPIO_BANK_BIT(port->pins[i]);
+        if(values & (1UL << i)){
+            bank_values[bank] |= GPIO_BANK_BIT(port->pins[i]);
+        }
+    }
+
+    bw->nbanks = 0;
+    for(b = 0; b < GPIO_NUM_BANKS; b++){
+        if(masks[b]){
+            bw->banks[bw->nbanks] = b;
+            bw->masks[bw->nbanks] = masks[b];
+            bw->values[bw->nbanks] = bank_values[b];
+            bw->nbanks++;
+        }
     }
 
+    return 0;
+}
+
+int gpio_write_banks(const struct gpio_bank_write* bw){
+
+    int ret = 0;
+    uint8_t b = 0;
+    uint64_t t_start = 0;
+
+    CHECK_BACKEND();
+
+    t_start = gpio_instr_start();
+    gpio_backend_lock();
+    for(b = 0; b < bw->nbanks && !ret; b++){
+        ret = write_bank(bw->banks[b], bw->masks[b], bw->values[b]);
+    }
+    gpio_instr_stop(GPIO_INSTR_WRITE_BANKS, GPIO_INSTR_NO_PIN, t_start);
+    gpio_backend_unlock();
+
+    return ret;
+}
+
+void gpio_shadow_invalidate(uint8_t gpio_no){
+
+    if(gpio_no < GPIO_MAX_NUMBER){
+        __atomic_fetch_and(&shadow_known[SHADOW_WORD(gpio_no)], ~SHADOW_BIT(gpio_no), __ATOMIC_RELAXED);
+    }
+}
+
+void gpio_get_write_stats(struct gpio_write_stats* stats){
+
+    gpio_backend_lock();
+    *stats = write_stats;
+    gpio_backend_unlock();
+}
+
+void gpio_reset_write_stats(void){
+
+    gpio_backend_lock();
+    memset(&write_stats, 0, sizeof(write_stats));
+    gpio_backend_unlock();
+}
+
+int gpio_init_pins(const struct gpio_pin_config* pins, uint8_t npins, struct gpio_init_report* report){
+
+    int ret = 0;
+    uint8_t i = 0;
+    uint8_t nout = 0;
+    uint32_t values = 0;
+    uint8_t gpios[UINT8_MAX];
+    uint64_t t_start = 0;
+    uint64_t t_step = 0;
+    struct gpio_port port;
+    struct gpio_init_report r;
+
+    memset(&r, 0, sizeof(r));
+    r.npins = npins;
+    t_start = now_us();
+
+    CHECK_BACKEND();
+
+    /* Export all pins, without waiting for each one to appear */
+    for(i = 0; i < npins; i++){
+        gpios[i] = pins[i].gpio_no;
+        if(gpio_export(pins[i].gpio_no)){
+            return 1;
+        }
+    }
+    t_step = now_us();
+    r.export_us = t_step - t_start;
+
+    /* One wait for all of them */
+    if(backend->wait_ready){
+        gpio_backend_lock();
+        ret = backend->wait_ready(gpios, npins);
+        gpio_backend_unlock();
+        if(ret){
+            return 1;
+        }
+    }
+    r.ready_us = now_us() - t_step;
+    t_step = now_us();
+
+    for(i = 0; i < npins; i++){
+        if(gpio_config_dir(pins[i].gpio_no, pins[i].dir)){
+            return 1;
+        }
+    }
+
+    /* Initial values of the outputs, written by ports of up to 32 pins */
+    for(i = 0; i < npins; i++){
+        if(pins[i].dir != GPIO_DIR_OUT){
+            continue;
+        }
+        gpios[nout] = pins[i].gpio_no;
+        values |= (uint32_t)(pins[i].value ? 1 : 0) << nout;
+        nout++;
+        if(nout == GPIO_PORT_MAX_PINS){
+            if(gpio_port_init(&port, gpios, nout) || gpio_write_mask(&port, UINT32_MAX, values)){
+                return 1;
+            }
+            nout = 0;
+            values = 0;
+        }
+    }
+    if(nout && (gpio_port_init(&port, gpios, nout) ||
+                gpio_write_mask(&port, (uint32_t)((1ULL << nout) - 1), values))){
+        return 1;
+    }
+
+    for(i = 0; i < npins; i++){
+        if(pins[i].dir == GPIO_DIR_IN && pins[i].edge && gpio_config_edge(pins[i].gpio_no, pins[i].edge)){
+            return 1;
+        }
+    }
+    r.config_us = now_us() - t_step;
+    r.total_us = now_us() - t_start;
+
+    if(report){
+        *report = r;
+    }
+
+    return 0;
+}
+
+void gpio_print_init_report(const struct gpio_init_report* report){
+
+    printf("gpio init (%s): %u pins in %u us (export %u us, ready %u us, config %u us)\n",
+           gpio_backend_name(), report->npins, report->total_us, report->export_us, report->ready_us,
+           report->config_us);
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static uint8_t shadow_match(uint8_t gpio_no, uint8_t out_val){
+
+    /* Pins shared with other processes can change at any time */
+    if(gpio_no >= GPIO_MAX_NUMBER || backend->shared ||
+       !(shadow_known[SHADOW_WORD(gpio_no)] & SHADOW_BIT(gpio_no))){
+        return 0;
+    }
+
+    return ((shadow_values[SHADOW_WORD(gpio_no)] & SHADOW_BIT(gpio_no)) != 0) == out_val;
+}
+
+static void shadow_set(uint8_t gpio_no, uint8_t out_val){
+
+    if(gpio_no >= GPIO_MAX_NUMBER){
+        return;
+    }
+
+    /* Atomic, gpio_shadow_invalidate() can clear bits of the word without the backend lock */
     if(out_val){
-        write(fd, "1", 2);
+        __atomic_fetch_or(&shadow_values[SHADOW_WORD(gpio_no)], SHADOW_BIT(gpio_no), __ATOMIC_RELAXED);
     }
     else{
-        write(fd, "0", 2);
+        __atomic_fetch_and(&shadow_values[SHADOW_WORD(gpio_no)], ~SHADOW_BIT(gpio_no), __ATOMIC_RELAXED);
     }
+    __atomic_fetch_or(&shadow_known[SHADOW_WORD(gpio_no)], SHADOW_BIT(gpio_no), __ATOMIC_RELAXED);
+}
+
+static int write_value(uint8_t gpio_no, uint8_t out_val){
 
-    close(fd);
+    out_val = out_val ? 1 : 0;
+
+    if(shadow_match(gpio_no, out_val)){
+        write_stats.elided++;
+        return 0;
+    }
+
+    write_stats.issued++;
+    if(backend->write(gpio_no, out_val)){
+        /* The pin state is unknown after a failure */
+        gpio_shadow_invalidate(gpio_no);
+        return 1;
+    }
+    shadow_set(gpio_no, out_val);
+    gpio_trace_record(gpio_trace_now(), gpio_no, out_val);
 
     return 0;
 }
 
-/**
- * @brief Function for reading an input value to a gpio number.
- * @param[in] gpio_no Is the gpio number for configuring.
- * @return 0 if success.
- * @return != 0 if fail.
- */
-int gpio_read_value(uint8_t gpio_no){
-
-    int fd = 0;
-    uint8_t read_val = 0;
-    char buf[100] = {0};
+static int write_mask(struct gpio_port* port, uint32_t mask, uint32_t values){
+
+    uint8_t i = 0;
+    uint32_t bit = 0;
+    uint32_t changed = 0;
+
+    /* Pins with unknown state are always written */
+    for(i = 0; i < port->npins; i++){
+        bit = 1UL << i;
+        if(mask & bit){
+            if(shadow_match(port->pins[i], (values & bit) != 0)){
+                write_stats.elided++;
+            }
+            else{
+                changed |= bit;
+                write_stats.issued++;
+            }
+        }
+    }
+    if(!changed){
+        return 0;
+    }
 
-    snprintf(buf, sizeof(buf), SYS_FS_GPIO_PATH "/gpio%d/value", gpio_no);
+    /* Backends able to write several pins at once get all the changed pins in one call */
+    if(backend->write_batch){
+        if(backend->write_batch(port->pins, port->npins, changed, values)){
+            for(i = 0; i < port->npins; i++){
+                if(changed & (1UL << i)){
+                    gpio_shadow_invalidate(port->pins[i]);
+                }
+            }
+            return 1;
+        }
+        for(i = 0; i < port->npins; i++){
+            if(changed & (1UL << i)){
+                shadow_set(port->pins[i], (values >> i) & 1);
+            }
+        }
+        /* The pins of a batch are traced with one timestamp */
+        gpio_trace_record_port(gpio_trace_now(), port->pins, changed, values);
+        return 0;
+    }
 
-    fd = open(buf, O_WRONLY);
-    if(fd < 0){
-        perror("Error, file for managing gpio could not be opened");
-        return fd;
+    for(i = 0; i < port->npins && changed; i++){
+        bit = 1UL << i;
+        if(changed & bit){
+            if(backend->write(port->pins[i], (values & bit) != 0)){
+                /* The pin state is unknown after a failure */
+                gpio_shadow_invalidate(port->pins[i]);
+                return 1;
+            }
+            shadow_set(port->pins[i], (values & bit) != 0);
+            gpio_trace_record(gpio_trace_now(), port->pins[i], (values & bit) != 0);
+            changed &= ~bit;
+        }
     }
 
-    read(fd, &read_val, 1);
+    return 0;
+}
+
+static int read_port(const struct gpio_port* port, uint32_t* values){
 
-    close(fd);
+    int level = 0;
+    uint8_t i = 0;
 
-    return read_val;
+    if(backend->read_batch){
+        return backend->read_batch(port->pins, port->npins, values);
+    }
+
+    *values = 0;
+    for(i = 0; i < port->npins; i++){
+        level = backend->read(port->pins[i]);
+        if(level < 0){
+            return 1;
+        }
+        if(level){
+            *values |= 1UL << i;
+        }
+    }
+
+    return 0;
 }
 
-int gpio_config_edge(uint8_t gpio_no, char* edge){
+static int write_bank(uint8_t bank, uint32_t mask, uint32_t values){
 
-    int fd = 0;
-    char buf[100] = {0};
+    uint8_t bit = 0;
+    uint32_t changed = mask;
+    uint64_t t_ns = 0;
 
-    snprintf(buf, sizeof(buf), SYS_FS_GPIO_PATH "/gpio%d/edge", gpio_no);
+    /* A whole bank is compared with its shadow words at once */
+    if(!backend->shared){
+        changed &= ~__atomic_load_n(&shadow_known[bank], __ATOMIC_RELAXED) |
+                   (__atomic_load_n(&shadow_values[bank], __ATOMIC_RELAXED) ^ values);
+    }
+    write_stats.elided += __builtin_popcount(mask & ~changed);
+    write_stats.issued += __builtin_popcount(changed);
+    if(!changed){
+        return 0;
+    }
 
-    fd = open(buf, O_WRONLY);
-    if(fd < 0){
-        perror("Error, file for managing gpio could not be opened");
-        return fd;
+    if(backend->write_bank){
+        if(backend->write_bank(bank, changed, values)){
+            __atomic_fetch_and(&shadow_known[bank], ~changed, __ATOMIC_RELAXED);
+            return 1;
+        }
+    }
+    else{
+        for(mask = changed; mask; mask &= mask - 1){
+            bit = __builtin_ctz(mask);
+            if(backend->write(bank * GPIO_BANK_LINES + bit, (values >> bit) & 1)){
+                /* The state of the gpios of the write is unknown after a failure */
+                __atomic_fetch_and(&shadow_known[bank], ~changed, __ATOMIC_RELAXED);
+                return 1;
+            }
+        }
     }
 
-    write(fd, edge, strlen(edge) + 1);
+    __atomic_fetch_or(&shadow_values[bank], values & changed, __ATOMIC_RELAXED);
+    __atomic_fetch_and(&shadow_values[bank], values | ~changed, __ATOMIC_RELAXED);
+    __atomic_fetch_or(&shadow_known[bank], changed, __ATOMIC_RELAXED);
 
-    close(fd);
+    t_ns = gpio_trace_now();
+    if(t_ns){
+        for(mask = changed; mask; mask &= mask - 1){
+            bit = __builtin_ctz(mask);
+            gpio_trace_record(t_ns, bank * GPIO_BANK_LINES + bit, (values >> bit) & 1);
+        }
+    }
 
     return 0;
 }
+
+static uint64_t now_us(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
@@ -3,12 +3,40 @@
 *
 * @brief Header file containing the prototypes fo the APIs for controlling the gpio.
 *
+* The gpio operations are implemented by a backend selected with gpio_init(). If no backend is selected the
+* one named by the GPIO_BACKEND environment variable (or sysfs if not set) is used on the first call.
+*
+* The driver keeps a shadow copy of the last value written to each output, so writes of the value a pin
+* already holds are dropped (elided) before reaching the backend. The shadow of a pin is invalidated when it
+* is exported or its direction is configured, or with gpio_shadow_invalidate() if the pin can be changed
+* outside of this process.
+*
 * Public Functions:
+*       - int gpio_init(const char* backend_name)
+*       - int gpio_init_backend(const struct gpio_backend* be) (gpio_backend.h)
+*       - const struct gpio_backend* gpio_get_backend(void) (gpio_backend.h)
+*       - void gpio_deinit(void)
+*       - const char* gpio_backend_name(void)
 *       - int gpio_export(uint8_t gpio_no)
 *       - int gpio_config_dir(uint8_t gpio_no, uint8_t dir_val)
 *       - int gpio_write_value(uint8_t gpio_no, uint8_t out_val)
 *       - int gpio_read_value(uint8_t gpio_no)
 *       - int gpio_config_edge(uint8_t gpio_no, char* edge)
+*       - int gpio_open(uint8_t gpio_no)
+*       - void gpio_close(uint8_t gpio_no)
+*       - void gpio_close_all(void)
+*       - void gpio_set_sysfs_root(const char* path)
+*       - int gpio_port_init(struct gpio_port* port, const uint8_t* pins, uint8_t npins)
+*       - int gpio_write_mask(struct gpio_port* port, uint32_t mask, uint32_t values)
+*       - int gpio_read_port(const struct gpio_port* port, uint32_t* values)
+*       - int gpio_port_prepare(const struct gpio_port* port, uint32_t mask, uint32_t values,
+*                               struct gpio_bank_write* bw)
+*       - int gpio_write_banks(const struct gpio_bank_write* bw)
+*       - void gpio_shadow_invalidate(uint8_t gpio_no)
+*       - void gpio_get_write_stats(struct gpio_write_stats* stats)
+*       - void gpio_reset_write_stats(void)
+*       - int gpio_init_pins(const struct gpio_pin_config* pins, uint8_t npins, struct gpio_init_report* report)
+*       - void gpio_print_init_report(const struct gpio_init_report* report)
 */
 
 #ifndef GPIO_DRIVER_H
@@ -22,6 +50,23 @@
 
 #define SYS_FS_GPIO_PATH    "/sys/class/gpio"
 
+#define GPIO_BACKEND_ENV        "GPIO_BACKEND"  /**< @brief Environment variable selecting the backend */
+#define GPIO_DEFAULT_BACKEND    "sysfs"         /**< @brief Backend used if none is selected */
+
+/** @brief Number of gpios handled by the driver (4 banks of 32 gpios in the AM335x) */
+#define GPIO_MAX_NUMBER     128
+
+#define GPIO_BANK_LINES     32                                  /**< @brief Gpios of a bank */
+#define GPIO_NUM_BANKS      (GPIO_MAX_NUMBER / GPIO_BANK_LINES) /**< @brief Number of banks */
+
+/**
+ * @defgroup GPIO_BANK_BITS Bank of a gpio and its bit in the bank, constant for a constant gpio number.
+ * @{
+ */
+#define GPIO_BANK(gpio)         ((gpio) / GPIO_BANK_LINES)
+#define GPIO_BANK_BIT(gpio)     (1UL << ((gpio) % GPIO_BANK_LINES))
+/** @} */
+
 /**
  * @defgroup GPIO_DIR Possible configuration values for direction of GPIOs.
  * @{
@@ -38,10 +83,83 @@
 #define GPIO_LOW_VALUE          0   /**< @brief Value for setting the output of the GPIO as low */
 /** @} */
 
+/** @brief Maximum number of pins grouped in a port */
+#define GPIO_PORT_MAX_PINS  32
+
+/**
+ * @defgroup GPIO_PIN_TABLE Entries of a pin table for gpio_init_pins().
+ * @{
+ */
+#define GPIO_PIN_OUT(gpio, value)   {(gpio), GPIO_DIR_OUT, (value), NULL}   /**< @brief Output, initial value */
+#define GPIO_PIN_IN(gpio, edge)     {(gpio), GPIO_DIR_IN, 0, (edge)}        /**< @brief Input, edge or NULL */
+/** @} */
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Group of gpios written or read as a bitmask, bit N of the values is pins[N] */
+struct gpio_port{
+    uint8_t npins;                      /**< @brief Number of pins of the port */
+    uint8_t pins[GPIO_PORT_MAX_PINS];   /**< @brief Gpio number of each pin */
+};
+
+/** @brief Port write translated once into one write per bank, see gpio_port_prepare() */
+struct gpio_bank_write{
+    uint8_t nbanks;                     /**< @brief Number of banks written */
+    uint8_t banks[GPIO_NUM_BANKS];      /**< @brief Bank of each write */
+    uint32_t masks[GPIO_NUM_BANKS];     /**< @brief Gpios of the bank written (GPIO_BANK_BIT()) */
+    uint32_t values[GPIO_NUM_BANKS];    /**< @brief Values of the written gpios */
+};
+
+/** @brief Configuration of a gpio in a pin table, see @ref GPIO_PIN_TABLE */
+struct gpio_pin_config{
+    uint8_t gpio_no;                    /**< @brief Gpio number */
+    uint8_t dir;                        /**< @brief Direction (GPIO_DIR_OUT or GPIO_DIR_IN) */
+    uint8_t value;                      /**< @brief Initial value of an output */
+    char* edge;                         /**< @brief Edge of an input, NULL if not configured */
+};
+
+/** @brief Duration of each step of gpio_init_pins() */
+struct gpio_init_report{
+    uint8_t npins;                      /**< @brief Number of pins initialized */
+    uint32_t export_us;                 /**< @brief Export of all pins */
+    uint32_t ready_us;                  /**< @brief Wait for the exported pins to be available */
+    uint32_t config_us;                 /**< @brief Direction, initial values and edges */
+    uint32_t total_us;                  /**< @brief Whole initialization */
+};
+
+/** @brief Number of output pin writes requested to the driver */
+struct gpio_write_stats{
+    uint32_t issued;                    /**< @brief Pin writes forwarded to the backend */
+    uint32_t elided;                    /**< @brief Pin writes dropped because the pin held the value */
+};
+
 /***********************************************************************************************************/
 /*                                       APIs Supported                                                    */
 /***********************************************************************************************************/
 
+/**
+ * @brief Function for selecting and initializing the gpio backend.
+ * @param[in] backend_name Is "sysfs", "chardev", "mmio", "mock" or "shm". NULL selects the backend named
+ *            by the GPIO_BACKEND environment variable, or GPIO_DEFAULT_BACKEND if it is not set.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_init(const char* backend_name);
+
+/**
+ * @brief Function for releasing the selected gpio backend.
+ * @return void.
+ */
+void gpio_deinit(void);
+
+/**
+ * @brief Function for getting the name of the selected backend.
+ * @return the name of the backend, NULL if no backend is selected.
+ */
+const char* gpio_backend_name(void);
+
 /**
  * @brief Function for exporting a gpio number.
  * @param[in] gpio_no Is the gpio number for exporting.
@@ -61,6 +179,7 @@ int gpio_config_dir(uint8_t gpio_no, uint8_t dir_val);
 
 /**
  * @brief Function for setting an output value to a gpio number.
+ * @note Nothing is written if the last value written to the gpio is out_val.
  * @param[in] gpio_no Is the gpio number for configuring.
  * @param[in] out_val Is the value to be set as output.
  * @return 0 if success.
@@ -71,8 +190,8 @@ int gpio_write_value(uint8_t gpio_no, uint8_t out_val);
 /**
  * @brief Function for reading an input value to a gpio number.
  * @param[in] gpio_no Is the gpio number for configuring.
- * @return 0 if success.
- * @return != 0 if fail.
+ * @return the value read (0 or 1) if success.
+ * @return < 0 if fail.
  */
 int gpio_read_value(uint8_t gpio_no);
 
@@ -85,4 +204,134 @@ int gpio_read_value(uint8_t gpio_no);
  */
 int gpio_config_edge(uint8_t gpio_no, char* edge);
 
+/**
+ * @brief Function for opening the sysfs handle of a gpio number.
+ * @note The handle (value file descriptor) is kept opened and reused by gpio_write_value() and
+ *       gpio_read_value(). It is also opened by gpio_export(), so calling this function is optional.
+ * @param[in] gpio_no Is the gpio number.
+ * @return the file descriptor of the value file if success.
+ * @return < 0 if fail.
+ */
+int gpio_open(uint8_t gpio_no);
+
+/**
+ * @brief Function for closing the cached sysfs handle of a gpio number.
+ * @note The cached direction and edge are also forgotten, they are read again on the next configuration.
+ * @param[in] gpio_no Is the gpio number.
+ * @return void.
+ */
+void gpio_close(uint8_t gpio_no);
+
+/**
+ * @brief Function for closing the cached sysfs handles of all gpios.
+ * @return void.
+ */
+void gpio_close_all(void);
+
+/**
+ * @brief Function for changing the root of the gpio sysfs tree.
+ * @note Useful for running the driver against a fake sysfs tree. All cached handles are closed.
+ * @param[in] path Is the new root path, NULL restores SYS_FS_GPIO_PATH.
+ * @return void.
+ */
+void gpio_set_sysfs_root(const char* path);
+
+/**
+ * @brief Function for initializing a port grouping several gpios.
+ * @note The gpios must be exported and configured as output before writing the port, or as input before
+ *       reading it.
+ * @param[out] port Is the port to be initialized.
+ * @param[in] pins Is the list of gpio numbers, pins[N] is bit N of the port.
+ * @param[in] npins Is the number of gpios in the list (up to GPIO_PORT_MAX_PINS).
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_port_init(struct gpio_port* port, const uint8_t* pins, uint8_t npins);
+
+/**
+ * @brief Function for writing a bitmask of values to the pins of a port.
+ * @note Only the pins selected in mask whose value changed since the last write are written, the pins
+ *       share the shadow copy of gpio_write_value().
+ * @param[in] port Is the port.
+ * @param[in] mask Is the bitmask of pins to be modified.
+ * @param[in] values Is the bitmask of values (bit N is the value of pins[N]).
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_write_mask(struct gpio_port* port, uint32_t mask, uint32_t values);
+
+/**
+ * @brief Function for reading the levels of all the pins of a port at once.
+ * @note Backends able to read several pins at once (chardev, mmio) sample each bank with one operation, so
+ *       the pins of a bank are read at the same time. Otherwise the pins are read one by one.
+ * @param[in] port Is the port.
+ * @param[out] values Is the bitmask of levels (bit N is the level of pins[N]).
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_read_port(const struct gpio_port* port, uint32_t* values);
+
+/**
+ * @brief Function for translating a port write into bank masks, to be written with gpio_write_banks().
+ * @note Done once for the fixed patterns of an application (e.g. the segments of each digit), so their
+ *       writes do not map the port bits to the gpios again.
+ * @param[in] port Is the port.
+ * @param[in] mask Is the bitmask of pins to be modified.
+ * @param[in] values Is the bitmask of values (bit N is the value of pins[N]).
+ * @param[out] bw Is the bank writes, in increasing bank order.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_port_prepare(const struct gpio_port* port, uint32_t mask, uint32_t values, struct gpio_bank_write* bw);
+
+/**
+ * @brief Function for writing prepared bank masks, with one backend operation per bank.
+ * @note The writes are elided against the shadow copy one bank at a time, as gpio_write_mask() does per pin.
+ *       Backends without bank writes (sysfs) get one write per changed gpio.
+ * @param[in] bw Is the bank writes returned by gpio_port_prepare().
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_write_banks(const struct gpio_bank_write* bw);
+
+/**
+ * @brief Function for forgetting the last value written to a gpio, so the next write is not elided.
+ * @param[in] gpio_no Is the gpio number.
+ * @return void.
+ */
+void gpio_shadow_invalidate(uint8_t gpio_no);
+
+/**
+ * @brief Function for getting the number of pin writes issued and elided by the driver.
+ * @param[out] stats Is the statistics.
+ * @return void.
+ */
+void gpio_get_write_stats(struct gpio_write_stats* stats);
+
+/**
+ * @brief Function for clearing the write statistics.
+ * @return void.
+ */
+void gpio_reset_write_stats(void);
+
+/**
+ * @brief Function for initializing all the gpios of a pin table.
+ * @note All pins are exported first, then the driver waits once for all of them to be available (udev),
+ *       then the directions are configured, the initial values of the outputs are written in batches
+ *       (one port write per 32 outputs) and the edges of the inputs are configured.
+ * @param[in] pins Is the pin table.
+ * @param[in] npins Is the number of entries of the table.
+ * @param[out] report Is the duration of each step, it can be NULL.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_init_pins(const struct gpio_pin_config* pins, uint8_t npins, struct gpio_init_report* report);
+
+/**
+ * @brief Function for printing the duration of gpio_init_pins() to stdout.
+ * @param[in] report Is the report filled by gpio_init_pins().
+ * @return void.
+ */
+void gpio_print_init_report(const struct gpio_init_report* report);
+
 #endif
@@ -0,0 +1,521 @@
+/********************************************************************************************************//**
+* @file gpio_event.c
+*
+* @brief Event engine waiting for edges on several input gpios with one epoll set.
+*
+* The settle deadlines of the debounced gpios are served by one timerfd registered in the same epoll set.
+*
+* Public Functions:
+*       - int gpio_event_init(void)
+*       - void gpio_event_deinit(void)
+*       - int gpio_event_add(uint8_t gpio_no, char* edge)
+*       - int gpio_event_remove(uint8_t gpio_no)
+*       - int gpio_event_wait(struct gpio_event* events, int max_events, int timeout_ms)
+*       - int gpio_event_get_fd(void)
+*       - int gpio_event_set_debounce(uint8_t gpio_no, uint8_t mode, uint32_t window_us)
+*       - void gpio_event_get_stats(struct gpio_event_stats* stats)
+*       - uint32_t gpio_event_get_filtered(uint8_t gpio_no)
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include "gpio_driver.h"
+#include "gpio_backend.h"
+#include "gpio_event.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+#define EDGE_RISING         (1 << 0)    /**< @brief Low to high changes are delivered */
+#define EDGE_FALLING        (1 << 1)    /**< @brief High to low changes are delivered */
+
+/** @brief epoll data of the debounce timer, it can not be a gpio number */
+#define TIMER_ID            GPIO_MAX_NUMBER
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief State of a gpio in the event engine */
+struct event_pin{
+    uint8_t registered;         /**< @brief The gpio is in the epoll set */
+    uint8_t edges;              /**< @brief Edges delivered (EDGE_RISING and/or EDGE_FALLING) */
+    uint8_t mode;               /**< @brief Debounce mode */
+    uint8_t level;              /**< @brief Last stable level (GPIO_DEBOUNCE_SETTLE) */
+    uint8_t pending;            /**< @brief A settle deadline is pending */
+    int fd;                     /**< @brief File descriptor registered in the epoll set */
+    uint64_t window_ns;         /**< @brief Lockout or settle time */
+    uint64_t deadline_ns;       /**< @brief End of the lockout or settle window */
+    uint64_t t_edge_ns;         /**< @brief Time of the last edge */
+    uint32_t filtered;          /**< @brief Edges dropped by the debounce stage */
+};
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief File descriptor of the epoll set, -1 if not created */
+static int epoll_fd = -1;
+
+/** @brief File descriptor of the debounce timer, -1 if not created */
+static int timer_fd = -1;
+
+/** @brief State of each gpio */
+static struct event_pin pins[GPIO_MAX_NUMBER];
+
+/** @brief Counters of the engine */
+static struct gpio_event_stats stats;
+
+/** @brief Number of gpios with a pending settle deadline */
+static int npending = 0;
+
+/** @brief The pending deadlines changed since the timer was armed */
+static uint8_t timer_dirty = 0;
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for getting the edge configured in the backend for a gpio.
+ * @param[in] pin Is the state of the gpio.
+ * @return "rising", "falling", "both" or "none".
+ */
+static char* backend_edge(const struct event_pin* pin);
+
+/**
+ * @brief Function for handling an edge signaled by the backend.
+ * @param[in] be Is the backend.
+ * @param[in] gpio_no Is the gpio number.
+ * @param[in] t_ns Is the time of the wake up.
+ * @param[out] event Is the event to be delivered.
+ * @return 1 if the event must be delivered, 0 if it was filtered.
+ */
+static uint8_t handle_edge(const struct gpio_backend* be, uint8_t gpio_no, uint64_t t_ns,
+                           struct gpio_event* event);
+
+/**
+ * @brief Function for delivering the gpios whose settle window expired and re-arming the timer.
+ * @param[in] be Is the backend.
+ * @param[in] t_ns Is the current time.
+ * @param[out] events Is the array receiving the events.
+ * @param[in] max_events Is the free space in the array.
+ * @return the number of events added.
+ */
+static int handle_settled(const struct gpio_backend* be, uint64_t t_ns, struct gpio_event* events,
+                          int max_events);
+
+/**
+ * @brief Function for arming the debounce timer at the earliest pending settle deadline.
+ * @return void.
+ */
+static void arm_timer(void);
+
+/**
+ * @brief Function for getting the monotonic time in ns.
+ * @return the current time.
+ */
+static uint64_t now_ns(void);
+
+/***********************************************************************************************************/
+/*                                       Public API Definitions                                            */
+/***********************************************************************************************************/
+
+int gpio_event_init(void){
+
+    struct epoll_event ev = {0};
+
+    if(epoll_fd >= 0){
+        return 0;
+    }
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if(epoll_fd < 0){
+        perror("Error, epoll set for gpio events could not be created");
+        return 1;
+    }
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if(timer_fd < 0){
+        perror("Error, debounce timer could not be created");
+        gpio_event_deinit();
+        return 1;
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.u32 = TIMER_ID;
+    if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev) < 0){
+        perror("Error, debounce timer could not be added to the epoll set");
+        gpio_event_deinit();
+        return 1;
+    }
+
+    return 0;
+}
+
+void gpio_event_deinit(void){
+
+    int i = 0;
+
+    /* The file descriptors of the gpios belong to the backend, they are only unregistered */
+    for(i = 0; i < GPIO_MAX_NUMBER; i++){
+        pins[i].registered = 0;
+        pins[i].pending = 0;
+    }
+    npending = 0;
+
+    if(timer_fd >= 0){
+        close(timer_fd);
+        timer_fd = -1;
+    }
+    if(epoll_fd >= 0){
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+}
+
+int gpio_event_add(uint8_t gpio_no, char* edge){
+
+    const struct gpio_backend* be = gpio_get_backend();
+    struct event_pin* pin = NULL;
+    struct epoll_event ev = {0};
+    uint32_t events = 0;
+    int level = 0;
+    int fd = 0;
+
+    if(!be || gpio_no >= GPIO_MAX_NUMBER){
+        return 1;
+    }
+    if(!be->event_fd || !be->event_read){
+        fprintf(stderr, "Error, gpio backend \"%s\" does not support edge events\n", be->name);
+        return 1;
+    }
+
+    pin = &pins[gpio_no];
+    if(pin->registered){
+        return 0;
+    }
+    if(gpio_event_init()){
+        return 1;
+    }
+
+    if(!strcmp(edge, "rising")){
+        pin->edges = EDGE_RISING;
+    }
+    else if(!strcmp(edge, "falling")){
+        pin->edges = EDGE_FALLING;
+    }
+    else if(!strcmp(edge, "both")){
+        pin->edges = EDGE_RISING | EDGE_FALLING;
+    }
+    else{
+        fprintf(stderr, "Error, unknown edge \"%s\"\n", edge);
+        return 1;
+    }
+
+    if(gpio_config_edge(gpio_no, backend_edge(pin))){
+        return 1;
+    }
+
+    gpio_backend_lock();
+    fd = be->event_fd(gpio_no, &events);
+    if(fd < 0){
+        gpio_backend_unlock();
+        fprintf(stderr, "Error, edge events of gpio %d are not available\n", gpio_no);
+        return 1;
+    }
+
+    /* Discard the edge pending since the file was opened, the level is the first stable one */
+    level = be->event_read(gpio_no);
+    gpio_backend_unlock();
+    pin->level = level > 0;
+    pin->deadline_ns = 0;
+
+    ev.events = events;
+    ev.data.u32 = gpio_no;
+    if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0){
+        perror("Error, gpio could not be added to the epoll set");
+        return 1;
+    }
+    pin->fd = fd;
+    pin->registered = 1;
+
+    return 0;
+}
+
+int gpio_event_remove(uint8_t gpio_no){
+
+    if(gpio_no >= GPIO_MAX_NUMBER || !pins[gpio_no].registered){
+        return 1;
+    }
+
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, pins[gpio_no].fd, NULL);
+    pins[gpio_no].registered = 0;
+    if(pins[gpio_no].pending){
+        pins[gpio_no].pending = 0;
+        npending--;
+        timer_dirty = 1;
+    }
+
+    return gpio_config_edge(gpio_no, "none");
+}
+
+int gpio_event_wait(struct gpio_event* events, int max_events, int timeout_ms){
+
+    const struct gpio_backend* be = gpio_get_backend();
+    struct epoll_event ev[GPIO_EVENT_MAX_BATCH];
+    uint64_t t_ns = 0;
+    uint64_t t_end_ns = 0;
+    uint64_t expirations = 0;
+    int wait_ms = timeout_ms;
+    int n = 0;
+    int i = 0;
+    int count = 0;
+
+    if(epoll_fd < 0 || !be){
+        return -1;
+    }
+    if(max_events > GPIO_EVENT_MAX_BATCH){
+        max_events = GPIO_EVENT_MAX_BATCH;
+    }
+    if(timeout_ms > 0){
+        t_end_ns = now_ns() + (uint64_t)timeout_ms * 1000000ULL;
+    }
+
+    /* Wake ups whose edges are all filtered do not return to the application */
+    while(1){
+        n = epoll_wait(epoll_fd, ev, max_events, wait_ms);
+        if(n < 0){
+            if(errno == EINTR){
+                return 0;
+            }
+            perror("Error, waiting for gpio events failed");
+            return -1;
+        }
+
+        /* Every event of the batch gets the time of the wake up */
+        t_ns = now_ns();
+        if(n > 0){
+            stats.wakeups++;
+        }
+
+        for(i = 0; i < n; i++){
+            if(ev[i].data.u32 == TIMER_ID){
+                read(timer_fd, &expirations, sizeof(expirations));
+                continue;
+            }
+            count += handle_edge(be, ev[i].data.u32, t_ns, &events[count]);
+        }
+        count += handle_settled(be, t_ns, &events[count], max_events - count);
+        stats.delivered += count;
+
+        if(count || timeout_ms == 0){
+            return count;
+        }
+        if(timeout_ms > 0){
+            if(t_ns >= t_end_ns){
+                return 0;
+            }
+            wait_ms = (t_end_ns - t_ns + 999999) / 1000000;
+        }
+    }
+}
+
+int gpio_event_get_fd(void){
+
+    return epoll_fd;
+}
+
+int gpio_event_set_debounce(uint8_t gpio_no, uint8_t mode, uint32_t window_us){
+
+    struct event_pin* pin = NULL;
+    uint8_t old_mode = 0;
+
+    if(gpio_no >= GPIO_MAX_NUMBER || mode > GPIO_DEBOUNCE_SETTLE){
+        return 1;
+    }
+
+    pin = &pins[gpio_no];
+    old_mode = pin->mode;
+    pin->mode = mode;
+    pin->window_ns = (uint64_t)window_us * 1000ULL;
+    pin->deadline_ns = 0;
+    if(pin->pending){
+        pin->pending = 0;
+        npending--;
+        timer_dirty = 1;
+    }
+
+    /* The integrator needs both edges to follow the level */
+    if(pin->registered && (old_mode == GPIO_DEBOUNCE_SETTLE) != (mode == GPIO_DEBOUNCE_SETTLE)){
+        return gpio_config_edge(gpio_no, backend_edge(pin));
+    }
+
+    return 0;
+}
+
+void gpio_event_get_stats(struct gpio_event_stats* st){
+
+    *st = stats;
+}
+
+uint32_t gpio_event_get_filtered(uint8_t gpio_no){
+
+    return gpio_no < GPIO_MAX_NUMBER ? pins[gpio_no].filtered : 0;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static char* backend_edge(const struct event_pin* pin){
+
+    uint8_t edges = pin->mode == GPIO_DEBOUNCE_SETTLE ? (EDGE_RISING | EDGE_FALLING) : pin->edges;
+
+    switch(edges){
+        case EDGE_RISING:
+            return "rising";
+        case EDGE_FALLING:
+            return "falling";
+        case EDGE_RISING | EDGE_FALLING:
+            return "both";
+        default:
+            return "none";
+    }
+}
+
+static uint8_t handle_edge(const struct gpio_backend* be, uint8_t gpio_no, uint64_t t_ns,
+                           struct gpio_event* event){
+
+    int level = 0;
+    struct event_pin* pin = &pins[gpio_no];
+
+    gpio_backend_lock();
+    level = be->event_read(gpio_no);
+    gpio_backend_unlock();
+
+    if(level < 0 || !pin->registered){
+        return 0;
+    }
+    stats.edges++;
+
+    switch(pin->mode){
+        case GPIO_DEBOUNCE_LOCKOUT:
+            if(t_ns < pin->deadline_ns){
+                pin->filtered++;
+                stats.filtered++;
+                return 0;
+            }
+            pin->deadline_ns = t_ns + pin->window_ns;
+            break;
+
+        case GPIO_DEBOUNCE_SETTLE:
+            /* The previous edge did not settle */
+            if(pin->pending){
+                pin->filtered++;
+                stats.filtered++;
+            }
+            else{
+                npending++;
+            }
+            timer_dirty = 1;
+            pin->pending = 1;
+            pin->t_edge_ns = t_ns;
+            pin->deadline_ns = t_ns + pin->window_ns;
+            return 0;
+
+        default:
+            break;
+    }
+
+    event->t_ns = t_ns;
+    event->gpio_no = gpio_no;
+    event->level = level;
+
+    return 1;
+}
+
+static int handle_settled(const struct gpio_backend* be, uint64_t t_ns, struct gpio_event* events,
+                          int max_events){
+
+    int i = 0;
+    int level = 0;
+    int count = 0;
+    struct event_pin* pin = NULL;
+
+    if(!npending && !timer_dirty){
+        return 0;
+    }
+
+    for(i = 0; i < GPIO_MAX_NUMBER && count < max_events; i++){
+        pin = &pins[i];
+        if(!pin->pending || t_ns < pin->deadline_ns){
+            continue;
+        }
+        pin->pending = 0;
+        npending--;
+
+        gpio_backend_lock();
+        level = be->read(i);
+        gpio_backend_unlock();
+        if(level < 0){
+            continue;
+        }
+
+        /* Bounces returning to the stable level, or changes not requested, are dropped */
+        if(level == pin->level || !(pin->edges & (level ? EDGE_RISING : EDGE_FALLING))){
+            if(level == pin->level){
+                pin->filtered++;
+                stats.filtered++;
+            }
+            pin->level = level;
+            continue;
+        }
+        pin->level = level;
+
+        events[count].t_ns = pin->t_edge_ns;
+        events[count].gpio_no = i;
+        events[count].level = level;
+        count++;
+    }
+
+    arm_timer();
+    timer_dirty = 0;
+
+    return count;
+}
+
+static void arm_timer(void){
+
+    int i = 0;
+    uint64_t next_ns = 0;
+    struct itimerspec its;
+
+    for(i = 0; i < GPIO_MAX_NUMBER; i++){
+        if(pins[i].pending && (!next_ns || pins[i].deadline_ns < next_ns)){
+            next_ns = pins[i].deadline_ns;
+        }
+    }
+
+    /* A zero value disarms the timer */
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = next_ns / 1000000000ULL;
+    its.it_value.tv_nsec = next_ns % 1000000000ULL;
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static uint64_t now_ns(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
@@ -0,0 +1,150 @@
+/********************************************************************************************************//**
+* @file gpio_event.h
+*
+* @brief Header file containing the prototypes of the APIs for waiting for edges on several input gpios.
+*
+* The input gpios are registered in one epoll set, so a single thread can service several buttons. Every
+* wake up delivers a batch of events with the gpio number, its level and the CLOCK_MONOTONIC time of the
+* wake up. The edges are signaled by the selected backend of gpio_driver.h (sysfs value files, or the mock
+* backend on a host).
+*
+* Contact bounce can be filtered per gpio with gpio_event_set_debounce(), before the application is woken:
+*       - GPIO_DEBOUNCE_LOCKOUT: the first edge is delivered at once and the edges of the following window
+*         are dropped. Lowest latency, but a bounce after the window is seen as a new edge.
+*       - GPIO_DEBOUNCE_SETTLE: an edge is delivered when the level stays stable during the window
+*         (integrator). The latency is the window, but only real level changes are delivered.
+*
+* Public Functions:
+*       - int gpio_event_init(void)
+*       - void gpio_event_deinit(void)
+*       - int gpio_event_add(uint8_t gpio_no, char* edge)
+*       - int gpio_event_remove(uint8_t gpio_no)
+*       - int gpio_event_wait(struct gpio_event* events, int max_events, int timeout_ms)
+*       - int gpio_event_get_fd(void)
+*       - int gpio_event_set_debounce(uint8_t gpio_no, uint8_t mode, uint32_t window_us)
+*       - void gpio_event_get_stats(struct gpio_event_stats* stats)
+*       - uint32_t gpio_event_get_filtered(uint8_t gpio_no)
+*/
+
+#ifndef GPIO_EVENT_H
+#define GPIO_EVENT_H
+
+#include <stdint.h>
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Maximum number of events delivered by one call of gpio_event_wait() */
+#define GPIO_EVENT_MAX_BATCH    32
+
+/**
+ * @defgroup GPIO_DEBOUNCE Debounce modes of an input gpio.
+ * @{
+ */
+#define GPIO_DEBOUNCE_NONE      0   /**< @brief Every edge is delivered */
+#define GPIO_DEBOUNCE_LOCKOUT   1   /**< @brief Edges are dropped during a window after a delivered one */
+#define GPIO_DEBOUNCE_SETTLE    2   /**< @brief Edges are delivered when the level is stable a window */
+/** @} */
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Edge detected on an input gpio */
+struct gpio_event{
+    uint64_t t_ns;          /**< @brief CLOCK_MONOTONIC time of the wake up in ns (of the last edge with
+                                 GPIO_DEBOUNCE_SETTLE) */
+    uint8_t gpio_no;        /**< @brief Gpio number */
+    uint8_t level;          /**< @brief Level read after the edge (0 or 1) */
+};
+
+/** @brief Counters of the event engine */
+struct gpio_event_stats{
+    uint32_t wakeups;       /**< @brief Wake ups of the epoll set (edges or debounce timer) */
+    uint32_t edges;         /**< @brief Edges signaled by the backend */
+    uint32_t delivered;     /**< @brief Events delivered to the application */
+    uint32_t filtered;      /**< @brief Edges dropped by the debounce stage */
+};
+
+/***********************************************************************************************************/
+/*                                       APIs Supported                                                    */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for creating the epoll set of the event engine.
+ * @note It is called by gpio_event_add() if needed.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_event_init(void);
+
+/**
+ * @brief Function for releasing the epoll set, all gpios are removed.
+ * @return void.
+ */
+void gpio_event_deinit(void);
+
+/**
+ * @brief Function for configuring the edge of an input gpio and adding it to the epoll set.
+ * @note The gpio must be exported and configured as input. A pending edge is discarded.
+ * @param[in] gpio_no Is the gpio number.
+ * @param[in] edge Is the edge: "rising", "falling" or "both".
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_event_add(uint8_t gpio_no, char* edge);
+
+/**
+ * @brief Function for removing a gpio from the epoll set and disabling its edge detection.
+ * @param[in] gpio_no Is the gpio number.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_event_remove(uint8_t gpio_no);
+
+/**
+ * @brief Function for waiting for edges on the registered gpios.
+ * @param[out] events Is the array receiving the events.
+ * @param[in] max_events Is the size of the array (up to GPIO_EVENT_MAX_BATCH events are delivered).
+ * @param[in] timeout_ms Is the maximum time to wait, -1 waits forever and 0 returns immediately.
+ * @note It only returns when an event passed the debounce stage, the timeout expired or a signal arrived.
+ * @return the number of events (0 if the timeout expired or a signal was received).
+ * @return < 0 if fail.
+ */
+int gpio_event_wait(struct gpio_event* events, int max_events, int timeout_ms);
+
+/**
+ * @brief Function for getting the file descriptor of the epoll set, readable when edges are pending.
+ * @note Useful for adding the engine to another event loop, gpio_event_wait(..., 0) reads the events.
+ * @return the file descriptor, < 0 if the engine is not initialized.
+ */
+int gpio_event_get_fd(void);
+
+/**
+ * @brief Function for configuring the debounce stage of an input gpio.
+ * @note It can be called before or after gpio_event_add(). With GPIO_DEBOUNCE_SETTLE both edges are
+ *       enabled in the backend, only the edges requested in gpio_event_add() are delivered.
+ * @param[in] gpio_no Is the gpio number.
+ * @param[in] mode Is the debounce mode (see @ref GPIO_DEBOUNCE).
+ * @param[in] window_us Is the lockout or settle time in us.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_event_set_debounce(uint8_t gpio_no, uint8_t mode, uint32_t window_us);
+
+/**
+ * @brief Function for getting the counters of the event engine.
+ * @param[out] stats Is the statistics.
+ * @return void.
+ */
+void gpio_event_get_stats(struct gpio_event_stats* stats);
+
+/**
+ * @brief Function for getting the number of edges of a gpio dropped by the debounce stage.
+ * @param[in] gpio_no Is the gpio number.
+ * @return the number of filtered edges.
+ */
+uint32_t gpio_event_get_filtered(uint8_t gpio_no);
+
+#endif
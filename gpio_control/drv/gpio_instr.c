@@ -0,0 +1,252 @@
+/********************************************************************************************************//**
+* @file gpio_instr.c
+*
+* @brief Latency histograms of the gpio_driver calls, per operation and per gpio.
+*
+* Public Functions:
+*       - void gpio_instr_enable(uint8_t enable)
+*       - void gpio_instr_reset(void)
+*       - void gpio_instr_dump(FILE* out)
+*       - int gpio_instr_dump_file(const char* path)
+*       - void gpio_instr_record(uint8_t op, uint8_t gpio_no, uint64_t t_ns)
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include "gpio_driver.h"
+#include "gpio_instr.h"
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Latency histogram */
+struct histogram{
+    uint32_t buckets[GPIO_INSTR_BUCKETS];   /**< @brief Calls per log2 bucket */
+    uint32_t calls;                         /**< @brief Number of calls */
+    uint64_t total_ns;                      /**< @brief Sum of the durations */
+    uint64_t max_ns;                        /**< @brief Longest call */
+};
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+volatile uint8_t gpio_instr_enabled = 0;
+
+/** @brief Histogram of each operation */
+static struct histogram op_hist[GPIO_INSTR_NUM_OPS];
+
+/** @brief Histogram of each gpio (all operations) */
+static struct histogram pin_hist[GPIO_MAX_NUMBER];
+
+/** @brief Name of each operation */
+static const char* const op_names[GPIO_INSTR_NUM_OPS] = {
+    "export", "config_dir", "write", "read", "config_edge", "write_mask", "read_port", "write_banks"
+};
+
+/** @brief A dump was requested with SIGUSR1 */
+static volatile sig_atomic_t dump_requested = 0;
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for adding a duration to a histogram.
+ * @param[in] h Is the histogram.
+ * @param[in] t_ns Is the duration.
+ * @return void.
+ */
+static void hist_add(struct histogram* h, uint64_t t_ns);
+
+/**
+ * @brief Function for getting the upper bound of the bucket containing a percentile (or the max if lower).
+ * @param[in] h Is the histogram.
+ * @param[in] percent Is the percentile (0 to 100).
+ * @return the upper bound in ns.
+ */
+static uint64_t hist_percentile(const struct histogram* h, uint8_t percent);
+
+/**
+ * @brief Function for dumping to the file given in GPIO_INSTRUMENT, or to stderr.
+ * @return void.
+ */
+static void dump_default(void);
+
+/**
+ * @brief Signal handler for SIGUSR1, requesting a dump.
+ * @param[in] sig Is the signal number.
+ * @return void.
+ */
+static void sigusr1_handler(int sig);
+
+/***********************************************************************************************************/
+/*                                       Public API Definitions                                            */
+/***********************************************************************************************************/
+
+void gpio_instr_enable(uint8_t enable){
+
+    static uint8_t handlers_registered = 0;
+
+    if(enable && !handlers_registered){
+        signal(SIGUSR1, sigusr1_handler);
+        atexit(dump_default);
+        handlers_registered = 1;
+    }
+
+    gpio_instr_enabled = enable ? 1 : 0;
+}
+
+void gpio_instr_reset(void){
+
+    memset(op_hist, 0, sizeof(op_hist));
+    memset(pin_hist, 0, sizeof(pin_hist));
+}
+
+void gpio_instr_dump(FILE* out){
+
+    uint8_t op = 0;
+    uint8_t b = 0;
+    int i = 0;
+    uint32_t peak = 0;
+    struct histogram* h = NULL;
+
+    fprintf(out, "---------------- gpio latency histograms ----------------\n");
+    fprintf(out, "%-11s %10s %10s %10s %10s %10s %12s\n", "operation", "calls", "mean(ns)", "p50(ns)",
+            "p99(ns)", "max(ns)", "total(us)");
+    for(op = 0; op < GPIO_INSTR_NUM_OPS; op++){
+        h = &op_hist[op];
+        if(!h->calls){
+            continue;
+        }
+        fprintf(out, "%-11s %10u %10llu %10llu %10llu %10llu %12llu\n", op_names[op], h->calls,
+                (unsigned long long)(h->total_ns / h->calls),
+                (unsigned long long)hist_percentile(h, 50), (unsigned long long)hist_percentile(h, 99),
+                (unsigned long long)h->max_ns, (unsigned long long)(h->total_ns / 1000));
+    }
+
+    for(op = 0; op < GPIO_INSTR_NUM_OPS; op++){
+        h = &op_hist[op];
+        if(!h->calls){
+            continue;
+        }
+        peak = 0;
+        for(b = 0; b < GPIO_INSTR_BUCKETS; b++){
+            if(h->buckets[b] > peak){
+                peak = h->buckets[b];
+            }
+        }
+        fprintf(out, "%s:\n", op_names[op]);
+        for(b = 0; b < GPIO_INSTR_BUCKETS; b++){
+            if(h->buckets[b]){
+                fprintf(out, "  [%10llu, %10llu) ns %10u |%-40.*s|\n", b ? 1ULL << b : 0ULL,
+                        1ULL << (b + 1), h->buckets[b], (int)(40ULL * h->buckets[b] / peak),
+                        "****************************************");
+            }
+        }
+    }
+
+    fprintf(out, "%-11s %10s %10s %10s %10s %10s %12s\n", "gpio", "calls", "mean(ns)", "p50(ns)",
+            "p99(ns)", "max(ns)", "total(us)");
+    for(i = 0; i < GPIO_MAX_NUMBER; i++){
+        h = &pin_hist[i];
+        if(!h->calls){
+            continue;
+        }
+        fprintf(out, "%-11d %10u %10llu %10llu %10llu %10llu %12llu\n", i, h->calls,
+                (unsigned long long)(h->total_ns / h->calls),
+                (unsigned long long)hist_percentile(h, 50), (unsigned long long)hist_percentile(h, 99),
+                (unsigned long long)h->max_ns, (unsigned long long)(h->total_ns / 1000));
+    }
+}
+
+int gpio_instr_dump_file(const char* path){
+
+    FILE* f = fopen(path, "a");
+
+    if(!f){
+        perror("Error, file for the gpio histograms could not be opened");
+        return 1;
+    }
+
+    gpio_instr_dump(f);
+    fclose(f);
+
+    return 0;
+}
+
+void gpio_instr_record(uint8_t op, uint8_t gpio_no, uint64_t t_ns){
+
+    /* The dump requested by SIGUSR1 is done here, out of the signal handler */
+    if(dump_requested){
+        dump_requested = 0;
+        dump_default();
+    }
+
+    if(op >= GPIO_INSTR_NUM_OPS){
+        return;
+    }
+
+    hist_add(&op_hist[op], t_ns);
+    if(gpio_no < GPIO_MAX_NUMBER){
+        hist_add(&pin_hist[gpio_no], t_ns);
+    }
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static void hist_add(struct histogram* h, uint64_t t_ns){
+
+    uint8_t b = t_ns ? 63 - __builtin_clzll(t_ns) : 0;
+
+    if(b >= GPIO_INSTR_BUCKETS){
+        b = GPIO_INSTR_BUCKETS - 1;
+    }
+
+    h->buckets[b]++;
+    h->calls++;
+    h->total_ns += t_ns;
+    if(t_ns > h->max_ns){
+        h->max_ns = t_ns;
+    }
+}
+
+static uint64_t hist_percentile(const struct histogram* h, uint8_t percent){
+
+    uint8_t b = 0;
+    uint64_t count = 0;
+    uint64_t target = ((uint64_t)h->calls * percent + 99) / 100;
+
+    for(b = 0; b < GPIO_INSTR_BUCKETS; b++){
+        count += h->buckets[b];
+        if(count >= target){
+            break;
+        }
+    }
+
+    /* The bucket bound can not be above the longest call */
+    return ((1ULL << (b + 1)) - 1) < h->max_ns ? (1ULL << (b + 1)) - 1 : h->max_ns;
+}
+
+static void dump_default(void){
+
+    const char* path = getenv(GPIO_INSTR_ENV);
+
+    if(path && strcmp(path, "") && strcmp(path, "1") && !gpio_instr_dump_file(path)){
+        return;
+    }
+
+    gpio_instr_dump(stderr);
+}
+
+static void sigusr1_handler(int sig){
+
+    dump_requested = 1;
+}
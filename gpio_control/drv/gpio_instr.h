@@ -0,0 +1,143 @@
+/********************************************************************************************************//**
+* @file gpio_instr.h
+*
+* @brief Header file containing the prototypes of the APIs for measuring the latency of the gpio_driver calls.
+*
+* When enabled, every call of gpio_export(), gpio_config_dir(), gpio_write_value(), gpio_read_value(),
+* gpio_config_edge(), gpio_write_mask(), gpio_read_port() and gpio_write_banks() is timed and recorded in a
+* log2 histogram of its operation and of its gpio (port and bank operations are only recorded per operation).
+* Bucket N counts the calls which took between 2^N and 2^(N+1) - 1 ns. When disabled the cost is one test per
+* call.
+*
+* It is enabled at run time with gpio_instr_enable() or setting the GPIO_INSTRUMENT environment variable
+* before the first gpio call. If GPIO_INSTRUMENT is a path, the histograms are appended to that file,
+* otherwise they are printed to stderr. They are dumped at exit and every time SIGUSR1 is received (the dump
+* is done by the next gpio call, not by the signal handler):
+*       GPIO_INSTRUMENT=/tmp/gpio_hist.txt ./test_4dig7seg up 10 &
+*       kill -USR1 $!
+*
+* Public Functions:
+*       - void gpio_instr_enable(uint8_t enable)
+*       - void gpio_instr_reset(void)
+*       - void gpio_instr_dump(FILE* out)
+*       - int gpio_instr_dump_file(const char* path)
+*/
+
+#ifndef GPIO_INSTR_H
+#define GPIO_INSTR_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+#define GPIO_INSTR_ENV          "GPIO_INSTRUMENT"   /**< @brief Environment variable enabling it */
+#define GPIO_INSTR_BUCKETS      32                  /**< @brief Log2 buckets, up to 4 s */
+
+/**
+ * @defgroup GPIO_INSTR_OP Operations measured.
+ * @{
+ */
+#define GPIO_INSTR_EXPORT       0
+#define GPIO_INSTR_DIR          1
+#define GPIO_INSTR_WRITE        2
+#define GPIO_INSTR_READ         3
+#define GPIO_INSTR_EDGE         4
+#define GPIO_INSTR_WRITE_MASK   5
+#define GPIO_INSTR_READ_PORT    6
+#define GPIO_INSTR_WRITE_BANKS  7
+#define GPIO_INSTR_NUM_OPS      8
+/** @} */
+
+/** @brief Gpio number given for the calls which are not recorded per gpio */
+#define GPIO_INSTR_NO_PIN       0xFF
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief The instrumentation is enabled, read by the inline functions */
+extern volatile uint8_t gpio_instr_enabled;
+
+/***********************************************************************************************************/
+/*                                       APIs Supported                                                    */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for enabling or disabling the instrumentation.
+ * @note Enabling it installs the SIGUSR1 handler and registers the dump at exit.
+ * @param[in] enable Is 1 for enabling and 0 for disabling.
+ * @return void.
+ */
+void gpio_instr_enable(uint8_t enable);
+
+/**
+ * @brief Function for clearing the histograms.
+ * @return void.
+ */
+void gpio_instr_reset(void);
+
+/**
+ * @brief Function for printing the histograms of the operations and the summary of each gpio.
+ * @param[in] out Is the output stream.
+ * @return void.
+ */
+void gpio_instr_dump(FILE* out);
+
+/**
+ * @brief Function for appending the histograms to a file.
+ * @param[in] path Is the path of the file.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_instr_dump_file(const char* path);
+
+/**
+ * @brief Function for recording a call, used by gpio_instr_stop().
+ * @param[in] op Is the operation (see @ref GPIO_INSTR_OP).
+ * @param[in] gpio_no Is the gpio number, or GPIO_INSTR_NO_PIN.
+ * @param[in] t_ns Is the duration of the call.
+ * @return void.
+ */
+void gpio_instr_record(uint8_t op, uint8_t gpio_no, uint64_t t_ns);
+
+/**
+ * @brief Function for getting the start time of a call.
+ * @return the CLOCK_MONOTONIC time in ns, 0 if the instrumentation is disabled.
+ */
+static inline uint64_t gpio_instr_start(void){
+
+    struct timespec ts;
+
+    if(!gpio_instr_enabled){
+        return 0;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Function for recording the end of a call started with gpio_instr_start().
+ * @param[in] op Is the operation (see @ref GPIO_INSTR_OP).
+ * @param[in] gpio_no Is the gpio number, or GPIO_INSTR_NO_PIN.
+ * @param[in] t_start_ns Is the value returned by gpio_instr_start().
+ * @return void.
+ */
+static inline void gpio_instr_stop(uint8_t op, uint8_t gpio_no, uint64_t t_start_ns){
+
+    struct timespec ts;
+
+    if(!t_start_ns){
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    gpio_instr_record(op, gpio_no, (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec - t_start_ns);
+}
+
+#endif
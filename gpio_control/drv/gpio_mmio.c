@@ -0,0 +1,363 @@
+/********************************************************************************************************//**
+* @file gpio_mmio.c
+*
+* @brief Functions for controlling the gpio through the memory mapped registers of the AM335x gpio banks.
+*
+* It also implements gpio_mmio_backend. Export (and the wait for exported gpios), direction, edge
+* configuration and edge events are done through the sysfs backend, which sets the pin mux and enables the
+* bank clock, except for fake banks (GPIO_MMIO_EMULATE). The kernel gpio driver owns the OE register of the
+* banks and updates it without a lock shared with user space, so only the data registers (DATAIN,
+* SETDATAOUT and CLEARDATAOUT) are accessed directly.
+*
+* Public Functions:
+*       - int gpio_mmio_init(void)
+*       - int gpio_mmio_init_fd(int fd, const off_t* bank_offset, uint8_t flags)
+*       - void gpio_mmio_deinit(void)
+*       - void gpio_mmio_config_dir(uint8_t gpio_no, uint8_t dir_val)
+*       - void gpio_mmio_write(uint8_t gpio_no, uint8_t out_val)
+*       - int gpio_mmio_read(uint8_t gpio_no)
+*       - void gpio_mmio_write_bank(uint8_t bank, uint32_t mask, uint32_t values)
+*       - uint32_t gpio_mmio_read_bank(uint8_t bank)
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "gpio_driver.h"
+#include "gpio_mmio.h"
+#include "gpio_backend.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Access to a register of a mapped bank */
+#define GPIO_REG(bank, offset)  (*(volatile uint32_t*)((volatile uint8_t*)bank_regs[(bank)] + (offset)))
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Physical base address of each gpio bank */
+static const off_t bank_phys_addr[GPIO_MMIO_NUM_BANKS] = {
+    GPIO0_BASE_ADDR, GPIO1_BASE_ADDR, GPIO2_BASE_ADDR, GPIO3_BASE_ADDR
+};
+
+/** @brief Mapped registers of each gpio bank */
+static volatile void* bank_regs[GPIO_MMIO_NUM_BANKS] = {NULL};
+
+/** @brief Flags given at init time */
+static uint8_t mmio_flags = 0;
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/* Backend operations, see struct gpio_backend */
+static int mmio_init(void);
+static int mmio_export(uint8_t gpio_no);
+static int mmio_config_dir(uint8_t gpio_no, uint8_t dir_val);
+static int mmio_write(uint8_t gpio_no, uint8_t out_val);
+static int mmio_read(uint8_t gpio_no);
+static int mmio_config_edge(uint8_t gpio_no, const char* edge);
+static int mmio_write_batch(const uint8_t* pins, uint8_t npins, uint32_t mask, uint32_t values);
+static int mmio_read_batch(const uint8_t* pins, uint8_t npins, uint32_t* values);
+static int mmio_write_bank(uint8_t bank, uint32_t mask, uint32_t values);
+static int mmio_event_fd(uint8_t gpio_no, uint32_t* events);
+static int mmio_event_read(uint8_t gpio_no);
+static int mmio_wait_ready(const uint8_t* gpios, uint8_t n);
+
+/***********************************************************************************************************/
+/*                                       Backend Definition                                                */
+/***********************************************************************************************************/
+
+const struct gpio_backend gpio_mmio_backend = {
+    .name = "mmio",
+    .init = mmio_init,
+    .deinit = gpio_mmio_deinit,
+    .export = mmio_export,
+    .config_dir = mmio_config_dir,
+    .write = mmio_write,
+    .read = mmio_read,
+    .config_edge = mmio_config_edge,
+    .write_batch = mmio_write_batch,
+    .read_batch = mmio_read_batch,
+    .write_bank = mmio_write_bank,
+    .event_fd = mmio_event_fd,
+    .event_read = mmio_event_read,
+    .wait_ready = mmio_wait_ready,
+};
+
+/***********************************************************************************************************/
+/*                                       Public API Definitions                                            */
+/***********************************************************************************************************/
+
+int gpio_mmio_init(void){
+
+    int fd = 0;
+    int ret = 0;
+
+    fd = open(GPIO_MMIO_DEV_PATH, O_RDWR | O_SYNC);
+    if(fd < 0){
+        perror("Error, file for mapping gpio registers could not be opened");
+        return 1;
+    }
+
+    ret = gpio_mmio_init_fd(fd, bank_phys_addr, 0);
+
+    close(fd);
+
+    return ret;
+}
+
+int gpio_mmio_init_fd(int fd, const off_t* bank_offset, uint8_t flags){
+
+    uint8_t bank = 0;
+    off_t offset = 0;
+    void* regs = NULL;
+
+    for(bank = 0; bank < GPIO_MMIO_NUM_BANKS; bank++){
+        offset = bank_offset ? bank_offset[bank] : (off_t)bank * GPIO_MMIO_BANK_SIZE;
+        regs = mmap(NULL, GPIO_MMIO_BANK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+        if(regs == MAP_FAILED){
+            perror("Error, gpio bank registers could not be mapped");
+            gpio_mmio_deinit();
+            return 1;
+        }
+        bank_regs[bank] = regs;
+    }
+
+    mmio_flags = flags;
+
+    return 0;
+}
+
+void gpio_mmio_deinit(void){
+
+    uint8_t bank = 0;
+
+    for(bank = 0; bank < GPIO_MMIO_NUM_BANKS; bank++){
+        if(bank_regs[bank]){
+            munmap((void*)bank_regs[bank], GPIO_MMIO_BANK_SIZE);
+            bank_regs[bank] = NULL;
+        }
+    }
+}
+
+void gpio_mmio_config_dir(uint8_t gpio_no, uint8_t dir_val){
+
+    uint8_t bank = gpio_no / GPIO_MMIO_BANK_LINES;
+    uint32_t bit = 1UL << (gpio_no % GPIO_MMIO_BANK_LINES);
+
+    /* A 0 in OE enables the output driver */
+    if(dir_val){
+        GPIO_REG(bank, GPIO_OE_OFFSET) &= ~bit;
+    }
+    else{
+        GPIO_REG(bank, GPIO_OE_OFFSET) |= bit;
+    }
+}
+
+void gpio_mmio_write(uint8_t gpio_no, uint8_t out_val){
+
+    uint32_t bit = 1UL << (gpio_no % GPIO_MMIO_BANK_LINES);
+
+    gpio_mmio_write_bank(gpio_no / GPIO_MMIO_BANK_LINES, bit, out_val ? bit : 0);
+}
+
+int gpio_mmio_read(uint8_t gpio_no){
+
+    return (gpio_mmio_read_bank(gpio_no / GPIO_MMIO_BANK_LINES) >> (gpio_no % GPIO_MMIO_BANK_LINES)) & 1;
+}
+
+void gpio_mmio_write_bank(uint8_t bank, uint32_t mask, uint32_t values){
+
+    uint32_t set = mask & values;
+    uint32_t clear = mask & ~values;
+
+    if(set){
+        GPIO_REG(bank, GPIO_SETDATAOUT_OFFSET) = set;
+    }
+    if(clear){
+        GPIO_REG(bank, GPIO_CLEARDATAOUT_OFFSET) = clear;
+    }
+
+    /* A fake bank is plain memory, do what the hardware does with SETDATAOUT/CLEARDATAOUT */
+    if(mmio_flags & GPIO_MMIO_EMULATE){
+        GPIO_REG(bank, GPIO_DATAOUT_OFFSET) = (GPIO_REG(bank, GPIO_DATAOUT_OFFSET) | set) & ~clear;
+        GPIO_REG(bank, GPIO_DATAIN_OFFSET) = GPIO_REG(bank, GPIO_DATAOUT_OFFSET);
+    }
+}
+
+uint32_t gpio_mmio_read_bank(uint8_t bank){
+
+    return GPIO_REG(bank, GPIO_DATAIN_OFFSET);
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static int mmio_init(void){
+
+    /* Banks can be injected with gpio_mmio_init_fd() before selecting the backend */
+    if(bank_regs[0]){
+        return 0;
+    }
+
+    return gpio_mmio_init();
+}
+
+static int mmio_export(uint8_t gpio_no){
+
+    if(mmio_flags & GPIO_MMIO_EMULATE){
+        return 0;
+    }
+
+    return gpio_sysfs_backend.export(gpio_no);
+}
+
+static int mmio_config_dir(uint8_t gpio_no, uint8_t dir_val){
+
+    if(gpio_no >= GPIO_MAX_NUMBER){
+        return 1;
+    }
+
+    /* Through the kernel, which keeps OE and /sys/class/gpio/gpioN/direction consistent */
+    if(!(mmio_flags & GPIO_MMIO_EMULATE)){
+        return gpio_sysfs_backend.config_dir(gpio_no, dir_val);
+    }
+
+    gpio_mmio_config_dir(gpio_no, dir_val);
+
+    return 0;
+}
+
+static int mmio_write(uint8_t gpio_no, uint8_t out_val){
+
+    if(gpio_no >= GPIO_MAX_NUMBER){
+        return 1;
+    }
+
+    gpio_mmio_write(gpio_no, out_val);
+
+    return 0;
+}
+
+static int mmio_read(uint8_t gpio_no){
+
+    if(gpio_no >= GPIO_MAX_NUMBER){
+        return -1;
+    }
+
+    return gpio_mmio_read(gpio_no);
+}
+
+static int mmio_config_edge(uint8_t gpio_no, const char* edge){
+
+    if(mmio_flags & GPIO_MMIO_EMULATE){
+        return 0;
+    }
+
+    return gpio_sysfs_backend.config_edge(gpio_no, edge);
+}
+
+static int mmio_write_batch(const uint8_t* pins, uint8_t npins, uint32_t mask, uint32_t values){
+
+    uint8_t i = 0;
+    uint8_t bank = 0;
+    uint32_t bit = 0;
+    uint32_t bank_mask[GPIO_MMIO_NUM_BANKS] = {0};
+    uint32_t bank_values[GPIO_MMIO_NUM_BANKS] = {0};
+
+    for(i = 0; i < npins; i++){
+        if(!(mask & (1UL << i))){
+            continue;
+        }
+        if(pins[i] >= GPIO_MAX_NUMBER){
+            return 1;
+        }
+        bank = pins[i] / GPIO_MMIO_BANK_LINES;
+        bit = 1UL << (pins[i] % GPIO_MMIO_BANK_LINES);
+        bank_mask[bank] |= bit;
+        if(values & (1UL << i)){
+            bank_values[bank] |= bit;
+        }
+    }
+
+    for(bank = 0; bank < GPIO_MMIO_NUM_BANKS; bank++){
+        if(bank_mask[bank]){
+            gpio_mmio_write_bank(bank, bank_mask[bank], bank_values[bank]);
+        }
+    }
+
+    return 0;
+}
+
+static int mmio_read_batch(const uint8_t* pins, uint8_t npins, uint32_t* values){
+
+    uint8_t i = 0;
+    uint8_t bank = 0;
+    uint8_t sampled = 0;
+    uint32_t datain[GPIO_MMIO_NUM_BANKS] = {0};
+
+    *values = 0;
+    for(i = 0; i < npins; i++){
+        if(pins[i] >= GPIO_MAX_NUMBER){
+            return 1;
+        }
+        bank = pins[i] / GPIO_MMIO_BANK_LINES;
+
+        /* One DATAIN read per bank touched */
+        if(!(sampled & (1 << bank))){
+            datain[bank] = gpio_mmio_read_bank(bank);
+            sampled |= 1 << bank;
+        }
+        if(datain[bank] & (1UL << (pins[i] % GPIO_MMIO_BANK_LINES))){
+            *values |= 1UL << i;
+        }
+    }
+
+    return 0;
+}
+
+static int mmio_write_bank(uint8_t bank, uint32_t mask, uint32_t values){
+
+    if(bank >= GPIO_MMIO_NUM_BANKS){
+        return 1;
+    }
+
+    gpio_mmio_write_bank(bank, mask, values);
+
+    return 0;
+}
+
+static int mmio_event_fd(uint8_t gpio_no, uint32_t* events){
+
+    /* The edges are delivered by the kernel gpio driver, fake banks have none */
+    if(mmio_flags & GPIO_MMIO_EMULATE){
+        return -1;
+    }
+
+    return gpio_sysfs_backend.event_fd(gpio_no, events);
+}
+
+static int mmio_event_read(uint8_t gpio_no){
+
+    if(mmio_flags & GPIO_MMIO_EMULATE){
+        return -1;
+    }
+
+    return gpio_sysfs_backend.event_read(gpio_no);
+}
+
+static int mmio_wait_ready(const uint8_t* gpios, uint8_t n){
+
+    if(mmio_flags & GPIO_MMIO_EMULATE){
+        return 0;
+    }
+
+    return gpio_sysfs_backend.wait_ready(gpios, n);
+}
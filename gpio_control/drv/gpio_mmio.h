@@ -0,0 +1,136 @@
+/********************************************************************************************************//**
+* @file gpio_mmio.h
+*
+* @brief Header file containing the prototypes of the APIs for controlling the gpio through the memory
+*        mapped registers of the AM335x gpio banks.
+*
+* Gpios are identified using the sysfs numbering (bank * 32 + line). The pins must be muxed as gpio and the
+* bank clock must be enabled, exporting the gpio through sysfs (gpio_export()) before is enough for that.
+*
+* Public Functions:
+*       - int gpio_mmio_init(void)
+*       - int gpio_mmio_init_fd(int fd, const off_t* bank_offset, uint8_t flags)
+*       - void gpio_mmio_deinit(void)
+*       - void gpio_mmio_config_dir(uint8_t gpio_no, uint8_t dir_val)
+*       - void gpio_mmio_write(uint8_t gpio_no, uint8_t out_val)
+*       - int gpio_mmio_read(uint8_t gpio_no)
+*       - void gpio_mmio_write_bank(uint8_t bank, uint32_t mask, uint32_t values)
+*       - uint32_t gpio_mmio_read_bank(uint8_t bank)
+*/
+
+#ifndef GPIO_MMIO_H
+#define GPIO_MMIO_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+#define GPIO_MMIO_DEV_PATH      "/dev/mem"
+
+#define GPIO_MMIO_NUM_BANKS     4       /**< @brief Number of gpio banks of the AM335x */
+#define GPIO_MMIO_BANK_LINES    32      /**< @brief Number of lines of each gpio bank */
+#define GPIO_MMIO_BANK_SIZE     0x1000  /**< @brief Size of the register space of each gpio bank */
+
+/**
+ * @defgroup GPIO_BANK_ADDR Physical base addresses of the AM335x gpio banks.
+ * @{
+ */
+#define GPIO0_BASE_ADDR         0x44E07000
+#define GPIO1_BASE_ADDR         0x4804C000
+#define GPIO2_BASE_ADDR         0x481AC000
+#define GPIO3_BASE_ADDR         0x481AE000
+/** @} */
+
+/**
+ * @defgroup GPIO_REG_OFFSET Offsets of the gpio bank registers.
+ * @{
+ */
+#define GPIO_OE_OFFSET              0x134   /**< @brief Output enable, 0 is output and 1 is input */
+#define GPIO_DATAIN_OFFSET          0x138   /**< @brief Sampled input data */
+#define GPIO_DATAOUT_OFFSET         0x13C   /**< @brief Output data */
+#define GPIO_CLEARDATAOUT_OFFSET    0x190   /**< @brief Writing 1 clears the bit in DATAOUT */
+#define GPIO_SETDATAOUT_OFFSET      0x194   /**< @brief Writing 1 sets the bit in DATAOUT */
+/** @} */
+
+/**
+ * @defgroup GPIO_MMIO_FLAGS Flags for gpio_mmio_init_fd().
+ * @{
+ */
+#define GPIO_MMIO_EMULATE       (1 << 0)    /**< @brief Emulate DATAOUT/DATAIN updates for a fake bank */
+/** @} */
+
+/***********************************************************************************************************/
+/*                                       APIs Supported                                                    */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for mapping the registers of all gpio banks through /dev/mem.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_mmio_init(void);
+
+/**
+ * @brief Function for mapping the registers of all gpio banks from a given file.
+ * @note Used for injecting a fake register file (e.g. a memfd of GPIO_MMIO_NUM_BANKS * GPIO_MMIO_BANK_SIZE
+ *       bytes) so the backend runs on a host machine.
+ * @param[in] fd Is the file containing the registers, it can be closed after the call.
+ * @param[in] bank_offset Is the offset of each bank in the file, NULL for consecutive banks from 0.
+ * @param[in] flags Is a combination of @ref GPIO_MMIO_FLAGS.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_mmio_init_fd(int fd, const off_t* bank_offset, uint8_t flags);
+
+/**
+ * @brief Function for unmapping the registers of the gpio banks.
+ * @return void.
+ */
+void gpio_mmio_deinit(void);
+
+/**
+ * @brief Function for setting the direction of a gpio number.
+ * @note Read-modify-write of the OE register, not synchronized with the kernel gpio driver: only for banks
+ *       not used by the kernel (e.g. fake banks), gpio_mmio_backend sets the direction through sysfs.
+ * @param[in] gpio_no Is the gpio number for configuring.
+ * @param[in] dir_val Is the direction (1 is output and 0 is input).
+ * @return void.
+ */
+void gpio_mmio_config_dir(uint8_t gpio_no, uint8_t dir_val);
+
+/**
+ * @brief Function for setting an output value to a gpio number.
+ * @param[in] gpio_no Is the gpio number.
+ * @param[in] out_val Is the value to be set as output.
+ * @return void.
+ */
+void gpio_mmio_write(uint8_t gpio_no, uint8_t out_val);
+
+/**
+ * @brief Function for reading the input value of a gpio number.
+ * @param[in] gpio_no Is the gpio number.
+ * @return the value (0 or 1).
+ */
+int gpio_mmio_read(uint8_t gpio_no);
+
+/**
+ * @brief Function for setting several outputs of a bank at once.
+ * @note It costs one SETDATAOUT and one CLEARDATAOUT write, no read-modify-write is needed.
+ * @param[in] bank Is the bank number.
+ * @param[in] mask Is the bitmask of lines to be modified.
+ * @param[in] values Is the bitmask of values.
+ * @return void.
+ */
+void gpio_mmio_write_bank(uint8_t bank, uint32_t mask, uint32_t values);
+
+/**
+ * @brief Function for reading all the inputs of a bank.
+ * @param[in] bank Is the bank number.
+ * @return the DATAIN register.
+ */
+uint32_t gpio_mmio_read_bank(uint8_t bank);
+
+#endif
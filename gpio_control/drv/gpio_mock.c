@@ -0,0 +1,491 @@
+/********************************************************************************************************//**
+* @file gpio_mock.c
+*
+* @brief Mock gpio backend keeping the gpios in memory and recording every output transition.
+*
+* Public Functions:
+*       - void gpio_mock_reset(void)
+*       - uint32_t gpio_mock_get_events(const struct gpio_mock_event** events)
+*       - void gpio_mock_get_stats(struct gpio_mock_stats* stats)
+*       - int gpio_mock_get_value(uint8_t gpio_no)
+*       - void gpio_mock_set_input(uint8_t gpio_no, uint8_t value)
+*       - void gpio_mock_set_observer(void (*observer)(const struct gpio_mock_event* event, void* ctx),
+*                                     void* ctx)
+*       - void gpio_mock_report(FILE* out)
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "gpio_driver.h"
+#include "gpio_backend.h"
+#include "gpio_mock.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+#define EDGE_RISING         (1 << 0)    /**< @brief Edge detection of low to high changes */
+#define EDGE_FALLING        (1 << 1)    /**< @brief Edge detection of high to low changes */
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief State of a mock gpio */
+struct mock_pin{
+    uint8_t exported;       /**< @brief The gpio was exported */
+    uint8_t dir;            /**< @brief Direction */
+    uint8_t value;          /**< @brief Current level */
+    uint8_t known;          /**< @brief The level was written at least once */
+    uint32_t transitions;   /**< @brief Number of output transitions */
+    uint8_t edge;           /**< @brief Edges signaled (EDGE_RISING and/or EDGE_FALLING) */
+    uint8_t has_efd;        /**< @brief The event file descriptor was created */
+    int efd;                /**< @brief eventfd signaling the edges of an input */
+};
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief State of each mock gpio */
+static struct mock_pin pins[GPIO_MAX_NUMBER];
+
+/** @brief Recorded transitions */
+static struct gpio_mock_event events[GPIO_MOCK_MAX_EVENTS];
+
+/** @brief Number of recorded transitions */
+static uint32_t nevents = 0;
+
+/** @brief Number of operations */
+static struct gpio_mock_stats stats;
+
+/** @brief Time when the backend was selected or reset */
+static uint64_t t_start_ns = 0;
+
+/** @brief Function called on every output transition, NULL if none */
+static void (*observer_fn)(const struct gpio_mock_event* event, void* ctx) = NULL;
+
+/** @brief Context of the observer */
+static void* observer_ctx = NULL;
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for getting the monotonic time in ns.
+ * @return the current time.
+ */
+static uint64_t now_ns(void);
+
+/**
+ * @brief Function for checking that a gpio can be written, as the sysfs backend would reject it otherwise.
+ * @param[in] gpio_no Is the gpio number.
+ * @return 1 if it is an exported output, 0 otherwise.
+ */
+static int is_output(uint8_t gpio_no);
+
+/**
+ * @brief Function for setting an output value and recording the transition.
+ * @param[in] gpio_no Is the gpio number.
+ * @param[in] out_val Is the value.
+ * @param[in] t_ns Is the timestamp of the transition.
+ * @return void.
+ */
+static void set_output(uint8_t gpio_no, uint8_t out_val, uint64_t t_ns);
+
+/**
+ * @brief Function printing the report at exit, registered when GPIO_MOCK_REPORT is set.
+ * @return void.
+ */
+static void report_at_exit(void);
+
+/* Backend operations, see struct gpio_backend */
+static int mock_init(void);
+static int mock_export(uint8_t gpio_no);
+static int mock_config_dir(uint8_t gpio_no, uint8_t dir_val);
+static int mock_write(uint8_t gpio_no, uint8_t out_val);
+static int mock_read(uint8_t gpio_no);
+static int mock_config_edge(uint8_t gpio_no, const char* edge);
+static int mock_write_batch(const uint8_t* gpios, uint8_t npins, uint32_t mask, uint32_t values);
+static int mock_read_batch(const uint8_t* gpios, uint8_t npins, uint32_t* values);
+static int mock_write_bank(uint8_t bank, uint32_t mask, uint32_t values);
+static int mock_event_fd(uint8_t gpio_no, uint32_t* events);
+static int mock_event_read(uint8_t gpio_no);
+
+/***********************************************************************************************************/
+/*                                       Backend Definition                                                */
+/***********************************************************************************************************/
+
+const struct gpio_backend gpio_mock_backend = {
+    .name = "mock",
+    .init = mock_init,
+    .export = mock_export,
+    .config_dir = mock_config_dir,
+    .write = mock_write,
+    .read = mock_read,
+    .config_edge = mock_config_edge,
+    .write_batch = mock_write_batch,
+    .read_batch = mock_read_batch,
+    .write_bank = mock_write_bank,
+    .event_fd = mock_event_fd,
+    .event_read = mock_event_read,
+};
+
+/***********************************************************************************************************/
+/*                                       Public API Definitions                                            */
+/***********************************************************************************************************/
+
+void gpio_mock_reset(void){
+
+    uint8_t i = 0;
+
+    for(i = 0; i < GPIO_MAX_NUMBER; i++){
+        pins[i].transitions = 0;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    nevents = 0;
+    t_start_ns = now_ns();
+}
+
+uint32_t gpio_mock_get_events(const struct gpio_mock_event** ev){
+
+    *ev = events;
+
+    return nevents;
+}
+
+void gpio_mock_get_stats(struct gpio_mock_stats* st){
+
+    *st = stats;
+}
+
+int gpio_mock_get_value(uint8_t gpio_no){
+
+    if(gpio_no >= GPIO_MAX_NUMBER){
+        return -1;
+    }
+
+    return pins[gpio_no].value;
+}
+
+void gpio_mock_set_input(uint8_t gpio_no, uint8_t value){
+
+    struct mock_pin* pin = NULL;
+    uint64_t one = 1;
+
+    if(gpio_no >= GPIO_MAX_NUMBER){
+        return;
+    }
+
+    pin = &pins[gpio_no];
+    value = value ? 1 : 0;
+
+    /* Same lock as the backend calls of the driver, e.g. a port read sees all the levels set before it */
+    gpio_backend_lock();
+    if(pin->value != value){
+        /* The level is updated before signaling, so the woken thread reads the new one */
+        pin->value = value;
+        if(pin->has_efd && (pin->edge & (value ? EDGE_RISING : EDGE_FALLING))){
+            write(pin->efd, &one, sizeof(one));
+        }
+    }
+    gpio_backend_unlock();
+}
+
+void gpio_mock_set_observer(void (*observer)(const struct gpio_mock_event* event, void* ctx), void* ctx){
+
+    observer_ctx = ctx;
+    observer_fn = observer;
+}
+
+void gpio_mock_report(FILE* out){
+
+    uint8_t i = 0;
+    double elapsed_s = (now_ns() - t_start_ns) / 1e9;
+    struct gpio_write_stats wstats;
+
+    gpio_get_write_stats(&wstats);
+
+    fprintf(out, "---------------- gpio mock report ----------------\n");
+    fprintf(out, "elapsed time          : %.3f s\n", elapsed_s);
+    fprintf(out, "exports               : %u\n", stats.exports);
+    fprintf(out, "direction configs     : %u\n", stats.dir_configs);
+    fprintf(out, "edge configs          : %u\n", stats.edge_configs);
+    fprintf(out, "single writes         : %u\n", stats.writes);
+    fprintf(out, "batched writes        : %u\n", stats.batches);
+    fprintf(out, "reads                 : %u\n", stats.reads);
+    fprintf(out, "transitions           : %u (%.0f/s)\n", stats.transitions,
+            elapsed_s > 0 ? stats.transitions / elapsed_s : 0.0);
+    fprintf(out, "transitions dropped   : %u\n", stats.dropped);
+    fprintf(out, "driver writes issued  : %u\n", wstats.issued);
+    fprintf(out, "driver writes elided  : %u\n", wstats.elided);
+    fprintf(out, "gpio  transitions  rate(/s)\n");
+    for(i = 0; i < GPIO_MAX_NUMBER; i++){
+        if(pins[i].transitions){
+            fprintf(out, "%4d  %11u  %8.0f\n", i, pins[i].transitions,
+                    elapsed_s > 0 ? pins[i].transitions / elapsed_s : 0.0);
+        }
+    }
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static uint64_t now_ns(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int is_output(uint8_t gpio_no){
+
+    return gpio_no < GPIO_MAX_NUMBER && pins[gpio_no].exported && pins[gpio_no].dir == GPIO_DIR_OUT;
+}
+
+static void set_output(uint8_t gpio_no, uint8_t out_val, uint64_t t_ns){
+
+    struct mock_pin* pin = &pins[gpio_no];
+    struct gpio_mock_event event;
+
+    out_val = out_val ? 1 : 0;
+
+    if(pin->known && pin->value == out_val){
+        return;
+    }
+
+    pin->value = out_val;
+    pin->known = 1;
+    pin->transitions++;
+    stats.transitions++;
+
+    if(nevents < GPIO_MOCK_MAX_EVENTS){
+        events[nevents].t_ns = t_ns;
+        events[nevents].gpio_no = gpio_no;
+        events[nevents].value = out_val;
+        nevents++;
+    }
+    else{
+        stats.dropped++;
+    }
+
+    if(observer_fn){
+        event.t_ns = t_ns;
+        event.gpio_no = gpio_no;
+        event.value = out_val;
+        observer_fn(&event, observer_ctx);
+    }
+}
+
+static void report_at_exit(void){
+
+    gpio_mock_report(stderr);
+}
+
+static int mock_init(void){
+
+    static uint8_t report_registered = 0;
+    uint8_t i = 0;
+
+    for(i = 0; i < GPIO_MAX_NUMBER; i++){
+        if(pins[i].has_efd){
+            close(pins[i].efd);
+        }
+    }
+    memset(pins, 0, sizeof(pins));
+    gpio_mock_reset();
+
+    /* SIGINT is left to the application, the report is printed when it returns from main() or exits */
+    if(getenv(GPIO_MOCK_REPORT_ENV) && !report_registered){
+        atexit(report_at_exit);
+        report_registered = 1;
+    }
+
+    return 0;
+}
+
+static int mock_export(uint8_t gpio_no){
+
+    if(gpio_no >= GPIO_MAX_NUMBER){
+        return 1;
+    }
+
+    stats.exports++;
+    pins[gpio_no].exported = 1;
+
+    return 0;
+}
+
+static int mock_config_dir(uint8_t gpio_no, uint8_t dir_val){
+
+    if(gpio_no >= GPIO_MAX_NUMBER || !pins[gpio_no].exported){
+        return 1;
+    }
+
+    stats.dir_configs++;
+    pins[gpio_no].dir = dir_val;
+
+    return 0;
+}
+
+static int mock_write(uint8_t gpio_no, uint8_t out_val){
+
+    if(!is_output(gpio_no)){
+        return 1;
+    }
+
+    stats.writes++;
+    set_output(gpio_no, out_val, now_ns());
+
+    return 0;
+}
+
+static int mock_read(uint8_t gpio_no){
+
+    if(gpio_no >= GPIO_MAX_NUMBER || !pins[gpio_no].exported){
+        return -1;
+    }
+
+    stats.reads++;
+
+    return pins[gpio_no].value;
+}
+
+static int mock_config_edge(uint8_t gpio_no, const char* edge){
+
+    if(gpio_no >= GPIO_MAX_NUMBER || !pins[gpio_no].exported){
+        return 1;
+    }
+
+    stats.edge_configs++;
+
+    if(!strcmp(edge, "rising")){
+        pins[gpio_no].edge = EDGE_RISING;
+    }
+    else if(!strcmp(edge, "falling")){
+        pins[gpio_no].edge = EDGE_FALLING;
+    }
+    else if(!strcmp(edge, "both")){
+        pins[gpio_no].edge = EDGE_RISING | EDGE_FALLING;
+    }
+    else{
+        pins[gpio_no].edge = 0;
+    }
+
+    return 0;
+}
+
+static int mock_write_batch(const uint8_t* gpios, uint8_t npins, uint32_t mask, uint32_t values){
+
+    uint8_t i = 0;
+    uint64_t t_ns = now_ns();
+
+    for(i = 0; i < npins; i++){
+        if((mask & (1UL << i)) && !is_output(gpios[i])){
+            return 1;
+        }
+    }
+
+    stats.batches++;
+
+    /* All the pins of a batch change at the same time */
+    for(i = 0; i < npins; i++){
+        if(mask & (1UL << i)){
+            set_output(gpios[i], (values >> i) & 1, t_ns);
+        }
+    }
+
+    return 0;
+}
+
+static int mock_read_batch(const uint8_t* gpios, uint8_t npins, uint32_t* values){
+
+    uint8_t i = 0;
+
+    *values = 0;
+    for(i = 0; i < npins; i++){
+        if(gpios[i] >= GPIO_MAX_NUMBER || !pins[gpios[i]].exported){
+            return 1;
+        }
+        if(pins[gpios[i]].value){
+            *values |= 1UL << i;
+        }
+    }
+
+    stats.reads++;
+
+    return 0;
+}
+
+static int mock_write_bank(uint8_t bank, uint32_t mask, uint32_t values){
+
+    uint32_t m = 0;
+    uint8_t base = bank * GPIO_BANK_LINES;
+    uint64_t t_ns = now_ns();
+
+    if(bank >= GPIO_NUM_BANKS){
+        return 1;
+    }
+    for(m = mask; m; m &= m - 1){
+        if(!is_output(base + __builtin_ctz(m))){
+            return 1;
+        }
+    }
+
+    stats.batches++;
+
+    /* All the gpios of a bank change at the same time */
+    for(m = mask; m; m &= m - 1){
+        set_output(base + __builtin_ctz(m), (values >> __builtin_ctz(m)) & 1, t_ns);
+    }
+
+    return 0;
+}
+
+static int mock_event_fd(uint8_t gpio_no, uint32_t* events){
+
+    struct mock_pin* pin = NULL;
+
+    if(gpio_no >= GPIO_MAX_NUMBER || !pins[gpio_no].exported){
+        return -1;
+    }
+
+    pin = &pins[gpio_no];
+    if(!pin->has_efd){
+        pin->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(pin->efd < 0){
+            return -1;
+        }
+        pin->has_efd = 1;
+    }
+
+    *events = EPOLLIN;
+
+    return pin->efd;
+}
+
+static int mock_event_read(uint8_t gpio_no){
+
+    uint64_t count = 0;
+
+    if(gpio_no >= GPIO_MAX_NUMBER || !pins[gpio_no].has_efd){
+        return -1;
+    }
+
+    /* Several edges signaled before the read are merged, like in the sysfs value file */
+    read(pins[gpio_no].efd, &count, sizeof(count));
+    stats.reads++;
+
+    return pins[gpio_no].value;
+}
@@ -0,0 +1,120 @@
+/********************************************************************************************************//**
+* @file gpio_mock.h
+*
+* @brief Header file containing the prototypes of the APIs for inspecting the mock gpio backend.
+*
+* The mock backend ("mock") keeps the gpios in memory and records every output transition with a monotonic
+* timestamp, so the applications can be run and profiled on a host machine. If the GPIO_MOCK_REPORT
+* environment variable is set, a report is printed to stderr when the application exits; applications
+* stopping on Ctrl+C (e.g. counter_4dig7seg.c, gpio_server.c) print it then. As with sysfs, writes to gpios
+* not exported or not configured as outputs fail.
+* Input levels are set with gpio_mock_set_input(), which also signals the edges configured with
+* gpio_config_edge() to the event engine (gpio_event.h). A model of the hardware wired to the outputs (e.g. a
+* shift register) is fed with every transition through gpio_mock_set_observer().
+*
+* Public Functions:
+*       - void gpio_mock_reset(void)
+*       - uint32_t gpio_mock_get_events(const struct gpio_mock_event** events)
+*       - void gpio_mock_get_stats(struct gpio_mock_stats* stats)
+*       - int gpio_mock_get_value(uint8_t gpio_no)
+*       - void gpio_mock_set_input(uint8_t gpio_no, uint8_t value)
+*       - void gpio_mock_set_observer(void (*observer)(const struct gpio_mock_event* event, void* ctx),
+*                                     void* ctx)
+*       - void gpio_mock_report(FILE* out)
+*/
+
+#ifndef GPIO_MOCK_H
+#define GPIO_MOCK_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+#define GPIO_MOCK_MAX_EVENTS    (1 << 18)           /**< @brief Transitions recorded before dropping */
+#define GPIO_MOCK_REPORT_ENV    "GPIO_MOCK_REPORT"  /**< @brief Environment variable enabling the report */
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Output transition recorded by the mock backend */
+struct gpio_mock_event{
+    uint64_t t_ns;          /**< @brief CLOCK_MONOTONIC timestamp in ns */
+    uint8_t gpio_no;        /**< @brief Gpio number */
+    uint8_t value;          /**< @brief New value */
+};
+
+/** @brief Number of backend operations handled by the mock backend */
+struct gpio_mock_stats{
+    uint32_t exports;       /**< @brief Export operations */
+    uint32_t dir_configs;   /**< @brief Direction configurations */
+    uint32_t edge_configs;  /**< @brief Edge configurations */
+    uint32_t writes;        /**< @brief Single gpio writes */
+    uint32_t batches;       /**< @brief Batched writes (several gpios in one operation) */
+    uint32_t reads;         /**< @brief Reads (a port read counts once) */
+    uint32_t transitions;   /**< @brief Output value changes */
+    uint32_t dropped;       /**< @brief Transitions not recorded because the event buffer was full */
+};
+
+/***********************************************************************************************************/
+/*                                       APIs Supported                                                    */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for clearing the recorded events and statistics (gpio values are kept).
+ * @return void.
+ */
+void gpio_mock_reset(void);
+
+/**
+ * @brief Function for getting the recorded transitions.
+ * @param[out] events Is set to the first recorded event.
+ * @return the number of recorded events.
+ */
+uint32_t gpio_mock_get_events(const struct gpio_mock_event** events);
+
+/**
+ * @brief Function for getting the number of operations handled by the mock.
+ * @param[out] stats Is the statistics.
+ * @return void.
+ */
+void gpio_mock_get_stats(struct gpio_mock_stats* stats);
+
+/**
+ * @brief Function for getting the current value of a mock gpio.
+ * @param[in] gpio_no Is the gpio number.
+ * @return the value (0 or 1).
+ * @return < 0 if fail.
+ */
+int gpio_mock_get_value(uint8_t gpio_no);
+
+/**
+ * @brief Function for setting the level of a mock input gpio, signaling the edge if it is configured.
+ * @note It takes the backend lock, so it must not be called from the observer.
+ * @param[in] gpio_no Is the gpio number.
+ * @param[in] value Is the level.
+ * @return void.
+ */
+void gpio_mock_set_input(uint8_t gpio_no, uint8_t value);
+
+/**
+ * @brief Function for calling a function on every output transition, in the order of the writes.
+ * @note The pins of a port write are given in the order of the port, the observer runs in the writing thread
+ *       with the backend lock held, so it must not call the gpio_driver functions.
+ * @param[in] observer Is the function, NULL for removing it.
+ * @param[in] ctx Is passed to the observer.
+ * @return void.
+ */
+void gpio_mock_set_observer(void (*observer)(const struct gpio_mock_event* event, void* ctx), void* ctx);
+
+/**
+ * @brief Function for printing a report of the operations and transitions.
+ * @param[in] out Is the output stream.
+ * @return void.
+ */
+void gpio_mock_report(FILE* out);
+
+#endif
@@ -0,0 +1,478 @@
+/********************************************************************************************************//**
+* @file gpio_pwm.c
+*
+* @brief Software PWM engine driving several output gpios from one thread.
+*
+* The schedule is compiled by the API functions under a mutex and picked up by the thread at the start of a
+* period, so a duty cycle change never produces a truncated or doubled pulse.
+*
+* Public Functions:
+*       - int gpio_pwm_init(uint32_t period_us)
+*       - void gpio_pwm_deinit(void)
+*       - int gpio_pwm_add(uint8_t gpio_no, uint8_t duty)
+*       - int gpio_pwm_set_duty(uint8_t gpio_no, uint8_t duty)
+*       - int gpio_pwm_remove(uint8_t gpio_no)
+*       - int gpio_pwm_start(void)
+*       - void gpio_pwm_stop(void)
+*       - void gpio_pwm_get_stats(struct gpio_pwm_stats* stats)
+*       - void gpio_pwm_reset_stats(void)
+*       - uint32_t gpio_pwm_late_percentile(const struct gpio_pwm_stats* stats, uint8_t percent)
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/timerfd.h>
+#include "gpio_driver.h"
+#include "gpio_pwm.h"
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Port write at a fixed offset of the period */
+struct pwm_step{
+    uint32_t offset_ns;         /**< @brief Time from the start of the period */
+    uint32_t mask;              /**< @brief Pins of the port written */
+    uint32_t values;            /**< @brief Values of the written pins */
+};
+
+/** @brief Compiled period, copied by the thread when it changes */
+struct pwm_schedule{
+    struct gpio_port port;                          /**< @brief Gpios of the engine */
+    struct pwm_step steps[GPIO_PWM_MAX_PINS + 1];   /**< @brief Edges sorted by offset */
+    uint8_t nsteps;                                 /**< @brief Number of edges */
+    uint32_t period_ns;                             /**< @brief PWM period */
+    uint32_t gen;                                   /**< @brief Generation, incremented on every change */
+};
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Protects the schedule, the duty cycles and the statistics */
+static pthread_mutex_t pwm_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Duty cycle of each pin of the port */
+static uint8_t duties[GPIO_PWM_MAX_PINS];
+
+/** @brief Current schedule */
+static struct pwm_schedule schedule = {.period_ns = GPIO_PWM_DEFAULT_PERIOD_US * 1000};
+
+/** @brief Generation of the schedule whose first edge was written by the thread */
+static volatile uint32_t applied_gen = 0;
+
+/** @brief Timing statistics */
+static struct gpio_pwm_stats stats;
+
+/** @brief PWM thread */
+static pthread_t pwm_thread;
+
+/** @brief The PWM thread is running */
+static volatile uint8_t running = 0;
+
+/** @brief File descriptor of the deadline timer, -1 if not created */
+static int timer_fd = -1;
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for compiling the schedule from the duty cycles, called with pwm_lock held.
+ * @return void.
+ */
+static void build_schedule(void);
+
+/**
+ * @brief Function for getting the position of a gpio in the port, called with pwm_lock held.
+ * @param[in] gpio_no Is the gpio number.
+ * @return the position, < 0 if the gpio is not in the engine.
+ */
+static int find_pin(uint8_t gpio_no);
+
+/**
+ * @brief Function for waiting until the thread has written the first edge of the current schedule.
+ * @return void.
+ */
+static void wait_applied(void);
+
+/**
+ * @brief Function for sleeping until an absolute deadline.
+ * @param[in] deadline_ns Is the CLOCK_MONOTONIC deadline.
+ * @return void.
+ */
+static void sleep_until(uint64_t deadline_ns);
+
+/**
+ * @brief Thread running the periods.
+ * @param[in] arg Is not used.
+ * @return NULL.
+ */
+static void* pwm_loop(void* arg);
+
+/**
+ * @brief Function for getting the monotonic time in ns.
+ * @return the current time.
+ */
+static uint64_t now_ns(void);
+
+/***********************************************************************************************************/
+/*                                       Public API Definitions                                            */
+/***********************************************************************************************************/
+
+int gpio_pwm_init(uint32_t period_us){
+
+    if(running){
+        fprintf(stderr, "Error, the pwm period can not be changed while running\n");
+        return 1;
+    }
+
+    if(!period_us){
+        period_us = GPIO_PWM_DEFAULT_PERIOD_US;
+    }
+    if(period_us < GPIO_PWM_MIN_PERIOD_US){
+        fprintf(stderr, "Error, the pwm period can not be shorter than %d us\n", GPIO_PWM_MIN_PERIOD_US);
+        return 1;
+    }
+    if(period_us > GPIO_PWM_MAX_PERIOD_US){
+        fprintf(stderr, "Error, the pwm period can not be longer than %d us\n", GPIO_PWM_MAX_PERIOD_US);
+        return 1;
+    }
+
+    if(timer_fd < 0){
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        if(timer_fd < 0){
+            perror("Error, pwm timer could not be created");
+            return 1;
+        }
+    }
+
+    pthread_mutex_lock(&pwm_lock);
+    schedule.period_ns = period_us * 1000;
+    build_schedule();
+    pthread_mutex_unlock(&pwm_lock);
+
+    return 0;
+}
+
+void gpio_pwm_deinit(void){
+
+    uint8_t i = 0;
+
+    gpio_pwm_stop();
+
+    pthread_mutex_lock(&pwm_lock);
+    for(i = 0; i < schedule.port.npins; i++){
+        gpio_write_value(schedule.port.pins[i], GPIO_LOW_VALUE);
+    }
+    schedule.port.npins = 0;
+    build_schedule();
+    pthread_mutex_unlock(&pwm_lock);
+
+    if(timer_fd >= 0){
+        close(timer_fd);
+        timer_fd = -1;
+    }
+}
+
+int gpio_pwm_add(uint8_t gpio_no, uint8_t duty){
+
+    if(gpio_no >= GPIO_MAX_NUMBER || duty > GPIO_PWM_DUTY_MAX){
+        fprintf(stderr, "Error, invalid pwm gpio %d or duty cycle %d\n", gpio_no, duty);
+        return 1;
+    }
+
+    pthread_mutex_lock(&pwm_lock);
+    if(find_pin(gpio_no) >= 0 || schedule.port.npins >= GPIO_PWM_MAX_PINS){
+        pthread_mutex_unlock(&pwm_lock);
+        fprintf(stderr, "Error, gpio %d can not be added to the pwm engine\n", gpio_no);
+        return 1;
+    }
+    schedule.port.pins[schedule.port.npins] = gpio_no;
+    duties[schedule.port.npins] = duty;
+    schedule.port.npins++;
+    build_schedule();
+    pthread_mutex_unlock(&pwm_lock);
+
+    return 0;
+}
+
+int gpio_pwm_set_duty(uint8_t gpio_no, uint8_t duty){
+
+    int pos = 0;
+
+    if(duty > GPIO_PWM_DUTY_MAX){
+        return 1;
+    }
+
+    pthread_mutex_lock(&pwm_lock);
+    pos = find_pin(gpio_no);
+    if(pos >= 0 && duties[pos] != duty){
+        duties[pos] = duty;
+        build_schedule();
+    }
+    pthread_mutex_unlock(&pwm_lock);
+
+    return pos < 0;
+}
+
+int gpio_pwm_remove(uint8_t gpio_no){
+
+    int pos = 0;
+
+    /* The next period of the thread drives it low, then it is removed from the port */
+    if(gpio_pwm_set_duty(gpio_no, 0)){
+        return 1;
+    }
+    wait_applied();
+
+    pthread_mutex_lock(&pwm_lock);
+    pos = find_pin(gpio_no);
+    if(pos >= 0){
+        schedule.port.npins--;
+        memmove(&schedule.port.pins[pos], &schedule.port.pins[pos + 1], schedule.port.npins - pos);
+        memmove(&duties[pos], &duties[pos + 1], schedule.port.npins - pos);
+        build_schedule();
+    }
+    pthread_mutex_unlock(&pwm_lock);
+
+    if(!running){
+        gpio_write_value(gpio_no, GPIO_LOW_VALUE);
+    }
+
+    return 0;
+}
+
+int gpio_pwm_start(void){
+
+    if(running){
+        return 0;
+    }
+
+    if(timer_fd < 0 && gpio_pwm_init(0)){
+        return 1;
+    }
+
+    running = 1;
+    if(pthread_create(&pwm_thread, NULL, pwm_loop, NULL)){
+        running = 0;
+        fprintf(stderr, "Error, pwm thread could not be created\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+void gpio_pwm_stop(void){
+
+    if(!running){
+        return;
+    }
+
+    /* The thread checks the flag at least once per period */
+    running = 0;
+    pthread_join(pwm_thread, NULL);
+}
+
+void gpio_pwm_get_stats(struct gpio_pwm_stats* stats_out){
+
+    pthread_mutex_lock(&pwm_lock);
+    *stats_out = stats;
+    pthread_mutex_unlock(&pwm_lock);
+}
+
+void gpio_pwm_reset_stats(void){
+
+    pthread_mutex_lock(&pwm_lock);
+    memset(&stats, 0, sizeof(stats));
+    pthread_mutex_unlock(&pwm_lock);
+}
+
+uint32_t gpio_pwm_late_percentile(const struct gpio_pwm_stats* stats_in, uint8_t percent){
+
+    uint8_t b = 0;
+    uint64_t count = 0;
+    uint64_t target = ((uint64_t)stats_in->edges * percent + 99) / 100;
+
+    for(b = 0; b < GPIO_PWM_LATE_BUCKETS; b++){
+        count += stats_in->late_hist[b];
+        if(count >= target){
+            break;
+        }
+    }
+
+    return ((1UL << (b + 1)) - 1) < stats_in->late_max_ns ? (1UL << (b + 1)) - 1 : stats_in->late_max_ns;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static void build_schedule(void){
+
+    uint8_t i = 0;
+    uint8_t duty = 0;
+    uint32_t mask = 0;
+    struct pwm_step* step = schedule.steps;
+
+    /* Start of the period: every pin with a duty cycle is switched on, the others are kept off */
+    step->offset_ns = 0;
+    step->mask = schedule.port.npins ? (uint32_t)((1ULL << schedule.port.npins) - 1) : 0;
+    step->values = 0;
+    for(i = 0; i < schedule.port.npins; i++){
+        if(duties[i]){
+            step->values |= 1UL << i;
+        }
+    }
+    step++;
+
+    /* One edge per distinct duty cycle, in increasing order */
+    for(duty = 1; duty < GPIO_PWM_DUTY_MAX; duty++){
+        mask = 0;
+        for(i = 0; i < schedule.port.npins; i++){
+            if(duties[i] == duty){
+                mask |= 1UL << i;
+            }
+        }
+        if(mask){
+            step->offset_ns = (uint64_t)schedule.period_ns * duty / GPIO_PWM_DUTY_MAX;
+            step->mask = mask;
+            step->values = 0;
+            step++;
+        }
+    }
+
+    schedule.nsteps = step - schedule.steps;
+    schedule.gen++;
+}
+
+static int find_pin(uint8_t gpio_no){
+
+    uint8_t i = 0;
+
+    for(i = 0; i < schedule.port.npins; i++){
+        if(schedule.port.pins[i] == gpio_no){
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static void wait_applied(void){
+
+    uint32_t gen = 0;
+
+    pthread_mutex_lock(&pwm_lock);
+    gen = schedule.gen;
+    pthread_mutex_unlock(&pwm_lock);
+
+    while(running && applied_gen != gen){
+        usleep(schedule.period_ns / 4000);
+    }
+}
+
+static void sleep_until(uint64_t deadline_ns){
+
+    uint64_t expirations = 0;
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = deadline_ns / 1000000000ULL;
+    its.it_value.tv_nsec = deadline_ns % 1000000000ULL;
+
+    /* A deadline already passed expires at once */
+    if(timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0){
+        return;
+    }
+    while(read(timer_fd, &expirations, sizeof(expirations)) < 0 && errno == EINTR);
+}
+
+static void* pwm_loop(void* arg){
+
+    uint8_t s = 0;
+    uint8_t b = 0;
+    uint64_t t_period = 0;
+    uint64_t deadline = 0;
+    uint64_t late = 0;
+    uint64_t now = 0;
+    uint64_t skipped = 0;
+    struct pwm_schedule local;
+    struct gpio_pwm_stats period_stats;
+
+    pthread_mutex_lock(&pwm_lock);
+    local = schedule;
+    pthread_mutex_unlock(&pwm_lock);
+
+    t_period = now_ns();
+
+    while(running){
+        memset(&period_stats, 0, sizeof(period_stats));
+
+        for(s = 0; s < local.nsteps; s++){
+            deadline = t_period + local.steps[s].offset_ns;
+            sleep_until(deadline);
+
+            now = now_ns();
+            late = now > deadline ? now - deadline : 0;
+            gpio_write_mask(&local.port, local.steps[s].mask, local.steps[s].values);
+            if(!s){
+                applied_gen = local.gen;
+            }
+
+            b = late ? 63 - __builtin_clzll(late) : 0;
+            period_stats.late_hist[b < GPIO_PWM_LATE_BUCKETS ? b : GPIO_PWM_LATE_BUCKETS - 1]++;
+            period_stats.late_total_ns += late;
+            if(late > period_stats.late_max_ns){
+                period_stats.late_max_ns = late > UINT32_MAX ? UINT32_MAX : late;
+            }
+            period_stats.edges++;
+        }
+
+        /* Without pins the thread only waits for the period */
+        if(!local.nsteps){
+            sleep_until(t_period);
+        }
+
+        t_period += local.period_ns;
+        now = now_ns();
+        if(now >= t_period + local.period_ns){
+            skipped = (now - t_period) / local.period_ns;
+            period_stats.overruns = skipped;
+            t_period += skipped * local.period_ns;
+        }
+
+        /* Statistics of the period and pick up of a new schedule, once per period */
+        pthread_mutex_lock(&pwm_lock);
+        stats.periods++;
+        stats.edges += period_stats.edges;
+        stats.overruns += period_stats.overruns;
+        stats.late_total_ns += period_stats.late_total_ns;
+        if(period_stats.late_max_ns > stats.late_max_ns){
+            stats.late_max_ns = period_stats.late_max_ns;
+        }
+        for(b = 0; b < GPIO_PWM_LATE_BUCKETS; b++){
+            stats.late_hist[b] += period_stats.late_hist[b];
+        }
+        if(schedule.gen != local.gen){
+            local = schedule;
+        }
+        pthread_mutex_unlock(&pwm_lock);
+    }
+
+    return NULL;
+}
+
+static uint64_t now_ns(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
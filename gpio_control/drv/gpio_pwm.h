@@ -0,0 +1,143 @@
+/********************************************************************************************************//**
+* @file gpio_pwm.h
+*
+* @brief Header file containing the prototypes of the APIs for the software PWM of output gpios.
+*
+* One thread drives all the PWM gpios (e.g. for dimming the segments of a display or several leds). The
+* gpios are grouped in a port and, every time a duty cycle changes, the period is compiled into a schedule
+* of edges: one port write at the start of the period switching on every gpio with a duty cycle > 0, and
+* one port write per distinct duty cycle switching off the gpios which share it. The thread sleeps until the
+* absolute deadline of each edge with a timerfd, so the period does not drift with the write latency.
+*
+* The lateness of every edge (time from its deadline to its port write) is recorded in a log2 histogram,
+* returned by gpio_pwm_get_stats(). When the thread is late by a whole period, the missed periods are
+* skipped and counted as overruns.
+*
+* Public Functions:
+*       - int gpio_pwm_init(uint32_t period_us)
+*       - void gpio_pwm_deinit(void)
+*       - int gpio_pwm_add(uint8_t gpio_no, uint8_t duty)
+*       - int gpio_pwm_set_duty(uint8_t gpio_no, uint8_t duty)
+*       - int gpio_pwm_remove(uint8_t gpio_no)
+*       - int gpio_pwm_start(void)
+*       - void gpio_pwm_stop(void)
+*       - void gpio_pwm_get_stats(struct gpio_pwm_stats* stats)
+*       - void gpio_pwm_reset_stats(void)
+*       - uint32_t gpio_pwm_late_percentile(const struct gpio_pwm_stats* stats, uint8_t percent)
+*/
+
+#ifndef GPIO_PWM_H
+#define GPIO_PWM_H
+
+#include <stdint.h>
+#include "gpio_driver.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+#define GPIO_PWM_MAX_PINS           GPIO_PORT_MAX_PINS  /**< @brief Gpios driven by the engine */
+#define GPIO_PWM_DUTY_MAX           100                 /**< @brief Duty cycle of a gpio always on */
+#define GPIO_PWM_DEFAULT_PERIOD_US  10000               /**< @brief 100 Hz, no visible flicker */
+#define GPIO_PWM_MIN_PERIOD_US      100                 /**< @brief Shortest period accepted */
+#define GPIO_PWM_MAX_PERIOD_US      4000000             /**< @brief Longest period accepted, in 32 bits ns */
+#define GPIO_PWM_LATE_BUCKETS       24                  /**< @brief Log2 buckets of the lateness, up to 16 ms */
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Timing statistics of the PWM thread */
+struct gpio_pwm_stats{
+    uint32_t periods;                               /**< @brief Periods run */
+    uint32_t edges;                                 /**< @brief Port writes done at a deadline */
+    uint32_t overruns;                              /**< @brief Periods skipped because the thread was late */
+    uint64_t late_total_ns;                         /**< @brief Sum of the lateness of the edges */
+    uint32_t late_max_ns;                           /**< @brief Latest edge */
+    uint32_t late_hist[GPIO_PWM_LATE_BUCKETS];      /**< @brief Edges per log2 bucket of lateness in ns */
+};
+
+/***********************************************************************************************************/
+/*                                       APIs Supported                                                    */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for initializing the PWM engine.
+ * @note It can be called again (with the engine stopped) for changing the period, the gpios are kept.
+ * @param[in] period_us Is the PWM period in us (GPIO_PWM_MIN_PERIOD_US to GPIO_PWM_MAX_PERIOD_US), 0 selects
+ *            GPIO_PWM_DEFAULT_PERIOD_US.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_pwm_init(uint32_t period_us);
+
+/**
+ * @brief Function for stopping the engine, driving its gpios low and releasing them.
+ * @return void.
+ */
+void gpio_pwm_deinit(void);
+
+/**
+ * @brief Function for adding a gpio to the engine.
+ * @note The gpio must be exported and configured as output.
+ * @param[in] gpio_no Is the gpio number.
+ * @param[in] duty Is the duty cycle, from 0 (always off) to GPIO_PWM_DUTY_MAX (always on).
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_pwm_add(uint8_t gpio_no, uint8_t duty);
+
+/**
+ * @brief Function for changing the duty cycle of a gpio.
+ * @note The new duty cycle is applied at the start of the next period.
+ * @param[in] gpio_no Is the gpio number.
+ * @param[in] duty Is the duty cycle, from 0 to GPIO_PWM_DUTY_MAX.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_pwm_set_duty(uint8_t gpio_no, uint8_t duty);
+
+/**
+ * @brief Function for removing a gpio from the engine, it is left low.
+ * @note If the engine is running, it waits for the start of the next period.
+ * @param[in] gpio_no Is the gpio number.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_pwm_remove(uint8_t gpio_no);
+
+/**
+ * @brief Function for starting the PWM thread.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_pwm_start(void);
+
+/**
+ * @brief Function for stopping the PWM thread, the gpios keep their last level.
+ * @return void.
+ */
+void gpio_pwm_stop(void);
+
+/**
+ * @brief Function for getting the timing statistics (updated at the end of every period).
+ * @param[out] stats Is the statistics.
+ * @return void.
+ */
+void gpio_pwm_get_stats(struct gpio_pwm_stats* stats);
+
+/**
+ * @brief Function for clearing the timing statistics.
+ * @return void.
+ */
+void gpio_pwm_reset_stats(void);
+
+/**
+ * @brief Function for getting a percentile of the lateness of the edges.
+ * @param[in] stats Is the statistics.
+ * @param[in] percent Is the percentile (0 to 100).
+ * @return the upper bound of the bucket containing the percentile in ns (clamped to the maximum).
+ */
+uint32_t gpio_pwm_late_percentile(const struct gpio_pwm_stats* stats, uint8_t percent);
+
+#endif
@@ -0,0 +1,294 @@
+/********************************************************************************************************//**
+* @file gpio_sampler.c
+*
+* @brief Fixed rate sampling of a group of input gpios into a lock-free ring buffer.
+*
+* The thread is the only writer of the head of the ring and the consumer the only writer of the tail, so
+* the ring only needs acquire/release ordering on these two indexes.
+*
+* Public Functions:
+*       - int gpio_sampler_init(const struct gpio_port* port, uint32_t period_us, uint8_t flags)
+*       - void gpio_sampler_deinit(void)
+*       - int gpio_sampler_start(void)
+*       - void gpio_sampler_stop(void)
+*       - uint32_t gpio_sampler_read(struct gpio_sample* samples, uint32_t max)
+*       - void gpio_sampler_get_stats(struct gpio_sampler_stats* stats)
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/timerfd.h>
+#include "gpio_driver.h"
+#include "gpio_sampler.h"
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Port sampled by the thread */
+static struct gpio_port sampled_port;
+
+/** @brief Sampling period */
+static uint64_t period_ns = 0;
+
+/** @brief Options, see @ref GPIO_SAMPLER_FLAGS */
+static uint8_t sampler_flags = 0;
+
+/** @brief Samples not consumed yet */
+static struct gpio_sample ring[GPIO_SAMPLER_RING_SIZE];
+
+/** @brief Next slot written by the thread */
+static uint32_t head = 0;
+
+/** @brief Next slot read by the consumer */
+static uint32_t tail = 0;
+
+/** @brief Protects the counters */
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Counters of the thread */
+static struct gpio_sampler_stats stats;
+
+/** @brief Sampling thread */
+static pthread_t sampler_thread;
+
+/** @brief The sampling thread is running */
+static volatile uint8_t running = 0;
+
+/** @brief File descriptor of the periodic timer, -1 if not created */
+static int timer_fd = -1;
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Thread reading the port every period.
+ * @param[in] arg Is not used.
+ * @return NULL.
+ */
+static void* sampler_loop(void* arg);
+
+/**
+ * @brief Function for appending a sample to the ring, dropping it if the ring is full.
+ * @param[in] t_ns Is the time of the read.
+ * @param[in] values Is the levels of the port.
+ * @return 0 if stored, != 0 if dropped.
+ */
+static int push_sample(uint64_t t_ns, uint32_t values);
+
+/**
+ * @brief Function for getting the monotonic time in ns.
+ * @return the current time.
+ */
+static uint64_t now_ns(void);
+
+/***********************************************************************************************************/
+/*                                       Public API Definitions                                            */
+/***********************************************************************************************************/
+
+int gpio_sampler_init(const struct gpio_port* port, uint32_t period_us, uint8_t flags){
+
+    if(running){
+        fprintf(stderr, "Error, the sampler can not be configured while running\n");
+        return 1;
+    }
+    if(period_us < GPIO_SAMPLER_MIN_PERIOD_US){
+        fprintf(stderr, "Error, the sampling period can not be shorter than %d us\n",
+                GPIO_SAMPLER_MIN_PERIOD_US);
+        return 1;
+    }
+
+    if(timer_fd < 0){
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        if(timer_fd < 0){
+            perror("Error, sampler timer could not be created");
+            return 1;
+        }
+    }
+
+    sampled_port = *port;
+    period_ns = (uint64_t)period_us * 1000;
+    sampler_flags = flags;
+    head = 0;
+    tail = 0;
+
+    pthread_mutex_lock(&stats_lock);
+    memset(&stats, 0, sizeof(stats));
+    pthread_mutex_unlock(&stats_lock);
+
+    return 0;
+}
+
+void gpio_sampler_deinit(void){
+
+    gpio_sampler_stop();
+
+    if(timer_fd >= 0){
+        close(timer_fd);
+        timer_fd = -1;
+    }
+}
+
+int gpio_sampler_start(void){
+
+    if(running){
+        return 0;
+    }
+    if(timer_fd < 0){
+        fprintf(stderr, "Error, the sampler is not initialized\n");
+        return 1;
+    }
+
+    running = 1;
+    if(pthread_create(&sampler_thread, NULL, sampler_loop, NULL)){
+        running = 0;
+        fprintf(stderr, "Error, sampler thread could not be created\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+void gpio_sampler_stop(void){
+
+    struct itimerspec its;
+
+    if(!running){
+        return;
+    }
+
+    /* The thread checks the flag after each expiration, one is forced now instead of a period later */
+    running = 0;
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_nsec = 1;
+    timerfd_settime(timer_fd, 0, &its, NULL);
+    pthread_join(sampler_thread, NULL);
+
+    its.it_value.tv_nsec = 0;
+    timerfd_settime(timer_fd, 0, &its, NULL);
+}
+
+uint32_t gpio_sampler_read(struct gpio_sample* samples, uint32_t max){
+
+    uint32_t n = 0;
+    uint32_t h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+
+    while(tail + n != h && n < max){
+        samples[n] = ring[(tail + n) & (GPIO_SAMPLER_RING_SIZE - 1)];
+        n++;
+    }
+
+    /* The slots are given back to the thread once copied */
+    __atomic_store_n(&tail, tail + n, __ATOMIC_RELEASE);
+
+    return n;
+}
+
+void gpio_sampler_get_stats(struct gpio_sampler_stats* stats_out){
+
+    pthread_mutex_lock(&stats_lock);
+    *stats_out = stats;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static void* sampler_loop(void* arg){
+
+    int ret = 0;
+    uint8_t first = 1;
+    uint32_t values = 0;
+    uint32_t last = 0;
+    uint64_t late = 0;
+    uint64_t t = 0;
+    uint64_t deadline = 0;
+    uint64_t expirations = 0;
+    struct itimerspec its;
+
+    /* Periodic timer with absolute expirations, the first one a period from now */
+    deadline = now_ns() + period_ns;
+    its.it_value.tv_sec = deadline / 1000000000ULL;
+    its.it_value.tv_nsec = deadline % 1000000000ULL;
+    its.it_interval.tv_sec = period_ns / 1000000000ULL;
+    its.it_interval.tv_nsec = period_ns % 1000000000ULL;
+    if(timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0){
+        perror("Error, sampler timer could not be armed");
+        running = 0;
+        return NULL;
+    }
+
+    while(running){
+        if(read(timer_fd, &expirations, sizeof(expirations)) < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            break;
+        }
+        if(!running){
+            break;
+        }
+
+        /* The deadline of a late read is the last expiration, the ones before it were missed */
+        deadline += (expirations - 1) * period_ns;
+        t = now_ns();
+        ret = gpio_read_port(&sampled_port, &values);
+        late = t > deadline ? t - deadline : 0;
+        deadline += period_ns;
+
+        pthread_mutex_lock(&stats_lock);
+        stats.samples++;
+        stats.overruns += expirations - 1;
+        stats.late_total_ns += late;
+        if(late > stats.late_max_ns){
+            stats.late_max_ns = late > UINT32_MAX ? UINT32_MAX : late;
+        }
+        if(ret){
+            stats.errors++;
+        }
+        else if(!(sampler_flags & GPIO_SAMPLER_CHANGES) || first || values != last){
+            if(push_sample(t, values)){
+                stats.dropped++;
+            }
+            else{
+                stats.stored++;
+                first = 0;
+                last = values;
+            }
+        }
+        pthread_mutex_unlock(&stats_lock);
+    }
+
+    return NULL;
+}
+
+static int push_sample(uint64_t t_ns, uint32_t values){
+
+    if(head - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) >= GPIO_SAMPLER_RING_SIZE){
+        return 1;
+    }
+
+    ring[head & (GPIO_SAMPLER_RING_SIZE - 1)].t_ns = t_ns;
+    ring[head & (GPIO_SAMPLER_RING_SIZE - 1)].values = values;
+
+    /* The sample is written before it is published to the consumer */
+    __atomic_store_n(&head, head + 1, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+static uint64_t now_ns(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
@@ -0,0 +1,118 @@
+/********************************************************************************************************//**
+* @file gpio_sampler.h
+*
+* @brief Header file containing the prototypes of the APIs for sampling a group of input gpios at a fixed
+*        rate (e.g. scanning a keypad or decoding a rotary encoder).
+*
+* One thread reads a port with gpio_read_port() every period and appends the packed levels and their
+* timestamp to a ring buffer, which the application consumes with gpio_sampler_read() at its own pace. The
+* thread wakes up with a periodic timerfd, so the sampling rate does not drift with the read latency. The
+* ring has a single producer (the thread) and a single consumer, so neither side takes a lock.
+*
+* With GPIO_SAMPLER_CHANGES only the samples whose levels differ from the previous one are stored, so a
+* slow consumer sees every transition of a mostly idle input without having to drain a full ring.
+*
+* When the ring is full the new samples are dropped and counted. When the thread wakes up late by whole
+* periods, the missed samples are counted as overruns.
+*
+* Public Functions:
+*       - int gpio_sampler_init(const struct gpio_port* port, uint32_t period_us, uint8_t flags)
+*       - void gpio_sampler_deinit(void)
+*       - int gpio_sampler_start(void)
+*       - void gpio_sampler_stop(void)
+*       - uint32_t gpio_sampler_read(struct gpio_sample* samples, uint32_t max)
+*       - void gpio_sampler_get_stats(struct gpio_sampler_stats* stats)
+*/
+
+#ifndef GPIO_SAMPLER_H
+#define GPIO_SAMPLER_H
+
+#include <stdint.h>
+#include "gpio_driver.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+#define GPIO_SAMPLER_RING_SIZE      1024    /**< @brief Samples in the ring, power of 2 */
+#define GPIO_SAMPLER_MIN_PERIOD_US  50      /**< @brief Shortest period accepted */
+
+/**
+ * @defgroup GPIO_SAMPLER_FLAGS Options of the sampler.
+ * @{
+ */
+#define GPIO_SAMPLER_CHANGES        0x01    /**< @brief Only store the samples whose levels changed */
+/** @} */
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Levels of the port at a given time */
+struct gpio_sample{
+    uint64_t t_ns;                      /**< @brief CLOCK_MONOTONIC time of the read */
+    uint32_t values;                    /**< @brief Bit N is the level of pins[N] of the port */
+};
+
+/** @brief Counters of the sampling thread */
+struct gpio_sampler_stats{
+    uint64_t samples;                   /**< @brief Port reads done */
+    uint64_t stored;                    /**< @brief Samples appended to the ring */
+    uint32_t dropped;                   /**< @brief Samples lost because the ring was full */
+    uint32_t overruns;                  /**< @brief Periods missed because the thread was late */
+    uint32_t errors;                    /**< @brief Port reads which failed */
+    uint32_t late_max_ns;               /**< @brief Latest read after its period boundary */
+    uint64_t late_total_ns;             /**< @brief Sum of the lateness of the reads */
+};
+
+/***********************************************************************************************************/
+/*                                       APIs Supported                                                    */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for initializing the sampler, discarding the samples not read yet.
+ * @note The gpios of the port must be exported and configured as input.
+ * @param[in] port Is the port sampled, it is copied.
+ * @param[in] period_us Is the sampling period in us (at least GPIO_SAMPLER_MIN_PERIOD_US).
+ * @param[in] flags Is a combination of @ref GPIO_SAMPLER_FLAGS, or 0 for storing every sample.
+ * @return 0 if success.
+ * @return != 0 if fail (e.g. the sampler is running).
+ */
+int gpio_sampler_init(const struct gpio_port* port, uint32_t period_us, uint8_t flags);
+
+/**
+ * @brief Function for stopping the sampler and releasing its timer.
+ * @return void.
+ */
+void gpio_sampler_deinit(void);
+
+/**
+ * @brief Function for starting the sampling thread.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_sampler_start(void);
+
+/**
+ * @brief Function for stopping the sampling thread, the samples stored can still be read.
+ * @return void.
+ */
+void gpio_sampler_stop(void);
+
+/**
+ * @brief Function for consuming the oldest samples of the ring.
+ * @note It does not block, it must be called from a single thread.
+ * @param[out] samples Is the buffer for the samples.
+ * @param[in] max Is the size of the buffer.
+ * @return the number of samples copied.
+ */
+uint32_t gpio_sampler_read(struct gpio_sample* samples, uint32_t max);
+
+/**
+ * @brief Function for getting the counters of the sampling thread.
+ * @param[out] stats Is the counters.
+ * @return void.
+ */
+void gpio_sampler_get_stats(struct gpio_sampler_stats* stats);
+
+#endif
@@ -0,0 +1,814 @@
+/********************************************************************************************************//**
+* @file gpio_shm.c
+*
+* @brief Gpio server sharing the pins between processes, and its client backend ("shm").
+*
+* Public Functions:
+*       - int gpio_shm_server_init(void)
+*       - void gpio_shm_server_deinit(void)
+*       - int gpio_shm_serve(volatile sig_atomic_t* stop)
+*       - void gpio_shm_get_stats(struct gpio_shm_stats* stats)
+*       - int gpio_shm_flush(void)
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "gpio_driver.h"
+#include "gpio_backend.h"
+#include "gpio_shm.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+#define SHM_MAGIC               0x4750534DUL    /**< @brief "GPSM", set when the object is initialized */
+#define SHM_RING_MASK           (GPIO_SHM_RING_SIZE - 1)
+#define SHM_WAIT_NS             100000000       /**< @brief Longest wait of the server (stop polling) */
+#define SHM_POLL_NS             50000           /**< @brief Polling of the empty ring before waiting */
+#define SHM_CLIENT_TIMEOUT_NS   1000000000ULL   /**< @brief Longest wait of a client without progress */
+#define SHM_MODE                0600            /**< @brief Only the user of the server can connect */
+#define SHM_CACHE_LINE          64              /**< @brief Words written by different sides are not shared */
+
+/**
+ * @defgroup SHM_CMD Commands of the ring.
+ * @{
+ */
+#define SHM_CMD_WRITE           0   /**< @brief Write the pins of a bank (mask and values) */
+#define SHM_CMD_EXPORT          1   /**< @brief Export a gpio */
+#define SHM_CMD_DIR             2   /**< @brief Configure the direction of a gpio */
+#define SHM_CMD_READ            3   /**< @brief Read a gpio */
+#define SHM_CMD_READ_BANK       4   /**< @brief Read the pins of a bank (mask), levels in values */
+/** @} */
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Slot of the ring */
+struct shm_cmd{
+    uint32_t seq;                       /**< @brief pos + 1 when filled, pos + ring size when free again */
+    uint8_t op;                         /**< @brief Command (see @ref SHM_CMD) */
+    uint8_t target;                     /**< @brief Bank for SHM_CMD_WRITE and SHM_CMD_READ_BANK, gpio
+                                             otherwise */
+    uint8_t arg;                        /**< @brief Direction for SHM_CMD_DIR */
+    uint32_t mask;                      /**< @brief Pins of the bank written or read */
+    uint32_t values;                    /**< @brief Values of the written pins */
+};
+
+/** @brief Result of the synchronous command of a slot, kept after the slot is freed */
+struct shm_result{
+    uint32_t seq;                       /**< @brief pos + 1 of the command, pos + 1 + half the ring size
+                                             while being written */
+    int32_t ret;                        /**< @brief Result of the command */
+    uint32_t values;                    /**< @brief Levels of the read pins */
+};
+
+/** @brief Shared memory object */
+struct shm_area{
+    uint32_t magic;                                             /**< @brief SHM_MAGIC when ready */
+    pid_t server_pid;                                           /**< @brief Process serving the ring */
+    uint32_t head __attribute__((aligned(SHM_CACHE_LINE)));     /**< @brief Next slot reserved by a client */
+    uint32_t done __attribute__((aligned(SHM_CACHE_LINE)));     /**< @brief Commands applied, futex of the
+                                                                     clients waiting in gpio_shm_flush() */
+    uint32_t waiters;                                           /**< @brief Clients waiting on done */
+    struct gpio_shm_stats stats;                                /**< @brief Counters of the server */
+    uint32_t wake __attribute__((aligned(SHM_CACHE_LINE)));     /**< @brief Futex of the server */
+    uint32_t sleeping;                                          /**< @brief The server waits on wake */
+    struct shm_cmd ring[GPIO_SHM_RING_SIZE] __attribute__((aligned(SHM_CACHE_LINE)));
+    struct shm_result results[GPIO_SHM_RING_SIZE];              /**< @brief Results, indexed as the ring */
+};
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+static int shm_init(void);
+static void shm_deinit(void);
+static int shm_export(uint8_t gpio_no);
+static int shm_config_dir(uint8_t gpio_no, uint8_t dir_val);
+static int shm_write(uint8_t gpio_no, uint8_t out_val);
+static int shm_read(uint8_t gpio_no);
+static int shm_config_edge(uint8_t gpio_no, const char* edge);
+static int shm_write_batch(const uint8_t* pins, uint8_t npins, uint32_t mask, uint32_t values);
+static int shm_read_batch(const uint8_t* pins, uint8_t npins, uint32_t* values);
+static int shm_write_bank(uint8_t bank, uint32_t mask, uint32_t values);
+
+/**
+ * @brief Function for getting the name of the shared memory object.
+ * @return GPIO_SHM or GPIO_SHM_DEFAULT_NAME.
+ */
+static const char* shm_name(void);
+
+/**
+ * @brief Function for calling the futex syscall on a shared word.
+ * @param[in] addr Is the futex word.
+ * @param[in] op Is FUTEX_WAIT or FUTEX_WAKE.
+ * @param[in] val Is the expected value (wait) or the number of waiters woken (wake).
+ * @param[in] timeout Is the relative timeout of a wait, NULL for none.
+ * @return the result of the syscall.
+ */
+static long futex(uint32_t* addr, int op, uint32_t val, const struct timespec* timeout);
+
+/**
+ * @brief Function for getting the monotonic time in ns.
+ * @return the time in ns.
+ */
+static uint64_t time_ns(void);
+
+/**
+ * @brief Function for checking that the server of the mapped object is still running.
+ * @return 1 if it is running, 0 otherwise.
+ */
+static int server_alive(void);
+
+/**
+ * @brief Function for waiting until the server has applied the commands before a position of the ring.
+ * @param[in] target Is the position following the last command waited for.
+ * @return 0 if success.
+ * @return != 0 if fail (the server stopped or did not progress for SHM_CLIENT_TIMEOUT_NS).
+ */
+static int wait_done(uint32_t target);
+
+/**
+ * @brief Function for appending a command to the ring, waiting while it is full.
+ * @param[in] op Is the command (see @ref SHM_CMD).
+ * @param[in] target Is the bank or the gpio.
+ * @param[in] arg Is the argument of the command.
+ * @param[in] mask Is the bitmask of the written or read pins.
+ * @param[in] values Is the values of the written pins.
+ * @param[out] pos_out Is the position of the command in the ring, NULL if not needed.
+ * @return 0 if success.
+ * @return != 0 if fail (the ring stayed full while the server stopped or did not progress).
+ */
+static int push_cmd(uint8_t op, uint8_t target, uint8_t arg, uint32_t mask, uint32_t values,
+                    uint32_t* pos_out);
+
+/**
+ * @brief Function for sending a command and waiting for its result.
+ * @note The result outlives the slot, until a synchronous command a whole ring later overwrites it.
+ * @param[in] op Is the command (see @ref SHM_CMD).
+ * @param[in] target Is the bank or the gpio.
+ * @param[in] arg Is the argument of the command.
+ * @param[in] mask Is the bitmask of the read pins.
+ * @param[out] values Is the levels of the read pins, NULL if not needed.
+ * @return the result of the command in the server, -1 if the server did not answer or the result was
+ *         overwritten before being read.
+ */
+static int sync_cmd(uint8_t op, uint8_t target, uint8_t arg, uint32_t mask, uint32_t* values);
+
+/**
+ * @brief Function for reading the pins of a bank in the server.
+ * @param[in] bank Is the bank.
+ * @param[in] mask Is the bitmask of the read pins of the bank.
+ * @param[out] values Is the levels of the read pins.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int read_bank(uint8_t bank, uint32_t mask, uint32_t* values);
+
+/**
+ * @brief Function for applying all the commands in the ring, merging the writes of each bank.
+ * @return the number of commands applied.
+ */
+static uint32_t drain(void);
+
+/**
+ * @brief Function for issuing the merged writes to the backend.
+ * @return void.
+ */
+static void apply_pending(void);
+
+/***********************************************************************************************************/
+/*                                       Backend Definition                                                */
+/***********************************************************************************************************/
+
+const struct gpio_backend gpio_shm_backend = {
+    .name = "shm",
+    .init = shm_init,
+    .deinit = shm_deinit,
+    .export = shm_export,
+    .config_dir = shm_config_dir,
+    .write = shm_write,
+    .read = shm_read,
+    .config_edge = shm_config_edge,
+    .write_batch = shm_write_batch,
+    .read_batch = shm_read_batch,
+    .write_bank = shm_write_bank,
+    .shared = 1,
+};
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Shared memory object mapped by the server or by a client */
+static struct shm_area* area = NULL;
+
+/** @brief The object was created by this process */
+static uint8_t is_server = 0;
+
+/** @brief Position of the last command sent by this process, + 1 (0 if none) */
+static uint32_t last_sent = 0;
+
+/** @brief Next slot read by the server */
+static uint32_t tail = 0;
+
+/** @brief Merged writes of each bank, not yet issued */
+static uint32_t pending_mask[GPIO_SHM_BANKS];
+static uint32_t pending_values[GPIO_SHM_BANKS];
+
+/** @brief Ports of the 32 gpios of each bank, used by the server */
+static struct gpio_port bank_ports[GPIO_SHM_BANKS];
+
+/***********************************************************************************************************/
+/*                                       Public API Definitions                                            */
+/***********************************************************************************************************/
+
+int gpio_shm_server_init(void){
+
+    int fd = -1;
+    uint8_t b = 0;
+    uint8_t i = 0;
+    uint32_t pos = 0;
+    uint8_t pins[GPIO_PORT_MAX_PINS];
+    struct shm_area* old = NULL;
+
+    if(gpio_get_backend() == &gpio_shm_backend){
+        fprintf(stderr, "Error, the gpio server can not use the shm backend\n");
+        return 1;
+    }
+
+    fd = shm_open(shm_name(), O_RDWR | O_CREAT | O_EXCL, SHM_MODE);
+    if(fd < 0 && errno == EEXIST){
+        /* Left by a server which did not exit cleanly */
+        fd = shm_open(shm_name(), O_RDWR, 0);
+        old = (fd >= 0) ? mmap(NULL, sizeof(*old), PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+        if(old != MAP_FAILED && old->magic == SHM_MAGIC && !kill(old->server_pid, 0)){
+            fprintf(stderr, "Error, gpio server \"%s\" is already running (pid %d)\n", shm_name(),
+                    (int)old->server_pid);
+            munmap(old, sizeof(*old));
+            close(fd);
+            return 1;
+        }
+        if(old != MAP_FAILED){
+            munmap(old, sizeof(*old));
+        }
+        if(fd >= 0){
+            close(fd);
+        }
+        shm_unlink(shm_name());
+        fd = shm_open(shm_name(), O_RDWR | O_CREAT | O_EXCL, SHM_MODE);
+    }
+    if(fd < 0){
+        perror("Error, shared memory of the gpio server could not be created");
+        return 1;
+    }
+
+    if(ftruncate(fd, sizeof(*area)) < 0){
+        perror("Error, shared memory of the gpio server could not be sized");
+        close(fd);
+        shm_unlink(shm_name());
+        return 1;
+    }
+    area = mmap(NULL, sizeof(*area), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(area == MAP_FAILED){
+        perror("Error, shared memory of the gpio server could not be mapped");
+        area = NULL;
+        shm_unlink(shm_name());
+        return 1;
+    }
+
+    memset(area, 0, sizeof(*area));
+    for(pos = 0; pos < GPIO_SHM_RING_SIZE; pos++){
+        area->ring[pos].seq = pos;
+    }
+    area->server_pid = getpid();
+    tail = 0;
+    memset(pending_mask, 0, sizeof(pending_mask));
+
+    for(b = 0; b < GPIO_SHM_BANKS; b++){
+        for(i = 0; i < GPIO_PORT_MAX_PINS; i++){
+            pins[i] = b * GPIO_PORT_MAX_PINS + i;
+        }
+        gpio_port_init(&bank_ports[b], pins, GPIO_PORT_MAX_PINS);
+    }
+
+    /* The clients check the magic before using the ring */
+    __atomic_store_n(&area->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+    is_server = 1;
+
+    return 0;
+}
+
+void gpio_shm_server_deinit(void){
+
+    if(!area || !is_server){
+        return;
+    }
+
+    area->magic = 0;
+    munmap(area, sizeof(*area));
+    shm_unlink(shm_name());
+    area = NULL;
+    is_server = 0;
+}
+
+int gpio_shm_serve(volatile sig_atomic_t* stop){
+
+    uint32_t wake = 0;
+    uint64_t t_now = 0;
+    uint64_t t_idle = 0;
+    struct timespec timeout = {0, SHM_WAIT_NS};
+
+    if(!area || !is_server){
+        fprintf(stderr, "Error, the gpio server is not initialized\n");
+        return 1;
+    }
+
+    while(!*stop){
+        if(drain()){
+            t_idle = 0;
+            continue;
+        }
+
+        /* Commands usually come in bursts, poll a while (yielding, there can be one core) before waiting */
+        t_now = time_ns();
+        if(!t_idle){
+            t_idle = t_now;
+        }
+        if(t_now - t_idle < SHM_POLL_NS){
+            sched_yield();
+            continue;
+        }
+        t_idle = 0;
+
+        /* Announce the wait before checking the ring again, so a client either sees it or is seen */
+        wake = __atomic_load_n(&area->wake, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&area->sleeping, 1, __ATOMIC_SEQ_CST);
+        if(__atomic_load_n(&area->ring[tail & SHM_RING_MASK].seq, __ATOMIC_SEQ_CST) != tail + 1 &&
+           !futex(&area->wake, FUTEX_WAIT, wake, &timeout)){
+            area->stats.wakeups++;
+        }
+        __atomic_store_n(&area->sleeping, 0, __ATOMIC_RELAXED);
+    }
+
+    return 0;
+}
+
+void gpio_shm_get_stats(struct gpio_shm_stats* stats){
+
+    if(area){
+        *stats = area->stats;
+    }
+    else{
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+int gpio_shm_flush(void){
+
+    if(!area || is_server){
+        return 1;
+    }
+
+    return wait_done(__atomic_load_n(&last_sent, __ATOMIC_RELAXED));
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static int shm_init(void){
+
+    int fd = shm_open(shm_name(), O_RDWR, 0);
+
+    if(fd < 0){
+        fprintf(stderr, "Error, gpio server \"%s\" is not running\n", shm_name());
+        return 1;
+    }
+
+    area = mmap(NULL, sizeof(*area), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(area == MAP_FAILED || !server_alive()){
+        fprintf(stderr, "Error, gpio server \"%s\" is not ready\n", shm_name());
+        if(area != MAP_FAILED){
+            munmap(area, sizeof(*area));
+        }
+        area = NULL;
+        return 1;
+    }
+
+    is_server = 0;
+    last_sent = 0;
+
+    return 0;
+}
+
+static void shm_deinit(void){
+
+    if(!area || is_server){
+        return;
+    }
+
+    gpio_shm_flush();
+    munmap(area, sizeof(*area));
+    area = NULL;
+}
+
+static int shm_export(uint8_t gpio_no){
+
+    return sync_cmd(SHM_CMD_EXPORT, gpio_no, 0, 0, NULL);
+}
+
+static int shm_config_dir(uint8_t gpio_no, uint8_t dir_val){
+
+    return sync_cmd(SHM_CMD_DIR, gpio_no, dir_val, 0, NULL);
+}
+
+static int shm_write(uint8_t gpio_no, uint8_t out_val){
+
+    if(gpio_no >= GPIO_MAX_NUMBER){
+        return 1;
+    }
+
+    return push_cmd(SHM_CMD_WRITE, gpio_no >> 5, 0, 1UL << (gpio_no & 31),
+                    (uint32_t)out_val << (gpio_no & 31), NULL);
+}
+
+static int shm_read(uint8_t gpio_no){
+
+    if(gpio_no >= GPIO_MAX_NUMBER){
+        return -1;
+    }
+
+    /* Read by the server after the pending writes of this process, inputs included */
+    return sync_cmd(SHM_CMD_READ, gpio_no, 0, 0, NULL);
+}
+
+static int shm_config_edge(uint8_t gpio_no, const char* edge){
+
+    fprintf(stderr, "Error, edges are not supported by the shm backend\n");
+
+    return 1;
+}
+
+static int shm_write_batch(const uint8_t* pins, uint8_t npins, uint32_t mask, uint32_t values){
+
+    uint8_t i = 0;
+    uint8_t b = 0;
+    uint32_t bank_mask[GPIO_SHM_BANKS] = {0};
+    uint32_t bank_values[GPIO_SHM_BANKS] = {0};
+
+    for(i = 0; i < npins; i++){
+        if(!(mask & (1UL << i)) || pins[i] >= GPIO_MAX_NUMBER){
+            continue;
+        }
+        bank_mask[pins[i] >> 5] |= 1UL << (pins[i] & 31);
+        if(values & (1UL << i)){
+            bank_values[pins[i] >> 5] |= 1UL << (pins[i] & 31);
+        }
+    }
+
+    /* One command per bank */
+    for(b = 0; b < GPIO_SHM_BANKS; b++){
+        if(bank_mask[b] && push_cmd(SHM_CMD_WRITE, b, 0, bank_mask[b], bank_values[b], NULL)){
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int shm_read_batch(const uint8_t* pins, uint8_t npins, uint32_t* values){
+
+    uint8_t i = 0;
+    uint8_t b = 0;
+    uint32_t bank_mask[GPIO_SHM_BANKS] = {0};
+    uint32_t levels[GPIO_SHM_BANKS] = {0};
+
+    for(i = 0; i < npins; i++){
+        if(pins[i] >= GPIO_MAX_NUMBER){
+            return 1;
+        }
+        bank_mask[pins[i] >> 5] |= 1UL << (pins[i] & 31);
+    }
+
+    /* One round trip to the server per bank */
+    for(b = 0; b < GPIO_SHM_BANKS; b++){
+        if(bank_mask[b] && sync_cmd(SHM_CMD_READ_BANK, b, 0, bank_mask[b], &levels[b])){
+            return 1;
+        }
+    }
+
+    *values = 0;
+    for(i = 0; i < npins; i++){
+        if((levels[pins[i] >> 5] >> (pins[i] & 31)) & 1){
+            *values |= 1UL << i;
+        }
+    }
+
+    return 0;
+}
+
+static int shm_write_bank(uint8_t bank, uint32_t mask, uint32_t values){
+
+    if(bank >= GPIO_SHM_BANKS){
+        return 1;
+    }
+
+    /* A bank write is already a command */
+    return push_cmd(SHM_CMD_WRITE, bank, 0, mask, values, NULL);
+}
+
+static const char* shm_name(void){
+
+    const char* name = getenv(GPIO_SHM_ENV);
+
+    return name ? name : GPIO_SHM_DEFAULT_NAME;
+}
+
+static long futex(uint32_t* addr, int op, uint32_t val, const struct timespec* timeout){
+
+    return syscall(SYS_futex, addr, op, val, timeout, NULL, 0);
+}
+
+static uint64_t time_ns(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int server_alive(void){
+
+    pid_t pid = 0;
+
+    if(__atomic_load_n(&area->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC){
+        return 0;
+    }
+    pid = area->server_pid;
+
+    return !kill(pid, 0) || errno == EPERM;
+}
+
+static int wait_done(uint32_t target){
+
+    uint32_t done = 0;
+    uint32_t last = __atomic_load_n(&area->done, __ATOMIC_ACQUIRE);
+    uint64_t t_last = time_ns();
+    struct timespec timeout = {0, SHM_WAIT_NS};
+
+    while(1){
+        done = __atomic_load_n(&area->done, __ATOMIC_ACQUIRE);
+        if((int32_t)(done - target) >= 0){
+            return 0;
+        }
+
+        /* Give up when the server is gone or stuck, instead of blocking the application */
+        if(done != last){
+            last = done;
+            t_last = time_ns();
+        }
+        else if(!server_alive() || time_ns() - t_last >= SHM_CLIENT_TIMEOUT_NS){
+            fprintf(stderr, "Error, gpio server \"%s\" is not responding\n", shm_name());
+            return 1;
+        }
+
+        __atomic_fetch_add(&area->waiters, 1, __ATOMIC_SEQ_CST);
+        futex(&area->done, FUTEX_WAIT, done, &timeout);
+        __atomic_fetch_sub(&area->waiters, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static int push_cmd(uint8_t op, uint8_t target, uint8_t arg, uint32_t mask, uint32_t values,
+                    uint32_t* pos_out){
+
+    uint32_t pos = __atomic_load_n(&area->head, __ATOMIC_RELAXED);
+    uint32_t seq = 0;
+    uint64_t t_full = 0;
+    struct shm_cmd* slot = NULL;
+
+    /* Reserve a free slot */
+    while(1){
+        slot = &area->ring[pos & SHM_RING_MASK];
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if(seq == pos){
+            if(__atomic_compare_exchange_n(&area->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+                break;
+            }
+        }
+        else if((int32_t)(seq - pos) < 0){
+            /* Full, let the server run, but not forever */
+            if(!t_full){
+                t_full = time_ns();
+            }
+            else if(!server_alive() || time_ns() - t_full >= SHM_CLIENT_TIMEOUT_NS){
+                fprintf(stderr, "Error, the ring of gpio server \"%s\" stays full\n", shm_name());
+                return 1;
+            }
+            __atomic_fetch_add(&area->wake, 1, __ATOMIC_SEQ_CST);
+            futex(&area->wake, FUTEX_WAKE, 1, NULL);
+            sched_yield();
+            pos = __atomic_load_n(&area->head, __ATOMIC_RELAXED);
+        }
+        else{
+            pos = __atomic_load_n(&area->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->op = op;
+    slot->target = target;
+    slot->arg = arg;
+    slot->mask = mask;
+    slot->values = values;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_SEQ_CST);
+
+    /* Several threads of a client can send at once, keep the latest position */
+    seq = __atomic_load_n(&last_sent, __ATOMIC_RELAXED);
+    while((int32_t)(pos + 1 - seq) > 0 &&
+          !__atomic_compare_exchange_n(&last_sent, &seq, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    /* One syscall, only if the server is waiting */
+    if(__atomic_load_n(&area->sleeping, __ATOMIC_SEQ_CST)){
+        __atomic_fetch_add(&area->wake, 1, __ATOMIC_SEQ_CST);
+        futex(&area->wake, FUTEX_WAKE, 1, NULL);
+    }
+
+    if(pos_out){
+        *pos_out = pos;
+    }
+
+    return 0;
+}
+
+static int sync_cmd(uint8_t op, uint8_t target, uint8_t arg, uint32_t mask, uint32_t* values){
+
+    int ret = 0;
+    uint32_t pos = 0;
+    uint32_t levels = 0;
+    struct shm_result* result = NULL;
+
+    if(push_cmd(op, target, arg, mask, 0, &pos) || wait_done(pos + 1)){
+        return -1;
+    }
+
+    /* Read as a seqlock, the server may be writing the result of the command a ring later */
+    result = &area->results[pos & SHM_RING_MASK];
+    if(__atomic_load_n(&result->seq, __ATOMIC_ACQUIRE) != pos + 1){
+        fprintf(stderr, "Error, result lost by gpio server \"%s\"\n", shm_name());
+        return -1;
+    }
+    ret = __atomic_load_n(&result->ret, __ATOMIC_RELAXED);
+    levels = __atomic_load_n(&result->values, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if(__atomic_load_n(&result->seq, __ATOMIC_RELAXED) != pos + 1){
+        fprintf(stderr, "Error, result lost by gpio server \"%s\"\n", shm_name());
+        return -1;
+    }
+    if(values){
+        *values = levels;
+    }
+
+    return ret;
+}
+
+static int read_bank(uint8_t bank, uint32_t mask, uint32_t* values){
+
+    uint8_t i = 0;
+    uint8_t npins = 0;
+    uint8_t pins[GPIO_PORT_MAX_PINS];
+    uint32_t port_values = 0;
+    struct gpio_port port;
+
+    for(i = 0; i < GPIO_PORT_MAX_PINS; i++){
+        if(mask & (1UL << i)){
+            pins[npins++] = bank * GPIO_PORT_MAX_PINS + i;
+        }
+    }
+    if(gpio_port_init(&port, pins, npins) || gpio_read_port(&port, &port_values)){
+        return 1;
+    }
+
+    /* Bit N of the port is the pin pins[N] */
+    *values = 0;
+    for(i = 0; i < npins; i++){
+        if(port_values & (1UL << i)){
+            *values |= 1UL << (pins[i] & 31);
+        }
+    }
+
+    return 0;
+}
+
+static uint32_t drain(void){
+
+    uint32_t n = 0;
+    uint8_t b = 0;
+    int ret = 0;
+    uint32_t values = 0;
+    struct shm_cmd* slot = NULL;
+    struct shm_result* result = NULL;
+    struct shm_cmd cmd;
+
+    while(n < GPIO_SHM_RING_SIZE){
+        slot = &area->ring[tail & SHM_RING_MASK];
+        if(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != tail + 1){
+            break;
+        }
+        cmd = *slot;
+
+        if(cmd.op == SHM_CMD_WRITE){
+            b = cmd.target % GPIO_SHM_BANKS;
+            /* A pin written twice in the batch keeps both values (e.g. a pulse) */
+            if(pending_mask[b] & cmd.mask){
+                apply_pending();
+            }
+            pending_values[b] = (pending_values[b] & ~cmd.mask) | (cmd.values & cmd.mask);
+            pending_mask[b] |= cmd.mask;
+        }
+        else{
+            /* Synchronous command, after the writes sent before it */
+            apply_pending();
+            values = 0;
+            switch(cmd.op){
+                case SHM_CMD_EXPORT:
+                    ret = gpio_export(cmd.target) ? 1 : 0;
+                    break;
+                case SHM_CMD_DIR:
+                    ret = gpio_config_dir(cmd.target, cmd.arg) ? 1 : 0;
+                    break;
+                case SHM_CMD_READ:
+                    ret = (cmd.target < GPIO_MAX_NUMBER) ? gpio_read_value(cmd.target) : -1;
+                    ret = (ret < 0) ? -1 : ret;
+                    break;
+                case SHM_CMD_READ_BANK:
+                    ret = read_bank(cmd.target % GPIO_SHM_BANKS, cmd.mask, &values) ? -1 : 0;
+                    break;
+                default:
+                    ret = 1;
+                    break;
+            }
+            if(ret < 0 || (ret && cmd.op != SHM_CMD_READ)){
+                area->stats.errors++;
+            }
+            result = &area->results[tail & SHM_RING_MASK];
+            __atomic_store_n(&result->seq, tail + 1 + GPIO_SHM_RING_SIZE / 2, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            __atomic_store_n(&result->ret, ret, __ATOMIC_RELAXED);
+            __atomic_store_n(&result->values, values, __ATOMIC_RELAXED);
+            __atomic_store_n(&result->seq, tail + 1, __ATOMIC_RELEASE);
+        }
+
+        /* The command was copied, the slot can be filled again */
+        __atomic_store_n(&slot->seq, tail + GPIO_SHM_RING_SIZE, __ATOMIC_RELEASE);
+        tail++;
+        n++;
+    }
+
+    if(!n){
+        return 0;
+    }
+
+    apply_pending();
+    area->stats.commands += n;
+    area->stats.batches++;
+
+    /* The commands up to tail are applied */
+    __atomic_store_n(&area->done, tail, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&area->waiters, __ATOMIC_SEQ_CST)){
+        futex(&area->done, FUTEX_WAKE, INT_MAX, NULL);
+    }
+
+    return n;
+}
+
+static void apply_pending(void){
+
+    uint8_t b = 0;
+
+    for(b = 0; b < GPIO_SHM_BANKS; b++){
+        if(!pending_mask[b]){
+            continue;
+        }
+        if(gpio_write_mask(&bank_ports[b], pending_mask[b], pending_values[b])){
+            area->stats.errors++;
+        }
+        area->stats.port_writes++;
+        pending_mask[b] = 0;
+    }
+}
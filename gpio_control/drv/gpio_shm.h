@@ -0,0 +1,105 @@
+/********************************************************************************************************//**
+* @file gpio_shm.h
+*
+* @brief Header file containing the prototypes of the APIs for sharing the gpios between processes through a
+*        gpio server.
+*
+* The server (gpio_server.c) is the only process driving the pins, with any other backend. The client
+* processes select the "shm" backend (GPIO_BACKEND=shm), which appends a command to a lock-free ring in a
+* POSIX shared memory object for every write, instead of a syscall per pin:
+*       - several producers (the clients) reserve slots with a compare and swap on the head, and each slot has
+*         a sequence number telling the single consumer (the server) when it is filled,
+*       - a port write is one command per bank of 32 gpios (mask and values),
+*       - the server drains all the pending commands and merges them into one backend port write per bank,
+*         a command writing a pin already pending in the merged writes flushes them first, so short pulses
+*         (e.g. the EN strobe of the HD44780) are kept,
+*       - the server only waits on a futex when the ring is empty, and the clients only wake it (one syscall)
+*         when it is waiting.
+*
+* Writes are asynchronous, gpio_shm_flush() waits until the server has applied all the commands of the
+* client. Export, direction changes and reads (inputs included) are synchronous: the server runs them after
+* the writes sent before, frees their slot at once and publishes the result in a table beside the ring, so a
+* client which gave up or died can not block the ring. Edges are not supported. A client waiting for the
+* server (full ring, flush or synchronous command) returns an error when the server stopped or did not
+* progress for 1 s.
+*
+* The shared memory object is GPIO_SHM_DEFAULT_NAME, or the name given in the GPIO_SHM environment variable.
+* It is created with mode 0600, so the clients must run as the user of the server.
+*
+* Public Functions:
+*       - int gpio_shm_server_init(void)
+*       - void gpio_shm_server_deinit(void)
+*       - int gpio_shm_serve(volatile sig_atomic_t* stop)
+*       - void gpio_shm_get_stats(struct gpio_shm_stats* stats)
+*       - int gpio_shm_flush(void)
+*/
+
+#ifndef GPIO_SHM_H
+#define GPIO_SHM_H
+
+#include <stdint.h>
+#include <signal.h>
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+#define GPIO_SHM_ENV            "GPIO_SHM"      /**< @brief Environment variable naming the object */
+#define GPIO_SHM_DEFAULT_NAME   "/gpio_server"  /**< @brief Shared memory object used by default */
+#define GPIO_SHM_RING_SIZE      1024            /**< @brief Commands in the ring, power of 2 */
+#define GPIO_SHM_BANKS          4               /**< @brief Banks of 32 gpios (GPIO_MAX_NUMBER / 32) */
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Counters of the server */
+struct gpio_shm_stats{
+    uint64_t commands;                  /**< @brief Commands applied */
+    uint64_t batches;                   /**< @brief Drains of the ring with at least one command */
+    uint64_t port_writes;               /**< @brief Merged port writes issued to the backend */
+    uint64_t wakeups;                   /**< @brief Times the server was woken by a client */
+    uint32_t errors;                    /**< @brief Commands which failed */
+};
+
+/***********************************************************************************************************/
+/*                                       APIs Supported                                                    */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for creating the shared memory object of the server.
+ * @note The backend driving the pins is the one selected in gpio_driver (gpio_init()), it can not be "shm".
+ * @return 0 if success.
+ * @return != 0 if fail (e.g. another server is running).
+ */
+int gpio_shm_server_init(void);
+
+/**
+ * @brief Function for removing the shared memory object of the server.
+ * @return void.
+ */
+void gpio_shm_server_deinit(void);
+
+/**
+ * @brief Function for serving the commands of the clients until stop is set.
+ * @param[in] stop Is polled at least every 100 ms, e.g. set by a signal handler.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_shm_serve(volatile sig_atomic_t* stop);
+
+/**
+ * @brief Function for getting the counters of the server, from the server or from a client.
+ * @param[out] stats Is the counters.
+ * @return void.
+ */
+void gpio_shm_get_stats(struct gpio_shm_stats* stats);
+
+/**
+ * @brief Function for waiting until the server has applied all the commands sent by this process.
+ * @return 0 if success.
+ * @return != 0 if fail (not connected to a server, or the server stopped or did not progress for 1 s).
+ */
+int gpio_shm_flush(void);
+
+#endif
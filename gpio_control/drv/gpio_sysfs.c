@@ -0,0 +1,403 @@
+/********************************************************************************************************//**
+* @file gpio_sysfs.c
+*
+* @brief Gpio backend using the sysfs interface (/sys/class/gpio).
+*
+* The value file of each gpio is opened once and reused with pwrite/pread. After an export the files of the
+* gpio are created (and their permissions fixed by udev) asynchronously, wait_ready polls all of them at once.
+*
+* The configuration is idempotent: a gpio already exported (e.g. by a previous run of the application) is not
+* exported again, and the direction and edge are read once and only written when they change, so restarting
+* an application on a configured system does not rewrite the sysfs tree.
+*
+* Public Functions:
+*       - int gpio_open(uint8_t gpio_no)
+*       - void gpio_close(uint8_t gpio_no)
+*       - void gpio_close_all(void)
+*       - void gpio_set_sysfs_root(const char* path)
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include "gpio_driver.h"
+#include "gpio_backend.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+#define READY_TIMEOUT_US    1000000     /**< @brief Maximum wait for exported gpios to be available */
+#define READY_POLL_US       1000        /**< @brief Period of the checks while waiting */
+
+/** @brief Direction or edge of a gpio not read yet */
+#define STATE_UNKNOWN       0xFF
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Root of the gpio sysfs tree, it can be redirected to a fake tree for testing */
+static const char* sysfs_root = SYS_FS_GPIO_PATH;
+
+/** @brief Cached file descriptors of the value files, -1 if the file is not opened */
+static int value_fd[GPIO_MAX_NUMBER] = {[0 ... GPIO_MAX_NUMBER - 1] = -1};
+
+/** @brief Direction of each gpio as read or last written, STATE_UNKNOWN if not known */
+static uint8_t pin_dir[GPIO_MAX_NUMBER] = {[0 ... GPIO_MAX_NUMBER - 1] = STATE_UNKNOWN};
+
+/** @brief Edge of each gpio (index in edge_names) as read or last written, STATE_UNKNOWN if not known */
+static uint8_t pin_edge[GPIO_MAX_NUMBER] = {[0 ... GPIO_MAX_NUMBER - 1] = STATE_UNKNOWN};
+
+/** @brief Values of the edge attribute */
+static const char* const edge_names[] = {"none", "rising", "falling", "both"};
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for getting the cached file descriptor of the value file, opening it if needed.
+ * @param[in] gpio_no Is the gpio number.
+ * @return the file descriptor if success.
+ * @return < 0 if fail.
+ */
+static int get_value_fd(uint8_t gpio_no);
+
+/**
+ * @brief Function for reading an attribute of a gpio (e.g. "direction"), without the trailing new line.
+ * @param[in] gpio_no Is the gpio number.
+ * @param[in] attr Is the name of the attribute file.
+ * @param[out] buf Is the buffer receiving the value.
+ * @param[in] len Is the size of the buffer.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int read_attr(uint8_t gpio_no, const char* attr, char* buf, size_t len);
+
+/**
+ * @brief Function for getting the index of an edge in edge_names.
+ * @param[in] edge Is the edge.
+ * @return the index, STATE_UNKNOWN if it is not a valid edge.
+ */
+static uint8_t edge_index(const char* edge);
+
+/* Backend operations, see struct gpio_backend */
+static int sysfs_export(uint8_t gpio_no);
+static int sysfs_config_dir(uint8_t gpio_no, uint8_t dir_val);
+static int sysfs_write(uint8_t gpio_no, uint8_t out_val);
+static int sysfs_read(uint8_t gpio_no);
+static int sysfs_config_edge(uint8_t gpio_no, const char* edge);
+static int sysfs_event_fd(uint8_t gpio_no, uint32_t* events);
+static int sysfs_wait_ready(const uint8_t* gpios, uint8_t n);
+
+/***********************************************************************************************************/
+/*                                       Backend Definition                                                */
+/***********************************************************************************************************/
+
+const struct gpio_backend gpio_sysfs_backend = {
+    .name = "sysfs",
+    .deinit = gpio_close_all,
+    .export = sysfs_export,
+    .config_dir = sysfs_config_dir,
+    .write = sysfs_write,
+    .read = sysfs_read,
+    .config_edge = sysfs_config_edge,
+    .event_fd = sysfs_event_fd,
+    .event_read = sysfs_read,
+    .wait_ready = sysfs_wait_ready,
+};
+
+/***********************************************************************************************************/
+/*                                       Public API Definitions                                            */
+/***********************************************************************************************************/
+
+int gpio_open(uint8_t gpio_no){
+
+    return get_value_fd(gpio_no);
+}
+
+void gpio_close(uint8_t gpio_no){
+
+    if(gpio_no < GPIO_MAX_NUMBER){
+        if(value_fd[gpio_no] >= 0){
+            close(value_fd[gpio_no]);
+            value_fd[gpio_no] = -1;
+        }
+        pin_dir[gpio_no] = STATE_UNKNOWN;
+        pin_edge[gpio_no] = STATE_UNKNOWN;
+    }
+}
+
+void gpio_close_all(void){
+
+    int i = 0;
+
+    for(i = 0; i < GPIO_MAX_NUMBER; i++){
+        gpio_close(i);
+    }
+}
+
+void gpio_set_sysfs_root(const char* path){
+
+    /* Cached handles and states belong to the previous tree */
+    gpio_close_all();
+    sysfs_root = path ? path : SYS_FS_GPIO_PATH;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static int get_value_fd(uint8_t gpio_no){
+
+    char buf[100] = {0};
+
+    if(gpio_no >= GPIO_MAX_NUMBER){
+        errno = EINVAL;
+        perror("Error, gpio number out of range");
+        return -1;
+    }
+
+    if(value_fd[gpio_no] < 0){
+        snprintf(buf, sizeof(buf), "%s/gpio%d/value", sysfs_root, gpio_no);
+        value_fd[gpio_no] = open(buf, O_RDWR);
+        if(value_fd[gpio_no] < 0){
+            perror("Error, file for managing gpio could not be opened");
+        }
+    }
+
+    return value_fd[gpio_no];
+}
+
+static int sysfs_export(uint8_t gpio_no){
+
+    int fd = 0;
+    int len = 0;
+    int ret = 0;
+    char buf[100] = {0};
+
+    /* A gpio already exported is not exported again (the kernel would reject it with EBUSY) */
+    snprintf(buf, sizeof(buf), "%s/gpio%d", sysfs_root, gpio_no);
+    if(access(buf, F_OK)){
+        snprintf(buf, sizeof(buf), "%s/export", sysfs_root);
+
+        fd = open(buf, O_WRONLY);
+        if(fd < 0){
+            perror("Error, filer for exporting gpio could not be opened");
+            return fd;
+        }
+
+        len = snprintf(buf, sizeof(buf), "%d", gpio_no);
+        ret = write(fd, buf, len);
+
+        /* EBUSY if exported meanwhile (e.g. by another process), which is what was asked */
+        if(ret < 0 && errno != EBUSY){
+            perror("Error, gpio could not be exported");
+            close(fd);
+            return ret;
+        }
+
+        close(fd);
+    }
+
+    /* Try to open the value file now, if udev has not created it yet it will be opened on first use */
+    if(gpio_no < GPIO_MAX_NUMBER && value_fd[gpio_no] < 0){
+        snprintf(buf, sizeof(buf), "%s/gpio%d/value", sysfs_root, gpio_no);
+        value_fd[gpio_no] = open(buf, O_RDWR);
+    }
+
+    return 0;
+}
+
+static int sysfs_config_dir(uint8_t gpio_no, uint8_t dir_val){
+
+    int fd = 0;
+    int ret = 0;
+    char buf[100] = {0};
+
+    dir_val = dir_val ? GPIO_DIR_OUT : GPIO_DIR_IN;
+
+    /* The current direction is read once, then only changes are written */
+    if(gpio_no < GPIO_MAX_NUMBER){
+        if(pin_dir[gpio_no] == STATE_UNKNOWN && !read_attr(gpio_no, "direction", buf, sizeof(buf))){
+            pin_dir[gpio_no] = strcmp(buf, "in") ? GPIO_DIR_OUT : GPIO_DIR_IN;
+        }
+        if(pin_dir[gpio_no] == dir_val){
+            return 0;
+        }
+    }
+
+    snprintf(buf, sizeof(buf), "%s/gpio%d/direction", sysfs_root, gpio_no);
+
+    fd = open(buf, O_WRONLY);
+    if(fd < 0){
+        perror("Error, file for managing gpio could not be opened");
+        return fd;
+    }
+
+    if(dir_val){
+        ret = write(fd, "out", 4);
+    }
+    else{
+        ret = write(fd, "in", 3);
+    }
+
+    if(ret < 0){
+        perror("Error, gpio direction could not be set");
+    }
+
+    close(fd);
+
+    if(gpio_no < GPIO_MAX_NUMBER){
+        pin_dir[gpio_no] = ret < 0 ? STATE_UNKNOWN : dir_val;
+    }
+
+    return ret < 0 ? ret : 0;
+}
+
+static int sysfs_write(uint8_t gpio_no, uint8_t out_val){
+
+    int fd = get_value_fd(gpio_no);
+
+    if(fd < 0){
+        return fd;
+    }
+
+    if(pwrite(fd, out_val ? "1" : "0", 1, 0) < 0){
+        perror("Error, gpio value could not be written");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int sysfs_read(uint8_t gpio_no){
+
+    int fd = get_value_fd(gpio_no);
+    char read_val = 0;
+
+    if(fd < 0){
+        return fd;
+    }
+
+    if(pread(fd, &read_val, 1, 0) < 0){
+        perror("Error, gpio value could not be read");
+        return -1;
+    }
+
+    return read_val == '1';
+}
+
+static int sysfs_config_edge(uint8_t gpio_no, const char* edge){
+
+    int fd = 0;
+    int ret = 0;
+    uint8_t index = edge_index(edge);
+    char buf[100] = {0};
+
+    /* The current edge is read once, then only changes are written */
+    if(gpio_no < GPIO_MAX_NUMBER && index != STATE_UNKNOWN){
+        if(pin_edge[gpio_no] == STATE_UNKNOWN && !read_attr(gpio_no, "edge", buf, sizeof(buf))){
+            pin_edge[gpio_no] = edge_index(buf);
+        }
+        if(pin_edge[gpio_no] == index){
+            return 0;
+        }
+    }
+
+    snprintf(buf, sizeof(buf), "%s/gpio%d/edge", sysfs_root, gpio_no);
+
+    fd = open(buf, O_WRONLY);
+    if(fd < 0){
+        perror("Error, file for managing gpio could not be opened");
+        return fd;
+    }
+
+    ret = write(fd, edge, strlen(edge) + 1);
+    if(ret < 0){
+        perror("Error, gpio edge could not be set");
+    }
+
+    close(fd);
+
+    if(gpio_no < GPIO_MAX_NUMBER){
+        pin_edge[gpio_no] = ret < 0 ? STATE_UNKNOWN : index;
+    }
+
+    return ret < 0 ? ret : 0;
+}
+
+static int sysfs_event_fd(uint8_t gpio_no, uint32_t* events){
+
+    /* The kernel signals the edges as an exceptional condition on the value file, reading it re-arms it */
+    *events = EPOLLPRI | EPOLLERR;
+
+    return get_value_fd(gpio_no);
+}
+
+static int sysfs_wait_ready(const uint8_t* gpios, uint8_t n){
+
+    uint8_t i = 0;
+    uint32_t waited_us = 0;
+    char buf[100] = {0};
+
+    /* Every check restarts from the first gpio not available yet */
+    while(i < n){
+        snprintf(buf, sizeof(buf), "%s/gpio%d/direction", sysfs_root, gpios[i]);
+        if(!access(buf, W_OK)){
+            i++;
+            continue;
+        }
+        if(waited_us >= READY_TIMEOUT_US){
+            perror("Error, exported gpio is not available");
+            return -1;
+        }
+        usleep(READY_POLL_US);
+        waited_us += READY_POLL_US;
+    }
+
+    return 0;
+}
+
+static int read_attr(uint8_t gpio_no, const char* attr, char* buf, size_t len){
+
+    int fd = 0;
+    ssize_t n = 0;
+
+    snprintf(buf, len, "%s/gpio%d/%s", sysfs_root, gpio_no, attr);
+
+    fd = open(buf, O_RDONLY);
+    if(fd < 0){
+        return -1;
+    }
+
+    n = read(fd, buf, len - 1);
+    close(fd);
+    if(n < 0){
+        return -1;
+    }
+
+    buf[n] = '\0';
+    buf[strcspn(buf, "\n")] = '\0';
+
+    return 0;
+}
+
+static uint8_t edge_index(const char* edge){
+
+    uint8_t i = 0;
+
+    for(i = 0; i < sizeof(edge_names) / sizeof(edge_names[0]); i++){
+        if(!strcmp(edge, edge_names[i])){
+            return i;
+        }
+    }
+
+    return STATE_UNKNOWN;
+}
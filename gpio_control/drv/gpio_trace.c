@@ -0,0 +1,206 @@
+/********************************************************************************************************//**
+* @file gpio_trace.c
+*
+* @brief Ring of the gpio transitions written by gpio_driver and its flush to a trace file.
+*
+* Public Functions:
+*       - int gpio_trace_enable(const char* path)
+*       - void gpio_trace_disable(void)
+*       - void gpio_trace_reset(void)
+*       - int gpio_trace_flush(const char* path)
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "gpio_trace.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Maximum length of the path of the trace file */
+#define TRACE_PATH_LEN          256
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+volatile uint8_t gpio_trace_enabled = 0;
+
+uint32_t gpio_trace_head = 0;
+
+uint64_t gpio_trace_ring[GPIO_TRACE_RING_SIZE];
+
+/** @brief Trace file written at exit and on the signals, empty if none */
+static char trace_path[TRACE_PATH_LEN];
+
+/** @brief SIGINT action of the application when the tracing was enabled, called after the flush */
+static struct sigaction prev_sigint;
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for writing a buffer to a file, retrying the partial writes.
+ * @param[in] fd Is the file descriptor.
+ * @param[in] buf Is the buffer.
+ * @param[in] len Is the number of bytes.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+static int write_all(int fd, const void* buf, size_t len);
+
+/**
+ * @brief Function for flushing to the trace file given at enable time.
+ * @return void.
+ */
+static void flush_default(void);
+
+/**
+ * @brief Signal handler for SIGUSR2, flushing the trace file.
+ * @param[in] sig Is the signal number.
+ * @return void.
+ */
+static void sigusr2_handler(int sig);
+
+/**
+ * @brief Signal handler for SIGINT, flushing the trace file and then running the previous action.
+ * @param[in] sig Is the signal number.
+ * @param[in] info Is the signal information, given to the previous handler.
+ * @param[in] ctx Is the context, given to the previous handler.
+ * @return void.
+ */
+static void sigint_handler(int sig, siginfo_t* info, void* ctx);
+
+/***********************************************************************************************************/
+/*                                       Public API Definitions                                            */
+/***********************************************************************************************************/
+
+int gpio_trace_enable(const char* path){
+
+    static uint8_t handlers_registered = 0;
+    struct sigaction sa;
+
+    if(path && strlen(path) >= TRACE_PATH_LEN){
+        fprintf(stderr, "Error, the path of the gpio trace can not be longer than %d\n", TRACE_PATH_LEN - 1);
+        return 1;
+    }
+    strcpy(trace_path, path ? path : "");
+
+    if(!handlers_registered){
+        signal(SIGUSR2, sigusr2_handler);
+
+        /* Chained to the handler of the application (e.g. stopping it cleanly), with the same flags */
+        sigaction(SIGINT, NULL, &prev_sigint);
+        if(prev_sigint.sa_handler != SIG_IGN){
+            sa = prev_sigint;
+            sa.sa_sigaction = sigint_handler;
+            sa.sa_flags = (prev_sigint.sa_flags & SA_RESTART) | SA_SIGINFO;
+            sigaction(SIGINT, &sa, NULL);
+        }
+        atexit(flush_default);
+        handlers_registered = 1;
+    }
+
+    gpio_trace_enabled = 1;
+
+    return 0;
+}
+
+void gpio_trace_disable(void){
+
+    gpio_trace_enabled = 0;
+}
+
+void gpio_trace_reset(void){
+
+    __atomic_store_n(&gpio_trace_head, 0, __ATOMIC_RELAXED);
+}
+
+int gpio_trace_flush(const char* path){
+
+    int fd = -1;
+    int ret = 0;
+    uint32_t head = __atomic_load_n(&gpio_trace_head, __ATOMIC_ACQUIRE);
+    uint32_t count = head < GPIO_TRACE_RING_SIZE ? head : GPIO_TRACE_RING_SIZE;
+    uint32_t first = (head - count) & (GPIO_TRACE_RING_SIZE - 1);
+    uint32_t n1 = count < GPIO_TRACE_RING_SIZE - first ? count : GPIO_TRACE_RING_SIZE - first;
+    struct gpio_trace_header hdr;
+
+    memcpy(hdr.magic, GPIO_TRACE_MAGIC, sizeof(hdr.magic));
+    hdr.nevents = count;
+    hdr.dropped = head - count;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0){
+        return 1;
+    }
+
+    /* Oldest events first, the ring can wrap once */
+    ret = write_all(fd, &hdr, sizeof(hdr)) ||
+          write_all(fd, &gpio_trace_ring[first], n1 * sizeof(uint64_t)) ||
+          write_all(fd, gpio_trace_ring, (count - n1) * sizeof(uint64_t));
+    close(fd);
+
+    return ret;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static int write_all(int fd, const void* buf, size_t len){
+
+    ssize_t n = 0;
+    const uint8_t* p = buf;
+
+    while(len){
+        n = write(fd, p, len);
+        if(n <= 0){
+            return 1;
+        }
+        p += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+static void flush_default(void){
+
+    if(trace_path[0] && gpio_trace_flush(trace_path)){
+        perror("Error, gpio trace could not be written");
+    }
+}
+
+static void sigusr2_handler(int sig){
+
+    if(trace_path[0]){
+        gpio_trace_flush(trace_path);
+    }
+}
+
+static void sigint_handler(int sig, siginfo_t* info, void* ctx){
+
+    if(trace_path[0]){
+        gpio_trace_flush(trace_path);
+    }
+
+    if(prev_sigint.sa_flags & SA_SIGINFO){
+        prev_sigint.sa_sigaction(sig, info, ctx);
+    }
+    else if(prev_sigint.sa_handler != SIG_DFL){
+        prev_sigint.sa_handler(sig);
+    }
+    else{
+        /* Terminate as if the handler was not installed */
+        sigaction(SIGINT, &prev_sigint, NULL);
+        raise(SIGINT);
+    }
+}
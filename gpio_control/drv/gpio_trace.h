@@ -0,0 +1,175 @@
+/********************************************************************************************************//**
+* @file gpio_trace.h
+*
+* @brief Header file containing the prototypes of the APIs for recording the gpio transitions.
+*
+* When enabled, every pin write issued by gpio_driver (writes elided by the shadow copy are not transitions)
+* is appended to an in-memory ring of GPIO_TRACE_RING_SIZE events, overwriting the oldest ones. An event is
+* one 64 bit word: the CLOCK_MONOTONIC timestamp in ns in the bits 63 to 8, the gpio in the bits 7 to 1 and
+* the value in bit 0. Recording an event is an atomic increment of the head and one store. The pins of a
+* batched port write share one timestamp and one increment, so each of them costs one store.
+*
+* It is enabled at run time with gpio_trace_enable() or setting the GPIO_TRACE environment variable to the
+* path of the trace file before the first gpio call. The ring is written to that file at exit, on SIGINT
+* (before the SIGINT handler of the application, if any) and every time SIGUSR2 is received, and it can be
+* converted to VCD (GTKWave) with tools/trace2vcd.c:
+*       GPIO_TRACE=/tmp/lcd.trace ./test_lcd &
+*       kill -USR2 $!
+*       ./trace2vcd /tmp/lcd.trace /tmp/lcd.vcd
+*
+* The file is a struct gpio_trace_header followed by the events in time order (host byte order).
+*
+* Public Functions:
+*       - int gpio_trace_enable(const char* path)
+*       - void gpio_trace_disable(void)
+*       - void gpio_trace_reset(void)
+*       - int gpio_trace_flush(const char* path)
+*       - uint64_t gpio_trace_now(void)
+*       - void gpio_trace_record(uint64_t t_ns, uint8_t gpio_no, uint8_t value)
+*       - void gpio_trace_record_port(uint64_t t_ns, const uint8_t* pins, uint32_t changed, uint32_t values)
+*/
+
+#ifndef GPIO_TRACE_H
+#define GPIO_TRACE_H
+
+#include <stdint.h>
+#include <time.h>
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+#define GPIO_TRACE_ENV          "GPIO_TRACE"    /**< @brief Environment variable enabling it (trace file) */
+#define GPIO_TRACE_RING_SIZE    (1 << 16)       /**< @brief Events kept in the ring, power of 2 */
+#define GPIO_TRACE_MAGIC        "GPIOTRC1"      /**< @brief First bytes of a trace file */
+
+/** @brief Packing of an event, see the file description */
+#define GPIO_TRACE_EVENT(t_ns, gpio, value) (((uint64_t)(t_ns) << 8) | (((gpio) & 0x7F) << 1) | ((value) & 1))
+#define GPIO_TRACE_T_NS(ev)     ((ev) >> 8)
+#define GPIO_TRACE_GPIO(ev)     (((ev) >> 1) & 0x7F)
+#define GPIO_TRACE_VALUE(ev)    ((ev) & 1)
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Header of a trace file */
+struct gpio_trace_header{
+    char magic[8];                      /**< @brief GPIO_TRACE_MAGIC, without the null character */
+    uint32_t nevents;                   /**< @brief Events following the header */
+    uint32_t dropped;                   /**< @brief Oldest events overwritten in the ring */
+};
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief The tracing is enabled, read by the inline functions */
+extern volatile uint8_t gpio_trace_enabled;
+
+/** @brief Number of events recorded since the last reset, the next one is stored at head % size */
+extern uint32_t gpio_trace_head;
+
+/** @brief Ring of events */
+extern uint64_t gpio_trace_ring[GPIO_TRACE_RING_SIZE];
+
+/***********************************************************************************************************/
+/*                                       APIs Supported                                                    */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for enabling the tracing.
+ * @note Enabling it installs the SIGUSR2 handler, registers the flush at exit and chains a flush before
+ *       the SIGINT action installed by the application (or the default one, terminating the process).
+ * @param[in] path Is the trace file written at exit and on the signals, NULL for only gpio_trace_flush().
+ * @return 0 if success.
+ * @return != 0 if fail (path too long).
+ */
+int gpio_trace_enable(const char* path);
+
+/**
+ * @brief Function for disabling the tracing, the recorded events are kept.
+ * @return void.
+ */
+void gpio_trace_disable(void);
+
+/**
+ * @brief Function for dropping the recorded events.
+ * @return void.
+ */
+void gpio_trace_reset(void);
+
+/**
+ * @brief Function for writing the recorded events to a trace file.
+ * @note It only uses async-signal-safe calls. Events recorded during the flush may be missing or partial.
+ * @param[in] path Is the path of the file, it is truncated.
+ * @return 0 if success.
+ * @return != 0 if fail.
+ */
+int gpio_trace_flush(const char* path);
+
+/**
+ * @brief Function for getting the timestamp of a pin write.
+ * @return the CLOCK_MONOTONIC time in ns, 0 if the tracing is disabled.
+ */
+static inline uint64_t gpio_trace_now(void){
+
+    struct timespec ts;
+
+    if(!gpio_trace_enabled){
+        return 0;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Function for recording a transition, lock free (several threads can record at once).
+ * @param[in] t_ns Is the value returned by gpio_trace_now(), nothing is recorded if 0.
+ * @param[in] gpio_no Is the gpio number.
+ * @param[in] value Is the value written (0 or 1).
+ * @return void.
+ */
+static inline void gpio_trace_record(uint64_t t_ns, uint8_t gpio_no, uint8_t value){
+
+    uint32_t idx = 0;
+
+    if(!t_ns){
+        return;
+    }
+
+    idx = __atomic_fetch_add(&gpio_trace_head, 1, __ATOMIC_RELAXED);
+    gpio_trace_ring[idx & (GPIO_TRACE_RING_SIZE - 1)] = GPIO_TRACE_EVENT(t_ns, gpio_no, value);
+}
+
+/**
+ * @brief Function for recording the transitions of a batched port write, lock free.
+ * @param[in] t_ns Is the value returned by gpio_trace_now(), nothing is recorded if 0.
+ * @param[in] pins Is the array of gpios of the port.
+ * @param[in] changed Is the bitmask of the pins written.
+ * @param[in] values Is the value of each written pin.
+ * @return void.
+ */
+static inline void gpio_trace_record_port(uint64_t t_ns, const uint8_t* pins, uint32_t changed,
+                                          uint32_t values){
+
+    uint32_t idx = 0;
+    uint8_t i = 0;
+
+    if(!t_ns || !changed){
+        return;
+    }
+
+    /* One slot reserved per pin, then filled in order of bit */
+    idx = __atomic_fetch_add(&gpio_trace_head, __builtin_popcount(changed), __ATOMIC_RELAXED);
+    for(i = 0; changed; i++, changed >>= 1){
+        if(changed & 1){
+            gpio_trace_ring[idx++ & (GPIO_TRACE_RING_SIZE - 1)] = GPIO_TRACE_EVENT(t_ns, pins[i],
+                                                                                   values >> i);
+        }
+    }
+}
+
+#endif
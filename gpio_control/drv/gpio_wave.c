@@ -0,0 +1,152 @@
+/********************************************************************************************************//**
+* @file gpio_wave.c
+*
+* @brief Playback of precomputed waveforms on gpio ports with absolute deadlines.
+*
+* Public Functions:
+*       - void gpio_wave_init(struct gpio_wave* wave, struct gpio_port* port, struct gpio_wave_step* steps,
+*                             uint32_t max_steps)
+*       - void gpio_wave_clear(struct gpio_wave* wave)
+*       - int gpio_wave_add(struct gpio_wave* wave, uint32_t delay_ns, uint32_t mask, uint32_t values)
+*       - int gpio_wave_play(const struct gpio_wave* wave, struct gpio_wave_report* report)
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include "gpio_driver.h"
+#include "gpio_wave.h"
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for waiting until an absolute deadline, sleeping and then busy waiting.
+ * @param[in] deadline_ns Is the CLOCK_MONOTONIC deadline.
+ * @return the time when the wait ended.
+ */
+static uint64_t wait_until(uint64_t deadline_ns);
+
+/**
+ * @brief Function for getting the monotonic time in ns.
+ * @return the current time.
+ */
+static uint64_t now_ns(void);
+
+/***********************************************************************************************************/
+/*                                       Public API Definitions                                            */
+/***********************************************************************************************************/
+
+void gpio_wave_init(struct gpio_wave* wave, struct gpio_port* port, struct gpio_wave_step* steps,
+                    uint32_t max_steps){
+
+    wave->port = port;
+    wave->steps = steps;
+    wave->nsteps = 0;
+    wave->max_steps = max_steps;
+}
+
+void gpio_wave_clear(struct gpio_wave* wave){
+
+    wave->nsteps = 0;
+}
+
+int gpio_wave_add(struct gpio_wave* wave, uint32_t delay_ns, uint32_t mask, uint32_t values){
+
+    struct gpio_wave_step* last = wave->nsteps ? &wave->steps[wave->nsteps - 1] : NULL;
+
+    /* Same time as the previous step, one port write */
+    if(last && !delay_ns){
+        last->values = (last->values & ~mask) | (values & mask);
+        last->mask |= mask;
+        return 0;
+    }
+
+    if(wave->nsteps >= wave->max_steps){
+        fprintf(stderr, "Error, the waveform can not contain more than %u steps\n", wave->max_steps);
+        return 1;
+    }
+
+    wave->steps[wave->nsteps].t_ns = (last ? last->t_ns : 0) + (uint64_t)delay_ns;
+    wave->steps[wave->nsteps].mask = mask;
+    wave->steps[wave->nsteps].values = values & mask;
+    wave->nsteps++;
+
+    return 0;
+}
+
+int gpio_wave_play(const struct gpio_wave* wave, struct gpio_wave_report* report){
+
+    uint32_t i = 0;
+    uint64_t t_start = 0;
+    uint64_t deadline = 0;
+    uint64_t now = 0;
+    uint64_t late = 0;
+    uint64_t late_total = 0;
+    uint64_t late_max = 0;
+    int ret = 0;
+
+    t_start = now_ns();
+
+    for(i = 0; i < wave->nsteps; i++){
+        deadline = t_start + wave->steps[i].t_ns;
+        now = wait_until(deadline);
+
+        late = now - deadline;
+        late_total += late;
+        if(late > late_max){
+            late_max = late;
+        }
+
+        if(wave->steps[i].mask && gpio_write_mask(wave->port, wave->steps[i].mask, wave->steps[i].values)){
+            ret = 1;
+            break;
+        }
+    }
+
+    if(report){
+        report->steps = i;
+        report->late_mean_ns = i ? late_total / i : 0;
+        report->late_max_ns = late_max > UINT32_MAX ? UINT32_MAX : late_max;
+        report->duration_ns = now_ns() - t_start;
+    }
+
+    return ret;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static uint64_t wait_until(uint64_t deadline_ns){
+
+    uint64_t now = now_ns();
+    uint64_t wake = 0;
+    struct timespec ts;
+
+    /* Sleep, leaving the wake up latency of the kernel to the busy wait */
+    if(now + GPIO_WAVE_SPIN_NS < deadline_ns){
+        wake = deadline_ns - GPIO_WAVE_SPIN_NS;
+        ts.tv_sec = wake / 1000000000ULL;
+        ts.tv_nsec = wake % 1000000000ULL;
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+        now = now_ns();
+    }
+
+    while(now < deadline_ns){
+        now = now_ns();
+    }
+
+    return now;
+}
+
+static uint64_t now_ns(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
@@ -0,0 +1,113 @@
+/********************************************************************************************************//**
+* @file gpio_wave.h
+*
+* @brief Header file containing the prototypes of the APIs for playing precomputed waveforms on gpio ports.
+*
+* A waveform is a vector of steps (time offset from the start, port mask and values), built once with
+* gpio_wave_add() and played with gpio_wave_play(). Steps at the same time are merged into one port write,
+* and steps with an empty mask only wait. Every step is written at an absolute deadline from the start of
+* the playback, so the write latency does not accumulate: the thread sleeps until shortly before the
+* deadline and busy waits the last GPIO_WAVE_SPIN_NS. The port writes use the batched write of the selected
+* backend (one write per bank with mmio or chardev).
+*
+* The storage of the steps is given by the caller, e.g. for the frame of a 4 digit display:
+*       struct gpio_wave_step steps[8];
+*       gpio_wave_init(&wave, &port, steps, 8);
+*       gpio_wave_add(&wave, 0, SEG_MASK | DIG1, segments | DIG1);
+*       gpio_wave_add(&wave, 100000, SEG_MASK | DIG1, 0);
+*       ...
+*       gpio_wave_play(&wave, &report);
+*
+* Public Functions:
+*       - void gpio_wave_init(struct gpio_wave* wave, struct gpio_port* port, struct gpio_wave_step* steps,
+*                             uint32_t max_steps)
+*       - void gpio_wave_clear(struct gpio_wave* wave)
+*       - int gpio_wave_add(struct gpio_wave* wave, uint32_t delay_ns, uint32_t mask, uint32_t values)
+*       - int gpio_wave_play(const struct gpio_wave* wave, struct gpio_wave_report* report)
+*/
+
+#ifndef GPIO_WAVE_H
+#define GPIO_WAVE_H
+
+#include <stdint.h>
+#include "gpio_driver.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief Time before a deadline spent busy waiting instead of sleeping (wake up latency of the kernel) */
+#define GPIO_WAVE_SPIN_NS       100000
+
+/***********************************************************************************************************/
+/*                                       Structures                                                        */
+/***********************************************************************************************************/
+
+/** @brief Port write at a time offset of the waveform */
+struct gpio_wave_step{
+    uint64_t t_ns;                      /**< @brief Time from the start of the waveform (64 bits, the
+                                             delays of a long waveform add up past 4.29 s) */
+    uint32_t mask;                      /**< @brief Pins of the port written, 0 for only waiting */
+    uint32_t values;                    /**< @brief Values of the written pins */
+};
+
+/** @brief Waveform played on a port */
+struct gpio_wave{
+    struct gpio_port* port;             /**< @brief Port written */
+    struct gpio_wave_step* steps;       /**< @brief Steps sorted by time */
+    uint32_t nsteps;                    /**< @brief Number of steps */
+    uint32_t max_steps;                 /**< @brief Size of the steps array */
+};
+
+/** @brief Timing achieved by a playback */
+struct gpio_wave_report{
+    uint32_t steps;                     /**< @brief Steps played */
+    uint32_t late_mean_ns;              /**< @brief Mean time from the deadline of a step to its write */
+    uint32_t late_max_ns;               /**< @brief Latest step */
+    uint64_t duration_ns;               /**< @brief Time from the start to the end of the last step */
+};
+
+/***********************************************************************************************************/
+/*                                       APIs Supported                                                    */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for initializing an empty waveform.
+ * @param[out] wave Is the waveform.
+ * @param[in] port Is the port written by the waveform.
+ * @param[in] steps Is the storage of the steps.
+ * @param[in] max_steps Is the number of steps of the storage.
+ * @return void.
+ */
+void gpio_wave_init(struct gpio_wave* wave, struct gpio_port* port, struct gpio_wave_step* steps,
+                    uint32_t max_steps);
+
+/**
+ * @brief Function for removing all the steps of a waveform (e.g. before building the next frame).
+ * @param[in,out] wave Is the waveform.
+ * @return void.
+ */
+void gpio_wave_clear(struct gpio_wave* wave);
+
+/**
+ * @brief Function for appending a step to a waveform.
+ * @note A step with delay_ns 0 is merged into the previous one.
+ * @param[in,out] wave Is the waveform.
+ * @param[in] delay_ns Is the time from the previous step (from the start for the first one).
+ * @param[in] mask Is the bitmask of the port pins written (bit N is port->pins[N]), 0 for only waiting.
+ * @param[in] values Is the value of each pin selected by the mask.
+ * @return 0 if success.
+ * @return != 0 if fail (no free step).
+ */
+int gpio_wave_add(struct gpio_wave* wave, uint32_t delay_ns, uint32_t mask, uint32_t values);
+
+/**
+ * @brief Function for playing a waveform, it returns after the last step.
+ * @param[in] wave Is the waveform.
+ * @param[out] report Is the timing achieved, it can be NULL.
+ * @return 0 if success.
+ * @return != 0 if fail (a port write failed, the playback is aborted).
+ */
+int gpio_wave_play(const struct gpio_wave* wave, struct gpio_wave_report* report);
+
+#endif
@@ -0,0 +1,78 @@
+/********************************************************************************************************//**
+* @file gpio_server.c
+*
+* @brief Daemon owning the gpios and applying the writes of the client applications (see gpio_shm.h).
+*
+* The clients select the shm backend, e.g. two applications sharing the pins of the 4 digit display:
+*       ./gpio_server mmio &
+*       GPIO_BACKEND=shm ./test_4dig7seg clock
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <signal.h>
+#include "gpio_driver.h"
+#include "gpio_shm.h"
+
+/***********************************************************************************************************/
+/*                                       Global Variables                                                  */
+/***********************************************************************************************************/
+
+/** @brief Set by SIGINT and SIGTERM */
+static volatile sig_atomic_t stop = 0;
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Signal handler for SIGINT and SIGTERM, stopping the server.
+ * @param[in] sig Is the signal number.
+ * @return void.
+ */
+static void stop_handler(int sig);
+
+/***********************************************************************************************************/
+/*                                       Main Function                                                     */
+/***********************************************************************************************************/
+
+int main(int argc, char* argv[]){
+
+    struct gpio_shm_stats stats;
+
+    if(argc > 2){
+        printf("Usage: %s [backend]\n", argv[0]);
+        printf("Valid backend: sysfs, chardev, mmio or mock (GPIO_BACKEND or sysfs if not given)\n");
+        return EXIT_FAILURE;
+    }
+
+    if(gpio_init(argc == 2 ? argv[1] : NULL) || gpio_shm_server_init()){
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGINT, stop_handler);
+    signal(SIGTERM, stop_handler);
+
+    printf("gpio server running on the %s backend...\n", gpio_backend_name());
+    gpio_shm_serve(&stop);
+
+    gpio_shm_get_stats(&stats);
+    printf("commands %llu, batches %llu, port writes %llu, wake ups %llu, errors %u\n",
+           (unsigned long long)stats.commands, (unsigned long long)stats.batches,
+           (unsigned long long)stats.port_writes, (unsigned long long)stats.wakeups, stats.errors);
+
+    gpio_shm_server_deinit();
+    gpio_deinit();
+
+    return 0;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static void stop_handler(int sig){
+
+    stop = 1;
+}
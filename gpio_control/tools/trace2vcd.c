@@ -0,0 +1,173 @@
+/********************************************************************************************************//**
+* @file trace2vcd.c
+*
+* @brief Converter of a gpio trace file (gpio_trace.h) to a Value Change Dump file, opened with GTKWave.
+*
+* Each traced gpio is a 1 bit wire named gpioN, the time is in ns from the first event of the trace. The
+* value of a gpio is unknown (x) until its first event.
+*       ./trace2vcd /tmp/lcd.trace /tmp/lcd.vcd
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gpio_driver.h"
+#include "gpio_trace.h"
+
+/***********************************************************************************************************/
+/*                                       Defines and Macros                                                */
+/***********************************************************************************************************/
+
+/** @brief First printable character used in the VCD identifiers */
+#define VCD_ID_BASE             '!'
+
+/** @brief Number of printable characters used in the VCD identifiers ('!' to '~') */
+#define VCD_ID_CHARS            94
+
+/***********************************************************************************************************/
+/*                                       Static Function Prototypes                                        */
+/***********************************************************************************************************/
+
+/**
+ * @brief Function for reading a trace file.
+ * @param[in] path Is the path of the trace file.
+ * @param[out] hdr Is the header of the file.
+ * @return the events (to be freed), NULL if fail.
+ */
+static uint64_t* read_trace(const char* path, struct gpio_trace_header* hdr);
+
+/**
+ * @brief Function for writing the VCD file.
+ * @param[out] out Is the output stream.
+ * @param[in] events Is the array of events, in time order.
+ * @param[in] n Is the number of events.
+ * @return void.
+ */
+static void write_vcd(FILE* out, const uint64_t* events, uint32_t n);
+
+/***********************************************************************************************************/
+/*                                       Main Function                                                     */
+/***********************************************************************************************************/
+
+int main(int argc, char* argv[]){
+
+    FILE* out = NULL;
+    uint64_t* events = NULL;
+    struct gpio_trace_header hdr;
+
+    if(argc != 3){
+        printf("Usage: %s <trace file> <vcd file>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    events = read_trace(argv[1], &hdr);
+    if(!events){
+        return EXIT_FAILURE;
+    }
+
+    out = fopen(argv[2], "w");
+    if(!out){
+        perror("Error, vcd file could not be opened");
+        free(events);
+        return EXIT_FAILURE;
+    }
+
+    write_vcd(out, events, hdr.nevents);
+    fclose(out);
+    free(events);
+
+    printf("%u events converted (%u older events were overwritten in the ring)\n", hdr.nevents, hdr.dropped);
+
+    return 0;
+}
+
+/***********************************************************************************************************/
+/*                                       Static Function Definitions                                       */
+/***********************************************************************************************************/
+
+static uint64_t* read_trace(const char* path, struct gpio_trace_header* hdr){
+
+    FILE* f = fopen(path, "rb");
+    uint64_t* events = NULL;
+
+    if(!f){
+        perror("Error, trace file could not be opened");
+        return NULL;
+    }
+
+    if(fread(hdr, sizeof(*hdr), 1, f) != 1 || memcmp(hdr->magic, GPIO_TRACE_MAGIC, sizeof(hdr->magic))){
+        fprintf(stderr, "Error, %s is not a gpio trace file\n", path);
+        fclose(f);
+        return NULL;
+    }
+
+    /* One more element, so an empty trace is not a failed allocation */
+    events = malloc(((size_t)hdr->nevents + 1) * sizeof(uint64_t));
+    if(!events || fread(events, sizeof(uint64_t), hdr->nevents, f) != hdr->nevents){
+        fprintf(stderr, "Error, %s is truncated\n", path);
+        free(events);
+        fclose(f);
+        return NULL;
+    }
+
+    fclose(f);
+
+    return events;
+}
+
+static void write_vcd(FILE* out, const uint64_t* events, uint32_t n){
+
+    uint32_t i = 0;
+    uint8_t gpio = 0;
+    uint8_t nwires = 0;
+    uint8_t traced[GPIO_MAX_NUMBER] = {0};
+    uint64_t t0 = UINT64_MAX;
+    uint64_t t = 0;
+    uint64_t t_last = UINT64_MAX;
+    char id[GPIO_MAX_NUMBER][3];
+
+    /* One wire per traced gpio, in order of gpio number */
+    for(i = 0; i < n; i++){
+        traced[GPIO_TRACE_GPIO(events[i])] = 1;
+        if(GPIO_TRACE_T_NS(events[i]) < t0){
+            t0 = GPIO_TRACE_T_NS(events[i]);
+        }
+    }
+
+    fprintf(out, "$timescale 1ns $end\n");
+    fprintf(out, "$scope module gpio $end\n");
+    for(gpio = 0; gpio < GPIO_MAX_NUMBER; gpio++){
+        if(traced[gpio]){
+            /* One character identifiers, two after the first VCD_ID_CHARS wires */
+            id[gpio][0] = VCD_ID_BASE + nwires % VCD_ID_CHARS;
+            id[gpio][1] = nwires < VCD_ID_CHARS ? '\0' : VCD_ID_BASE + nwires / VCD_ID_CHARS;
+            id[gpio][2] = '\0';
+            nwires++;
+            fprintf(out, "$var wire 1 %s gpio%u $end\n", id[gpio], gpio);
+        }
+    }
+    fprintf(out, "$upscope $end\n");
+    fprintf(out, "$enddefinitions $end\n");
+
+    fprintf(out, "$dumpvars\n");
+    for(gpio = 0; gpio < GPIO_MAX_NUMBER; gpio++){
+        if(traced[gpio]){
+            fprintf(out, "x%s\n", id[gpio]);
+        }
+    }
+    fprintf(out, "$end\n");
+
+    for(i = 0; i < n; i++){
+        /* Threads recording at once can store their events out of time order by a few ns */
+        t = GPIO_TRACE_T_NS(events[i]) - t0;
+        if(t_last != UINT64_MAX && t < t_last){
+            t = t_last;
+        }
+        if(t != t_last){
+            fprintf(out, "#%llu\n", (unsigned long long)t);
+            t_last = t;
+        }
+        fprintf(out, "%u%s\n", (unsigned)GPIO_TRACE_VALUE(events[i]), id[GPIO_TRACE_GPIO(events[i])]);
+    }
+}